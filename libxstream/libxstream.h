@@ -16,6 +16,7 @@
 typedef int libxstream_bool_t;
 typedef struct libxstream_stream_t libxstream_stream_t;
 typedef struct libxstream_event_t libxstream_event_t;
+typedef struct libxstream_graph_t libxstream_graph_t;
 
 /** initialization and finalization */
 typedef struct libxstream_init_config_t {
@@ -36,6 +37,13 @@ LIBXSTREAM_API int libxstream_finalize(void);
 /** devices */
 LIBXSTREAM_API int libxstream_device_count(int* ndevices);
 LIBXSTREAM_API int libxstream_device_set_active(int device_id);
+/**
+ * Bind the calling thread to the given device (negative: follow the active
+ * device again). Streams created, memory allocated, and kernels built by this
+ * thread target the bound device; a stream remembers its device, so it can be
+ * used from any thread afterwards.
+ */
+LIBXSTREAM_API int libxstream_device_bind(int device_id);
 LIBXSTREAM_API int libxstream_device_sync(void);
 
 /** streams */
@@ -53,6 +61,31 @@ LIBXSTREAM_API int libxstream_stream_wait_event(libxstream_stream_t* stream, lib
 /** Enable CL_QUEUE_PROFILING_ENABLE on stream (no-op if already set). */
 LIBXSTREAM_API int libxstream_stream_set_profiling(libxstream_stream_t* stream);
 
+/** Host function run by libxstream_stream_enqueue_host_fn. */
+typedef void (*libxstream_host_fn_t)(void* arg);
+/**
+ * Run fn(arg) on the host once all work enqueued on the stream before has
+ * completed; work enqueued after does not start before fn has returned. The
+ * function runs on a library-owned thread (not on a thread of the OpenCL
+ * runtime) and must not enqueue on or synchronize the same stream. Fails if
+ * no such thread can be started (LIBXSTREAM_HOSTFN=0, or Windows).
+ */
+LIBXSTREAM_API int libxstream_stream_enqueue_host_fn(libxstream_stream_t* stream, libxstream_host_fn_t fn, void* arg);
+
+/**
+ * Graphs: kernel launches (libxstream_opencl_launch), copies, and fills issued
+ * on a capturing stream are recorded rather than executed, and end_capture
+ * returns the recorded sequence. Kernel arguments are snapshotted at capture
+ * time, whereas host memory of a copy is accessed when the graph is launched.
+ * Events are not recorded, hence libxstream_event_record and
+ * libxstream_stream_wait_event fail on a capturing stream.
+ */
+LIBXSTREAM_API int libxstream_stream_begin_capture(libxstream_stream_t* stream);
+LIBXSTREAM_API int libxstream_stream_end_capture(libxstream_stream_t* stream, libxstream_graph_t** graph);
+/** Enqueue the recorded work onto the given stream (NULL: default stream). */
+LIBXSTREAM_API int libxstream_graph_launch(libxstream_graph_t* graph, libxstream_stream_t* stream);
+LIBXSTREAM_API int libxstream_graph_destroy(libxstream_graph_t* graph);
+
 /** events */
 LIBXSTREAM_API int libxstream_event_create(libxstream_event_t** event_p);
 LIBXSTREAM_API int libxstream_event_destroy(libxstream_event_t* event);
@@ -65,6 +98,49 @@ LIBXSTREAM_API int libxstream_mem_allocate(void** dev_mem, size_t nbytes);
 LIBXSTREAM_API int libxstream_mem_deallocate(void* dev_mem);
 LIBXSTREAM_API int libxstream_mem_offset(void** dev_mem, void* other, size_t lb);
 LIBXSTREAM_API int libxstream_mem_info(size_t* mem_free, size_t* mem_total);
+/**
+ * Device memory accounting: an allocation is attributed to the innermost tag
+ * pushed by the allocating thread (index 0: untagged), and tags are enumerated
+ * by index until the query fails. Live and peak are bytes requested by the
+ * caller (not what a pool keeps), and nallocs counts allocations ever made.
+ */
+typedef struct libxstream_mem_tag_info_t {
+  const char* name;
+  size_t live, peak, nallocs;
+} libxstream_mem_tag_info_t;
+LIBXSTREAM_API int libxstream_mem_tag_push(const char* tag);
+LIBXSTREAM_API int libxstream_mem_tag_pop(void);
+LIBXSTREAM_API int libxstream_mem_tag_info(int index, libxstream_mem_tag_info_t* info);
+/**
+ * Memory pressure: a reclaimer releases device memory it can rebuild (caches,
+ * arenas) and returns the bytes released, where nbytes is what is still wanted.
+ * An allocation that fails or exceeds the budget (LIBXSTREAM_MEMBUDGET) asks
+ * the reclaimers in ascending priority before it reports failure. A reclaimer
+ * runs on the allocating thread with no lock held, must not allocate device
+ * memory, and is unregistered outside of any reclaimer.
+ */
+typedef size_t (*libxstream_mem_reclaim_fn_t)(size_t nbytes, void* arg);
+LIBXSTREAM_API int libxstream_mem_reclaim_register(libxstream_mem_reclaim_fn_t fn, void* arg, int priority);
+LIBXSTREAM_API int libxstream_mem_reclaim_unregister(libxstream_mem_reclaim_fn_t fn, void* arg);
+/** Ask the reclaimers for nbytes ((size_t)-1: everything), returns the bytes released. */
+LIBXSTREAM_API size_t libxstream_mem_reclaim(size_t nbytes);
+/**
+ * Placement of shared memory (Intel USM shared allocations, SVM): pages are
+ * migrated ahead of their use rather than on first touch, i.e., by the stream
+ * and overlapping with prior work on it (NULL-stream: synchronous). DISCARD
+ * combines with a location if the content is about to be overwritten. Other
+ * kinds of memory are not migrated (no-op), and a capture does not record it.
+ */
+typedef enum libxstream_mem_advice_t {
+  LIBXSTREAM_MEM_ADVISE_DEVICE = 1,
+  LIBXSTREAM_MEM_ADVISE_HOST = 2,
+  LIBXSTREAM_MEM_ADVISE_DISCARD = 4
+} libxstream_mem_advice_t;
+LIBXSTREAM_API int libxstream_mem_advise(const void* mem, size_t nbytes, int advice,
+  libxstream_stream_t* LIBXS_ARGDEF(stream, NULL));
+/** Same as libxstream_mem_advise with LIBXSTREAM_MEM_ADVISE_DEVICE or _HOST. */
+LIBXSTREAM_API int libxstream_mem_prefetch(const void* mem, size_t nbytes, int to_device,
+  libxstream_stream_t* LIBXS_ARGDEF(stream, NULL));
 LIBXSTREAM_API int libxstream_mem_host_allocate(void** host_mem, size_t nbytes,
   libxstream_stream_t* LIBXS_ARGDEF(stream, NULL));
 LIBXSTREAM_API int libxstream_mem_host_deallocate(void* host_mem,
@@ -75,7 +151,55 @@ LIBXSTREAM_API int libxstream_mem_copy_d2h(const void* dev_mem, void* host_mem,
   libxstream_stream_t* LIBXS_ARGDEF(stream, NULL));
 LIBXSTREAM_API int libxstream_mem_copy_d2d(const void* devmem_src, void* devmem_dst, size_t nbytes,
   libxstream_stream_t* LIBXS_ARGDEF(stream, NULL));
+/**
+ * Copy between devices, where each stream stands for its device (a stream
+ * created by a thread bound to it, NULL: default stream of the calling thread),
+ * and work enqueued on the source stream before is complete when the source is
+ * read. A direct copy is enqueued on the destination stream (one device, or USM
+ * the destination can address); otherwise chunks are relayed through pinned
+ * host memory, reading one chunk while writing the previous, and the call
+ * returns once the copy completed.
+ */
+LIBXSTREAM_API int libxstream_mem_copy_p2p(const void* devmem_src, void* devmem_dst, size_t nbytes,
+  libxstream_stream_t* src_stream, libxstream_stream_t* LIBXS_ARGDEF(dst_stream, NULL));
 LIBXSTREAM_API int libxstream_mem_zero(void* dev_mem, size_t offset, size_t nbytes,
   libxstream_stream_t* LIBXS_ARGDEF(stream, NULL));
+/**
+ * Rectangular (2D/3D) copies like clEnqueue{Write,Read,Copy}BufferRect: origin
+ * and region are given as {bytes, rows, slices}, and a pitch of zero denotes a
+ * tightly packed layout (row pitch region[0], slice pitch region[1] * row pitch).
+ */
+LIBXSTREAM_API int libxstream_mem_copy_h2d_rect(const void* host_mem, void* dev_mem,
+  const size_t host_origin[3], const size_t dev_origin[3], const size_t region[3],
+  size_t host_row_pitch, size_t host_slice_pitch, size_t dev_row_pitch, size_t dev_slice_pitch,
+  libxstream_stream_t* LIBXS_ARGDEF(stream, NULL));
+LIBXSTREAM_API int libxstream_mem_copy_d2h_rect(const void* dev_mem, void* host_mem,
+  const size_t dev_origin[3], const size_t host_origin[3], const size_t region[3],
+  size_t dev_row_pitch, size_t dev_slice_pitch, size_t host_row_pitch, size_t host_slice_pitch,
+  libxstream_stream_t* LIBXS_ARGDEF(stream, NULL));
+LIBXSTREAM_API int libxstream_mem_copy_d2d_rect(const void* devmem_src, void* devmem_dst,
+  const size_t src_origin[3], const size_t dst_origin[3], const size_t region[3],
+  size_t src_row_pitch, size_t src_slice_pitch, size_t dst_row_pitch, size_t dst_slice_pitch,
+  libxstream_stream_t* LIBXS_ARGDEF(stream, NULL));
+/**
+ * Copy n host buffers to the device, where small items are packed into one
+ * pinned staging buffer, uploaded at once, and scattered on the device, and
+ * larger items are copied individually (crossover measured on first use).
+ */
+LIBXSTREAM_API int libxstream_mem_copy_h2d_batch(int n, const void* const host_mem[],
+  void* const dev_mem[], const size_t nbytes[],
+  libxstream_stream_t* LIBXS_ARGDEF(stream, NULL));
+/**
+ * Block gather into (scatter out of) a packed buffer in one kernel launch. The
+ * index holds count triplets {offset, packed offset, size} in units of typesize,
+ * where offset addresses the unpacked buffer. The index is device memory, i.e.,
+ * uploaded like the data (a capture does not record these calls).
+ */
+LIBXSTREAM_API int libxstream_mem_gather(const void* devmem_src, void* devmem_packed,
+  const size_t* dev_index, size_t count, size_t typesize,
+  libxstream_stream_t* LIBXS_ARGDEF(stream, NULL));
+LIBXSTREAM_API int libxstream_mem_scatter(const void* devmem_packed, void* devmem_dst,
+  const size_t* dev_index, size_t count, size_t typesize,
+  libxstream_stream_t* LIBXS_ARGDEF(stream, NULL));
 
 #endif /*LIBXSTREAM_H*/
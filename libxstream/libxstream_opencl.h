@@ -79,6 +79,42 @@ LIBXS_PRAGMA_DIAG_POP()
 #if !defined(LIBXSTREAM_MAXNKERNELS)
 # define LIBXSTREAM_MAXNKERNELS 32
 #endif
+/** Event handles cached per thread (libxstream_opencl_event_cache_t). */
+#if !defined(LIBXSTREAM_EVENT_NCACHE)
+# define LIBXSTREAM_EVENT_NCACHE 16
+#endif
+/** Host memory pools per NUMA node (LIBXSTREAM_NUMA); nodes beyond use pool_hst. */
+#if !defined(LIBXSTREAM_MAXNNODES)
+# define LIBXSTREAM_MAXNNODES 8
+#endif
+/** Memory tags (libxstream_mem_tag_push); further tags are accounted as untagged. */
+#if !defined(LIBXSTREAM_MAXNTAGS)
+# define LIBXSTREAM_MAXNTAGS 32
+#endif
+/** Nesting of memory tags per thread; deeper pushes keep the innermost tag that fits. */
+#if !defined(LIBXSTREAM_MEM_NTAGDEPTH)
+# define LIBXSTREAM_MEM_NTAGDEPTH 8
+#endif
+/** Chunk relayed through pinned host memory by libxstream_mem_copy_p2p (bytes). */
+#if !defined(LIBXSTREAM_MEM_P2PCHUNK)
+# define LIBXSTREAM_MEM_P2PCHUNK (4 << 20)
+#endif
+/** Alignment of the pieces carved from a scratch arena (libxstream_mem_arena_alloc). */
+#if !defined(LIBXSTREAM_MEM_ARENA_ALIGN)
+# define LIBXSTREAM_MEM_ARENA_ALIGN 4096
+#endif
+/** Claims after which an owned scratch arena is reconsidered for shrinking. */
+#if !defined(LIBXSTREAM_MEM_ARENA_WINDOW)
+# define LIBXSTREAM_MEM_ARENA_WINDOW 64
+#endif
+/** Reclaimers of device memory (libxstream_mem_reclaim_register). */
+#if !defined(LIBXSTREAM_MAXNRECLAIM)
+# define LIBXSTREAM_MAXNRECLAIM 16
+#endif
+/** Streams listed per thread (libxstream_opencl_stream_cache_t); more fall back to a scan. */
+#if !defined(LIBXSTREAM_STREAM_NCACHE)
+# define LIBXSTREAM_STREAM_NCACHE 32
+#endif
 /**
  * Accuracy target for profiled samples, expressed as a multiple of the device
  * timer granularity (CL_DEVICE_PROFILING_TIMER_RESOLUTION, queried per device
@@ -203,6 +239,22 @@ typedef struct libxstream_opencl_error_t {
 /** Information about streams (libxstream_stream_create). */
 typedef struct libxstream_stream_t {
   cl_command_queue queue;
+  /** Device the queue was created on (see libxstream_device_bind). */
+  struct libxstream_opencl_device_t* devinfo;
+  /** Graph being recorded (libxstream_stream_begin_capture), or NULL. */
+  struct libxstream_graph_t* capture;
+  /**
+   * Marker of the last libxstream_event_record as long as no command followed,
+   * i.e., recording again shares it rather than enqueuing another (or NULL).
+   */
+  cl_event marker;
+  /** Non-zero while the queue is known to be drained (libxstream_stream_sync). */
+  int idle;
+  /**
+   * Commands submitted (libxstream_opencl_stream_busy, under lock_event): a sync
+   * marks the stream idle only if no other thread submitted during its wait.
+   */
+  size_t nsubmit;
   int tid;
 #if defined(LIBXSTREAM_STREAM_PRIORITIES)
   int priority;
@@ -212,8 +264,68 @@ typedef struct libxstream_stream_t {
 /** Information about events (libxstream_event_create). */
 struct libxstream_event_t {
   cl_event cl_evt;
+  /** In-order queue the event was recorded on (waiting on this queue is implied), or NULL. */
+  cl_command_queue queue;
+  /** Recorded on an idle stream: complete without any cl_event. */
+  int done;
 };
 
+/**
+ * Per-thread cache of event handles: libxstream_event_create/destroy are called
+ * per operation by CP2K's offload layer, and recycling a handle on the thread
+ * that released it avoids lock_event and the shared pool.
+ */
+typedef struct libxstream_opencl_event_cache_t {
+  libxstream_event_t* slot[LIBXSTREAM_EVENT_NCACHE];
+  int n;
+} libxstream_opencl_event_cache_t;
+
+/**
+ * Per-thread default stream and stream list: a NULL stream is resolved per
+ * operation (libxstream_opencl_stream_default), which would otherwise scan all
+ * registered streams under lock_stream. The default stream is valid as long as
+ * the epoch (libxstream_opencl_config_t::stream_epoch) and the thread's device
+ * are unchanged, and it is only written by the owning thread. The list holds
+ * the streams of the thread-ID (libxstream_device_sync), maintained under
+ * lock_stream; n beyond LIBXSTREAM_STREAM_NCACHE marks an overflow (scan).
+ */
+typedef struct libxstream_opencl_stream_cache_t {
+  const struct libxstream_stream_t* stream;
+  const struct libxstream_opencl_device_t* devinfo;
+  cl_int epoch;
+  int n;
+  struct libxstream_stream_t* slot[LIBXSTREAM_STREAM_NCACHE];
+} libxstream_opencl_stream_cache_t;
+
+/**
+ * Device memory accounted per tag (libxstream_mem_tag_info_t), updated under
+ * lock_memtag. The name is copied, i.e., a tag may be pushed from a temporary.
+ */
+typedef struct libxstream_opencl_tag_t {
+  char name[LIBXSTREAM_MAXSTRLEN];
+  size_t live, peak, nallocs;
+} libxstream_opencl_tag_t;
+
+/** Live allocation (open addressing by pointer), remembered to credit its tag when freed. */
+typedef struct libxstream_opencl_tag_ptr_t {
+  const void* pointer;
+  size_t nbytes;
+  int tag;
+} libxstream_opencl_tag_ptr_t;
+
+/** Reclaimer of device memory, kept in ascending order of priority. */
+typedef struct libxstream_opencl_reclaim_t {
+  libxstream_mem_reclaim_fn_t fn;
+  void* arg;
+  int priority;
+} libxstream_opencl_reclaim_t;
+
+/** Tags pushed by a thread; n beyond LIBXSTREAM_MEM_NTAGDEPTH is counted but not stored. */
+typedef struct libxstream_opencl_tag_stack_t {
+  int tag[LIBXSTREAM_MEM_NTAGDEPTH];
+  int n;
+} libxstream_opencl_tag_stack_t;
+
 /** Settings updated during libxstream_device_set_active. */
 typedef struct libxstream_opencl_device_t {
   /** Activated device context. */
@@ -256,11 +368,25 @@ typedef struct libxstream_opencl_device_t {
   cl_uint uid;
   /** Main vendor? */
   cl_int intel, amd, nv;
+  /** NUMA node the device is attached to (sysfs), or negative if unknown. */
+  cl_int numa;
   /** Large GRF mode (opt-in via LIBXSTREAM_BIGGRF). */
   cl_int biggrf;
   /** Helper kernel used to recover device-side pointer representations. */
   cl_context memptr_context;
   cl_kernel memptr_kernel;
+  /** Block gather/scatter kernels (libxstream_mem_gather) per element width (1 to 16 bytes). */
+  cl_context pack_context;
+  cl_kernel pack_kernel[5];
+  /**
+   * Index into the devices-array (valid while context is non-NULL). Kept per
+   * devinfo rather than only per process (libxstream_opencl_config_t::device_id),
+   * because a thread bound to another device (libxstream_device_bind) owns a
+   * devinfo of its own and must not consult the process-wide index.
+   */
+  cl_int device_id;
+  /** Device memory pool of a bound devinfo (the active one uses pool_dev). */
+  libxs_malloc_pool_t* pool_dev;
   /* USM support functions */
   cl_int (*clSetKernelArgMemPointerINTEL)(cl_kernel, cl_uint, const void*);
   cl_int (*clEnqueueMemFillINTEL)(cl_command_queue, void*, const void*, size_t, size_t, cl_uint, const cl_event*, cl_event*);
@@ -269,6 +395,9 @@ typedef struct libxstream_opencl_device_t {
   void* (*clSharedMemAllocINTEL)(cl_context, cl_device_id, const /*cl_mem_properties_intel*/ void*, size_t, cl_uint, cl_int*);
   void* (*clHostMemAllocINTEL)(cl_context, const /*cl_mem_properties_intel*/ void*, size_t, cl_uint, cl_int*);
   cl_int (*clMemFreeINTEL)(cl_context, void*);
+  /* optional USM functions (libxstream_mem_advise) */
+  cl_int (*clEnqueueMigrateMemINTEL)(cl_command_queue, const void*, size_t, cl_mem_migration_flags, cl_uint, const cl_event*, cl_event*);
+  cl_int (*clGetMemAllocInfoINTEL)(cl_context, const void*, cl_uint /*cl_mem_info_intel*/, size_t, void*, size_t*);
 } libxstream_opencl_device_t;
 
 typedef enum libxstream_event_kind_t {
@@ -276,7 +405,8 @@ typedef enum libxstream_event_kind_t {
   libxstream_event_kind_h2d,
   libxstream_event_kind_d2h,
   libxstream_event_kind_d2d,
-  libxstream_event_kind_zero
+  libxstream_event_kind_zero,
+  libxstream_event_kind_p2p
 } libxstream_event_kind_t;
 
 /**
@@ -346,8 +476,22 @@ typedef struct libxstream_opencl_config_t {
   cl_device_id devices[LIBXSTREAM_MAXNDEVS];
   /** Active device (per process). */
   libxstream_opencl_device_t device;
-  /** Locks used by domain. */
-  libxs_lock_t *lock_main, *lock_stream, *lock_event, *lock_memory;
+  /**
+   * Devices bound by a thread (libxstream_device_bind) other than the active
+   * one, created on first use and kept until finalization. Each carries its own
+   * context, internal stream and device memory pool, so several threads of one
+   * process can drive several devices concurrently.
+   */
+  libxstream_opencl_device_t* devinfos[LIBXSTREAM_MAXNDEVS];
+  /**
+   * Per-thread binding (indexed by libxs_tid, nthreads entries; NULL if the
+   * thread follows the active device), and the number of bound threads. The
+   * count is what keeps lookups free of cost in a process that never binds.
+   */
+  libxstream_opencl_device_t** bound;
+  cl_int nbound;
+  /** Locks used by domain, and the lock of the memory accounting (a leaf, not aliased). */
+  libxs_lock_t *lock_main, *lock_stream, *lock_event, *lock_memory, *lock_memtag;
   /** All memptrs and related storage/counter. */
   libxstream_opencl_info_memptr_t **memptrs, *memptr_data;
   size_t nmemptrs; /* counter */
@@ -363,6 +507,19 @@ typedef struct libxstream_opencl_config_t {
   void* (*pool_hst_clHostMemAllocINTEL)(cl_context, const void*, size_t, cl_uint, cl_int*);
   cl_int (*pool_hst_clMemFreeINTEL)(cl_context, void*);
   cl_int pool_hst_usm;
+  /**
+   * Host memory pools per NUMA node (LIBXSTREAM_NUMA), node 0 being pool_hst.
+   * Each pool carries its node as xmalloc's extra argument (pool_hst_nodeid),
+   * i.e., a block is bound to and first touched on the node of its pool. The
+   * bytes obtained per node complement the pool statistics at finalization.
+   * Pools are indexed by node ID (/sys/devices/system/node/online), and an
+   * offline node below the highest online one has no pool (NULL). nnodes is
+   * one unless the host has several nodes and the policy is enabled.
+   */
+  libxs_malloc_pool_t* pool_hst_node[LIBXSTREAM_MAXNNODES];
+  int pool_hst_nodeid[LIBXSTREAM_MAXNNODES];
+  size_t pool_hst_nbytes[LIBXSTREAM_MAXNNODES];
+  cl_int nnodes, numa;
   /** Device memory pool (3-arg libxs_malloc, LIBXS_MALLOC_NATIVE). */
   libxs_malloc_pool_t* pool_dev;
   /**
@@ -388,13 +545,25 @@ typedef struct libxstream_opencl_config_t {
   /** All streams and related storage. */
   libxstream_opencl_stream_t **streams, *stream_data;
   /** All events and related storage. */
-  cl_event **events, *event_data;
+  libxstream_event_t **events, *event_data;
+  /** Per-thread caches of event handles (nthreads entries), or NULL. */
+  libxstream_opencl_event_cache_t* event_cache;
+  /** Per-thread default stream and streams (nthreads entries), or NULL. */
+  libxstream_opencl_stream_cache_t* stream_cache;
+  /** Incremented when a stream is created or destroyed (invalidates default streams). */
+  cl_int stream_epoch;
+  /** Markers not enqueued (shared or idle stream), and device-side waits found implied or complete. */
+  size_t nmarker_elided, nwait_elided;
   /** Device-ID to lookup devices-array. */
   cl_int device_id;
   /** Kernel-parameters are matched against device's UID */
   cl_uint devmatch;
   /** Split devices into sub-devices (if possible) */
   cl_int devsplit;
+  /** Rank-aware device assignment (bit 1: by rank and affinity, bit 2: split if ranks outnumber devices). */
+  cl_int rankmap;
+  /** Node-local rank and number of node-local ranks (launcher), negative/zero if unknown. */
+  cl_int lrank, nlocal;
   /** Verbosity level (output on stderr). */
   cl_int verbosity;
   /** Non-zero if library is initialized (negative: no device). */
@@ -417,7 +586,7 @@ typedef struct libxstream_opencl_config_t {
    */
   cl_int profile, profile_mem;
   /** Detailed/optional insight (LIBXSTREAM_PROFILE_MEM). */
-  libxs_hist_t *hist_h2d, *hist_d2h, *hist_d2d, *hist_zero;
+  libxs_hist_t *hist_h2d, *hist_d2h, *hist_d2d, *hist_zero, *hist_p2p;
   /**
    * Per-kernel histograms (LIBXSTREAM_PROFILE), keyed by the cl_kernel handle
    * observed at launch. The name is not supplied by the caller: it is read from
@@ -478,18 +647,119 @@ typedef struct libxstream_opencl_config_t {
   cl_int dump;
   /** WA level */
   cl_int wa;
+  /**
+   * Graph backend (LIBXSTREAM_GRAPH): 0 replays the recorded launches one by
+   * one, and non-zero prefers cl_khr_command_buffer where the device offers it.
+   */
+  cl_int graph;
+  /**
+   * Elide markers and waits (LIBXSTREAM_ELIDE): a record on a stream with no
+   * command since the previous record or since libxstream_stream_sync enqueues
+   * nothing, and a device-side wait on an event that is complete or that was
+   * recorded on the same in-order queue enqueues no barrier.
+   */
+  cl_int elide;
+  /** Workers running host functions (libxstream_stream_enqueue_host_fn), started on first use. */
+  struct libxstream_hostfn_pool_t* hostfn;
+  /** Number of such workers (LIBXSTREAM_HOSTFN); zero refuses host functions. */
+  cl_int nhostfn;
+  /**
+   * Largest item staged by libxstream_mem_copy_h2d_batch (LIBXSTREAM_BATCH, in
+   * bytes), negative until measured on first use (batch_calib claims it).
+   */
+  cl_int batch, batch_calib;
+  /**
+   * Device memory accounting (LIBXSTREAM_MEMTAG): tags with live and peak bytes
+   * (tag 0 is untagged), per-thread tag stacks (nthreads entries, or NULL), and
+   * the live allocations (capacity ntag_ptrs, power of two, grown on demand).
+   */
+  libxstream_opencl_tag_t tags[LIBXSTREAM_MAXNTAGS];
+  libxstream_opencl_tag_stack_t* tag_stack;
+  libxstream_opencl_tag_ptr_t* tag_ptrs;
+  size_t ntag_ptrs, ntag_live;
+  cl_int ntags, memtag;
+  /**
+   * Device memory budget in bytes (LIBXSTREAM_MEMBUDGET, zero: unlimited),
+   * compared against the live bytes of all tags (mem_live), and reclaimers
+   * asked under memory pressure (registered under lock_main). nreclaiming
+   * counts callers that run reclaimers (unregistering waits for them), and
+   * the remaining counters are reported at finalization.
+   */
+  size_t mem_budget, mem_live;
+  libxstream_opencl_reclaim_t reclaim[LIBXSTREAM_MAXNRECLAIM];
+  volatile int nreclaiming;
+  cl_int nreclaim;
+  size_t nreclaim_calls, nreclaim_bytes, nbudget_denied;
 } libxstream_opencl_config_t;
 
 LIBXSTREAM_API_INTERN void* libxstream_mem_hst_xmalloc(size_t, const void*);
 LIBXSTREAM_API_INTERN void libxstream_mem_hst_xfree(void*, const void*);
+/** Release the gather/scatter kernels of the given device. */
+LIBXSTREAM_API_INTERN void libxstream_mem_pack_release(libxstream_opencl_device_t* devinfo);
+/** Host pool serving the calling thread (LIBXSTREAM_NUMA), i.e., pool_hst or a per-node pool. */
+LIBXSTREAM_API_INTERN libxs_malloc_pool_t* libxstream_mem_hst_pool(void);
+/** Account device memory to the calling thread's tag, and credit it back (under lock_memtag). */
+LIBXSTREAM_API_INTERN void libxstream_mem_tag_alloc(const void* memory, size_t nbytes);
+LIBXSTREAM_API_INTERN void libxstream_mem_tag_free(const void* memory);
 LIBXSTREAM_API_INTERN void* libxstream_mem_dev_xmalloc(size_t, const void*);
 LIBXSTREAM_API_INTERN void libxstream_mem_dev_xfree(void*, const void*);
 
+/** Enqueue kernel (libxstream_opencl_launch_work); kernel_id identifies the profile entry. */
+LIBXSTREAM_API_INTERN int libxstream_opencl_enqueue_kernel(const libxstream_opencl_stream_t*, cl_kernel, cl_kernel,
+  cl_uint, const size_t*, const size_t*, const size_t*, cl_uint, const cl_event*, cl_event*, size_t, size_t);
+/** Record work into the graph of a capturing stream (libxstream_stream_begin_capture). */
+LIBXSTREAM_API_INTERN int libxstream_graph_record_kernel(struct libxstream_graph_t*, cl_kernel, cl_uint, const size_t*,
+  const size_t*, const size_t*, cl_uint, cl_event*, size_t, size_t);
+LIBXSTREAM_API_INTERN int libxstream_graph_record_copy(
+  struct libxstream_graph_t*, libxstream_event_kind_t, const void*, void*, size_t, size_t, int);
+
 /** Allocate device memory with explicit hint (bypasses pool). */
 LIBXSTREAM_API int libxstream_mem_dev_allocate_hint(void** dev_mem, size_t nbytes, libxstream_opencl_mem_hint_t hint);
 /** Deallocate device memory that was allocated with libxstream_mem_dev_allocate_hint. */
 LIBXSTREAM_API int libxstream_mem_dev_deallocate_hint(void* dev_mem);
 
+/**
+ * Device scratch arena: the transient buffers of one call are carved from a
+ * single allocation that outlives the call (bump allocation), instead of being
+ * allocated and released per call. A claim takes the arena for one call and
+ * makes sure it holds the bytes announced, and a release hands it back once the
+ * stream that used the pieces has completed them. A claim that cannot be served
+ * (busy, disabled, or beyond the limit) is not an error: the caller allocates
+ * per buffer instead. An owned arena is resized with hysteresis (it grows by at
+ * least half again, and shrinks only after a window of claims that all stayed
+ * below a quarter), whereas caller-owned memory (libxstream_mem_arena_set) is
+ * never resized or released here.
+ */
+typedef struct libxstream_mem_arena_t {
+  void* ptr; /* arena base, NULL until first use */
+  size_t size; /* capacity of ptr */
+  size_t used; /* bump offset, meaningful only while claimed */
+  size_t limit; /* upper bound for growth, 0 disables the arena */
+  size_t window; /* largest claim in the current window (shrink decision) */
+  size_t peak; /* largest claim over the life of the arena */
+  int nclaims; /* claims in the current window */
+  int ngrow, nshrink; /* reallocations */
+  int owned; /* 1: allocated here, grown on demand; 0: caller's memory */
+  libxstream_opencl_mem_hint_t hint;
+  volatile LIBXS_ATOMIC_LOCKTYPE busy;
+} libxstream_mem_arena_t;
+/** Initialize an (owned) arena with the given limit ((size_t)-1: unbounded, 0: disabled). */
+LIBXSTREAM_API void libxstream_mem_arena_init(libxstream_mem_arena_t* arena, size_t limit, libxstream_opencl_mem_hint_t hint);
+/** Release the memory of an owned arena (must not be claimed). */
+LIBXSTREAM_API void libxstream_mem_arena_destroy(libxstream_mem_arena_t* arena);
+/** Claim the arena for nbytes (LIBXSTREAM_MEM_ARENA_ALIGN per piece), returns non-zero if claimed. */
+LIBXSTREAM_API int libxstream_mem_arena_claim(libxstream_mem_arena_t* arena, size_t nbytes);
+/** Carve nbytes from a claimed arena, or return NULL if there is no room. */
+LIBXSTREAM_API void* libxstream_mem_arena_alloc(libxstream_mem_arena_t* arena, size_t nbytes);
+/** Hand the arena back after the stream completed the work using it (NULL: already synchronized). */
+LIBXSTREAM_API int libxstream_mem_arena_release(libxstream_mem_arena_t* arena, libxstream_stream_t* stream);
+/** Non-zero if ptr was carved from the arena. */
+LIBXSTREAM_API int libxstream_mem_arena_owns(const libxstream_mem_arena_t* arena, const void* ptr);
+/** Install caller-owned memory (NULL: revert to an owned arena), waits for a claim to be released. */
+LIBXSTREAM_API int libxstream_mem_arena_set(libxstream_mem_arena_t* arena, void* dev_mem, size_t nbytes);
+/** Release the memory of an owned arena unless it is claimed (reclaimer), returns the bytes released. */
+LIBXSTREAM_API size_t libxstream_mem_arena_trim(libxstream_mem_arena_t* arena);
+
 LIBXSTREAM_API int libxstream_stream_priority_range(int* least, int* greatest);
 
 /** Global configuration setup in libxstream_init. */
@@ -505,20 +775,48 @@ LIBXSTREAM_API int libxstream_opencl_use_cmem(const libxstream_opencl_device_t*
 LIBXSTREAM_API libxstream_opencl_info_memptr_t* libxstream_opencl_info_hostptr(const void* memory);
 /**
  * Determines device-pointer registration (for modification; internal). The offset is measured in elsize.
- * Returns NULL if memory is SVM/USM (offset is zero in this case).
+ * Returns NULL if memory is SVM/USM (offset is zero in this case). The device decides between both kinds,
+ * e.g., the stream's device (NULL: device of the calling thread).
  */
 LIBXSTREAM_API libxstream_opencl_info_memptr_t* libxstream_opencl_info_devptr_modify(
-  libxs_lock_t* lock, void* memory, size_t elsize, const size_t* amount, size_t* offset);
+  const libxstream_opencl_device_t* device, libxs_lock_t* lock, void* memory, size_t elsize, const size_t* amount, size_t* offset);
 /** Determines device-pointer registration for info/ro (lock-control); offset is measured in elsize. */
 LIBXSTREAM_API int libxstream_opencl_info_devptr_lock(libxstream_opencl_info_memptr_t* info, libxs_lock_t* lock, const void* memory,
   size_t elsize, const size_t* amount, size_t* offset);
 /** Determines device-pointer registration for info/ro; offset is measured in elsize. */
 LIBXSTREAM_API int libxstream_opencl_info_devptr(
   libxstream_opencl_info_memptr_t* info, const void* memory, size_t elsize, const size_t* amount, size_t* offset);
+/** Device of the calling thread: the bound one (libxstream_device_bind) or the active one. */
+LIBXSTREAM_API libxstream_opencl_device_t* libxstream_opencl_device(void);
+/** Like libxstream_opencl_device, but for the given thread-ID. */
+LIBXSTREAM_API libxstream_opencl_device_t* libxstream_opencl_device_thread(int thread_id);
+/**
+ * Device owning the given device memory, which need not be the device of the calling thread (e.g., a
+ * host function freeing what another thread allocated). Falls back to libxstream_opencl_device.
+ */
+LIBXSTREAM_API libxstream_opencl_device_t* libxstream_opencl_device_owner(const void* dev_mem);
+/**
+ * Node-local rank as published by the launcher (negative if unknown), and the number of ranks on
+ * the node (zero if unknown). A global rank (PMI_RANK, libxs_nrank) is not a local one.
+ */
+LIBXSTREAM_API int libxstream_opencl_local_rank(int* nlocal);
+/** Parse a CPU-list ("0-3,8,10-11") into a bitmap of nbits, and return the number of CPUs. */
+LIBXSTREAM_API int libxstream_opencl_cpulist(const char list[], unsigned char bitmap[], int nbits);
 /** Finds an existing stream for the given thread-ID (or NULL). */
 LIBXSTREAM_API const libxstream_opencl_stream_t* libxstream_opencl_stream(libxs_lock_t* lock, int thread_id);
-/** Determines default-stream (see libxstream_opencl_device_t::stream). */
+/** Determines default-stream (see libxstream_opencl_device_t::stream), cached per thread. */
 LIBXSTREAM_API const libxstream_opencl_stream_t* libxstream_opencl_stream_default(void);
+/** Like libxstream_opencl_stream_default, but the lock (or none) is only taken if not cached. */
+LIBXSTREAM_API const libxstream_opencl_stream_t* libxstream_opencl_stream_default_lock(libxs_lock_t* lock);
+/** Drain and join the host-function workers (libxstream_stream_enqueue_host_fn). */
+LIBXSTREAM_API_INTERN void libxstream_hostfn_finalize(void);
+/** Stream receives a command: forget its marker and idle state, and count the submission (libxstream_event_record). */
+LIBXSTREAM_API_INTERN void libxstream_opencl_stream_busy(const libxstream_opencl_stream_t* stream);
+/**
+ * Command just enqueued on the (in-order) stream: its event stands for all work so far, hence serves as the
+ * stream's marker (libxstream_event_record) if there is none, e.g., the event taken for a profile.
+ */
+LIBXSTREAM_API_INTERN void libxstream_opencl_stream_mark(const libxstream_opencl_stream_t* stream, cl_event event);
 /** Like libxstream_mem_zero, but supporting an arbitrary value used as initialization pattern. */
 LIBXSTREAM_API int libxstream_opencl_memset(void* dev_mem, int value, size_t offset, size_t nbytes, libxstream_stream_t* stream);
 /** Amount of device memory; local memory is only non-zero if separate from global. */
@@ -528,6 +826,8 @@ LIBXSTREAM_API int libxstream_opencl_info_devmem(
 LIBXSTREAM_API int libxstream_opencl_device_id(cl_device_id device, int* device_id, int* global_id);
 /** Confirm the vendor of the given device. */
 LIBXSTREAM_API int libxstream_opencl_device_vendor(cl_device_id device, const char vendor[], int use_platform_name);
+/** NUMA node of the given device (PCI location), or negative if unknown. */
+LIBXSTREAM_API int libxstream_opencl_device_numa(cl_device_id device, int* node);
 /** Capture or calculate UID based on the device-name. */
 LIBXSTREAM_API int libxstream_opencl_device_uid(cl_device_id device, const char devname[], unsigned int* uid);
 /** Based on the device-ID, return the device's UID (capture or calculate), device name, and platform name. */
@@ -544,6 +844,8 @@ LIBXSTREAM_API int libxstream_opencl_device_ext(cl_device_id device, const char*
 LIBXSTREAM_API int libxstream_opencl_create_context(cl_device_id device_id, cl_context* context);
 /** Internal variant of libxstream_device_set_active. */
 LIBXSTREAM_API int libxstream_opencl_set_active_device(libxs_lock_t* lock, int device_id);
+/** Create context, internal stream, and device-specific information for the given devinfo. */
+LIBXSTREAM_API int libxstream_opencl_device_activate(libxs_lock_t* lock, libxstream_opencl_device_t* devinfo, int device_id);
 /** Assemble flags to support atomic operations. */
 LIBXSTREAM_API int libxstream_opencl_flags_atomics(const libxstream_opencl_device_t* devinfo, libxstream_opencl_atomic_fp_t kind,
   const char* exts[], size_t* exts_maxlen, char flags[], size_t flags_maxlen);
@@ -598,6 +900,12 @@ LIBXSTREAM_API int libxstream_opencl_kernel_query(cl_program program, const char
 LIBXSTREAM_API int libxstream_opencl_kernel(size_t source_kind, const char source[], const char kernel_name[],
   const char build_params[], const char build_options[], const char try_build_options[], int* try_ok, const char* const extnames[],
   size_t num_exts, cl_kernel* kernel);
+/** Like libxstream_mem_copy_h2d_batch, but staging items up to the given size (in bytes). */
+LIBXSTREAM_API int libxstream_opencl_mem_copy_h2d_batch(int n, const void* const host_mem[], void* const dev_mem[],
+  const size_t nbytes[], size_t crossover, libxstream_stream_t* stream);
+/** Like libxstream_mem_copy_p2p, but relaying chunks of the given size (zero: direct path if possible). */
+LIBXSTREAM_API int libxstream_opencl_mem_copy_p2p(const void* devmem_src, void* devmem_dst, size_t nbytes,
+  libxstream_stream_t* src_stream, libxstream_stream_t* dst_stream, size_t chunk);
 /** Per-thread variant of libxstream_device_sync. */
 LIBXSTREAM_API int libxstream_opencl_device_synchronize(libxs_lock_t* lock, int thread_id);
 /** To support USM, call this function for pointer arguments instead of clSetKernelArg. */
@@ -30,6 +30,8 @@
 #include "../src/libxstream_cp2k.c"
 #include "../src/libxstream_dbcsr.c"
 #include "../src/libxstream_event.c"
+#include "../src/libxstream_graph.c"
+#include "../src/libxstream_hostfn.c"
 #include "../src/libxstream_mem.c"
 #include "../src/libxstream_stream.c"
 
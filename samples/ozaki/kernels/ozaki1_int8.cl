@@ -435,7 +435,7 @@ preprocess_a_dense(CONSTANT const real_t* restrict a_base, int a_index, int M, i
   global real_t* restrict expa_base, /* [M] per-row FP scale factor = 2^max_exp */ int expa_index,
   int K_pad, /* padded K stride (>= 64) */
   int M_pad, /* padded M = nblk_m * BM_PRE */
-  global int* restrict occ_base, /* [NSLICES] per-slice nonzero flag (or NULL) */ int occ_index)
+  global int* restrict occ_base, /* [NSLICES+1] per-slice nonzero flag, exponent span (or NULL) */ int occ_index)
 {
   CONSTANT const real_t* restrict a = a_base + a_index;
   global char* restrict as = as_base + as_index;
@@ -448,8 +448,16 @@ preprocess_a_dense(CONSTANT const real_t* restrict a_base, int a_index, int M, i
 
   local int row_max_exp[BM_PRE];
   local int occ_local[NSLICES];
+#if defined(OZAKI_SPAN) && (0 < OZAKI_SPAN)
+  local int row_min_exp[BM_PRE];
+  local int span_local;
+#endif
   if (0 == kk) row_max_exp[mi] = 0;
   if (0 == kk && mi < NSLICES) occ_local[mi] = 0;
+#if defined(OZAKI_SPAN) && (0 < OZAKI_SPAN)
+  if (0 == kk) row_min_exp[mi] = 2 * BIAS_PLUS_MANT; /* above any biased exponent */
+  if (0 == kk && 0 == mi) span_local = 0;
+#endif
   barrier(CLK_LOCAL_MEM_FENCE);
 
   /* Pass 1: find max exponent across ALL of K for this row */
@@ -460,10 +468,20 @@ preprocess_a_dense(CONSTANT const real_t* restrict a_base, int a_index, int M, i
       uint_repr_t m0;
       const int idx = OZAKI_IDX_A(row, col, lda);
       ieee_decompose(a[idx], &s0, &e0, &m0);
-      if (e0 > 0) atomic_max(&row_max_exp[mi], (int)e0);
+      if (e0 > 0) {
+        atomic_max(&row_max_exp[mi], (int)e0);
+#if defined(OZAKI_SPAN) && (0 < OZAKI_SPAN)
+        atomic_min(&row_min_exp[mi], (int)e0);
+#endif
+      }
     }
   }
   barrier(CLK_LOCAL_MEM_FENCE);
+#if defined(OZAKI_SPAN) && (0 < OZAKI_SPAN)
+  if (0 == kk && row < M && row_min_exp[mi] <= row_max_exp[mi]) {
+    atomic_max(&span_local, row_max_exp[mi] - row_min_exp[mi]);
+  }
+#endif
 
   /**
    * Write global max exponent as FP scale: 2^(max_exp - BIAS).
@@ -499,6 +517,11 @@ preprocess_a_dense(CONSTANT const real_t* restrict a_base, int a_index, int M, i
   if (0 == kk && mi < NSLICES && 0 != occ_local[mi]) {
     atomic_or(&slice_occ[mi], 1);
   }
+#if defined(OZAKI_SPAN) && (0 < OZAKI_SPAN)
+  if (0 == kk && 0 == mi && 0 != span_local) {
+    atomic_max(&slice_occ[NSLICES], span_local);
+  }
+#endif
 }
 
 
@@ -525,7 +548,7 @@ preprocess_b_dense(CONSTANT const real_t* restrict b_base, int b_index, int N, i
   global char* restrict bs_base, /* [NSLICES * K_pad * N_pad] */ long bs_index,
   global real_t* restrict expb_base, /* [N] per-column FP scale factor = 2^max_exp */ int expb_index,
   int K_pad, int N_pad,
-  global int* restrict occ_base, /* [NSLICES] per-slice nonzero flag */ int occ_index)
+  global int* restrict occ_base, /* [NSLICES+1] per-slice nonzero flag, exponent span */ int occ_index)
 {
   CONSTANT const real_t* restrict b = b_base + b_index;
   global char* restrict bs = bs_base + bs_index;
@@ -538,8 +561,16 @@ preprocess_b_dense(CONSTANT const real_t* restrict b_base, int b_index, int N, i
 
   local int col_max_exp[BN_PRE];
   local int occ_local[NSLICES];
+#if defined(OZAKI_SPAN) && (0 < OZAKI_SPAN)
+  local int col_min_exp[BN_PRE];
+  local int span_local;
+#endif
   if (0 == kk) col_max_exp[nj] = 0;
   if (0 == kk && nj < NSLICES) occ_local[nj] = 0;
+#if defined(OZAKI_SPAN) && (0 < OZAKI_SPAN)
+  if (0 == kk) col_min_exp[nj] = 2 * BIAS_PLUS_MANT; /* above any biased exponent */
+  if (0 == kk && 0 == nj) span_local = 0;
+#endif
   barrier(CLK_LOCAL_MEM_FENCE);
 
   /* Pass 1: find max exponent across ALL of K for this column */
@@ -550,10 +581,20 @@ preprocess_b_dense(CONSTANT const real_t* restrict b_base, int b_index, int N, i
       uint_repr_t m0;
       const int idx = OZAKI_IDX_B(row, col, ldb);
       ieee_decompose(b[idx], &s0, &e0, &m0);
-      if (e0 > 0) atomic_max(&col_max_exp[nj], (int)e0);
+      if (e0 > 0) {
+        atomic_max(&col_max_exp[nj], (int)e0);
+#if defined(OZAKI_SPAN) && (0 < OZAKI_SPAN)
+        atomic_min(&col_min_exp[nj], (int)e0);
+#endif
+      }
     }
   }
   barrier(CLK_LOCAL_MEM_FENCE);
+#if defined(OZAKI_SPAN) && (0 < OZAKI_SPAN)
+  if (0 == kk && col < N && col_min_exp[nj] <= col_max_exp[nj]) {
+    atomic_max(&span_local, col_max_exp[nj] - col_min_exp[nj]);
+  }
+#endif
 
   /* Write global max exponent as FP scale: 2^(max_exp - BIAS). */
   if (0 == kk && col < N) {
@@ -586,6 +627,11 @@ preprocess_b_dense(CONSTANT const real_t* restrict b_base, int b_index, int N, i
   if (0 == kk && nj < NSLICES && 0 != occ_local[nj]) {
     atomic_or(&slice_occ[nj], 1);
   }
+#if defined(OZAKI_SPAN) && (0 < OZAKI_SPAN)
+  if (0 == kk && 0 == nj && 0 != span_local) {
+    atomic_max(&slice_occ[NSLICES], span_local);
+  }
+#endif
 }
 
 
@@ -48,6 +48,7 @@ LIBXS_EXTERN void SGEMM(const char* transa, const char* transb, const int* m, co
 /* Function prototypes */
 static void print_diff(FILE* ostream, const char* label, const libxs_matdiff_t* diff);
 static double ozaki_duration(double* times, int nrepeat, double total);
+static int ozaki_bench_init(ozaki_context_t* ctx);
 #if defined(__CUBLAS)
 static void cublas_putenv(int use_double, int nslices);
 static const char* cublas_mode(int use_double);
@@ -83,6 +84,7 @@ int main(int argc, char* argv[])
   libxstream_stream_t* stream = NULL;
   libxs_matdiff_t diff;
   libxs_timer_tick_t t0, t1;
+  double duration_oz = 0;
   /* Per-call durations, one buffer for every timed loop; see ozaki_duration. */
   double* const times = (double*)malloc((size_t)nrepeat * sizeof(double));
   size_t elem_size = 0;
@@ -123,27 +125,7 @@ int main(int argc, char* argv[])
 
   /* Initialize Ozaki context (kernels) */
   if (EXIT_SUCCESS == result) {
-    const char* env;
-    int ozflags = -1 /*auto*/, oztrim = 0, ndecomp = 0 /*auto*/;
-    int ozgroups = 0, kind = 0 /*auto: ozaki_init decides*/, verbosity = 0;
-    /* tm/tn stay 0: ozaki_init reads OZAKI_TM/OZAKI_TN and selects per call. */
-    const int tm = 0, tn = 0;
-    int use_double = 1;
-    env = getenv("OZAKI_FLAGS");
-    if (NULL != env) ozflags = atoi(env);
-    env = getenv("OZAKI_TRIM");
-    if (NULL != env) oztrim = atoi(env);
-    env = getenv("OZAKI_N");
-    if (NULL != env) ndecomp = atoi(env);
-    env = getenv("OZAKI");
-    if (NULL != env) kind = atoi(env);
-    env = getenv("OZAKI_GROUPS");
-    if (NULL != env) ozgroups = atoi(env);
-    env = getenv("OZAKI_VERBOSE");
-    if (NULL != env) verbosity = atoi(env);
-    env = getenv("OZAKI_FP");
-    if (NULL != env) use_double = (32 != atoi(env));
-    result = ozaki_init(&ctx, tm, tn, use_double, kind, verbosity, ndecomp, ozflags, oztrim, ozgroups, 0 /*maxk: no grouping*/);
+    result = ozaki_bench_init(&ctx);
     if (EXIT_SUCCESS != result) {
       fprintf(stderr, "Failed to initialize Ozaki OpenCL context\n");
     }
@@ -245,10 +227,138 @@ int main(int argc, char* argv[])
         printf(" [%i calls %.3f-%.3f ms]", nrepeat, 1E3 * times[0], 1E3 * times[nrepeat-1]);
       }
       printf("\n");
+      duration_oz = duration;
     }
     else fprintf(stderr, "Ozaki GEMM failed (%s)\n", libxstream_opencl_strerror(result));
   }
 
+  /**
+   * Accuracy-bounded cutoff (OZAKI_ACC): the same calls once more with the bound
+   * lifted, so the gain of the smaller kernel specialization is reported next to
+   * the figure above rather than left to a second run. The cached planes are
+   * dropped before and after, because the cutoff remembered with them was taken
+   * under the respective setting.
+   */
+  if (EXIT_SUCCESS == result && 0 < ctx.acc_bits) {
+    const int acc_bits = ctx.acc_bits;
+    int i;
+    ctx.acc_bits = 0;
+    ozaki_invalidate_cache(&ctx, a, b);
+    result = ozaki_gemm(&ctx, stream, transa, transb, M, N, K, alpha, a, lda, b, ldb, beta, c_oz, ldc, 0);
+    if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+    t0 = libxs_timer_tick();
+    for (i = 0; i < nrepeat && EXIT_SUCCESS == result; ++i) {
+      const libxs_timer_tick_t tick = libxs_timer_tick();
+      result = ozaki_gemm(&ctx, stream, transa, transb, M, N, K, alpha, a, lda, b, ldb, beta, c_oz, ldc, 0);
+      if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+      if (NULL != times) times[i] = libxs_timer_duration(tick, libxs_timer_tick());
+    }
+    t1 = libxs_timer_tick();
+    if (EXIT_SUCCESS == result) {
+      const double duration = ozaki_duration(times, nrepeat, libxs_timer_duration(t0, t1));
+      printf("Ozaki GEMM (full cutoff): %.3f ms", 1E3 * duration);
+      if (0 < duration_oz) printf(" -> %.2fx with %d-bit target", duration / duration_oz, acc_bits);
+      printf("\n");
+    }
+    else fprintf(stderr, "Ozaki GEMM (full cutoff) failed (%s)\n", libxstream_opencl_strerror(result));
+    ctx.acc_bits = acc_bits;
+    ozaki_invalidate_cache(&ctx, a, b);
+  }
+
+  /**
+   * Device-resident operands (OZAKI_PREPARED=1): A, B and C are uploaded once
+   * and multiplied through prepared handles, so the timed calls show what is
+   * left once transfers and operand preprocessing are amortized. The first call
+   * builds the planes and stays untimed. C accumulates across calls, which is
+   * harmless for a timing; accuracy is checked on the host path only.
+   */
+  if (EXIT_SUCCESS == result && NULL != getenv("OZAKI_PREPARED") && 0 != atoi(getenv("OZAKI_PREPARED"))) {
+    const size_t size_a = (size_t)lda * (0 == ta ? K : M) * elem_size;
+    const size_t size_b = (size_t)ldb * (0 == tb ? N : K) * elem_size;
+    const size_t size_c = (size_t)ldc * N * elem_size;
+    ozaki_prepared_t *pa = NULL, *pb = NULL;
+    void *da = NULL, *db = NULL, *dc = NULL;
+    int r = libxstream_mem_allocate(&da, size_a), i;
+    if (EXIT_SUCCESS == r) r = libxstream_mem_allocate(&db, size_b);
+    if (EXIT_SUCCESS == r) r = libxstream_mem_allocate(&dc, size_c);
+    if (EXIT_SUCCESS == r) r = libxstream_mem_copy_h2d(a, da, size_a, stream);
+    if (EXIT_SUCCESS == r) r = libxstream_mem_copy_h2d(b, db, size_b, stream);
+    if (EXIT_SUCCESS == r) r = libxstream_mem_copy_h2d(c_ref, dc, size_c, stream);
+    if (EXIT_SUCCESS == r) r = ozaki_prepare_a(&ctx, transa, M, K, da, lda, &pa);
+    if (EXIT_SUCCESS == r) r = ozaki_prepare_b(&ctx, transb, N, K, db, ldb, &pb);
+    if (EXIT_SUCCESS == r) r = ozaki_gemm_prepared(&ctx, stream, alpha, pa, pb, beta, dc, ldc);
+    if (EXIT_SUCCESS == r) r = libxstream_stream_sync(stream);
+    t0 = libxs_timer_tick();
+    for (i = 0; i < nrepeat && EXIT_SUCCESS == r; ++i) {
+      const libxs_timer_tick_t tick = libxs_timer_tick();
+      r = ozaki_gemm_prepared(&ctx, stream, alpha, pa, pb, beta, dc, ldc);
+      if (EXIT_SUCCESS == r) r = libxstream_stream_sync(stream);
+      if (NULL != times) times[i] = libxs_timer_duration(tick, libxs_timer_tick());
+    }
+    t1 = libxs_timer_tick();
+    if (EXIT_SUCCESS == r) {
+      printf("Ozaki GEMM (prepared): %.3f ms\n", 1E3 * ozaki_duration(times, nrepeat, libxs_timer_duration(t0, t1)));
+    }
+    else fprintf(stderr, "Ozaki GEMM (prepared) failed (%s)\n", libxstream_opencl_strerror(r));
+    ozaki_prepared_release(pa);
+    ozaki_prepared_release(pb);
+    if (NULL != da) libxstream_mem_deallocate(da);
+    if (NULL != db) libxstream_mem_deallocate(db);
+    if (NULL != dc) libxstream_mem_deallocate(dc);
+  }
+
+  /**
+   * Tiled GEMM over several contexts (OZAKI_TILED=n): timed once with one
+   * context and once with n, so the ratio is the scaling of the scheduler. The
+   * extra contexts are initialized like the main one. C is overwritten and
+   * restored from c_ref, as for the host path.
+   */
+  if (EXIT_SUCCESS == result && NULL != getenv("OZAKI_TILED") && 0 < atoi(getenv("OZAKI_TILED"))) {
+    const int nctxs = LIBXS_MIN(atoi(getenv("OZAKI_TILED")), 64);
+    ozaki_context_t** const ctxs = (ozaki_context_t**)calloc((size_t)nctxs, sizeof(ozaki_context_t*));
+    double duration_1 = 0;
+    int r = (NULL != ctxs) ? EXIT_SUCCESS : EXIT_FAILURE, ndevices = 1, ninit = 1, n, i;
+    if (EXIT_SUCCESS == r) ctxs[0] = &ctx;
+    libxstream_device_count(&ndevices);
+    for (n = 1; n < nctxs && EXIT_SUCCESS == r; ++n) { /* round-robin over the devices */
+      ctxs[n] = (ozaki_context_t*)calloc(1, sizeof(ozaki_context_t));
+      r = (NULL != ctxs[n]) ? libxstream_device_bind(n % LIBXS_MAX(ndevices, 1)) : EXIT_FAILURE;
+      if (EXIT_SUCCESS == r) r = ozaki_bench_init(ctxs[n]);
+      if (EXIT_SUCCESS == r) ninit = n + 1; /* contexts [1, ninit) are initialized */
+      libxstream_device_bind(-1);
+    }
+    for (n = 1; n <= nctxs && EXIT_SUCCESS == r; n = (n < nctxs ? nctxs : n + 1)) {
+      r = ozaki_gemm_tiled(ctxs, n, transa, transb, M, N, K, alpha, a, lda, b, ldb, beta, c_oz, ldc); /* warmup */
+      t0 = libxs_timer_tick();
+      for (i = 0; i < nrepeat && EXIT_SUCCESS == r; ++i) {
+        const libxs_timer_tick_t tick = libxs_timer_tick();
+        r = ozaki_gemm_tiled(ctxs, n, transa, transb, M, N, K, alpha, a, lda, b, ldb, beta, c_oz, ldc);
+        if (NULL != times) times[i] = libxs_timer_duration(tick, libxs_timer_tick());
+      }
+      t1 = libxs_timer_tick();
+      if (EXIT_SUCCESS == r) {
+        const double duration = ozaki_duration(times, nrepeat, libxs_timer_duration(t0, t1));
+        printf("Ozaki GEMM (tiled x%d): %.3f ms", n, 1E3 * duration);
+        if (1 == n) duration_1 = duration;
+        else if (0 < duration) printf(" -> %.2fx", duration_1 / duration);
+        printf("\n");
+      }
+      else fprintf(stderr, "Ozaki GEMM (tiled x%d) failed (%s)\n", n, libxstream_opencl_strerror(r));
+    }
+    if (NULL != ctxs) {
+      for (n = 1; n < nctxs; ++n) {
+        if (n < ninit) { /* failed or missing contexts were never initialized */
+          libxstream_device_bind(ctxs[n]->device_id);
+          ozaki_destroy(ctxs[n]);
+          libxstream_device_bind(-1);
+        }
+        free(ctxs[n]);
+      }
+      free(ctxs);
+    }
+    memcpy(c_oz, c_ref, (size_t)ldc * N * elem_size);
+  }
+
   /* Reference BLAS GEMM */
   if (EXIT_SUCCESS == result) {
     int i;
@@ -354,6 +464,36 @@ int main(int argc, char* argv[])
 }
 
 
+/**
+ * Initialize a context from the environment. Shared by the main context and the
+ * extra ones of OZAKI_TILED, so that all of them are configured alike.
+ */
+static int ozaki_bench_init(ozaki_context_t* ctx)
+{
+  const char* env;
+  int ozflags = -1 /*auto*/, oztrim = 0, ndecomp = 0 /*auto*/;
+  int ozgroups = 0, kind = 0 /*auto: ozaki_init decides*/, verbosity = 0;
+  /* tm/tn stay 0: ozaki_init reads OZAKI_TM/OZAKI_TN and selects per call. */
+  const int tm = 0, tn = 0;
+  int use_double = 1;
+  env = getenv("OZAKI_FLAGS");
+  if (NULL != env) ozflags = atoi(env);
+  env = getenv("OZAKI_TRIM");
+  if (NULL != env) oztrim = atoi(env);
+  env = getenv("OZAKI_N");
+  if (NULL != env) ndecomp = atoi(env);
+  env = getenv("OZAKI");
+  if (NULL != env) kind = atoi(env);
+  env = getenv("OZAKI_GROUPS");
+  if (NULL != env) ozgroups = atoi(env);
+  env = getenv("OZAKI_VERBOSE");
+  if (NULL != env) verbosity = atoi(env);
+  env = getenv("OZAKI_FP");
+  if (NULL != env) use_double = (32 != atoi(env));
+  return ozaki_init(ctx, tm, tn, use_double, kind, verbosity, ndecomp, ozflags, oztrim, ozgroups, 0 /*maxk: no grouping*/);
+}
+
+
 static void print_diff(FILE* ostream, const char* label, const libxs_matdiff_t* diff)
 {
   const double epsilon = libxs_matdiff_epsilon(diff);
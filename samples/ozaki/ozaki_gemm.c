@@ -17,12 +17,13 @@
  * Local helper functions (static) to manage kernel argument setup and launches.
  * These were kept local to avoid adding new translation units for the sample.
  */
-static void ozaki_cache_check(ozaki_context_t* ctx, const void* a, const void* b, int M, int N, int K, int lda, int ldb, int ta,
-  int tb, size_t as_size, size_t bs_size, size_t expa_size, size_t expb_size, void** d_as, void** d_bs, void** d_expa_g,
-  void** d_expb_g, int* cache_hit_a, int* cache_hit_b);
-static void ozaki_cache_update(ozaki_context_t* ctx, int result, const void* a, const void* b, int M, int N, int K, int lda,
-  int ldb, int ta, int tb, size_t as_size, size_t bs_size, size_t expa_size, size_t expb_size, void* d_as, void* d_bs,
-  void* d_expa_g, void* d_expb_g, int prev_owned, int* cache_hit_a, int* cache_hit_b);
+static void ozaki_cache_check(ozaki_context_t* ctx, ozaki_prepared_t* pa, ozaki_prepared_t* pb, int dev, const void* a,
+  const void* b, int M, int N, int K, int lda, int ldb, int ta, int tb, size_t as_size, size_t bs_size, size_t expa_size,
+  size_t expb_size, void** d_as, void** d_bs, void** d_expa_g, void** d_expb_g, int* cache_hit_a, int* cache_hit_b);
+static void ozaki_cache_update(ozaki_context_t* ctx, ozaki_prepared_t* pa, ozaki_prepared_t* pb, int dev, int result,
+  const void* a, const void* b, int M, int N, int K, int lda, int ldb, int ta, int tb, size_t as_size, size_t bs_size,
+  size_t expa_size, size_t expb_size, void* d_as, void* d_bs, void* d_expa_g, void* d_expb_g, int occ_a, int occ_b, int span_a,
+  int span_b, int prev_owned, int* cache_hit_a, int* cache_hit_b);
 static int ozaki_set_ptr_base(cl_kernel kern, cl_int* i, const void* ptr, size_t elsize, int wide);
 static int ozaki_enqueue_preprocess(ozaki_context_t* ctx, libxstream_stream_t* stream, cl_kernel kern, void* d_src, void* d_slices,
   void* d_exp, size_t expsize, int M, int K, int ld, int trans, int k_pad, int pad, int bm_pre, int bk_pre, void* d_occ,
@@ -364,52 +365,30 @@ static const ozaki_crt_kernel_set_t* ozaki_get_crt_kernel(ozaki_context_t* ctx,
 
 /**
  * Device scratch arena (see ozaki_scratch_t). Sub-allocations are aligned well
- * past what the kernels need, because the arena's whole purpose is to be handed
- * out in a few large pieces: the residue planes are read as 16-byte vectors and
- * the operand planes as uint4, so anything coarser than 16 is free, and a page
- * keeps a piece from sharing a cache line with its neighbour.
+ * past what the kernels need (LIBXSTREAM_MEM_ARENA_ALIGN), because the arena's
+ * whole purpose is to be handed out in a few large pieces: the residue planes
+ * are read as 16-byte vectors and the operand planes as uint4, so anything
+ * coarser than 16 is free, and a page keeps a piece from sharing a cache line
+ * with its neighbour.
  */
-#define OZAKI_SCRATCH_ALIGN 4096
-
-static int ozaki_scratch_owns(const ozaki_context_t* ctx, const void* ptr)
-{
-  return (NULL != ctx->scratch.ptr && NULL != ptr && (const char*)ptr >= (const char*)ctx->scratch.ptr &&
-          (const char*)ptr < ((const char*)ctx->scratch.ptr + ctx->scratch.size));
-}
-
+#define OZAKI_SCRATCH_ALIGN LIBXSTREAM_MEM_ARENA_ALIGN
 
 /**
- * Take the arena for one call and, if it is ours, make sure it holds nbytes
- * before anything is carved from it. Growth happens here and nowhere else: a
- * reallocation part-way through a call would dangle the pieces already handed
- * out. Returns 0 when the arena is unavailable (busy, disabled, or too small to
- * grow into), which is not an error - the call then allocates per buffer.
+ * Take the arena for one call (see libxstream_mem_arena_claim). Returns 0 when
+ * the arena is unavailable (busy, disabled, or too small to grow into), which
+ * is not an error - the call then allocates per buffer.
  */
 static int ozaki_scratch_claim(ozaki_context_t* ctx, size_t nbytes)
 {
-  int result = 0;
-  if (0 != ctx->scratch.limit && 0 != LIBXS_ATOMIC_TRYLOCK(&ctx->scratch.busy, LIBXS_ATOMIC_LOCKORDER)) {
-    ctx->scratch.used = 0;
-    if (0 != ctx->scratch.owned && ctx->scratch.size < nbytes && nbytes <= ctx->scratch.limit) {
-      void* ptr = NULL;
-      if (EXIT_SUCCESS == libxstream_mem_dev_allocate_hint(&ptr, nbytes, libxstream_opencl_mem_hint_atomics)) {
-        if (NULL != ctx->scratch.ptr) libxstream_mem_dev_deallocate_hint(ctx->scratch.ptr);
-        ctx->scratch.ptr = ptr;
-        ctx->scratch.size = nbytes;
-      }
-    }
-    if (NULL != ctx->scratch.ptr) result = 1;
-    else LIBXS_ATOMIC_RELEASE(&ctx->scratch.busy, LIBXS_ATOMIC_LOCKORDER);
-  }
-  return result;
+  return libxstream_mem_arena_claim(&ctx->scratch, nbytes);
 }
 
 
+/** Only ever follows the synchronization of every stream that used the pieces. */
 static void ozaki_scratch_release(ozaki_context_t* ctx, int claimed)
 {
   if (0 != claimed) {
-    ctx->scratch.used = 0;
-    LIBXS_ATOMIC_RELEASE(&ctx->scratch.busy, LIBXS_ATOMIC_LOCKORDER);
+    LIBXS_ELIDE_RESULT(int, libxstream_mem_arena_release(&ctx->scratch, NULL /*synchronized*/));
   }
 }
 
@@ -422,24 +401,21 @@ static void ozaki_scratch_release(ozaki_context_t* ctx, int claimed)
  */
 static int ozaki_scratch_alloc(ozaki_context_t* ctx, int claimed, void** ptr, size_t nbytes, int atomics)
 {
-  const size_t need = LIBXS_UP2(nbytes, OZAKI_SCRATCH_ALIGN);
-  int result;
-  if (0 != claimed && need <= (ctx->scratch.size - ctx->scratch.used)) {
-    *ptr = (char*)ctx->scratch.ptr + ctx->scratch.used;
-    ctx->scratch.used += need;
-    result = EXIT_SUCCESS;
-  }
-  else if (0 != atomics) {
-    result = libxstream_mem_dev_allocate_hint(ptr, nbytes, libxstream_opencl_mem_hint_atomics);
+  int result = EXIT_SUCCESS;
+  *ptr = (0 != claimed ? libxstream_mem_arena_alloc(&ctx->scratch, nbytes) : NULL);
+  if (NULL == *ptr) {
+    if (0 != atomics) {
+      result = libxstream_mem_dev_allocate_hint(ptr, nbytes, libxstream_opencl_mem_hint_atomics);
+    }
+    else result = OZAKI_DEV_ALLOC(ptr, nbytes);
   }
-  else result = OZAKI_DEV_ALLOC(ptr, nbytes);
   return result;
 }
 
 
 static void ozaki_scratch_free(const ozaki_context_t* ctx, void* ptr, int atomics)
 {
-  if (NULL != ptr && 0 == ozaki_scratch_owns(ctx, ptr)) {
+  if (NULL != ptr && 0 == libxstream_mem_arena_owns(&ctx->scratch, ptr)) {
     if (0 != atomics) libxstream_mem_dev_deallocate_hint(ptr);
     else OZAKI_DEV_FREE(ptr);
   }
@@ -482,22 +458,18 @@ void* ozaki_scratch_get(const ozaki_context_t* ctx, size_t* nbytes)
 
 int ozaki_scratch_set(ozaki_context_t* ctx, void* dev_mem, size_t nbytes)
 {
-  int result = EXIT_SUCCESS;
-  LIBXS_ATOMIC_ACQUIRE(&ctx->scratch.busy, LIBXS_SYNC_NPAUSE, LIBXS_ATOMIC_LOCKORDER);
-  if (0 != ctx->scratch.owned && NULL != ctx->scratch.ptr) {
-    libxstream_mem_dev_deallocate_hint(ctx->scratch.ptr);
-  }
-  ctx->scratch.ptr = dev_mem;
-  ctx->scratch.size = (NULL != dev_mem) ? nbytes : 0;
-  ctx->scratch.used = 0;
-  ctx->scratch.owned = (NULL != dev_mem) ? 0 : 1;
-  LIBXS_ATOMIC_RELEASE(&ctx->scratch.busy, LIBXS_ATOMIC_LOCKORDER);
-  return result;
+  return libxstream_mem_arena_set(&ctx->scratch, dev_mem, nbytes);
 }
 
 
-int ozaki_gemm(ozaki_context_t* ctx, libxstream_stream_t* stream, char transa, char transb, int M, int N, int K, double alpha,
-  const void* a, int lda, const void* b, int ldb, double beta, void* c, int ldc, int dev)
+/**
+ * Body of ozaki_gemm and ozaki_gemm_prepared. pa/pb are prepared operands (or
+ * NULL): a non-NULL handle takes the place of the context cache for its side,
+ * which is what lets device pointers (dev != 0) keep their planes across calls.
+ */
+static int ozaki_gemm_run(ozaki_context_t* ctx, libxstream_stream_t* stream, char transa, char transb, int M, int N, int K,
+  double alpha, const void* a, int lda, const void* b, int ldb, double beta, void* c, int ldc, int dev, ozaki_prepared_t* pa,
+  ozaki_prepared_t* pb)
 {
   const size_t elem_size = ctx->use_double ? sizeof(double) : sizeof(float);
 
@@ -632,9 +604,11 @@ int ozaki_gemm(ozaki_context_t* ctx, libxstream_stream_t* stream, char transa, c
     void *d_occ_a = NULL, *d_occ_b = NULL;
     int first_pair;
     int cache_hit_a = 0, cache_hit_b = 0;
-    const int cacheable_a = (0 != (ctx->cache.flags & 1));
-    const int cacheable_b = (0 != (ctx->cache.flags & 2));
-    const size_t occ_size = (size_t)nslices_g * sizeof(cl_int);
+    int occ_a = -2, occ_b = -2; /* highest occupied slice per side, -2: not read back */
+    int span_a = -1, span_b = -1; /* widest exponent range per side (OZAKI_ACC), -1: not read back */
+    const int cacheable_a = (NULL != pa || 0 != (ctx->cache.flags & 1));
+    const int cacheable_b = (NULL != pb || 0 != (ctx->cache.flags & 2));
+    const size_t occ_size = (size_t)(nslices_g + 1) * sizeof(cl_int); /* slice flags, exponent span */
     int claimed = 0;
     int kg;
 
@@ -650,10 +624,13 @@ int ozaki_gemm(ozaki_context_t* ctx, libxstream_stream_t* stream, char transa, c
     expb_size = (size_t)nblk_gn * tn * elem_size;
     c_nbytes = (size_t)ldc * (size_t)N * elem_size;
 
-    /* Preprocessing cache: skip when K-grouping is active or a/b/c are device pointers */
-    if (0 == dev && n_kgroups <= 1) {
-      ozaki_cache_check(ctx, a, b, M, N, K, lda, ldb, ta, tb, as_size, bs_size, expa_size, expb_size, &d_as, &d_bs, &d_expa_g,
-        &d_expb_g, &cache_hit_a, &cache_hit_b);
+    /**
+     * Preprocessing cache: skip when K-grouping is active or a/b/c are device
+     * pointers, unless the device operand is prepared (keyed by its handle).
+     */
+    if ((0 == dev || NULL != pa || NULL != pb) && n_kgroups <= 1) {
+      ozaki_cache_check(ctx, pa, pb, dev, a, b, M, N, K, lda, ldb, ta, tb, as_size, bs_size, expa_size, expb_size, &d_as, &d_bs,
+        &d_expa_g, &d_expb_g, &cache_hit_a, &cache_hit_b);
     }
 
     /* Claim the arena for this call: see the CRT path below for what it removes. */
@@ -797,22 +774,61 @@ int ozaki_gemm(ozaki_context_t* ctx, libxstream_stream_t* stream, char transa, c
        * Compute adaptive cutoff from occupancy data.
        * On cache hit: reuse last_cutoff (no D2H readback, no sync bubble).
        * On miss: read occupancy from GPU, compute eff_cutoff, save for next time.
+       *
+       * A prepared operand records its own occupancy with its planes instead:
+       * last_cutoff belongs to whichever pair missed last, and a cutoff taken
+       * from another pair would drop slice pairs this one needs. A hit side
+       * without a record (built by Scheme 2, or by a call that read nothing
+       * back) leaves the static cutoff, which is always safe.
+       *
+       * With OZAKI_ACC, the same readback carries the widest exponent range of
+       * any row of A and column of B (slot NSLICES). A product a_ik*b_kj sits at
+       * most span_a+span_b bits below the product of the row/column maxima, so
+       * pairs whose weight 2^-7(sa+sb) lies more than acc_bits below that are
+       * beneath the target for every element and can be dropped: the cutoff is
+       * bounded by (span_a+span_b+acc_bits)/7 rounded up, which keeps one slice
+       * of margin for the dropped tail. The accuracy is relative to sum|a||b|,
+       * the usual bound for a dot product, not to the (possibly cancelling) sum.
        */
       { int eff_cutoff = cutoff;
-        if (0 != cache_hit_a && 0 != cache_hit_b && 0 != ctx->cache.last_cutoff) {
+        if (0 != cache_hit_a && NULL != pa) {
+          occ_a = pa->planes.occ;
+          span_a = pa->planes.span;
+        }
+        if (0 != cache_hit_b && NULL != pb) {
+          occ_b = pb->planes.occ;
+          span_b = pb->planes.span;
+        }
+        if (0 != cache_hit_a && 0 != cache_hit_b && NULL == pa && NULL == pb && 0 != ctx->cache.last_cutoff) {
           eff_cutoff = ctx->cache.last_cutoff;
         }
-        else if (0 == cache_hit_a && 0 == cache_hit_b) {
-          cl_int occ_a[20], occ_b[20]; /* max NSLICES = 16 (fp64), pad to 20 */
-          int sma = -1, smb = -1, si;
-          if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(d_occ_a, occ_a, occ_size, stream);
-          if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(d_occ_b, occ_b, occ_size, stream);
-          if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
-          for (si = nslices_g - 1; si >= 0; --si) { if (0 != occ_a[si]) { sma = si; break; } }
-          for (si = nslices_g - 1; si >= 0; --si) { if (0 != occ_b[si]) { smb = si; break; } }
-          if (sma >= 0 && smb >= 0) { eff_cutoff = sma + smb < cutoff ? sma + smb : cutoff; }
+        else if ((0 == cache_hit_a || -2 != occ_a) && (0 == cache_hit_b || -2 != occ_b)) {
+          cl_int occ_ha[20], occ_hb[20]; /* max NSLICES = 16 (fp64), pad to 20 */
+          int si;
+          if (0 == cache_hit_a && EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(d_occ_a, occ_ha, occ_size, stream);
+          if (0 == cache_hit_b && EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(d_occ_b, occ_hb, occ_size, stream);
+          if ((0 == cache_hit_a || 0 == cache_hit_b) && EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+          if (EXIT_SUCCESS == result && 0 == cache_hit_a) {
+            for (occ_a = -1, si = nslices_g - 1; si >= 0; --si) { if (0 != occ_ha[si]) { occ_a = si; break; } }
+            if (0 < ctx->acc_bits) span_a = occ_ha[nslices_g];
+          }
+          if (EXIT_SUCCESS == result && 0 == cache_hit_b) {
+            for (occ_b = -1, si = nslices_g - 1; si >= 0; --si) { if (0 != occ_hb[si]) { occ_b = si; break; } }
+            if (0 < ctx->acc_bits) span_b = occ_hb[nslices_g];
+          }
+          if (occ_a >= 0 && occ_b >= 0) { eff_cutoff = occ_a + occ_b < cutoff ? occ_a + occ_b : cutoff; }
           else eff_cutoff = -1;
-          ctx->cache.last_cutoff = eff_cutoff;
+          if (0 < ctx->acc_bits && 0 <= span_a && 0 <= span_b) {
+            const int cutoff_acc = (int)LIBXS_UPDIV(span_a + span_b + ctx->acc_bits, 7);
+            if (cutoff_acc < eff_cutoff) {
+              if (0 > ctx->verbosity || 2 < ctx->verbosity) {
+                fprintf(stderr, "INFO OZAKI: accuracy %d bits reduces cutoff %d -> %d (span %d+%d)\n", ctx->acc_bits, eff_cutoff,
+                  cutoff_acc, span_a, span_b);
+              }
+              eff_cutoff = cutoff_acc;
+            }
+          }
+          if (NULL == pa && NULL == pb) ctx->cache.last_cutoff = eff_cutoff;
         }
       /* Launch GEMM for this K-group */
       { const int bounds = (0 != M % tm || 0 != N % tn);
@@ -831,12 +847,13 @@ int ozaki_gemm(ozaki_context_t* ctx, libxstream_stream_t* stream, char transa, c
 
     /**
      * Save preprocessed buffers to cache (only for single-group case).
-     * Skip when dev != 0: device pointers are not valid cache keys.
+     * Skip when dev != 0: device pointers are not valid cache keys - unless
+     * prepared, in which case the handle is the key.
      */
-    if (0 == dev && n_kgroups <= 1) {
+    if ((0 == dev || NULL != pa || NULL != pb) && n_kgroups <= 1) {
       const int prev_owned = (0 != cache_hit_a || 0 != cache_hit_b);
-      ozaki_cache_update(ctx, result, a, b, M, N, K, lda, ldb, ta, tb, as_size, bs_size, expa_size, expb_size, d_as, d_bs, d_expa_g,
-        d_expb_g, prev_owned, &cache_hit_a, &cache_hit_b);
+      ozaki_cache_update(ctx, pa, pb, dev, result, a, b, M, N, K, lda, ldb, ta, tb, as_size, bs_size, expa_size, expb_size, d_as,
+        d_bs, d_expa_g, d_expb_g, occ_a, occ_b, span_a, span_b, prev_owned, &cache_hit_a, &cache_hit_b);
     }
 
     /**
@@ -925,9 +942,10 @@ int ozaki_gemm(ozaki_context_t* ctx, libxstream_stream_t* stream, char transa, c
      * across calls versus overlap within a call. Caching keeps precedence
      * (an explicit OZAKI_CACHE request is honored unchanged); it is the
      * absence of a B-cache request - the default - that enables panelling.
+     * A prepared B counts as a request.
      */
-    const int cacheable_a = (0 != (ctx->cache.flags & 1));
-    const int cacheable_b = (0 != (ctx->cache.flags & 2));
+    const int cacheable_a = (NULL != pa || 0 != (ctx->cache.flags & 1));
+    const int cacheable_b = (NULL != pb || 0 != (ctx->cache.flags & 2));
     const int n_panel = (0 == dev && n_kgroups <= 1 && 0 == cacheable_b) ? ozaki_npanel(ctx, M, N, tm, tn) : N;
     const int npanels = LIBXS_UPDIV(N, n_panel);
     /* Per-panel B upload: only when a panel is a contiguous column block. */
@@ -967,12 +985,12 @@ int ozaki_gemm(ozaki_context_t* ctx, libxstream_stream_t* stream, char transa, c
 
     /**
      * Preprocessing cache: skip when K-grouping is active or a/b/c are device
-     * pointers. Caching B excludes panelling (see cacheable_b), so the two
-     * never both apply and no masking is needed here.
+     * pointers (unless prepared). Caching B excludes panelling (see
+     * cacheable_b), so the two never both apply and no masking is needed here.
      */
-    if (0 == dev && n_kgroups <= 1) {
-      ozaki_cache_check(ctx, a, b, M, N, K, lda, ldb, ta, tb, as_size, bs_size, expa_size, expb_size, &d_as, &d_bs, &d_expa_g,
-        &d_expb_g, &cache_hit_a, &cache_hit_b);
+    if ((0 == dev || NULL != pa || NULL != pb) && n_kgroups <= 1) {
+      ozaki_cache_check(ctx, pa, pb, dev, a, b, M, N, K, lda, ldb, ta, tb, as_size, bs_size, expa_size, expb_size, &d_as, &d_bs,
+        &d_expa_g, &d_expb_g, &cache_hit_a, &cache_hit_b);
     }
     /**
      * Claim the scratch arena for this call, sized to what this call carves and
@@ -1203,12 +1221,14 @@ int ozaki_gemm(ozaki_context_t* ctx, libxstream_stream_t* stream, char transa, c
 
     /**
      * Save preprocessed buffers to cache (only for single-group case).
-     * Skip when dev != 0: device pointers are not valid cache keys.
+     * Skip when dev != 0: device pointers are not valid cache keys - unless
+     * prepared, in which case the handle is the key.
      */
-    if (0 == dev && n_kgroups <= 1) {
+    if ((0 == dev || NULL != pa || NULL != pb) && n_kgroups <= 1) {
       const int prev_owned = (0 != cache_hit_a || 0 != cache_hit_b);
-      ozaki_cache_update(ctx, result, a, b, M, N, K, lda, ldb, ta, tb, as_size, bs_size, expa_size, expb_size, d_as, d_bs, d_expa_g,
-        d_expb_g, prev_owned, &cache_hit_a, &cache_hit_b);
+      ozaki_cache_update(ctx, pa, pb, dev, result, a, b, M, N, K, lda, ldb, ta, tb, as_size, bs_size, expa_size, expb_size, d_as,
+        d_bs, d_expa_g, d_expb_g, -2 /*occ_a*/, -2 /*occ_b*/, -1 /*span_a*/, -1 /*span_b*/, prev_owned, &cache_hit_a,
+        &cache_hit_b);
     }
 
     /**
@@ -1269,6 +1289,90 @@ int ozaki_gemm(ozaki_context_t* ctx, libxstream_stream_t* stream, char transa, c
 }
 
 
+int ozaki_gemm(ozaki_context_t* ctx, libxstream_stream_t* stream, char transa, char transb, int M, int N, int K, double alpha,
+  const void* a, int lda, const void* b, int ldb, double beta, void* c, int ldc, int dev)
+{
+  return ozaki_gemm_run(
+    ctx, stream, transa, transb, M, N, K, alpha, a, lda, b, ldb, beta, c, ldc, dev, NULL /*pa*/, NULL /*pb*/);
+}
+
+
+static int ozaki_prepare(
+  ozaki_context_t* ctx, int side, char trans, int dim, int K, const void* ptr, int ld, ozaki_prepared_t** handle)
+{
+  const int t = ('N' != trans && 'n' != trans);
+  int result = EXIT_SUCCESS;
+  if (NULL != ctx && NULL != ptr && NULL != handle && 0 < dim && 0 < K &&
+      /* A is M x K and B is K x N when not transposed, hence opposite leading extents */
+      ld >= ((0 == side) == (0 == t) ? dim : K))
+  {
+    ozaki_prepared_t* const h = (ozaki_prepared_t*)malloc(sizeof(ozaki_prepared_t));
+    if (NULL != h) {
+      memset(h, 0, sizeof(*h));
+      h->ctx = ctx;
+      h->ptr = ptr;
+      h->dim = dim;
+      h->K = K;
+      h->ld = ld;
+      h->trans = (char)(0 != t ? 'T' : 'N');
+      h->side = side;
+      h->planes.occ = -2;
+      h->planes.span = -1;
+      *handle = h;
+    }
+    else result = EXIT_FAILURE;
+  }
+  else result = EXIT_FAILURE;
+  return result;
+}
+
+
+int ozaki_prepare_a(ozaki_context_t* ctx, char transa, int M, int K, const void* a, int lda, ozaki_prepared_t** handle)
+{
+  return ozaki_prepare(ctx, 0 /*A*/, transa, M, K, a, lda, handle);
+}
+
+
+int ozaki_prepare_b(ozaki_context_t* ctx, char transb, int N, int K, const void* b, int ldb, ozaki_prepared_t** handle)
+{
+  return ozaki_prepare(ctx, 1 /*B*/, transb, N, K, b, ldb, handle);
+}
+
+
+void ozaki_prepared_modified(ozaki_prepared_t* handle)
+{
+  if (NULL != handle) LIBXS_ATOMIC_ADD_FETCH(&handle->generation, 1, LIBXS_ATOMIC_SEQ_CST);
+}
+
+
+void ozaki_prepared_release(ozaki_prepared_t* handle)
+{
+  if (NULL != handle) {
+    OZAKI_DEV_FREE(handle->planes.d_slices);
+    OZAKI_DEV_FREE(handle->planes.d_exp);
+    free(handle);
+  }
+}
+
+
+int ozaki_gemm_prepared(ozaki_context_t* ctx, libxstream_stream_t* stream, double alpha, ozaki_prepared_t* a,
+  ozaki_prepared_t* b, double beta, void* c, int ldc)
+{
+  int result;
+  if (NULL != ctx && NULL != a && NULL != b && NULL != c && 0 == a->side && 1 == b->side && ctx == a->ctx && ctx == b->ctx &&
+      a->K == b->K && a->dim <= ldc)
+  {
+    result = ozaki_gemm_run(ctx, stream, a->trans, b->trans, a->dim, b->dim, a->K, alpha, a->ptr, a->ld, b->ptr, b->ld, beta, c,
+      ldc, 1 /*dev*/, a, b);
+    /* C was written: an operand aliasing it is stale from now on */
+    if (c == a->ptr) ozaki_prepared_modified(a);
+    if (c == b->ptr) ozaki_prepared_modified(b);
+  }
+  else result = EXIT_FAILURE;
+  return result;
+}
+
+
 /**
  * Set a buffer argument as a (pointer, index) pair. Emitting both from one place
  * is what keeps them consistent: a call site that offsets the pointer but forgets
@@ -1623,28 +1727,55 @@ unsigned int ozaki_cache_fingerprint(const void* ptr, size_t elem_size, int ncon
 }
 
 
-static void ozaki_cache_check(ozaki_context_t* ctx, const void* a, const void* b, int M, int N, int K, int lda, int ldb, int ta,
-  int tb, size_t as_size, size_t bs_size, size_t expa_size, size_t expb_size, void** d_as, void** d_bs, void** d_expa_g,
-  void** d_expb_g, int* cache_hit_a, int* cache_hit_b)
+/**
+ * Structural part of a cache match; the content part (fingerprint or generation)
+ * is left to the caller so that the host fingerprint is only sampled when
+ * everything else already agrees.
+ */
+static int ozaki_cache_match(const ozaki_cache_side_t* side, const void* ptr, int dim, int K, int ld, int trans,
+  size_t slices_size, size_t exp_size)
+{
+  return (ptr == side->ptr && dim == side->dim && K == side->K && ld == side->ld && trans == side->trans &&
+          slices_size == side->slices_size && exp_size == side->exp_size && NULL != side->d_slices && NULL != side->d_exp);
+}
+
+
+static void ozaki_cache_check(ozaki_context_t* ctx, ozaki_prepared_t* pa, ozaki_prepared_t* pb, int dev, const void* a,
+  const void* b, int M, int N, int K, int lda, int ldb, int ta, int tb, size_t as_size, size_t bs_size, size_t expa_size,
+  size_t expb_size, void** d_as, void** d_bs, void** d_expa_g, void** d_expb_g, int* cache_hit_a, int* cache_hit_b)
 {
   const size_t elem_size = ctx->use_double ? sizeof(double) : sizeof(float);
+  const ozaki_cache_side_t* side_a = NULL;
+  const ozaki_cache_side_t* side_b = NULL;
   LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, &ctx->cache.lock);
-  if (0 != (ctx->cache.flags & 1) && a == ctx->cache.a.ptr && M == ctx->cache.a.dim && K == ctx->cache.a.K &&
-      lda == ctx->cache.a.ld && ta == ctx->cache.a.trans && as_size == ctx->cache.a.slices_size &&
-      expa_size == ctx->cache.a.exp_size && NULL != ctx->cache.a.d_slices && NULL != ctx->cache.a.d_exp &&
-      ctx->cache.a.fingerprint == ozaki_cache_fingerprint(a, elem_size, ta ? K : M, ta ? M : K, lda))
+  if (NULL != pa) {
+    if (ozaki_cache_match(&pa->planes, a, M, K, lda, ta, as_size, expa_size) && pa->planes.fingerprint == pa->generation) {
+      side_a = &pa->planes;
+    }
+  }
+  else if (0 == dev && 0 != (ctx->cache.flags & 1) && ozaki_cache_match(&ctx->cache.a, a, M, K, lda, ta, as_size, expa_size) &&
+           ctx->cache.a.fingerprint == ozaki_cache_fingerprint(a, elem_size, ta ? K : M, ta ? M : K, lda))
   {
-    *d_as = ctx->cache.a.d_slices;
-    *d_expa_g = ctx->cache.a.d_exp;
-    *cache_hit_a = 1;
+    side_a = &ctx->cache.a;
+  }
+  if (NULL != pb) {
+    if (ozaki_cache_match(&pb->planes, b, N, K, ldb, tb, bs_size, expb_size) && pb->planes.fingerprint == pb->generation) {
+      side_b = &pb->planes;
+    }
   }
-  if (0 != (ctx->cache.flags & 2) && b == ctx->cache.b.ptr && N == ctx->cache.b.dim && K == ctx->cache.b.K &&
-      ldb == ctx->cache.b.ld && tb == ctx->cache.b.trans && bs_size == ctx->cache.b.slices_size &&
-      expb_size == ctx->cache.b.exp_size && NULL != ctx->cache.b.d_slices && NULL != ctx->cache.b.d_exp &&
-      ctx->cache.b.fingerprint == ozaki_cache_fingerprint(b, elem_size, tb ? N : K, tb ? K : N, ldb))
+  else if (0 == dev && 0 != (ctx->cache.flags & 2) && ozaki_cache_match(&ctx->cache.b, b, N, K, ldb, tb, bs_size, expb_size) &&
+           ctx->cache.b.fingerprint == ozaki_cache_fingerprint(b, elem_size, tb ? N : K, tb ? K : N, ldb))
   {
-    *d_bs = ctx->cache.b.d_slices;
-    *d_expb_g = ctx->cache.b.d_exp;
+    side_b = &ctx->cache.b;
+  }
+  if (NULL != side_a) {
+    *d_as = side_a->d_slices;
+    *d_expa_g = side_a->d_exp;
+    *cache_hit_a = 1;
+  }
+  if (NULL != side_b) {
+    *d_bs = side_b->d_slices;
+    *d_expb_g = side_b->d_exp;
     *cache_hit_b = 1;
   }
   if (0 != *cache_hit_a || 0 != *cache_hit_b) ++ctx->cache.nusers;
@@ -1652,56 +1783,62 @@ static void ozaki_cache_check(ozaki_context_t* ctx, const void* a, const void* b
 }
 
 
-static void ozaki_cache_update(ozaki_context_t* ctx, int result, const void* a, const void* b, int M, int N, int K, int lda,
-  int ldb, int ta, int tb, size_t as_size, size_t bs_size, size_t expa_size, size_t expb_size, void* d_as, void* d_bs,
-  void* d_expa_g, void* d_expb_g, int prev_owned, int* cache_hit_a, int* cache_hit_b)
+/**
+ * Hand freshly built planes to a cache side, freeing what it held. fingerprint
+ * is the content key: sampled from the host matrix, or the generation of a
+ * prepared operand.
+ */
+static void ozaki_cache_store(ozaki_cache_side_t* side, const void* ptr, int dim, int K, int ld, int trans, void* d_slices,
+  void* d_exp, size_t slices_size, size_t exp_size, unsigned int fingerprint, int occ, int span)
+{
+  if (NULL != side->d_slices) OZAKI_DEV_FREE(side->d_slices);
+  if (NULL != side->d_exp) OZAKI_DEV_FREE(side->d_exp);
+  side->ptr = ptr;
+  side->dim = dim;
+  side->K = K;
+  side->ld = ld;
+  side->trans = trans;
+  side->d_slices = d_slices;
+  side->d_exp = d_exp;
+  side->slices_size = slices_size;
+  side->exp_size = exp_size;
+  side->fingerprint = fingerprint;
+  side->occ = occ;
+  side->span = span;
+}
+
+
+static void ozaki_cache_update(ozaki_context_t* ctx, ozaki_prepared_t* pa, ozaki_prepared_t* pb, int dev, int result,
+  const void* a, const void* b, int M, int N, int K, int lda, int ldb, int ta, int tb, size_t as_size, size_t bs_size,
+  size_t expa_size, size_t expb_size, void* d_as, void* d_bs, void* d_expa_g, void* d_expb_g, int occ_a, int occ_b, int span_a,
+  int span_b, int prev_owned, int* cache_hit_a, int* cache_hit_b)
 {
   const size_t elem_size = ctx->use_double ? sizeof(double) : sizeof(float);
   LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, &ctx->cache.lock);
   if ((0 == *cache_hit_a || 0 == *cache_hit_b) && EXIT_SUCCESS == result) {
     ctx->cache.last_cutoff = 0;
   }
-  if (0 == *cache_hit_a && 0 != (ctx->cache.flags & 1) && EXIT_SUCCESS == result) {
-    if (NULL != ctx->cache.a.d_slices) {
-      OZAKI_DEV_FREE(ctx->cache.a.d_slices);
-      ctx->cache.a.d_slices = NULL;
-    }
-    if (NULL != ctx->cache.a.d_exp) {
-      OZAKI_DEV_FREE(ctx->cache.a.d_exp);
-      ctx->cache.a.d_exp = NULL;
-    }
-    ctx->cache.a.ptr = a;
-    ctx->cache.a.dim = M;
-    ctx->cache.a.K = K;
-    ctx->cache.a.ld = lda;
-    ctx->cache.a.trans = ta;
-    ctx->cache.a.d_slices = d_as;
-    ctx->cache.a.d_exp = d_expa_g;
-    ctx->cache.a.slices_size = as_size;
-    ctx->cache.a.exp_size = expa_size;
-    ctx->cache.a.fingerprint = ozaki_cache_fingerprint(a, elem_size, ta ? K : M, ta ? M : K, lda);
-    *cache_hit_a = 1; /* ownership transferred; suppress cleanup free */
+  if (0 == *cache_hit_a && EXIT_SUCCESS == result) {
+    if (NULL != pa) {
+      ozaki_cache_store(&pa->planes, a, M, K, lda, ta, d_as, d_expa_g, as_size, expa_size, pa->generation, occ_a, span_a);
+      *cache_hit_a = 1; /* ownership transferred; suppress cleanup free */
+    }
+    else if (0 == dev && 0 != (ctx->cache.flags & 1)) {
+      ozaki_cache_store(&ctx->cache.a, a, M, K, lda, ta, d_as, d_expa_g, as_size, expa_size,
+        ozaki_cache_fingerprint(a, elem_size, ta ? K : M, ta ? M : K, lda), occ_a, span_a);
+      *cache_hit_a = 1; /* ownership transferred; suppress cleanup free */
+    }
   }
-  if (0 == *cache_hit_b && 0 != (ctx->cache.flags & 2) && EXIT_SUCCESS == result) {
-    if (NULL != ctx->cache.b.d_slices) {
-      OZAKI_DEV_FREE(ctx->cache.b.d_slices);
-      ctx->cache.b.d_slices = NULL;
-    }
-    if (NULL != ctx->cache.b.d_exp) {
-      OZAKI_DEV_FREE(ctx->cache.b.d_exp);
-      ctx->cache.b.d_exp = NULL;
-    }
-    ctx->cache.b.ptr = b;
-    ctx->cache.b.dim = N;
-    ctx->cache.b.K = K;
-    ctx->cache.b.ld = ldb;
-    ctx->cache.b.trans = tb;
-    ctx->cache.b.d_slices = d_bs;
-    ctx->cache.b.d_exp = d_expb_g;
-    ctx->cache.b.slices_size = bs_size;
-    ctx->cache.b.exp_size = expb_size;
-    ctx->cache.b.fingerprint = ozaki_cache_fingerprint(b, elem_size, tb ? N : K, tb ? K : N, ldb);
-    *cache_hit_b = 1; /* ownership transferred; suppress cleanup free */
+  if (0 == *cache_hit_b && EXIT_SUCCESS == result) {
+    if (NULL != pb) {
+      ozaki_cache_store(&pb->planes, b, N, K, ldb, tb, d_bs, d_expb_g, bs_size, expb_size, pb->generation, occ_b, span_b);
+      *cache_hit_b = 1; /* ownership transferred; suppress cleanup free */
+    }
+    else if (0 == dev && 0 != (ctx->cache.flags & 2)) {
+      ozaki_cache_store(&ctx->cache.b, b, N, K, ldb, tb, d_bs, d_expb_g, bs_size, expb_size,
+        ozaki_cache_fingerprint(b, elem_size, tb ? N : K, tb ? K : N, ldb), occ_b, span_b);
+      *cache_hit_b = 1; /* ownership transferred; suppress cleanup free */
+    }
   }
   if (0 == prev_owned && (0 != *cache_hit_a || 0 != *cache_hit_b)) ++ctx->cache.nusers;
   LIBXS_LOCK_RELEASE(LIBXS_LOCK, &ctx->cache.lock);
@@ -345,11 +345,46 @@ int ozaki_npanel(const ozaki_context_t* ctx, int M, int N, int tm, int tn)
 }
 
 
+/**
+ * Memory pressure (libxstream_mem_reclaim_register): the arena goes first since
+ * the next call regrows it at the cost of one allocation, then the cached
+ * operand planes, which cost a preprocessing pass on the next miss. Neither is
+ * touched while in use: a claimed arena or a cache with users is skipped, which
+ * also covers an allocation by a call of this context that runs out of memory.
+ */
+static size_t ozaki_reclaim(size_t nbytes, void* arg)
+{
+  ozaki_context_t* const ctx = (ozaki_context_t*)arg;
+  size_t result = libxstream_mem_arena_trim(&ctx->scratch);
+  if (result < nbytes) {
+    void *sa_sl = NULL, *sa_ex = NULL, *sb_sl = NULL, *sb_ex = NULL;
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, &ctx->cache.lock);
+    if (0 == ctx->cache.nusers) { /* forget the entries (no match), keep the flags */
+      sa_sl = ctx->cache.a.d_slices;
+      sa_ex = ctx->cache.a.d_exp;
+      sb_sl = ctx->cache.b.d_slices;
+      sb_ex = ctx->cache.b.d_exp;
+      if (NULL != sa_sl) result += ctx->cache.a.slices_size + ctx->cache.a.exp_size;
+      if (NULL != sb_sl) result += ctx->cache.b.slices_size + ctx->cache.b.exp_size;
+      LIBXS_MEMZERO(&ctx->cache.a);
+      LIBXS_MEMZERO(&ctx->cache.b);
+      ctx->cache.last_cutoff = 0;
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, &ctx->cache.lock);
+    OZAKI_DEV_FREE(sa_sl);
+    OZAKI_DEV_FREE(sa_ex);
+    OZAKI_DEV_FREE(sb_sl);
+    OZAKI_DEV_FREE(sb_ex);
+  }
+  return result;
+}
+
+
 int ozaki_init(ozaki_context_t* ctx, int tm, int tn, int use_double, int kind, int verbosity, int ndecomp, int ozflags, int oztrim,
   int ozgroups, int maxk)
 {
-  const libxstream_opencl_device_t* devinfo = &libxstream_opencl_config.device;
-  cl_device_id device = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
+  const libxstream_opencl_device_t* devinfo = libxstream_opencl_device();
+  cl_device_id device = libxstream_opencl_config.devices[devinfo->device_id];
   const int gpu = (CL_DEVICE_TYPE_GPU == devinfo->type ? 1 : 0);
   int result = EXIT_SUCCESS;
   int nv, has_fp64, crt;
@@ -472,8 +507,20 @@ int ozaki_init(ozaki_context_t* ctx, int tm, int tn, int use_double, int kind, i
   ctx->kind = kind;
   ctx->ozflags = ozflags;
   ctx->oztrim = oztrim;
+  /**
+   * Scheme 1 target accuracy in bits (OZAKI_ACC, 0/unset: off). Unlike
+   * OZAKI_TRIM, which drops a fixed number of levels, this derives the cutoff
+   * per call from the exponent range the preprocessing observes (see
+   * ozaki_gemm), so well-scaled operands run fewer slice pairs while wide-range
+   * ones keep what the target needs. Scheme 2 is unaffected.
+   */
+  { const char *const env_acc = getenv("OZAKI_ACC");
+    const int acc = (NULL != env_acc ? atoi(env_acc) : 0);
+    ctx->acc_bits = (2 != kind && 0 < acc) ? acc : 0;
+  }
   ctx->ndecomp = ndecomp;
   ctx->verbosity = verbosity;
+  ctx->device_id = devinfo->device_id;
 
   nv = (int)devinfo->nv;
 
@@ -1007,8 +1054,8 @@ int ozaki_init(ozaki_context_t* ctx, int tm, int tn, int use_double, int kind, i
       { /* Compile preprocessing + scale_beta (shared, tile/cutoff-independent) */
         char pp_flags[sizeof(build_params) + 64];
         cl_program program = NULL;
-        LIBXS_SNPRINTF(pp_flags, sizeof(pp_flags), "%s -DBM=%d -DBN=%d -DRTM=%d -DRTN=%d -DOZAKI_CUTOFF=%d",
-          build_params, tm, tn, rtm, rtn, cutoff_jit);
+        LIBXS_SNPRINTF(pp_flags, sizeof(pp_flags), "%s -DBM=%d -DBN=%d -DRTM=%d -DRTN=%d -DOZAKI_CUTOFF=%d -DOZAKI_SPAN=%d",
+          build_params, tm, tn, rtm, rtn, cutoff_jit, 0 < ctx->acc_bits ? 1 : 0);
         result = libxstream_opencl_program(
           0, OPENCL_KERNELS_SOURCE_OZAKI1_INT8, "ozaki1", pp_flags, build_options, NULL, NULL, NULL, 0, &program);
         if (EXIT_SUCCESS == result) {
@@ -1504,11 +1551,8 @@ int ozaki_init(ozaki_context_t* ctx, int tm, int tn, int use_double, int kind, i
    */
   { const char *const env_arena = getenv("OZAKI_ARENA");
     const int arena = (NULL != env_arena) ? atoi(env_arena) : -1;
-    if (0 > arena) {
-      ctx->scratch.limit = (NULL != libxstream_opencl_config.pool_dev) ? 0 : ((size_t)-1);
-    }
-    else ctx->scratch.limit = (size_t)arena << 20;
-    ctx->scratch.owned = 1;
+    libxstream_mem_arena_init(&ctx->scratch, 0 <= arena ? ((size_t)arena << 20)
+      : (NULL != libxstream_opencl_config.pool_dev ? 0 : ((size_t)-1)), libxstream_opencl_mem_hint_atomics);
   }
 
   /* Report compiled kernel info */
@@ -1543,6 +1587,7 @@ int ozaki_init(ozaki_context_t* ctx, int tm, int tn, int use_double, int kind, i
     }
     ozaki_print_opt(stderr, "ndecomp", ndecomp);
     ozaki_print_opt(stderr, "trim", oztrim);
+    if (0 < ctx->acc_bits) ozaki_print_opt(stderr, "acc", ctx->acc_bits);
     if (0 != crt) {
       const char *const e_i8 = getenv("OZAKI_I8");
       fprintf(stderr, " u8=%d", (NULL == e_i8 || 0 == atoi(e_i8)) ? 1 : 0);
@@ -1582,6 +1627,8 @@ int ozaki_init(ozaki_context_t* ctx, int tm, int tn, int use_double, int kind, i
     }
   }
   if (EXIT_SUCCESS == result) result = libxstream_event_create(&ctx->evt_panel);
+  /* optional: without a free slot, the context simply keeps its memory */
+  if (EXIT_SUCCESS == result) LIBXS_ELIDE_RESULT(int, libxstream_mem_reclaim_register(ozaki_reclaim, ctx, 0 /*priority*/));
 
   return result;
 }
@@ -1590,10 +1637,16 @@ int ozaki_init(ozaki_context_t* ctx, int tm, int tn, int use_double, int kind, i
 void ozaki_destroy(ozaki_context_t* ctx)
 {
   if (NULL != ctx) {
-    if (0 != ctx->scratch.owned && NULL != ctx->scratch.ptr) {
-      libxstream_mem_dev_deallocate_hint(ctx->scratch.ptr);
-      ctx->scratch.ptr = NULL;
+    LIBXS_ELIDE_RESULT(int, libxstream_mem_reclaim_unregister(ozaki_reclaim, ctx));
+    if (0 != ctx->scratch.peak) {
+      const int verbosity = libxs_get_verbosity();
+      if (0 > LIBXS_MIN(ctx->verbosity, verbosity) || 2 < LIBXS_MAX(ctx->verbosity, verbosity)) {
+        const int peak = (int)LIBXS_UPDIV(ctx->scratch.peak, (size_t)1 << 20);
+        const int size = (int)LIBXS_UPDIV(ctx->scratch.size, (size_t)1 << 20);
+        printf("ARENA: peak_mb=%i size_mb=%i ngrow=%i nshrink=%i\n", peak, size, ctx->scratch.ngrow, ctx->scratch.nshrink);
+      }
     }
+    libxstream_mem_arena_destroy(&ctx->scratch);
     if (NULL != ctx->kern_preprocess_a) {
       clReleaseKernel(ctx->kern_preprocess_a);
     }
@@ -38,21 +38,25 @@
 
 /**
  * Device memory allocation macros (shared by ozaki_opencl.c and ozaki_gemm.c).
- * Uses libxstream's internal device pool when available.
+ * libxstream_mem_allocate serves from libxstream's device pool when available,
+ * and the scratch is accounted under its own tag (libxstream_mem_tag_info).
  */
-#define OZAKI_DEV_ALLOC(PTR, SIZE) \
-    ((NULL != libxstream_opencl_config.pool_dev) \
-      ? ((*(PTR) = libxs_malloc(libxstream_opencl_config.pool_dev, SIZE, LIBXS_MALLOC_NATIVE)) != NULL \
-          ? EXIT_SUCCESS : EXIT_FAILURE) \
-      : libxstream_mem_allocate((void**)(PTR), SIZE))
+#define OZAKI_DEV_ALLOC(PTR, SIZE) ozaki_dev_alloc((void**)(PTR), SIZE)
 #define OZAKI_DEV_FREE(PTR) \
     do { \
-      if (NULL != (PTR)) { \
-        if (NULL != libxstream_opencl_config.pool_dev) libxs_free(PTR); \
-        else libxstream_mem_deallocate(PTR); \
-      } \
+      if (NULL != (PTR)) libxstream_mem_deallocate(PTR); \
     } while (0)
 
+LIBXS_API_INLINE int ozaki_dev_alloc(void** ptr, size_t size)
+{
+  int result = libxstream_mem_tag_push("ozaki");
+  if (EXIT_SUCCESS == result) {
+    result = libxstream_mem_allocate(ptr, size);
+    libxstream_mem_tag_pop();
+  }
+  return result;
+}
+
 
 /* Ozaki flags */
 typedef enum ozaki_flags_t { OZAKI_TRIANGULAR = 1, OZAKI_SYMMETRIZE = 2 } ozaki_flags_t;
@@ -89,6 +93,8 @@ typedef struct ozaki_cache_side_t {
   void* d_exp;
   size_t slices_size, exp_size;
   unsigned int fingerprint; /* content fingerprint to detect in-place modifications */
+  int occ; /* Scheme 1: highest occupied slice as read back with the planes (-1: none, -2: not recorded) */
+  int span; /* Scheme 1: widest exponent range of a row/column (OZAKI_ACC), -1: not recorded */
 } ozaki_cache_side_t;
 
 /**
@@ -100,6 +106,28 @@ typedef struct ozaki_cache_side_t {
  */
 unsigned int ozaki_cache_fingerprint(const void* ptr, size_t elem_size, int ncontig, int nld, int ld);
 
+/**
+ * Prepared operand (ozaki_prepare_a/b): a device matrix whose slices and
+ * exponents are kept across calls, which is what the context cache cannot do for
+ * device pointers - it fingerprints content on the host. The handle is keyed by
+ * buffer identity plus a generation counter the caller bumps after modifying the
+ * matrix (ozaki_prepared_modified), so staleness is stated rather than guessed.
+ *
+ * The planes are materialized by the first product that uses the handle and not
+ * by ozaki_prepare_a/b: their layout is padded to the output tile, which depends
+ * on the other operand's extent as well. A later product with a different tile
+ * (or generation) rebuilds them in place.
+ */
+typedef struct ozaki_prepared_t {
+  const struct ozaki_context_t* ctx; /* planes hold this context's decomposition */
+  const void* ptr; /* device matrix */
+  int dim, K, ld; /* dim is the outer extent: M for A, N for B */
+  char trans;
+  int side; /* 0: A, 1: B */
+  volatile unsigned int generation;
+  ozaki_cache_side_t planes; /* fingerprint holds the generation the planes were built from */
+} ozaki_prepared_t;
+
 typedef struct ozaki_cache_t {
   libxs_lock_t lock;
   volatile LIBXS_ATOMIC_LOCKTYPE nusers;
@@ -126,15 +154,14 @@ typedef struct ozaki_cache_t {
  * the same property a cuBLAS handle's workspace has, and it keeps the footprint
  * one arena rather than one per thread; a caller that wants concurrency without
  * the fallback should use a context per thread.
+ *
+ * The arena itself is libxstream's (libxstream_mem_arena_t), which resizes an
+ * owned arena with hysteresis: it grows by at least half again, so shapes that
+ * creep upwards reallocate a logarithmic number of times, and it shrinks only
+ * after a window of claims that all stayed well below capacity, so alternating
+ * shapes do not reallocate on every call.
  */
-typedef struct ozaki_scratch_t {
-  void* ptr; /* arena base, NULL until first use */
-  size_t size; /* capacity of ptr */
-  size_t used; /* bump offset, meaningful only while claimed */
-  size_t limit; /* upper bound for growth (OZAKI_ARENA), 0 disables the arena */
-  int owned; /* 1: allocated here, grown on demand, freed at destroy; 0: caller's */
-  volatile LIBXS_ATOMIC_LOCKTYPE busy;
-} ozaki_scratch_t;
+typedef libxstream_mem_arena_t ozaki_scratch_t;
 
 /**
  * Ozaki-1 kernel specialization key: compile-time cutoff.
@@ -206,7 +233,9 @@ typedef struct ozaki_context_t {
   int kind; /* resolved: 1 = ozaki1 int8, 2 = ozaki2 int8 (CRT), 3 = adaptive */
   int ozflags; /* bitmask: OZAKI_TRIANGULAR | OZAKI_SYMMETRIZE */
   int oztrim; /* Precision levels to trim (~2 bits each). */
+  int acc_bits; /* Scheme 1: target accuracy in bits bounding the cutoff (OZAKI_ACC, 0: off). */
   int verbosity; /* 0: quiet, 1: info, 2+: debug */
+  int device_id; /* device the kernels were built for (libxstream_device_bind) */
   /* block sizes for preprocessing WGs */
   int bm_pre, bn_pre, bk_pre;
   /**
@@ -430,6 +459,43 @@ int ozaki_gemm(ozaki_context_t* ctx, libxstream_stream_t* stream, char transa, c
 int ozaki_gemm_complex(ozaki_context_t* ctx, libxstream_stream_t* stream, char transa, char transb, int M, int N, int K,
   const double* alpha, const void* a, int lda, const void* b, int ldb, const double* beta, void* c, int ldc);
 
+/**
+ * Device-resident operands: register a device matrix as A (M x K) or B (K x N)
+ * of later products, with the same layout arguments ozaki_gemm takes. The
+ * handle holds the operand's slices and exponents once a product has built
+ * them (see ozaki_prepared_t), so repeated products with the same matrix skip
+ * its preprocessing. K-grouping (maxk) defeats the reuse, as it does for the
+ * context cache: the planes then cover one group only and are not kept.
+ *
+ * ozaki_prepared_modified must be called whenever the matrix behind a handle
+ * changes, which invalidates its planes; ozaki_gemm_prepared does so by itself
+ * when C aliases an operand. ozaki_prepared_release frees the handle and its
+ * planes, and must not race with a product using it. A handle is used by one
+ * call at a time.
+ */
+int ozaki_prepare_a(ozaki_context_t* ctx, char transa, int M, int K, const void* a, int lda, ozaki_prepared_t** handle);
+int ozaki_prepare_b(ozaki_context_t* ctx, char transb, int N, int K, const void* b, int ldb, ozaki_prepared_t** handle);
+void ozaki_prepared_modified(ozaki_prepared_t* handle);
+void ozaki_prepared_release(ozaki_prepared_t* handle);
+
+/**
+ * C = alpha * op(A) * op(B) + beta * C with prepared operands and a device C.
+ * Both handles must belong to ctx and agree on K. Enqueues like ozaki_gemm.
+ */
+int ozaki_gemm_prepared(ozaki_context_t* ctx, libxstream_stream_t* stream, double alpha, ozaki_prepared_t* a,
+  ozaki_prepared_t* b, double beta, void* c, int ldc);
+
+/**
+ * Host-side GEMM (like ozaki_gemm with host pointers) spread over several
+ * contexts, e.g. one per device: C is cut into tiles (OZAKI_TILE, or a few per
+ * context) which the contexts take from a shared queue and steal from each
+ * other, so a faster one ends up with more of them. Each context uploads and
+ * prepares an A or B panel once and keeps it for all its tiles. Contexts must
+ * agree on the precision. Synchronous: C is complete on return.
+ */
+int ozaki_gemm_tiled(ozaki_context_t* const ctxs[], int nctxs, char transa, char transb, int M, int N, int K, double alpha,
+  const void* a, int lda, const void* b, int ldb, double beta, void* c, int ldc);
+
 /**
  * Invalidate preprocessing cache entries for the given matrix pointers.
  * This function must be called when matrices are modified outside of
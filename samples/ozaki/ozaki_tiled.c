@@ -0,0 +1,246 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#include "ozaki_opencl.h"
+
+#if !defined(OZAKI_TILED_MAXCTX)
+# define OZAKI_TILED_MAXCTX 64
+#endif
+/** Tiles per worker the default tiling aims for (balance versus panel reuse). */
+#if !defined(OZAKI_TILED_SPLIT)
+# define OZAKI_TILED_SPLIT 4
+#endif
+/** Granularity of the default tile edge, a multiple of every kernel tile. */
+#if !defined(OZAKI_TILED_ALIGN)
+# define OZAKI_TILED_ALIGN 256
+#endif
+
+
+/**
+ * Work queue of one worker: a contiguous range of tile indexes. The owner takes
+ * from the front and a thief from the back, so the owner keeps walking along
+ * the block row it started on - whose A panel it already holds - while the
+ * tiles stolen from it are the ones it would have reached last.
+ */
+typedef struct ozaki_tiled_queue_t {
+  int begin, end;
+} ozaki_tiled_queue_t;
+
+typedef struct ozaki_tiled_t {
+  ozaki_tiled_queue_t queue[OZAKI_TILED_MAXCTX];
+  libxs_lock_t lock;
+  const void *a, *b;
+  void* c;
+  double alpha, beta;
+  int M, N, K, lda, ldb, ldc, ta, tb;
+  char transa, transb;
+  int bm, bn, gm, gn, nctxs;
+  volatile int result;
+} ozaki_tiled_t;
+
+
+static int ozaki_tiled_next(ozaki_tiled_t* sched, int w)
+{
+  int result = -1, i, victim = -1, most = 0;
+  LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, &sched->lock);
+  if (sched->queue[w].begin < sched->queue[w].end) {
+    result = sched->queue[w].begin++;
+  }
+  else {
+    for (i = 0; i < sched->nctxs; ++i) {
+      const int left = sched->queue[i].end - sched->queue[i].begin;
+      if (most < left) {
+        most = left;
+        victim = i;
+      }
+    }
+    if (0 <= victim) result = --sched->queue[victim].end;
+  }
+  LIBXS_LOCK_RELEASE(LIBXS_LOCK, &sched->lock);
+  return result;
+}
+
+
+/* Copy a rows x cols block between column-major matrices. */
+static void ozaki_tiled_copy(void* dst, int ldd, const void* src, int lds, int rows, int cols, size_t elem_size)
+{
+  int j;
+  for (j = 0; j < cols; ++j) {
+    memcpy((char*)dst + (size_t)j * ldd * elem_size, (const char*)src + (size_t)j * lds * elem_size, (size_t)rows * elem_size);
+  }
+}
+
+
+/**
+ * Upload the rows x cols block at (r0, c0) of a host matrix into a new device
+ * buffer with leading dimension rows. Whole columns go up directly, anything
+ * else is packed into the pinned staging buffer first.
+ */
+static int ozaki_tiled_upload(libxstream_stream_t* stream, void* staging, const void* src, int ld, int r0, int c0, int rows,
+  int cols, size_t elem_size, void** d_panel)
+{
+  const size_t nbytes = (size_t)rows * cols * elem_size;
+  const char* const base = (const char*)src + ((size_t)c0 * ld + r0) * elem_size;
+  int result = libxstream_mem_allocate(d_panel, nbytes);
+  if (EXIT_SUCCESS == result) {
+    if (rows == ld) result = libxstream_mem_copy_h2d(base, *d_panel, nbytes, stream);
+    else {
+      ozaki_tiled_copy(staging, rows, base, ld, rows, cols, elem_size);
+      result = libxstream_mem_copy_h2d(staging, *d_panel, nbytes, stream);
+    }
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+  return result;
+}
+
+
+/**
+ * One worker: takes tiles until none are left, keeping every A and B panel it
+ * uploads (and its prepared planes) for the rest of the call, so a panel is
+ * transferred and decomposed at most once per worker however many tiles use it.
+ */
+static int ozaki_tiled_work(ozaki_tiled_t* sched, int w, ozaki_context_t* ctx)
+{
+  const size_t elem_size = ctx->use_double ? sizeof(double) : sizeof(float);
+  const size_t panel_size = (size_t)LIBXS_MAX(sched->bm, sched->bn) * sched->K;
+  const size_t staging_size = elem_size * LIBXS_MAX(panel_size, (size_t)sched->bm * sched->bn);
+  void **d_apanel = (void**)calloc((size_t)sched->gm, sizeof(void*)), **d_bpanel = (void**)calloc((size_t)sched->gn, sizeof(void*));
+  ozaki_prepared_t **ha = (ozaki_prepared_t**)calloc((size_t)sched->gm, sizeof(ozaki_prepared_t*));
+  ozaki_prepared_t **hb = (ozaki_prepared_t**)calloc((size_t)sched->gn, sizeof(ozaki_prepared_t*));
+  libxstream_stream_t* stream = NULL;
+  void *staging = NULL, *d_c = NULL;
+  int result = (NULL != d_apanel && NULL != d_bpanel && NULL != ha && NULL != hb) ? EXIT_SUCCESS : EXIT_FAILURE;
+  int ntiles = 0, npanels = 0, t, i;
+  /* stream and buffers must live on the context's device */
+  if (EXIT_SUCCESS == result) result = libxstream_device_bind(ctx->device_id);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_create(&stream, "ozaki_tiled", LIBXSTREAM_STREAM_DEFAULT);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_host_allocate(&staging, staging_size, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&d_c, (size_t)sched->bm * sched->bn * elem_size);
+  while (EXIT_SUCCESS == result && EXIT_SUCCESS == sched->result && 0 <= (t = ozaki_tiled_next(sched, w))) {
+    const int ti = t / sched->gn, tj = t % sched->gn;
+    const int i0 = ti * sched->bm, j0 = tj * sched->bn;
+    const int mi = LIBXS_MIN(sched->bm, sched->M - i0), nj = LIBXS_MIN(sched->bn, sched->N - j0);
+    char* const c_tile = (char*)sched->c + ((size_t)j0 * sched->ldc + i0) * elem_size;
+    if (NULL == ha[ti]) { /* row panel of op(A): mi x K */
+      if (0 == sched->ta) {
+        result = ozaki_tiled_upload(stream, staging, sched->a, sched->lda, i0, 0, mi, sched->K, elem_size, &d_apanel[ti]);
+        if (EXIT_SUCCESS == result) result = ozaki_prepare_a(ctx, sched->transa, mi, sched->K, d_apanel[ti], mi, &ha[ti]);
+      }
+      else {
+        result = ozaki_tiled_upload(stream, staging, sched->a, sched->lda, 0, i0, sched->K, mi, elem_size, &d_apanel[ti]);
+        if (EXIT_SUCCESS == result) result = ozaki_prepare_a(ctx, sched->transa, mi, sched->K, d_apanel[ti], sched->K, &ha[ti]);
+      }
+      ++npanels;
+    }
+    if (EXIT_SUCCESS == result && NULL == hb[tj]) { /* column panel of op(B): K x nj */
+      if (0 == sched->tb) {
+        result = ozaki_tiled_upload(stream, staging, sched->b, sched->ldb, 0, j0, sched->K, nj, elem_size, &d_bpanel[tj]);
+        if (EXIT_SUCCESS == result) result = ozaki_prepare_b(ctx, sched->transb, nj, sched->K, d_bpanel[tj], sched->K, &hb[tj]);
+      }
+      else {
+        result = ozaki_tiled_upload(stream, staging, sched->b, sched->ldb, j0, 0, nj, sched->K, elem_size, &d_bpanel[tj]);
+        if (EXIT_SUCCESS == result) result = ozaki_prepare_b(ctx, sched->transb, nj, sched->K, d_bpanel[tj], nj, &hb[tj]);
+      }
+      ++npanels;
+    }
+    if (EXIT_SUCCESS == result && 0 != sched->beta) {
+      ozaki_tiled_copy(staging, mi, c_tile, sched->ldc, mi, nj, elem_size);
+      result = libxstream_mem_copy_h2d(staging, d_c, (size_t)mi * nj * elem_size, stream);
+    }
+    if (EXIT_SUCCESS == result) result = ozaki_gemm_prepared(ctx, stream, sched->alpha, ha[ti], hb[tj], sched->beta, d_c, mi);
+    if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(d_c, staging, (size_t)mi * nj * elem_size, stream);
+    if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+    if (EXIT_SUCCESS == result) {
+      ozaki_tiled_copy(c_tile, sched->ldc, staging, mi, mi, nj, elem_size);
+      ++ntiles;
+    }
+  }
+  if (EXIT_SUCCESS != result) sched->result = result;
+  if (0 > ctx->verbosity || 2 < ctx->verbosity) {
+    fprintf(stderr, "INFO OZAKI: tiled worker %d: %d tiles, %d panels\n", w, ntiles, npanels);
+  }
+  for (i = 0; i < sched->gm; ++i) {
+    if (NULL != ha && NULL != ha[i]) ozaki_prepared_release(ha[i]);
+    if (NULL != d_apanel && NULL != d_apanel[i]) libxstream_mem_deallocate(d_apanel[i]);
+  }
+  for (i = 0; i < sched->gn; ++i) {
+    if (NULL != hb && NULL != hb[i]) ozaki_prepared_release(hb[i]);
+    if (NULL != d_bpanel && NULL != d_bpanel[i]) libxstream_mem_deallocate(d_bpanel[i]);
+  }
+  if (NULL != d_c) libxstream_mem_deallocate(d_c);
+  if (NULL != staging) libxstream_mem_host_deallocate(staging, stream);
+  if (NULL != stream) libxstream_stream_destroy(stream);
+  libxstream_device_bind(-1);
+  free(d_apanel);
+  free(d_bpanel);
+  free(ha);
+  free(hb);
+  return result;
+}
+
+
+int ozaki_gemm_tiled(ozaki_context_t* const ctxs[], int nctxs, char transa, char transb, int M, int N, int K, double alpha,
+  const void* a, int lda, const void* b, int ldb, double beta, void* c, int ldc)
+{
+  ozaki_tiled_t sched;
+  int result = EXIT_SUCCESS, w;
+  LIBXS_MEMZERO(&sched);
+  if (NULL == ctxs || 0 >= nctxs || OZAKI_TILED_MAXCTX < nctxs || 0 >= M || 0 >= N || 0 >= K || NULL == a || NULL == b ||
+      NULL == c || ldc < M)
+  {
+    result = EXIT_FAILURE;
+  }
+  for (w = 0; w < nctxs && EXIT_SUCCESS == result; ++w) {
+    if (NULL == ctxs[w] || ctxs[w]->use_double != ctxs[0]->use_double) result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result) {
+    const char *const env_tile = getenv("OZAKI_TILE");
+    int bm = (NULL != env_tile) ? atoi(env_tile) : 0;
+    if (0 >= bm) { /* halve the tile until every worker gets a few of them */
+      bm = LIBXS_UP(LIBXS_MAX(M, N), OZAKI_TILED_ALIGN);
+      while (OZAKI_TILED_ALIGN < bm && LIBXS_UPDIV(M, bm) * LIBXS_UPDIV(N, bm) < OZAKI_TILED_SPLIT * nctxs) {
+        bm = LIBXS_UP(bm / 2, OZAKI_TILED_ALIGN);
+      }
+    }
+    sched.a = a;
+    sched.b = b;
+    sched.c = c;
+    sched.alpha = alpha;
+    sched.beta = beta;
+    sched.M = M;
+    sched.N = N;
+    sched.K = K;
+    sched.lda = lda;
+    sched.ldb = ldb;
+    sched.ldc = ldc;
+    sched.transa = transa;
+    sched.transb = transb;
+    sched.ta = ('N' != transa && 'n' != transa);
+    sched.tb = ('N' != transb && 'n' != transb);
+    sched.bm = sched.bn = bm;
+    sched.gm = LIBXS_UPDIV(M, bm);
+    sched.gn = LIBXS_UPDIV(N, bm);
+    sched.nctxs = nctxs;
+    { /* initial distribution: consecutive tiles (block rows) per worker */
+      const int ntiles = sched.gm * sched.gn;
+      for (w = 0; w < nctxs; ++w) {
+        sched.queue[w].begin = (int)(((long)ntiles * w) / nctxs);
+        sched.queue[w].end = (int)(((long)ntiles * (w + 1)) / nctxs);
+      }
+    }
+#if defined(_OPENMP)
+#   pragma omp parallel for num_threads(nctxs) schedule(static, 1)
+#endif
+    for (w = 0; w < nctxs; ++w) {
+      ozaki_tiled_work(&sched, w, ctxs[w]);
+    }
+    result = sched.result;
+  }
+  return result;
+}
@@ -22,6 +22,16 @@
 #if defined(_OPENMP)
 #  include <omp.h>
 #endif
+#if defined(__OPENCL)
+#  include <libxstream/libxstream_opencl.h>
+/* carve from the claimed arena (reused across kernels), or allocate */
+#  define DEV_MEM_ALLOCATE(PTR, NBYTES) \
+    ((0 != claimed && NULL != (*(PTR) = libxstream_mem_arena_alloc(&arena, NBYTES))) ? EXIT_SUCCESS : c_dbcsr_acc_dev_mem_allocate(PTR, NBYTES))
+#  define DEV_MEM_DEALLOCATE(PTR) (0 == libxstream_mem_arena_owns(&arena, PTR) ? c_dbcsr_acc_dev_mem_deallocate(PTR) : EXIT_SUCCESS)
+#else
+#  define DEV_MEM_ALLOCATE(PTR, NBYTES) c_dbcsr_acc_dev_mem_allocate(PTR, NBYTES)
+#  define DEV_MEM_DEALLOCATE(PTR) c_dbcsr_acc_dev_mem_deallocate(PTR)
+#endif
 
 #define PRINTF(...) \
   do { \
@@ -116,6 +126,9 @@ int main(int argc, char* argv[]) {
 #if defined(__OPENCL)
   const char* const env_nrepeat_smm = getenv("NREPEAT_SMM");
   const int nrepeat_smm = (NULL == env_nrepeat_smm ? 1 : MAX(atoi(env_nrepeat_smm), 1));
+  /* device buffers of all kernels (triplets) come from one scratch arena */
+  libxstream_mem_arena_t arena;
+  libxstream_mem_arena_init(&arena, (size_t)-1 /*unbounded*/, libxstream_opencl_mem_hint_default);
 #else
   const int nrepeat_smm = 1;
 #endif
@@ -193,6 +206,9 @@ int main(int argc, char* argv[]) {
       const int xrepeat = (0 != check ? NREPEAT : XREPEAT);
       int nrepeat = (0 < inr ? inr : xrepeat);
       int stack_size, na, nb, nc, nr, r;
+#if defined(__OPENCL)
+      int claimed = 0;
+#endif
       if (NULL == env_batchsize_smm) {
         stack_size = 0;
         if (NULL != sss) {
@@ -277,11 +293,19 @@ int main(int argc, char* argv[]) {
         }
       }
 #if !defined(__OFFLOAD_UNIFIED_MEMORY) || !defined(DEDUPLICATE)
-      CHECK(c_dbcsr_acc_dev_mem_allocate((void**)(void*)&amat_dev, sizeof(ELEM_TYPE) * mk * na), &result, check);
-      CHECK(c_dbcsr_acc_dev_mem_allocate((void**)(void*)&bmat_dev, sizeof(ELEM_TYPE) * kn * nb), &result, check);
-      CHECK(c_dbcsr_acc_dev_mem_allocate((void**)(void*)&cmat_dev, sizeof(ELEM_TYPE) * mn * nc), &result, check);
-      CHECK(c_dbcsr_acc_dev_mem_allocate((void**)(void*)&stack_dev, sizeof(int) * 3 * stack_size), &result, check);
-      CHECK(c_dbcsr_acc_dev_mem_allocate((void**)(void*)&trans_dev, sizeof(int) * nb), &result, check);
+#  if defined(__OPENCL)
+      claimed = libxstream_mem_arena_claim(&arena,
+        LIBXS_UP2(sizeof(ELEM_TYPE) * mk * na, LIBXSTREAM_MEM_ARENA_ALIGN) +
+        LIBXS_UP2(sizeof(ELEM_TYPE) * kn * nb, LIBXSTREAM_MEM_ARENA_ALIGN) +
+        LIBXS_UP2(sizeof(ELEM_TYPE) * mn * nc, LIBXSTREAM_MEM_ARENA_ALIGN) +
+        LIBXS_UP2(sizeof(int) * 3 * stack_size, LIBXSTREAM_MEM_ARENA_ALIGN) +
+        LIBXS_UP2(sizeof(int) * nb, LIBXSTREAM_MEM_ARENA_ALIGN));
+#  endif
+      CHECK(DEV_MEM_ALLOCATE((void**)(void*)&amat_dev, sizeof(ELEM_TYPE) * mk * na), &result, check);
+      CHECK(DEV_MEM_ALLOCATE((void**)(void*)&bmat_dev, sizeof(ELEM_TYPE) * kn * nb), &result, check);
+      CHECK(DEV_MEM_ALLOCATE((void**)(void*)&cmat_dev, sizeof(ELEM_TYPE) * mn * nc), &result, check);
+      CHECK(DEV_MEM_ALLOCATE((void**)(void*)&stack_dev, sizeof(int) * 3 * stack_size), &result, check);
+      CHECK(DEV_MEM_ALLOCATE((void**)(void*)&trans_dev, sizeof(int) * nb), &result, check);
       CHECK(c_dbcsr_acc_memset_zero(cmat_dev, 0 /*offset*/, sizeof(ELEM_TYPE) * mn * nc, stream), &result, check);
       CHECK(c_dbcsr_acc_memcpy_h2d(trans_hst, trans_dev, sizeof(int) * nb, stream), &result, check);
       CHECK(c_dbcsr_acc_stream_sync(stream), &result, check);
@@ -431,11 +455,14 @@ int main(int argc, char* argv[]) {
       CHECK(c_dbcsr_acc_host_mem_deallocate(bmat_hst, stream), NULL, check);
       CHECK(c_dbcsr_acc_host_mem_deallocate(cmat_hst, stream), NULL, check);
 #if !defined(__OFFLOAD_UNIFIED_MEMORY) || !defined(DEDUPLICATE)
-      CHECK(c_dbcsr_acc_dev_mem_deallocate(stack_dev), NULL, check);
-      CHECK(c_dbcsr_acc_dev_mem_deallocate(trans_dev), NULL, check);
-      CHECK(c_dbcsr_acc_dev_mem_deallocate(amat_dev), NULL, check);
-      CHECK(c_dbcsr_acc_dev_mem_deallocate(bmat_dev), NULL, check);
-      CHECK(c_dbcsr_acc_dev_mem_deallocate(cmat_dev), NULL, check);
+      CHECK(DEV_MEM_DEALLOCATE(stack_dev), NULL, check);
+      CHECK(DEV_MEM_DEALLOCATE(trans_dev), NULL, check);
+      CHECK(DEV_MEM_DEALLOCATE(amat_dev), NULL, check);
+      CHECK(DEV_MEM_DEALLOCATE(bmat_dev), NULL, check);
+      CHECK(DEV_MEM_DEALLOCATE(cmat_dev), NULL, check);
+#  if defined(__OPENCL)
+      if (0 != claimed) CHECK(libxstream_mem_arena_release(&arena, (libxstream_stream_t*)stream), NULL, check);
+#  endif
 #endif
       CHECK(c_dbcsr_acc_stream_destroy(stream), NULL, check);
       if (0 == result || (0 > result && 0 == check)) {
@@ -455,6 +482,9 @@ int main(int argc, char* argv[]) {
     }
   }
   free(rnd); /* release array of random numbers */
+#if defined(__OPENCL)
+  libxstream_mem_arena_destroy(&arena);
+#endif
 #if !defined(__CUDA)
   CHECK(libsmm_acc_finalize(), NULL, check);
 #endif
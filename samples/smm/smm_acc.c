@@ -458,6 +458,14 @@ int libsmm_acc_finalize(void) {
         }
         if (EXIT_SUCCESS != result_entry) result = result_entry;
       }
+      { /* per-thread instances */
+        int result_clones = opencl_libsmm_kernel_release(0 != is_smm
+          ? ((const opencl_libsmm_smm_t*)regentry)->clones[0] : ((const opencl_libsmm_trans_t*)regentry)->clones);
+        if (0 != is_smm && EXIT_SUCCESS == result_clones) {
+          result_clones = opencl_libsmm_kernel_release(((const opencl_libsmm_smm_t*)regentry)->clones[1]);
+        }
+        if (EXIT_SUCCESS != result_clones) result = result_clones;
+      }
     }
     libxs_registry_destroy(opencl_libsmm_registry);
     opencl_libsmm_registry = NULL;
@@ -524,6 +532,47 @@ const char* opencl_libsmm_getenv(const char domain[], const char key[]) {
 }
 
 
+cl_kernel opencl_libsmm_kernel_thread(cl_kernel kernel, cl_kernel** clones) {
+  cl_kernel result = NULL;
+#  if defined(CL_VERSION_2_1)
+  const int nthreads = libxstream_opencl_config.nthreads, tid = libxs_tid();
+  LIBXS_ASSERT(NULL != kernel && NULL != clones);
+  if (0 == libxstream_opencl_config.profile && tid < nthreads) {
+    if (NULL == *clones) *clones = (cl_kernel*)calloc(nthreads, sizeof(cl_kernel));
+    if (NULL != *clones) {
+      result = (*clones)[tid];
+      if (NULL == result) {
+        cl_int result_clone = CL_SUCCESS;
+        result = clCloneKernel(kernel, &result_clone);
+        if (CL_SUCCESS == result_clone) (*clones)[tid] = result;
+        else result = NULL; /* e.g., OpenCL 1.2/2.0 platform */
+      }
+    }
+  }
+#  else
+  LIBXS_UNUSED(kernel);
+  LIBXS_UNUSED(clones);
+#  endif
+  return result;
+}
+
+
+int opencl_libsmm_kernel_release(cl_kernel* clones) {
+  int result = EXIT_SUCCESS;
+  if (NULL != clones) {
+    int i = 0;
+    for (; i < libxstream_opencl_config.nthreads; ++i) {
+      if (NULL != clones[i]) {
+        const int result_clone = clReleaseKernel(clones[i]);
+        if (EXIT_SUCCESS != result_clone) result = result_clone;
+      }
+    }
+    free(clones);
+  }
+  return result;
+}
+
+
 libxstream_bool_t libsmm_acc_process_suitable(
   libxstream_bool_t def_mnk, libsmm_acc_data_t datatype, int stack_size, int m_max, int n_max, int k_max, int max_kernel_dim) {
   libxstream_bool_t result = 0; /* false */
@@ -39,11 +39,15 @@ extern "C" {
 typedef struct opencl_libsmm_transkey_t {
   libsmm_acc_data_t type; /* must be the 1st data member */
   int m, n;
+  /* kernels belong to the calling thread's device (1 + device ID) */
+  int device;
 } opencl_libsmm_transkey_t;
 
 /** Type for transpose kernel configuration. */
 typedef struct opencl_libsmm_trans_t {
   cl_kernel kernel; /* must be the 1st data member */
+  /* per-thread instances of kernel (opencl_libsmm_kernel_thread) */
+  cl_kernel* clones;
   size_t wgsize;
   int bs;
 } opencl_libsmm_trans_t;
@@ -54,11 +58,15 @@ typedef struct opencl_libsmm_smmkey_t {
   int m, n, k;
   /* device matching configuration (parameters) */
   unsigned int devuid;
+  /* kernels belong to the calling thread's device (1 + device ID), tuned parameters to none (0) */
+  int device;
 } opencl_libsmm_smmkey_t;
 
 /** Type for SMM-kernel configuration. */
 typedef struct opencl_libsmm_smm_t {
   cl_kernel kernel[2]; /* must be the 1st data member */
+  /* per-thread instances of kernel[i] (opencl_libsmm_kernel_thread) */
+  cl_kernel* clones[2];
   size_t wgsize[2];
   double gflops;
   /* (pseudo-)parameters (either pretuned or determined) */
@@ -80,6 +88,19 @@ extern libxs_registry_t* opencl_libsmm_registry;
 /** Returns environment variable's value for given domain and key. */
 const char* opencl_libsmm_getenv(const char domain[], const char key[]);
 
+/**
+ * Returns the calling thread's instance of kernel (clCloneKernel), which is
+ * created on first use and kept in clones (indexed by thread-ID). Arguments
+ * set on a private instance cannot race with another thread, hence setting
+ * arguments and launching need no lock. Must be called under the lock that
+ * guards the registry entry. Returns NULL if no instance is available, i.e.,
+ * the shared kernel must be used under that lock (also while profiling, which
+ * identifies a kernel by its handle).
+ */
+cl_kernel opencl_libsmm_kernel_thread(cl_kernel kernel, cl_kernel** clones);
+/** Release per-thread instances (opencl_libsmm_kernel_thread) and the array. */
+int opencl_libsmm_kernel_release(cl_kernel* clones);
+
 /**
  * TRANS-kernel: write key and tunables into a (file-)stream.
  * If config=NULL, key/parameter names are written. The arguments
@@ -90,13 +90,14 @@ int opencl_libsmm_acc_process(const int* host_param_stack, const int* dev_param_
   if (0 != libsmm_acc_process_suitable(def_mnk, datatype, stack_size, m_max, n_max, k_max, max_kernel_dim)) {
     static libxs_lock_t locks[OPENCL_LIBSMM_NLOCKS_SMM];
     const libxs_timer_tick_t start = libxs_timer_tick();
-    const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+    const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
     const char *const env_s = OPENCL_LIBSMM_SMMENV("S"), *const env_bs = OPENCL_LIBSMM_SMMENV("BS");
     const int s = ((NULL == env_s || '\0' == *env_s) ? OPENCL_LIBSMM_SMM_S : atoi(env_s));
     int kernel_idx = 0, bs = ((NULL == env_bs || '\0' == *env_bs) ? 0 : atoi(env_bs));
     opencl_libsmm_smm_t* config;
     libxs_lock_t* lock = locks;
-    opencl_libsmm_smmkey_t key;
+    opencl_libsmm_smmkey_t key, key_tuned;
+    const opencl_libsmm_smmkey_t* key_config = &key;
     LIBXS_MEMZERO(&key); /* potentially heterogeneous key-data */
     key.devuid = (0 != opencl_libsmm_devuid) ? opencl_libsmm_devuid
       : ((1 != libxstream_opencl_config.devmatch && ((unsigned int)-1) != libxstream_opencl_config.devmatch)
@@ -106,13 +107,20 @@ int opencl_libsmm_acc_process(const int* host_param_stack, const int* dev_param_
     key.m = m_max;
     key.n = n_max;
     key.k = k_max;
+    memcpy(&key_tuned, &key, sizeof(key)); /* tuned parameters belong to no particular device */
+    key.device = 1 + devinfo->device_id;
 #  if (1 < OPENCL_LIBSMM_NLOCKS_SMM)
     LIBXS_ASSERT(!(OPENCL_LIBSMM_NLOCKS_SMM & (OPENCL_LIBSMM_NLOCKS_SMM - 1))); /* POT */
     lock += LIBXS_MOD2(libxs_hash(&key, sizeof(key), 25071975 /*seed*/), OPENCL_LIBSMM_NLOCKS_SMM);
 #  endif
-    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, lock); /* calling clSetKernelArg/clEnqueueNDRangeKernel must be consistent */
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, lock); /* guards creation; launching the shared kernel as well */
     config = (opencl_libsmm_smm_t*)libxs_registry_get(
       opencl_libsmm_registry, &key, sizeof(key), libxs_registry_lock(opencl_libsmm_registry));
+    if (NULL == config) { /* no kernel yet for this device: start from the tuned parameters */
+      config = (opencl_libsmm_smm_t*)libxs_registry_get(
+        opencl_libsmm_registry, &key_tuned, sizeof(key_tuned), libxs_registry_lock(opencl_libsmm_registry));
+      if (NULL != config) key_config = &key_tuned;
+    }
 #  if defined(OPENCL_KERNELS_PREDICT_MODELS)
     if (NULL == config && NULL != opencl_libsmm_predict_model) {
       libxs_predict_info_t pinfo;
@@ -179,7 +187,7 @@ int opencl_libsmm_acc_process(const int* host_param_stack, const int* dev_param_
         if (NULL != tname && dbcsr_type_real_8 == datatype) {
           const char* const fp64ext[] = {"cl_khr_fp64"};
           if (EXIT_SUCCESS !=
-              libxstream_opencl_device_ext(libxstream_opencl_config.devices[libxstream_opencl_config.device_id], fp64ext, 1))
+              libxstream_opencl_device_ext(libxstream_opencl_config.devices[devinfo->device_id], fp64ext, 1))
           {
             fprintf(stderr, "ERROR ACC/LIBSMM: device does not support FP64 (cl_khr_fp64) - build with ELEM_TYPE=float\n");
             result = EXIT_FAILURE;
@@ -188,7 +196,7 @@ int opencl_libsmm_acc_process(const int* host_param_stack, const int* dev_param_
         }
         if (NULL != tname) {
           const char *extensions[] = {NULL, NULL};
-          const cl_device_id device_id = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
+          const cl_device_id device_id = libxstream_opencl_config.devices[devinfo->device_id];
           const unsigned int devuid = (0 != opencl_libsmm_devuid) ? opencl_libsmm_devuid : devinfo->uid;
           size_t nextensions = sizeof(extensions) / sizeof(*extensions), sgs = 0, wgsize_prf = 1;
           const char *const env_bm = OPENCL_LIBSMM_SMMENV("BM"), *const env_bn = OPENCL_LIBSMM_SMMENV("BN");
@@ -350,7 +358,7 @@ int opencl_libsmm_acc_process(const int* host_param_stack, const int* dev_param_
               0 == new_config.ac ? "" : (1 == slm_c ? "-DSLM_C=1" : "-DSLM_C=2"));
             /* apply support for FP-atomics */
             if (0 < nchar && (int)sizeof(build_params) > nchar) {
-              nchar = libxstream_opencl_flags_atomics(&libxstream_opencl_config.device, tkind, extensions, &nextensions,
+              nchar = libxstream_opencl_flags_atomics(devinfo, tkind, extensions, &nextensions,
                 build_params + nchar, sizeof(build_params) - nchar);
             }
             else {
@@ -386,6 +394,7 @@ int opencl_libsmm_acc_process(const int* host_param_stack, const int* dev_param_
                   if (NULL == config || NULL == config->kernel[kernel_idx]) {
                     config = (opencl_libsmm_smm_t*)libxs_registry_set(opencl_libsmm_registry, &key, sizeof(key), &new_config,
                       sizeof(new_config), libxs_registry_lock(opencl_libsmm_registry));
+                    key_config = &key;
                   }
                   if (NULL != config) {
                     if (2 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity) {
@@ -436,7 +445,7 @@ int opencl_libsmm_acc_process(const int* host_param_stack, const int* dev_param_
       }
       /* remove configuration from registry to avoid infinitely retrying code generation */
       if (EXIT_SUCCESS != result && NULL != config) {
-        libxs_registry_remove(opencl_libsmm_registry, &key, sizeof(key), libxs_registry_lock(opencl_libsmm_registry));
+        libxs_registry_remove(opencl_libsmm_registry, key_config, sizeof(key), libxs_registry_lock(opencl_libsmm_registry));
       }
 #  if defined(__DBCSR_ACC)
       c_dbcsr_timestop(&routine_handle);
@@ -460,36 +469,36 @@ int opencl_libsmm_acc_process(const int* host_param_stack, const int* dev_param_
     LIBXS_ASSERT(EXIT_SUCCESS != result || (1 <= config->wgsize[kernel_idx]));
     LIBXS_ASSERT(EXIT_SUCCESS != result || (1 <= config->s && 1 <= config->bs));
     if (EXIT_SUCCESS == result) {
+      const opencl_libsmm_smm_t entry = *config; /* registry entry may be updated after unlock */
+      cl_kernel kernel = opencl_libsmm_kernel_thread(entry.kernel[kernel_idx], config->clones + kernel_idx);
       size_t work_size;
+      if (NULL != kernel) { /* private instance: launches of the same shape proceed concurrently */
+        LIBXS_LOCK_RELEASE(LIBXS_LOCK, lock);
+        lock = NULL;
+      }
+      else kernel = entry.kernel[kernel_idx]; /* shared kernel: launch under the lock */
       /* scale intra-kernel batchsize according to stacksize */
-      if (0 == kernel_idx && 1 < config->bs && stack_size < config->s) {
+      if (0 == kernel_idx && 1 < entry.bs && stack_size < entry.s) {
 #  if defined(OPENCL_LIBSMM_BS_MIN)
-        const int config_bs = LIBXS_MAX(config->bs, OPENCL_LIBSMM_BS_MIN);
+        const int config_bs = LIBXS_MAX(entry.bs, OPENCL_LIBSMM_BS_MIN);
 #  else
-        const int config_bs = config->bs;
+        const int config_bs = entry.bs;
 #  endif
-        bs = LIBXS_UPDIV(stack_size * config_bs, config->s - 1);
-        if (config->bs < bs) bs = config->bs;
+        bs = LIBXS_UPDIV(stack_size * config_bs, entry.s - 1);
+        if (entry.bs < bs) bs = entry.bs;
       }
       /* adjust launchsize according to intra-kernel batchsize */
-      work_size = LIBXS_UPDIV(stack_size, bs) * config->wgsize[kernel_idx];
-      /* calling clSetKernelArg/clEnqueueNDRangeKernel must be consistent */
-      LIBXSTREAM_CHECK(
-        result, libxstream_opencl_set_kernel_ptr(config->kernel[kernel_idx], 0, dev_c_data), "set C-matrix argument of SMM-kernel");
-      LIBXSTREAM_CHECK(
-        result, libxstream_opencl_set_kernel_ptr(config->kernel[kernel_idx], 1, dev_a_data), "set A-matrix argument of SMM-kernel");
-      LIBXSTREAM_CHECK(
-        result, libxstream_opencl_set_kernel_ptr(config->kernel[kernel_idx], 2, dev_b_data), "set B-matrix argument of SMM-kernel");
-      LIBXSTREAM_CHECK(result, libxstream_opencl_set_kernel_ptr(config->kernel[kernel_idx], 3, dev_param_stack),
+      work_size = LIBXS_UPDIV(stack_size, bs) * entry.wgsize[kernel_idx];
+      LIBXSTREAM_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, 0, dev_c_data), "set C-matrix argument of SMM-kernel");
+      LIBXSTREAM_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, 1, dev_a_data), "set A-matrix argument of SMM-kernel");
+      LIBXSTREAM_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, 2, dev_b_data), "set B-matrix argument of SMM-kernel");
+      LIBXSTREAM_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, 3, dev_param_stack),
         "set batch-list argument of SMM-kernel");
-      LIBXSTREAM_CHECK(result, clSetKernelArg(config->kernel[kernel_idx], 4, sizeof(int), &param_format),
-        "set batch-format argument of SMM-kernel");
+      LIBXSTREAM_CHECK(result, clSetKernelArg(kernel, 4, sizeof(int), &param_format), "set batch-format argument of SMM-kernel");
       if (0 == kernel_idx) {
-        LIBXS_ASSERT(bs <= config->bs);
-        LIBXSTREAM_CHECK(
-          result, clSetKernelArg(config->kernel[kernel_idx], 5, sizeof(int), &stack_size), "set stacksize argument of SMM-kernel");
-        LIBXSTREAM_CHECK(
-          result, clSetKernelArg(config->kernel[kernel_idx], 6, sizeof(int), &bs), "set minibatch argument of SMM-kernel");
+        LIBXS_ASSERT(bs <= entry.bs);
+        LIBXSTREAM_CHECK(result, clSetKernelArg(kernel, 5, sizeof(int), &stack_size), "set stacksize argument of SMM-kernel");
+        LIBXSTREAM_CHECK(result, clSetKernelArg(kernel, 6, sizeof(int), &bs), "set minibatch argument of SMM-kernel");
       }
       /**
        * State this launch's work so the profile reports rates rather than only
@@ -499,13 +508,12 @@ int opencl_libsmm_acc_process(const int* host_param_stack, const int* dev_param_
        * the kernel on the roofline instead of merely timing it.
        */
       LIBXSTREAM_CHECK(result,
-        libxstream_opencl_launch_work((libxstream_stream_t*)stream, config->kernel[kernel_idx], 1 /*work_dim*/, NULL /*offset*/,
-          &work_size, config->wgsize + kernel_idx, 0, NULL, event,
+        libxstream_opencl_launch_work((libxstream_stream_t*)stream, kernel, 1 /*work_dim*/, NULL /*offset*/, &work_size,
+          entry.wgsize + kernel_idx, 0, NULL, event,
           (size_t)2 * stack_size * m_max * n_max * k_max /*nflops*/,
           (size_t)stack_size * OPENCL_LIBSMM_TYPESIZE(datatype) *
             ((size_t)m_max * k_max + (size_t)k_max * n_max + 2 * (size_t)m_max * n_max) /*nbytes*/),
         "launch SMM-kernel");
-      /* eventually update performance counters inside of locked region */
       if ((3 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity) && 0 == param_format &&
           EXIT_SUCCESS == result)
       {
@@ -514,12 +522,12 @@ int opencl_libsmm_acc_process(const int* host_param_stack, const int* dev_param_
         opencl_libsmm_write_smm_params(
           stderr, 1 /*only_key*/, &key, NULL /*config*/, NULL /*delim*/, NULL /*begin*/, NULL /*close*/);
         fprintf(stderr, "=");
-        opencl_libsmm_write_smm_params(stderr, 1 /*only_key*/, &key, config, NULL /*delim*/, NULL /*begin*/, NULL /*close*/);
+        opencl_libsmm_write_smm_params(stderr, 1 /*only_key*/, &key, &entry, NULL /*delim*/, NULL /*begin*/, NULL /*close*/);
         fprintf(stderr, " ss=%i\n", stack_size);
         LIBXS_STDIO_RELEASE();
       }
     }
-    LIBXS_LOCK_RELEASE(LIBXS_LOCK, lock);
+    if (NULL != lock) LIBXS_LOCK_RELEASE(LIBXS_LOCK, lock);
   }
   else if (0 < stack_size) { /* inhomogeneous, large kernel, or unsupported datatype */
     return -1; /* TODO: document result code to trigger host-fallback */
@@ -79,12 +79,13 @@ int libsmm_acc_transpose(const int* dev_trs_stack, int offset, int stack_size, v
     key.type = datatype;
     key.m = m;
     key.n = n; /* initialize key */
+    key.device = 1 + libxstream_opencl_device()->device_id;
 #  if (1 < OPENCL_LIBSMM_NLOCKS_TRANS)
     LIBXS_ASSERT(!(OPENCL_LIBSMM_NLOCKS_TRANS & (OPENCL_LIBSMM_NLOCKS_TRANS - 1))); /* POT */
     hash = libxs_hash(&key, sizeof(key), 25071975 /*seed*/);
     lock += LIBXS_MOD2(hash, OPENCL_LIBSMM_NLOCKS_TRANS);
 #  endif
-    /* calling clSetKernelArg/clEnqueueNDRangeKernel must be consistent */
+    /* guards creation; launching the shared kernel (no per-thread instance) as well */
     LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, lock);
     config = (opencl_libsmm_trans_t*)libxs_registry_get(
       opencl_libsmm_registry, &key, sizeof(key), libxs_registry_lock(opencl_libsmm_registry));
@@ -99,8 +100,8 @@ int libsmm_acc_transpose(const int* dev_trs_stack, int offset, int stack_size, v
       c_dbcsr_timeset(LIBSMM_ACC_TRANSPOSE_ROUTINE_NAME_STRPTR, LIBSMM_ACC_TRANSPOSE_ROUTINE_NAME_LENPTR, &routine_handle);
 #  endif
       if (0 < nchar && (int)sizeof(fname) > nchar) {
-        const cl_device_id device_id = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
-        const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+        const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
+        const cl_device_id device_id = libxstream_opencl_config.devices[devinfo->device_id];
         const char *const env_cl = OPENCL_LIBSMM_TRANSENV("BUILDOPTS"), *const env_bm = OPENCL_LIBSMM_TRANSENV("BM");
         const char* const env_bs = OPENCL_LIBSMM_TRANSENV("BS");
         const char* const cmem = (EXIT_SUCCESS != libxstream_opencl_use_cmem_size(devinfo, 0) ? "global" : "constant");
@@ -191,38 +192,42 @@ int libsmm_acc_transpose(const int* dev_trs_stack, int offset, int stack_size, v
     }
     LIBXS_ASSERT((NULL != config && NULL != config->kernel && 0 < config->wgsize && 1 <= config->bs) || EXIT_SUCCESS != result);
     if (EXIT_SUCCESS == result) {
-      const size_t work_size = config->wgsize * LIBXS_UPDIV(stack_size, config->bs);
-      LIBXSTREAM_CHECK(result, clSetKernelArg(config->kernel, 0, sizeof(int), &offset), "set offset argument of transpose kernel");
+      const opencl_libsmm_trans_t entry = *config; /* registry entry may be updated after unlock */
+      const size_t work_size = entry.wgsize * LIBXS_UPDIV(stack_size, entry.bs);
+      cl_kernel kernel = opencl_libsmm_kernel_thread(entry.kernel, &config->clones);
+      if (NULL != kernel) { /* private instance: launches of the same shape proceed concurrently */
+        LIBXS_LOCK_RELEASE(LIBXS_LOCK, lock);
+        lock = NULL;
+      }
+      else kernel = entry.kernel; /* shared kernel: clSetKernelArg/clEnqueueNDRangeKernel must be consistent */
+      LIBXSTREAM_CHECK(result, clSetKernelArg(kernel, 0, sizeof(int), &offset), "set offset argument of transpose kernel");
       LIBXSTREAM_CHECK(
-        result, libxstream_opencl_set_kernel_ptr(config->kernel, 1, dev_trs_stack), "set batch-list argument of transpose kernel");
+        result, libxstream_opencl_set_kernel_ptr(kernel, 1, dev_trs_stack), "set batch-list argument of transpose kernel");
       LIBXSTREAM_CHECK(
-        result, libxstream_opencl_set_kernel_ptr(config->kernel, 2, dev_data), "set matrix-data argument of transpose kernel");
-      if (1 < config->bs) {
-        LIBXSTREAM_CHECK(
-          result, clSetKernelArg(config->kernel, 3, sizeof(int), &stack_size), "set stacksize argument of transpose kernel");
-        LIBXSTREAM_CHECK(
-          result, clSetKernelArg(config->kernel, 4, sizeof(int), &config->bs), "set minibatch argument of transpose kernel");
+        result, libxstream_opencl_set_kernel_ptr(kernel, 2, dev_data), "set matrix-data argument of transpose kernel");
+      if (1 < entry.bs) {
+        LIBXSTREAM_CHECK(result, clSetKernelArg(kernel, 3, sizeof(int), &stack_size), "set stacksize argument of transpose kernel");
+        LIBXSTREAM_CHECK(result, clSetKernelArg(kernel, 4, sizeof(int), &entry.bs), "set minibatch argument of transpose kernel");
       }
       /* transposing performs no arithmetic: each of the stack_size matrices is
          read once and written once, so only a byte count is stated */
       LIBXSTREAM_CHECK(result,
-        libxstream_opencl_launch_work((libxstream_stream_t*)stream, config->kernel, 1 /*work_dim*/, NULL /*offset*/, &work_size,
-          &config->wgsize, 0, NULL, NULL, 0 /*nflops*/,
+        libxstream_opencl_launch_work((libxstream_stream_t*)stream, kernel, 1 /*work_dim*/, NULL /*offset*/, &work_size,
+          &entry.wgsize, 0, NULL, NULL, 0 /*nflops*/,
           (size_t)stack_size * OPENCL_LIBSMM_TYPESIZE(datatype) * 2 * mn /*nbytes*/),
         "launch transpose kernel");
-      /* eventually update performance counters inside of locked region */
       if ((3 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity) && EXIT_SUCCESS == result) {
         LIBXS_STDIO_ACQUIRE();
         fprintf(stderr, "INFO ACC/LIBSMM: TRANS-kernel ");
         opencl_libsmm_write_trans_params(
           stderr, 1 /*only_key*/, &key, NULL /*config*/, NULL /*delim*/, NULL /*begin*/, NULL /*close*/);
         fprintf(stderr, "=");
-        opencl_libsmm_write_trans_params(stderr, 1 /*only_key*/, &key, config, NULL /*delim*/, NULL /*begin*/, NULL /*close*/);
+        opencl_libsmm_write_trans_params(stderr, 1 /*only_key*/, &key, &entry, NULL /*delim*/, NULL /*begin*/, NULL /*close*/);
         fprintf(stderr, " ss=%i\n", stack_size);
         LIBXS_STDIO_RELEASE();
       }
     }
-    LIBXS_LOCK_RELEASE(LIBXS_LOCK, lock);
+    if (NULL != lock) LIBXS_LOCK_RELEASE(LIBXS_LOCK, lock);
   }
   return result;
 }
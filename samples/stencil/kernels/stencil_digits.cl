@@ -0,0 +1,56 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#ifndef STENCIL_DIGITS_CL
+#define STENCIL_DIGITS_CL
+
+#include "../../../libxstream/opencl/libxstream_common.h"
+
+/**
+ * Biased IEEE exponent of a float, i.e., |x| < 2^(e - 126) for a non-zero value.
+ * The exponent buffers of the INT8 path and the INT8 snapshots take the maximum
+ * over a block.
+ */
+#define STENCIL_EXPONENT(VALUE) ((int)((as_uint(VALUE) >> 23) & 0xFFu))
+
+
+#if defined(ROUND_TO_BF16)
+/**
+ * Value at storage index idx, i.e., the device counterpart of the host packing
+ * (stencil_pack_bf16s). ndigits: -1 = FP32, 0 = FP16, 1 or 2 = BF16 limbs
+ * (limb k at idx + k * n).
+ */
+inline float stencil_digits_load(global const void* p, long idx, long n, int ndigits)
+{
+  float value;
+  if (0 > ndigits) value = ((global const float*)p)[idx];
+  else if (0 == ndigits) value = vload_half((size_t)idx, (global const half*)p);
+  else {
+    global const ushort* const limbs = (global const ushort*)p;
+    value = BF16_TO_F32(limbs[idx]);
+    if (1 < ndigits) value += BF16_TO_F32(limbs[idx + n]);
+  }
+  return value;
+}
+
+
+inline void stencil_digits_store(global void* p, long idx, long n, int ndigits, float value)
+{
+  if (0 > ndigits) ((global float*)p)[idx] = value;
+  else if (0 == ndigits) vstore_half_rte(value, (size_t)idx, (global half*)p);
+  else {
+    global ushort* const limbs = (global ushort*)p;
+    const ushort hi = ROUND_TO_BF16(value);
+    limbs[idx] = hi;
+    if (1 < ndigits) limbs[idx + n] = ROUND_TO_BF16(value - BF16_TO_F32(hi));
+  }
+}
+#endif
+
+#endif /*STENCIL_DIGITS_CL*/
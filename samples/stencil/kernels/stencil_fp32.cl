@@ -110,7 +110,7 @@ kernel void stencil_apply_direct(
 
   const int i_f = (int)get_global_id(0);
   const int i_m = (int)get_global_id(1);
-  const int is_base = (int)get_group_id(2) * BLK;
+  const int is_base = (int)get_global_id(2) * BLK; /* local size 1: honors an offset */
   const int lf = (int)get_local_id(0);
   const int lm = (int)get_local_id(1);
   const int lid = lm * WG_X + lf;
@@ -312,3 +312,119 @@ kernel void stencil_apply_direct(
   }
 #endif
 }
+
+
+#if defined(STENCIL_TB) && (1 < STENCIL_TB)
+/**
+ * Temporal blocking: STENCIL_TB time steps per launch (XYZ, FP32, no PML).
+ * Level t (1 <= t < STENCIL_TB) lags level t-1 by RADIUS planes along the slow
+ * axis and is kept in SLM as a ring of 2*RADIUS+1 planes, widened by the halo
+ * RADIUS*(STENCIL_TB-t) that the remaining steps consume (overlapped tiling).
+ */
+#define TB_RING (2 * RADIUS + 1)
+#define TB_EXT(T) (RADIUS * (STENCIL_TB - (T)))
+#define TB_PF(T) (WG_X + 2 * TB_EXT(T))
+#define TB_PM(T) (WG_Y + 2 * TB_EXT(T))
+#define TB_LEVEL_SLM(T) ((T) < STENCIL_TB ? (TB_RING * TB_PF(T) * TB_PM(T)) : 0)
+#define TB_SLM (TB_LEVEL_SLM(1) + TB_LEVEL_SLM(2) + TB_LEVEL_SLM(3))
+
+inline int tb_clamp(int value, int n)
+{
+  return (0 > value) ? 0 : ((value < n) ? value : (n - 1));
+}
+
+inline int tb_offset(int level)
+{
+  int result = 0, t;
+  for (t = 1; t < level; ++t) result += TB_LEVEL_SLM(t);
+  return result;
+}
+
+/* Level -1 (p_old) and 0 (p_cur) are read from memory, others from SLM; clamped like a single step. */
+inline float tb_value(global const float* restrict p_cur, global const float* restrict p_old,
+  local const float* restrict slm, int level, int f0, int m0, int gf, int gm, int gs)
+{
+  float result;
+  gf = tb_clamp(gf, FP32_NFAST);
+  gm = tb_clamp(gm, FP32_NMED);
+  gs = tb_clamp(gs, FP32_NSLOW);
+  if (0 >= level) {
+    result = (0 == level ? p_cur : p_old)[FP32_P_FMS(gf, gm, gs)];
+  }
+  else {
+    const int ext = TB_EXT(level), pf = TB_PF(level);
+    result = slm[tb_offset(level) + ((gs % TB_RING) * TB_PM(level) + gm - m0 + ext) * pf + gf - f0 + ext];
+  }
+  return result;
+}
+
+/**
+ * A work-group owns a WG_X x WG_Y column and a BLK-chunk of the slow axis. The
+ * last two levels are written to p_new and p_prev, which must not alias p_cur or
+ * p_old since other work-groups read their inputs beyond their own column.
+ */
+__attribute__((reqd_work_group_size(WG_X, WG_Y, 1)))
+kernel void stencil_apply_temporal(
+  global const float* restrict p_cur,
+  global const float* restrict p_old,
+  global float* restrict p_new,
+  global float* restrict p_prev,
+  global const float* restrict vel,
+  CONSTANT float* restrict coeff,
+  float dt2,
+  int nx, int ny, int nz)
+{
+  local float slm[TB_SLM];
+  const int f0 = (int)get_group_id(0) * WG_X;
+  const int m0 = (int)get_group_id(1) * WG_Y;
+  const int s0 = (int)get_group_id(2) * BLK;
+  const int s1 = min(s0 + BLK, FP32_NSLOW);
+  const int lid = (int)get_local_id(1) * WG_X + (int)get_local_id(0);
+  CONSTANT const float* cf = FP32_COEFF_FAST;
+  CONSTANT const float* cm = FP32_COEFF_MED;
+  CONSTANT const float* cs = FP32_COEFF_SLOW;
+  int j, t, r, idx;
+
+  /* j is the plane of level 1, level t works on plane j - RADIUS * (t - 1) */
+  for (j = s0 - TB_EXT(1); j < s1 + TB_EXT(1); ++j) {
+    UNROLL_FORCE(STENCIL_TB) for (t = 1; t <= STENCIL_TB; ++t) {
+      const int gs = j - RADIUS * (t - 1), ext = TB_EXT(t);
+      if (max(s0 - ext, 0) <= gs && gs < min(s1 + ext, FP32_NSLOW)) {
+        const int pf = TB_PF(t), pm = TB_PM(t);
+        for (idx = lid; idx < pf * pm; idx += WG_SIZE) {
+          const int gf = f0 - ext + idx % pf, gm = m0 - ext + idx / pf;
+          if (0 <= gf && gf < FP32_NFAST && 0 <= gm && gm < FP32_NMED) {
+            const float pc = tb_value(p_cur, p_old, slm, t - 1, f0, m0, gf, gm, gs);
+            const float po = tb_value(p_cur, p_old, slm, t - 2, f0, m0, gf, gm, gs);
+            float lap = cf[RADIUS] * pc, value;
+            UNROLL_FORCE(RADIUS) for (r = 1; r <= RADIUS; ++r) {
+              lap += cf[RADIUS + r] * (tb_value(p_cur, p_old, slm, t - 1, f0, m0, gf + r, gm, gs)
+                                     + tb_value(p_cur, p_old, slm, t - 1, f0, m0, gf - r, gm, gs));
+            }
+            lap += cm[RADIUS] * pc;
+            UNROLL_FORCE(RADIUS) for (r = 1; r <= RADIUS; ++r) {
+              lap += cm[RADIUS + r] * (tb_value(p_cur, p_old, slm, t - 1, f0, m0, gf, gm + r, gs)
+                                     + tb_value(p_cur, p_old, slm, t - 1, f0, m0, gf, gm - r, gs));
+            }
+            lap += cs[RADIUS] * pc;
+            UNROLL_FORCE(RADIUS) for (r = 1; r <= RADIUS; ++r) {
+              lap += cs[RADIUS + r] * (tb_value(p_cur, p_old, slm, t - 1, f0, m0, gf, gm, gs + r)
+                                     + tb_value(p_cur, p_old, slm, t - 1, f0, m0, gf, gm, gs - r));
+            }
+            value = 2.0f * pc - po + dt2 * vel[FP32_V_FMS(gf, gm, gs)] * lap;
+            if (STENCIL_TB == t) {
+              const long ip = FP32_P_FMS(gf, gm, gs);
+              p_new[ip] = value;
+              p_prev[ip] = pc;
+            }
+            else {
+              slm[tb_offset(t) + ((gs % TB_RING) * pm + idx / pf) * pf + idx % pf] = value;
+            }
+          }
+        }
+      }
+      barrier(CLK_LOCAL_MEM_FENCE);
+    }
+  }
+}
+#endif
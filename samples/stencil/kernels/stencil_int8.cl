@@ -8,6 +8,7 @@
 * SPDX-License-Identifier: BSD-3-Clause                                       *
 ******************************************************************************/
 #include "stencil_common.cl"
+#include "stencil_digits.cl"
 
 #if !defined(NSLICES_A)
 # define NSLICES_A 1
@@ -541,7 +542,7 @@ kernel void stencil_apply_int8(
             val = 2.0f * STENCIL_LOAD_P(p_grid, i) - STENCIL_LOAD_P(p_old, i)
                 + dt2 * vel[iv] * u.a[m];
 #endif
-            { const int oe = (int)((as_uint(val) >> 23) & 0xFFu);
+            { const int oe = STENCIL_EXPONENT(val);
               STENCIL_STORE_P(p_new, i, val);
               if (oe > out_max_exp) out_max_exp = oe;
             }
@@ -0,0 +1,68 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+/* Portable round-to-nearest-even, i.e., the same digits as the host packing. */
+#if !defined(USE_BF16)
+# define USE_BF16 1
+#endif
+
+#include "stencil_digits.cl"
+
+/* Block dimension (cube side length). */
+#if !defined(BLK)
+# define BLK 32
+#endif
+
+/* Layout identifiers (as in stencil_common.cl). */
+#define STENCIL_LAYOUT_XYZ 0
+#define STENCIL_LAYOUT_BLK 1
+#define STENCIL_LAYOUT_ZYX 2
+
+
+/**
+ * Convert a raw upload (linear [gz][gy][gx], x fastest) into the storage layout.
+ * One work-item per destination point, i.e., the NDRange spans the destination
+ * including halo (ZYX) or partial blocks (BLK). Points without a source value
+ * are zeroed, hence the destination needs no separate fill.
+ *
+ * XYZ/ZYX: dimension 0 is the fastest destination axis (x respectively z).
+ * BLK:     NDRange is (nbx, nby, nbz) * BLK, tiles of BLK^3 in block order.
+ * ndigits: -1 = FP32, 0 = FP16, 1 or 2 = BF16 limbs (limb k at idx + k * n).
+ */
+kernel void stencil_layout_convert(global const float* restrict src, global void* restrict dst,
+  int nx, int ny, int nz, int hx, int hy, int hz, int layout, int ndigits)
+{
+  const int i0 = (int)get_global_id(0), i1 = (int)get_global_id(1), i2 = (int)get_global_id(2);
+  const int n0 = (int)get_global_size(0), n1 = (int)get_global_size(1);
+  const long n = (long)n0 * n1 * get_global_size(2);
+  int gx, gy, gz;
+  long idx;
+  float value = 0.0f;
+
+  if (STENCIL_LAYOUT_BLK == layout) {
+    const int nbx = n0 / BLK, nby = n1 / BLK;
+    gx = i0; gy = i1; gz = i2;
+    idx = ((long)(gz / BLK) * nby * nbx + (long)(gy / BLK) * nbx + gx / BLK) * (BLK * BLK * BLK)
+        + (long)(gz % BLK) * (BLK * BLK) + (gy % BLK) * BLK + (gx % BLK);
+  }
+  else {
+    if (STENCIL_LAYOUT_ZYX == layout) {
+      gz = i0 - hz; gy = i1 - hy; gx = i2 - hx;
+    }
+    else {
+      gx = i0 - hx; gy = i1 - hy; gz = i2 - hz;
+    }
+    idx = ((long)i2 * n1 + i1) * n0 + i0;
+  }
+  if (0 <= gx && gx < nx && 0 <= gy && gy < ny && 0 <= gz && gz < nz) {
+    value = src[((long)gz * ny + gy) * nx + gx];
+  }
+
+  stencil_digits_store(dst, idx, n, ndigits, value);
+}
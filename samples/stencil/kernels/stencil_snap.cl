@@ -0,0 +1,72 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+/* Portable round-to-nearest-even, i.e., the same digits as the host packing. */
+#if !defined(USE_BF16)
+# define USE_BF16 1
+#endif
+
+#include "stencil_digits.cl"
+
+/* Values sharing an exponent (INT8 codec), and the work-group size of its kernels. */
+#if !defined(SNAP_BLK)
+# define SNAP_BLK 256
+#endif
+
+
+/** Compress FP32 storage into BF16 digits (limb k at idx + k * n), i.e., 1 or 2 limbs. */
+kernel void stencil_snap_bf16(global const float* restrict src, global ushort* restrict dst,
+  long n, int ndigits)
+{
+  const long idx = (long)get_global_id(0);
+  if (idx < n) stencil_digits_store(dst, idx, n, ndigits, src[idx]);
+}
+
+
+kernel void stencil_unsnap_bf16(global const ushort* restrict src, global float* restrict dst,
+  long n, int ndigits)
+{
+  const long idx = (long)get_global_id(0);
+  if (idx < n) dst[idx] = stencil_digits_load(src, idx, n, ndigits);
+}
+
+
+/**
+ * Compress FP32 storage into INT8 slices with one exponent per SNAP_BLK values
+ * (one work-group per block): |x| < 2^e for the block's maximum (the same scan
+ * as the exponent buffer of the INT8 path), i.e., a value is kept as x * 2^(7-e)
+ * rounded to the nearest integer.
+ */
+__attribute__((reqd_work_group_size(SNAP_BLK, 1, 1)))
+kernel void stencil_snap_int8(global const float* restrict src, global char* restrict dst,
+  global char* restrict exps, long n)
+{
+  local int emax[SNAP_BLK];
+  const long idx = (long)get_global_id(0);
+  const int l = (int)get_local_id(0);
+  const float value = (idx < n ? src[idx] : 0.0f);
+  int s, e;
+  emax[l] = STENCIL_EXPONENT(value);
+  barrier(CLK_LOCAL_MEM_FENCE);
+  for (s = SNAP_BLK / 2; 0 < s; s >>= 1) {
+    if (l < s) emax[l] = max(emax[l], emax[l + s]);
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+  e = clamp(emax[0] - 126, -126, 127);
+  if (idx < n) dst[idx] = (char)clamp(rint(ldexp(value, 7 - e)), -127.0f, 127.0f);
+  if (0 == l) exps[get_group_id(0)] = (char)e;
+}
+
+
+kernel void stencil_unsnap_int8(global const char* restrict src, global const char* restrict exps,
+  global float* restrict dst, long n)
+{
+  const long idx = (long)get_global_id(0);
+  if (idx < n) dst[idx] = ldexp((float)src[idx], (int)exps[idx / SNAP_BLK] - 7);
+}
@@ -0,0 +1,43 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+/* Portable round-to-nearest-even, i.e., the same digits as the host packing. */
+#if !defined(USE_BF16)
+# define USE_BF16 1
+#endif
+
+#include "stencil_digits.cl"
+
+
+/**
+ * Add the wavelet sample of the given step at every source (one work-item per
+ * source). src_idx holds storage indexes (layout resolved on the host), which
+ * must be distinct, and src_amp the scaling (velocity^2 * dt^2) per source.
+ */
+kernel void stencil_inject(global void* restrict p, global const long* restrict src_idx,
+  global const float* restrict src_amp, global const float* restrict wavelet,
+  int step, int nsrc, long n, int ndigits)
+{
+  const int s = (int)get_global_id(0);
+  if (s < nsrc) {
+    const long idx = src_idx[s];
+    stencil_digits_store(p, idx, n, ndigits, stencil_digits_load(p, idx, n, ndigits) + src_amp[s] * wavelet[step]);
+  }
+}
+
+
+/** Sample the wavefield at every receiver into row "slot" of the trace batch. */
+kernel void stencil_record(global const void* restrict p, global const long* restrict rcv_idx,
+  global float* restrict traces, int slot, int nrcv, long n, int ndigits)
+{
+  const int r = (int)get_global_id(0);
+  if (r < nrcv) {
+    traces[(long)slot * nrcv + r] = stencil_digits_load(p, rcv_idx[r], n, ndigits);
+  }
+}
@@ -50,6 +50,17 @@ static void stencil_cpu_reference(float* p_new, const float* p_cur,
                                   const double* fd_w, int radius,
                                   int nx, int ny, int nz,
                                   int nterms, float dt2);
+static int stencil_graph_bench(stencil_context_t* ctx, void* p_buf[2], void* vel,
+                               float dt2, float dh, int nterms, int nsteps);
+static int stencil_survey_init(stencil_context_t* ctx, stencil_survey_t* survey, int nrcv,
+                              const float* vel_host, float dt, int nsteps,
+                              int** survey_xyz, float** wavelet);
+static int stencil_domain_bench(int ndomains, int ndevices, const float* p_host,
+                                const float* vel_host, int nx, int ny, int nz,
+                                const double* fd_w, float dt2, float dh, int nsteps, int warmup);
+static int stencil_snap_bench(stencil_context_t* ctx, void* p_buf[2], void* vel,
+                              float dt2, float dh, int nterms, int nsteps,
+                              int every, size_t dev_bytes);
 static void usage(const char* prog);
 
 
@@ -189,6 +200,9 @@ int main(int argc, char* argv[])
     result = libxstream_init();
     if (EXIT_SUCCESS == result) initialized = 1;
   }
+  if (EXIT_SUCCESS == result) { /* device memory of this run (finalize report) */
+    result = libxstream_mem_tag_push("stencil");
+  }
   if (EXIT_SUCCESS == result) {
     result = libxstream_device_count(&ndevices);
     if (EXIT_SUCCESS == result && 0 < ndevices) {
@@ -227,6 +241,9 @@ int main(int argc, char* argv[])
     if (0 != trace) fprintf(stderr, "TRACE: configure\n");
     result = stencil_configure(&ctx, nx, ny, nz);
     if (0 != trace) fprintf(stderr, "TRACE: configure done result=%d\n", result);
+    if (EXIT_SUCCESS == result && 1 < ctx.tsteps) {
+      printf("  Temporal:   %d steps per launch (SLM-blocked)\n", ctx.tsteps);
+    }
   }
   if (EXIT_SUCCESS == result) {
     if (0 != trace) fprintf(stderr, "TRACE: precompute operators\n");
@@ -258,10 +275,16 @@ int main(int argc, char* argv[])
     float* p_host = NULL;
     float* p_host_init = NULL;
     float* vel_host = NULL;
-    float* pack_buf = NULL;
+    stencil_survey_t survey;
+    int* survey_xyz = NULL; /* source, then receivers */
+    float* wavelet = NULL;
     libxs_timer_tick_t t0, t1;
-    double t_elapsed, gpts_per_s;
-    int t, cur, old;
+    double t_elapsed, t_upload, t_traces = 0, gpts_per_s;
+    const char *const survey_env = getenv("STENCIL_SURVEY");
+    const int nrcv = (NULL == survey_env) ? 0 : LIBXS_MAX(atoi(survey_env), 0);
+    int cur;
+
+    LIBXS_MEMZERO(&survey);
 
     if (EXIT_SUCCESS == result) {
       if (0 != trace) fprintf(stderr, "TRACE: allocate p_host\n");
@@ -273,11 +296,6 @@ int main(int argc, char* argv[])
       result = libxstream_mem_host_allocate((void**)&vel_host, grid_bytes, ctx.stream);
       if (0 != trace) fprintf(stderr, "TRACE: allocate vel_host done result=%d\n", result);
     }
-    if (EXIT_SUCCESS == result && (0 != ctx.blocked || 0 != ctx.bf16s || 0 != ctx.fp16)) {
-      const size_t pack_bytes = (dev_bytes < dev_fp32_bytes)
-        ? dev_fp32_bytes : dev_bytes;
-      result = libxstream_mem_host_allocate((void**)&pack_buf, pack_bytes, ctx.stream);
-    }
 
     if (EXIT_SUCCESS == result) {
       if (VEL_FILE == vel_model && NULL != vel_file) {
@@ -336,115 +354,41 @@ int main(int argc, char* argv[])
     if (EXIT_SUCCESS == result) result = libxstream_mem_dev_allocate_hint(&p_buf[1], dev_bytes, libxstream_opencl_mem_hint_compress);
     if (EXIT_SUCCESS == result) result = libxstream_mem_dev_allocate_hint(&vel_dev, vel_dev_bytes, libxstream_opencl_mem_hint_compress);
 
+    /* raw upload, layout and storage conversion on the device */
+    t0 = libxs_timer_tick();
     if (EXIT_SUCCESS == result) {
-      if (0 != store_limbs) {
-        const int store_ndigits = (0 != ctx.fp16) ? 0 : store_limbs;
-        if (0 != ctx.blocked) {
-          stencil_pack_bf16s_blocked((unsigned short*)pack_buf, p_host, nx, ny, nz,
-            ctx.nblocks[0], ctx.nblocks[1], ctx.nblocks[2], store_ndigits);
-        }
-        else if (2 == ctx.layout) {
-          stencil_pack_bf16s_zyx((unsigned short*)pack_buf, p_host,
-            nx, ny, nz, hx, hy, hz, store_ndigits);
-        }
-        else {
-          stencil_pack_bf16s((unsigned short*)pack_buf, p_host, (size_t)nx * ny * nz,
-            store_ndigits);
-        }
-        result = libxstream_mem_copy_h2d(pack_buf, p_buf[0], dev_bytes, ctx.stream);
-      }
-      else if (0 != ctx.blocked) {
-        stencil_pack_blocked(pack_buf, p_host, nx, ny, nz,
-          ctx.nblocks[0], ctx.nblocks[1], ctx.nblocks[2]);
-        result = libxstream_mem_copy_h2d(pack_buf, p_buf[0], dev_bytes, ctx.stream);
-      }
-      else if (2 == ctx.layout && (0 != hx || 0 != hy || 0 != hz)) {
-        const int pnx = nx + 2 * hx, pny = ny + 2 * hy, pnz = nz + 2 * hz;
-        float* zyx_buf = NULL;
-        result = libxstream_mem_host_allocate((void**)&zyx_buf, dev_bytes, ctx.stream);
-        if (EXIT_SUCCESS == result) {
-          int ix, iy, iz;
-          const size_t n_padded = (size_t)pnx * pny * pnz;
-          size_t idx;
-#if defined(_OPENMP)
-#         pragma omp parallel for
-#endif
-          for (idx = 0; idx < n_padded; ++idx) zyx_buf[idx] = 0.0f;
-#if defined(_OPENMP)
-#         pragma omp parallel for LIBXS_OPENMP_COLLAPSE(3)
-#endif
-          for (ix = 0; ix < nx; ++ix) {
-            for (iy = 0; iy < ny; ++iy) {
-              for (iz = 0; iz < nz; ++iz) {
-                const long src = (long)iz * ny * nx + (long)iy * nx + ix;
-                const long dst = (long)(ix + hx) * pny * pnz + (long)(iy + hy) * pnz + (iz + hz);
-                zyx_buf[dst] = p_host[src];
-              }
-            }
-          }
-          result = libxstream_mem_copy_h2d(zyx_buf, p_buf[0], dev_bytes, ctx.stream);
-          libxstream_mem_host_deallocate(zyx_buf, ctx.stream);
-        }
-      }
-      else {
-        result = libxstream_mem_copy_h2d(p_host, p_buf[0], grid_bytes, ctx.stream);
-      }
+      const int store_ndigits = (0 == store_limbs) ? -1
+        : ((0 != ctx.fp16) ? 0 : store_limbs);
+      result = stencil_upload_field(&ctx, p_buf[0], p_host, 1 /*padded*/, store_ndigits);
     }
     if (EXIT_SUCCESS == result) {
       result = libxstream_mem_zero(p_buf[1], 0, dev_bytes, ctx.stream);
     }
     if (EXIT_SUCCESS == result) {
-      if (0 != ctx.blocked) {
-        stencil_pack_blocked(pack_buf, vel_host, nx, ny, nz,
-          ctx.nblocks[0], ctx.nblocks[1], ctx.nblocks[2]);
-        result = libxstream_mem_copy_h2d(pack_buf, vel_dev, vel_dev_bytes, ctx.stream);
-      }
-      else if (2 == ctx.layout) {
-        float* zyx_vel = NULL;
-        result = libxstream_mem_host_allocate((void**)&zyx_vel, grid_bytes, ctx.stream);
-        if (EXIT_SUCCESS == result) {
-          int ix, iy, iz;
-#if defined(_OPENMP)
-#         pragma omp parallel for LIBXS_OPENMP_COLLAPSE(3)
-#endif
-          for (ix = 0; ix < nx; ++ix) {
-            for (iy = 0; iy < ny; ++iy) {
-              for (iz = 0; iz < nz; ++iz) {
-                const long src = (long)iz * ny * nx + (long)iy * nx + ix;
-                const long dst = (long)ix * ny * nz + (long)iy * nz + iz;
-                zyx_vel[dst] = vel_host[src];
-              }
-            }
-          }
-          result = libxstream_mem_copy_h2d(zyx_vel, vel_dev, grid_bytes, ctx.stream);
-          libxstream_mem_host_deallocate(zyx_vel, ctx.stream);
-        }
-      }
-      else {
-        result = libxstream_mem_copy_h2d(vel_host, vel_dev, grid_bytes, ctx.stream);
-      }
+      result = stencil_upload_field(&ctx, vel_dev, vel_host, 0 /*padded*/, -1 /*FP32*/);
     }
     if (EXIT_SUCCESS == result) {
       result = libxstream_stream_sync(ctx.stream);
     }
+    t_upload = libxs_timer_duration(t0, libxs_timer_tick());
     if (EXIT_SUCCESS == result && 0 != ctx.int8) {
       result = stencil_seed_exp_buf(&ctx, p_host, nx, ny, nz);
     }
 
-    cur = 0; old = 1;
+    cur = 0;
+    if (EXIT_SUCCESS == result) {
+      result = stencil_apply_steps(&ctx, p_buf, &cur, vel_dev, dt2, dh, nterms, warmup);
+    }
+    if (EXIT_SUCCESS == result) {
+      result = libxstream_stream_sync(ctx.stream);
+    }
+    if (EXIT_SUCCESS == result && 0 < nrcv) { /* measured steps only */
+      result = stencil_survey_init(&ctx, &survey, nrcv, vel_host, dt_local, ntsteps,
+        &survey_xyz, &wavelet);
+    }
     t0 = libxs_timer_tick();
-
-    for (t = 0; t < warmup + ntsteps && EXIT_SUCCESS == result; ++t) {
-      int tmp;
-      if (t == warmup) {
-        result = libxstream_stream_sync(ctx.stream);
-        t0 = libxs_timer_tick();
-      }
-      if (EXIT_SUCCESS == result) {
-        result = stencil_apply_laplacian(&ctx,
-          p_buf[cur], p_buf[old], p_buf[old], vel_dev, dt2, dh, nterms);
-      }
-      tmp = cur; cur = old; old = tmp;
+    if (EXIT_SUCCESS == result) {
+      result = stencil_apply_steps(&ctx, p_buf, &cur, vel_dev, dt2, dh, nterms, ntsteps);
     }
     if (EXIT_SUCCESS == result) {
       result = libxstream_stream_sync(ctx.stream);
@@ -452,6 +396,10 @@ int main(int argc, char* argv[])
 
     t1 = libxs_timer_tick();
     t_elapsed = libxs_timer_duration(t0, t1);
+    if (EXIT_SUCCESS == result && 0 < nrcv) { /* what the trace stream did not hide */
+      result = stencil_survey_finish(&ctx);
+      t_traces = libxs_timer_duration(t1, libxs_timer_tick());
+    }
 
     if (EXIT_SUCCESS == result) {
       gpts_per_s = gpoints * ntsteps / t_elapsed;
@@ -461,6 +409,14 @@ int main(int argc, char* argv[])
       printf("  Per step:   %.3f ms\n", 1000.0 * t_elapsed / ntsteps);
       printf("  Bandwidth:  %.1f GB/s (effective, read+write)\n",
              gpoints * ntsteps * 2.0 * sizeof(float) / t_elapsed);
+      printf("  Upload:     %.1f ms (%.1f GB/s, wavefield and velocity)\n",
+             1E3 * t_upload, 0 < t_upload ? (2.0 * grid_bytes * 1E-9 / t_upload) : 0.0);
+      if (0 < nrcv) {
+        printf("  Survey:     1 source, %d receivers, %.1f MB traces in %d batches\n",
+               nrcv, sizeof(float) * nrcv * (double)ntsteps * 1E-6, survey.nbatches);
+        printf("  Traces:     %.3f ms after the last step (download not overlapped)\n",
+               1E3 * t_traces);
+      }
     }
 
     if (EXIT_SUCCESS == result) {
@@ -470,6 +426,7 @@ int main(int argc, char* argv[])
       if (0 != do_stats) {
         float* gpu_new = NULL;
         float* p_cpu[2] = { NULL, NULL };
+        float* trace_ref = NULL;
         const size_t n = (size_t)nx * ny * nz;
         const size_t check_bytes = (0 != ctx.blocked || 2 == ctx.layout)
           ? dev_fp32_bytes : grid_bytes;
@@ -486,6 +443,10 @@ int main(int argc, char* argv[])
         if (EXIT_SUCCESS == check_ok && 0 != do_check) {
           check_ok = libxstream_mem_host_allocate((void**)&p_cpu[1], grid_bytes, ctx.stream);
         }
+        if (EXIT_SUCCESS == check_ok && 0 != do_check && 0 < nrcv) {
+          trace_ref = (float*)malloc(sizeof(float) * nrcv * ntsteps);
+          if (NULL == trace_ref) check_ok = EXIT_FAILURE;
+        }
 
         if (EXIT_SUCCESS == check_ok) {
           check_ok = libxstream_mem_copy_d2h(p_buf[cur], gpu_new, copy_bytes, ctx.stream);
@@ -560,6 +521,17 @@ int main(int argc, char* argv[])
             int tmp;
             stencil_cpu_reference(p_cpu[cpu_old], p_cpu[cpu_cur],
               p_cpu[cpu_old], vel_host, fd_w, radius, nx, ny, nz, nterms, dt2);
+            if (0 < nrcv && warmup <= ts) { /* as stencil_survey_step */
+              float* const p_ref = p_cpu[cpu_old];
+              const int k = ts - warmup;
+              int r;
+              for (r = 0; r <= nrcv; ++r) {
+                const int* const xyz = survey_xyz + 3 * r;
+                const long si = ((long)xyz[2] * ny + xyz[1]) * nx + xyz[0];
+                if (0 == r) p_ref[si] += dt2 * vel_host[si] * vel_host[si] * wavelet[k];
+                else trace_ref[(long)k * nrcv + r - 1] = p_ref[si];
+              }
+            }
             tmp = cpu_cur; cpu_cur = cpu_old; cpu_old = tmp;
           }
         }
@@ -590,6 +562,12 @@ int main(int argc, char* argv[])
             printf("  L2 rel:     %.6e\n", diff.l2_rel);
             printf("  Ref min/max: %.6e %.6e\n", diff.min_ref, diff.max_ref);
             printf("  Output min/max: %.6e %.6e\n", diff.min_tst, diff.max_tst);
+            if (NULL != trace_ref) {
+              libxs_matdiff_t tdiff;
+              libxs_matdiff(&tdiff, LIBXS_DATATYPE_F32, nrcv * ntsteps, 1,
+                trace_ref, survey.traces_host, NULL, NULL);
+              printf("  Traces:     Linf rel %.6e, L2 rel %.6e\n", tdiff.linf_rel, tdiff.l2_rel);
+            }
             if (0 <= diff.m) {
               printf("  Max at:     %d (ref=%.6e, tst=%.6e)\n",
                      diff.m, diff.v_ref, diff.v_tst);
@@ -612,13 +590,45 @@ int main(int argc, char* argv[])
           fprintf(stderr, "WARNING: check/stats failed (memory or download error)\n");
         }
 
+        free(trace_ref);
         if (NULL != p_cpu[1]) libxstream_mem_host_deallocate(p_cpu[1], ctx.stream);
         if (NULL != p_cpu[0]) libxstream_mem_host_deallocate(p_cpu[0], ctx.stream);
         if (NULL != gpu_new) libxstream_mem_host_deallocate(gpu_new, ctx.stream);
       }
     }
 
-    if (NULL != pack_buf) libxstream_mem_host_deallocate(pack_buf, ctx.stream);
+    if (EXIT_SUCCESS == result) {
+      const char *const graph_env = getenv("STENCIL_GRAPH");
+      if (NULL != graph_env && 0 != atoi(graph_env)) {
+        result = stencil_graph_bench(&ctx, p_buf, vel_dev, dt2, dh, nterms, ntsteps);
+      }
+    }
+
+    if (EXIT_SUCCESS == result) {
+      const char *const domains_env = getenv("STENCIL_DOMAINS");
+      const int ndomains = (NULL == domains_env) ? 0 : atoi(domains_env);
+      if (0 != ndomains) { /* negative: one domain per device */
+        result = stencil_domain_bench(0 < ndomains ? ndomains : ndevices, ndevices,
+          p_host, vel_host, nx, ny, nz, fd_w, dt2, dh, ntsteps, warmup);
+      }
+    }
+
+    if (EXIT_SUCCESS == result) {
+      const char *const snap_env = getenv("STENCIL_SNAP");
+      const int every = (NULL == snap_env) ? 0 : atoi(snap_env);
+      if (0 < every && 0 == store_limbs) {
+        stencil_survey_release(&ctx); /* snapshots of the plain propagation */
+        result = stencil_snap_bench(&ctx, p_buf, vel_dev, dt2, dh, nterms, ntsteps,
+          LIBXS_MIN(every, ntsteps), dev_bytes);
+      }
+      else if (0 < every) {
+        fprintf(stderr, "WARNING: snapshots require FP32 wavefield storage\n");
+      }
+    }
+
+    stencil_survey_release(&ctx);
+    free(wavelet);
+    free(survey_xyz);
     if (NULL != vel_dev) libxstream_mem_dev_deallocate_hint(vel_dev);
     if (NULL != p_buf[1]) libxstream_mem_dev_deallocate_hint(p_buf[1]);
     if (NULL != p_buf[0]) libxstream_mem_dev_deallocate_hint(p_buf[0]);
@@ -628,7 +638,10 @@ int main(int argc, char* argv[])
   }
 
   stencil_finalize(&ctx);
-  if (0 != initialized) libxstream_finalize();
+  if (0 != initialized) {
+    libxstream_mem_tag_pop();
+    libxstream_finalize();
+  }
   return result;
 }
 
@@ -803,6 +816,286 @@ static void stencil_cpu_reference(float* p_new, const float* p_cur,
 }
 
 
+/**
+ * Host-side submission cost of the time loop, launched step by step versus
+ * replayed from a graph. Two steps are captured since the time levels swap
+ * every step (a period of two), hence a replay advances by two steps. The
+ * wavefield keeps evolving, i.e., this runs after the check.
+ */
+static int stencil_graph_bench(stencil_context_t* ctx, void* p_buf[2], void* vel,
+                               float dt2, float dh, int nterms, int nsteps)
+{
+  libxstream_graph_t* graph = NULL;
+  const int npairs = LIBXS_MAX(nsteps / 2, 1);
+  double t_submit[2] = { 0, 0 }, t_total[2] = { 0, 0 };
+  libxs_timer_tick_t t0, t1;
+  int result = EXIT_SUCCESS, i;
+
+  /* direct: every step sets kernel arguments and enqueues */
+  t0 = libxs_timer_tick();
+  for (i = 0; i < npairs && EXIT_SUCCESS == result; ++i) {
+    result = stencil_apply_laplacian(ctx, p_buf[0], p_buf[1], p_buf[1], vel, dt2, dh, nterms);
+    if (EXIT_SUCCESS == result) {
+      result = stencil_apply_laplacian(ctx, p_buf[1], p_buf[0], p_buf[0], vel, dt2, dh, nterms);
+    }
+  }
+  t1 = libxs_timer_tick();
+  t_submit[0] = libxs_timer_duration(t0, t1);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_sync(ctx->stream);
+  t_total[0] = libxs_timer_duration(t0, libxs_timer_tick());
+
+  /* graph: capture a pair of steps once, replay the pair */
+  if (EXIT_SUCCESS == result) result = libxstream_stream_begin_capture(ctx->stream);
+  if (EXIT_SUCCESS == result) {
+    int result_end;
+    result = stencil_apply_laplacian(ctx, p_buf[0], p_buf[1], p_buf[1], vel, dt2, dh, nterms);
+    if (EXIT_SUCCESS == result) {
+      result = stencil_apply_laplacian(ctx, p_buf[1], p_buf[0], p_buf[0], vel, dt2, dh, nterms);
+    }
+    result_end = libxstream_stream_end_capture(ctx->stream, &graph);
+    if (EXIT_SUCCESS == result) result = result_end;
+  }
+  if (EXIT_SUCCESS == result) {
+    t0 = libxs_timer_tick();
+    for (i = 0; i < npairs && EXIT_SUCCESS == result; ++i) {
+      result = libxstream_graph_launch(graph, ctx->stream);
+    }
+    t1 = libxs_timer_tick();
+    t_submit[1] = libxs_timer_duration(t0, t1);
+    if (EXIT_SUCCESS == result) result = libxstream_stream_sync(ctx->stream);
+    t_total[1] = libxs_timer_duration(t0, libxs_timer_tick());
+  }
+  if (NULL != graph) libxstream_graph_destroy(graph);
+
+  if (EXIT_SUCCESS == result) {
+    const double nsteps_run = 2.0 * npairs;
+    printf("Graph (%d steps):\n", 2 * npairs);
+    printf("  Submit:     %.2f us/step direct, %.2f us/step graph (%.1fx)\n",
+           1E6 * t_submit[0] / nsteps_run, 1E6 * t_submit[1] / nsteps_run,
+           0 < t_submit[1] ? (t_submit[0] / t_submit[1]) : 0.0);
+    printf("  Per step:   %.3f ms direct, %.3f ms graph\n",
+           1E3 * t_total[0] / nsteps_run, 1E3 * t_total[1] / nsteps_run);
+  }
+  else {
+    fprintf(stderr, "WARNING: graph benchmark failed (capture unsupported?)\n");
+    result = EXIT_SUCCESS; /* optional measurement */
+  }
+  return result;
+}
+
+
+/**
+ * One source near the surface at the center of the x-y plane, and nrcv receivers
+ * spread evenly over a plane below. Unless STENCIL_FREQ is given, the wavelet's
+ * peak frequency places its peak at a quarter of the measured steps.
+ */
+static int stencil_survey_init(stencil_context_t* ctx, stencil_survey_t* survey, int nrcv,
+                              const float* vel_host, float dt, int nsteps,
+                              int** survey_xyz, float** wavelet)
+{
+  const int nx = ctx->grid_size[0], ny = ctx->grid_size[1], nz = ctx->grid_size[2];
+  const char *const freq_env = getenv("STENCIL_FREQ");
+  const char *const batch_env = getenv("STENCIL_TRACE_BATCH");
+  const float freq = (NULL == freq_env) ? (6.0f / (nsteps * dt)) : (float)atof(freq_env);
+  const int batch = (NULL == batch_env) ? 64 : LIBXS_MAX(atoi(batch_env), 1);
+  int* const xyz = (int*)malloc(sizeof(int) * 3 * (1 + (size_t)nrcv));
+  float* const w = (float*)malloc(sizeof(float) * nsteps);
+  int result = (NULL != xyz && NULL != w && 0 < freq) ? EXIT_SUCCESS : EXIT_FAILURE;
+  if (EXIT_SUCCESS == result) {
+    const long nplane = (long)nx * ny;
+    int r;
+    xyz[0] = nx / 2;
+    xyz[1] = ny / 2;
+    xyz[2] = LIBXS_MIN(2 * STENCIL_RADIUS, nz - 1);
+    for (r = 0; r < nrcv; ++r) {
+      const long i = (long)r * nplane / nrcv;
+      xyz[3 * r + 3] = (int)(i % nx);
+      xyz[3 * r + 4] = (int)(i / nx);
+      xyz[3 * r + 5] = LIBXS_MIN(4 * STENCIL_RADIUS, nz - 1);
+    }
+    stencil_ricker(w, nsteps, dt, freq);
+    result = stencil_survey_setup(ctx, survey, xyz, 1, xyz + 3, nrcv, vel_host,
+      dt * dt, w, nsteps, batch);
+  }
+  if (EXIT_SUCCESS != result) {
+    fprintf(stderr, "ERROR: sources and receivers failed (%d receivers)\n", nrcv);
+  }
+  *survey_xyz = xyz;
+  *wavelet = w;
+  return result;
+}
+
+
+/**
+ * Strong scaling of the slow-axis decomposition (stencil_domain_run) over the
+ * same grid and steps: 1, 2, 4, ... up to ndomains domains. Each run is compared
+ * with the single-domain wavefield, i.e., the halo exchange is verified as well.
+ */
+static int stencil_domain_bench(int ndomains, int ndevices, const float* p_host,
+                                const float* vel_host, int nx, int ny, int nz,
+                                const double* fd_w, float dt2, float dh, int nsteps, int warmup)
+{
+  const size_t n = (size_t)nx * ny * nz;
+  const double gpoints = (double)n * 1.0e-9;
+  float* p_ref = (float*)malloc(n * sizeof(float));
+  float* p_tst = (float*)malloc(n * sizeof(float));
+  double t_base = 0;
+  int result = (NULL != p_ref && NULL != p_tst && 0 < nsteps) ? EXIT_SUCCESS : EXIT_FAILURE;
+  int nd = 1;
+
+  if (EXIT_SUCCESS == result) {
+    printf("Decomposition (slow axis, %d steps):\n", nsteps);
+    printf("  Domains  Devices  GPoints/s  Speedup  Efficiency  Halo [ms/step]  Linf abs\n");
+  }
+  while (EXIT_SUCCESS == result) {
+    stencil_domain_stats_t stats;
+    result = stencil_domain_run(nd, ndevices, p_host, vel_host, nx, ny, nz, fd_w, dt2, dh,
+      nsteps, warmup, 1 == nd ? p_ref : p_tst, &stats);
+    if (EXIT_SUCCESS == result) {
+      double linf = 0;
+      size_t i;
+      if (1 == nd) t_base = stats.t_elapsed;
+      else {
+        for (i = 0; i < n; ++i) {
+          const double d = fabs((double)p_tst[i] - p_ref[i]);
+          if (linf < d) linf = d;
+        }
+      }
+      printf("  %7d  %7d  %9.3f  %6.2fx  %9.1f%%  %14.3f  %.3e\n", nd, stats.ndevices,
+        gpoints * nsteps / stats.t_elapsed, t_base / stats.t_elapsed,
+        100.0 * t_base / (stats.t_elapsed * stats.ndevices), 1E3 * stats.t_halo, linf);
+    }
+    if (ndomains <= nd) break;
+    nd = LIBXS_MIN(2 * nd, ndomains);
+  }
+  if (EXIT_SUCCESS != result) {
+    fprintf(stderr, "WARNING: domain decomposition failed (%d domains)\n", nd);
+    result = EXIT_SUCCESS; /* optional measurement */
+  }
+  free(p_tst);
+  free(p_ref);
+  return result;
+}
+
+
+/**
+ * Forward pass with a compressed snapshot every "every" steps, timed against
+ * the same steps without snapshots, followed by a backward pass restoring the
+ * snapshots in reverse order (the next one prefetched) while an adjoint pair
+ * of wavefields is propagated. The wavefield keeps evolving (after the check).
+ */
+static int stencil_snap_bench(stencil_context_t* ctx, void* p_buf[2], void* vel,
+                              float dt2, float dh, int nterms, int nsteps,
+                              int every, size_t dev_bytes)
+{
+  static const char* codecs[] = { "bf16", "bf16x2", "int8" };
+  const char *const codec_env = getenv("STENCIL_SNAP_CODEC");
+  const char *const file_env = getenv("STENCIL_SNAP_FILE");
+  const int codec = (NULL == codec_env) ? STENCIL_SNAP_INT8
+    : LIBXS_MIN(LIBXS_MAX(atoi(codec_env), STENCIL_SNAP_BF16), STENCIL_SNAP_INT8);
+  const int nsnaps = nsteps / LIBXS_MAX(every, 1);
+  const size_t n = dev_bytes / sizeof(float);
+  stencil_snap_t snap;
+  void *scratch = NULL, *p_adj[2] = { NULL, NULL };
+  float *h_ref = NULL, *h_tst = NULL;
+  double t_plain = 0, t_fwd = 0, t_drain = 0, t_bwd = 0, t_prop = 0, linf_rel = -1;
+  libxs_timer_tick_t t0, t1;
+  int result = (0 < nsnaps ? EXIT_SUCCESS : EXIT_FAILURE), cur = 0, i, k;
+
+  LIBXS_MEMZERO(&snap);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&scratch, dev_bytes);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&p_adj[0], dev_bytes);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&p_adj[1], dev_bytes);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_zero(p_adj[0], 0, dev_bytes, ctx->stream);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_zero(p_adj[1], 0, dev_bytes, ctx->stream);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_sync(ctx->stream);
+
+  /* forward: without, then with snapshots */
+  if (EXIT_SUCCESS == result) {
+    t0 = libxs_timer_tick();
+    result = stencil_apply_steps(ctx, p_buf, &cur, vel, dt2, dh, nterms, nsteps);
+    if (EXIT_SUCCESS == result) result = libxstream_stream_sync(ctx->stream);
+    t_plain = libxs_timer_duration(t0, libxs_timer_tick());
+  }
+  if (EXIT_SUCCESS == result) {
+    result = stencil_snap_setup(ctx, &snap, (stencil_snap_codec_t)codec, every, nsnaps, file_env);
+  }
+  if (EXIT_SUCCESS == result) {
+    t0 = libxs_timer_tick();
+    result = stencil_apply_steps(ctx, p_buf, &cur, vel, dt2, dh, nterms, nsteps);
+    if (EXIT_SUCCESS == result) result = libxstream_stream_sync(ctx->stream);
+    t1 = libxs_timer_tick();
+    t_fwd = libxs_timer_duration(t0, t1);
+    if (EXIT_SUCCESS == result) result = stencil_snap_finish(ctx);
+    t_drain = libxs_timer_duration(t1, libxs_timer_tick());
+  }
+
+  /* roundtrip of the last snapshot (taken after the last step) */
+  if (EXIT_SUCCESS == result && 0 == (nsteps % every)) {
+    result = libxstream_mem_host_allocate((void**)&h_ref, dev_bytes, ctx->stream);
+    if (EXIT_SUCCESS == result) result = libxstream_mem_host_allocate((void**)&h_tst, dev_bytes, ctx->stream);
+    if (EXIT_SUCCESS == result) result = stencil_snap_restore(ctx, nsnaps - 1, scratch);
+    if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(scratch, h_tst, dev_bytes, ctx->stream);
+    if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(p_buf[cur], h_ref, dev_bytes, ctx->stream);
+    if (EXIT_SUCCESS == result) result = libxstream_stream_sync(ctx->stream);
+    if (EXIT_SUCCESS == result) {
+      libxs_matdiff_t diff;
+      libxs_matdiff(&diff, LIBXS_DATATYPE_F32, (int)n, 1, h_ref, h_tst, NULL, NULL);
+      linf_rel = diff.linf_rel;
+    }
+  }
+
+  /* backward: restore in reverse order, prefetch the next, propagate the adjoint */
+  if (EXIT_SUCCESS == result) {
+    t0 = libxs_timer_tick();
+    for (i = nsnaps - 1; 0 <= i && EXIT_SUCCESS == result; --i) {
+      if (0 < i) result = stencil_snap_prefetch(ctx, i - 1);
+      if (EXIT_SUCCESS == result) result = stencil_snap_restore(ctx, i, scratch);
+      for (k = 0; k < every && EXIT_SUCCESS == result; ++k) {
+        result = stencil_apply_laplacian(ctx, p_adj[k & 1], p_adj[1 - (k & 1)],
+          p_adj[1 - (k & 1)], vel, dt2, dh, nterms);
+      }
+    }
+    if (EXIT_SUCCESS == result) result = libxstream_stream_sync(ctx->stream);
+    t_bwd = libxs_timer_duration(t0, libxs_timer_tick());
+  }
+  if (EXIT_SUCCESS == result) { /* propagation alone */
+    t0 = libxs_timer_tick();
+    for (i = 0; i < nsnaps * every && EXIT_SUCCESS == result; ++i) {
+      result = stencil_apply_laplacian(ctx, p_adj[i & 1], p_adj[1 - (i & 1)],
+        p_adj[1 - (i & 1)], vel, dt2, dh, nterms);
+    }
+    if (EXIT_SUCCESS == result) result = libxstream_stream_sync(ctx->stream);
+    t_prop = libxs_timer_duration(t0, libxs_timer_tick());
+  }
+
+  if (EXIT_SUCCESS == result) {
+    const double mb = snap.store_bytes * 1E-6;
+    printf("Snapshots (%d every %d steps, %s, %s):\n", nsnaps, every, codecs[codec],
+           0 != snap.mapped ? "file" : "pinned");
+    printf("  Storage:    %.1f MB (%.2fx compression)\n", mb,
+           (double)n * sizeof(float) / snap.nbytes);
+    printf("  Forward:    %.3f ms/step (%+.1f%% vs. %.3f ms/step), drain %.3f ms\n",
+           1E3 * t_fwd / nsteps, 0 < t_plain ? (100.0 * (t_fwd - t_plain) / t_plain) : 0.0,
+           1E3 * t_plain / nsteps, 1E3 * t_drain);
+    printf("  Backward:   %.3f ms/step (%+.1f%% vs. propagation alone)\n",
+           1E3 * t_bwd / (nsnaps * every), 0 < t_prop ? (100.0 * (t_bwd - t_prop) / t_prop) : 0.0);
+    if (0 <= linf_rel) printf("  Roundtrip:  Linf rel %.6e (last snapshot)\n", linf_rel);
+  }
+  else {
+    fprintf(stderr, "WARNING: snapshots failed (codec %d)\n", codec);
+    result = EXIT_SUCCESS; /* optional measurement */
+  }
+  stencil_snap_release(ctx); /* before the buffers */
+  if (NULL != h_tst) libxstream_mem_host_deallocate(h_tst, ctx->stream);
+  if (NULL != h_ref) libxstream_mem_host_deallocate(h_ref, ctx->stream);
+  if (NULL != p_adj[1]) libxstream_mem_deallocate(p_adj[1]);
+  if (NULL != p_adj[0]) libxstream_mem_deallocate(p_adj[0]);
+  if (NULL != scratch) libxstream_mem_deallocate(scratch);
+  return result;
+}
+
+
 static void usage(const char* prog)
 {
   printf("Usage: %s [options]\n"
@@ -826,9 +1119,11 @@ static void usage(const char* prog)
          "Environment:\n"
          "  STENCIL_BF16, STENCIL_BF16S, STENCIL_FP16S, STENCIL_BLOCKED, STENCIL_CHECK\n"
          "  STENCIL_FIT, STENCIL_FP32_BLOCK_IO, STENCIL_FP32_SBLOCK, STENCIL_FP32_WG_X, STENCIL_FP32_WG_Y\n"
-         "  STENCIL_GRF256, STENCIL_HALO, STENCIL_HINT, STENCIL_INT8, STENCIL_LAYOUT\n"
+         "  STENCIL_GRAPH, STENCIL_GRF256, STENCIL_HALO, STENCIL_HINT, STENCIL_INT8, STENCIL_LAYOUT\n"
          "  STENCIL_LU, STENCIL_METHOD, STENCIL_NDIGITS_A, STENCIL_PML, STENCIL_PPW\n"
          "  STENCIL_RADIUS_FIT, STENCIL_SG, STENCIL_STRIPS_PER_WG, STENCIL_TRACE, STENCIL_TRIM\n"
+         "  STENCIL_DOMAINS, STENCIL_FREQ, STENCIL_SURVEY, STENCIL_TRACE_BATCH, STENCIL_TSTEPS\n"
+         "  STENCIL_SNAP, STENCIL_SNAP_CODEC, STENCIL_SNAP_FILE\n"
          "\n"
          "Performance is reported in GPoints/s.\n", prog);
 }
@@ -0,0 +1,291 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#include "stencil_opencl.h"
+#include <libxs/libxs_mem.h>
+#include <libxs/libxs_timer.h>
+
+#if defined(_OPENMP)
+# include <omp.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/**
+ * Slab of whole planes: owned planes [z0, z0 + nz) of the global grid are stored
+ * at [glo, glo + nz) of the local grid, below which glo (and above which ghi)
+ * ghost planes of the neighbors are kept. A domain at the physical boundary has
+ * no ghost planes on that side, i.e., the kernel's clamping matches the global grid.
+ */
+typedef struct {
+  stencil_context_t ctx;
+  /* boundary slabs and halo transfers (the context's stream computes the interior) */
+  libxstream_stream_t* halo;
+  void* p_buf[2];
+  void* vel;
+  /* pinned planes sent to the lower (0) and upper (1) neighbor, by step parity */
+  float* send[2][2];
+  int z0, nz, glo, ghi;
+  int cur;
+  double t_halo;
+} stencil_domain_t;
+
+
+static int stencil_domain_setup(stencil_domain_t* dom, const float* p_host, const float* vel_host,
+                                int nx, int ny, const double* fd_weights, int instance)
+{
+  const size_t plane_n = (size_t)nx * ny;
+  const int nzl = dom->glo + dom->nz + dom->ghi;
+  const size_t local_bytes = plane_n * nzl * sizeof(float);
+  const size_t send_bytes = plane_n * STENCIL_RADIUS * sizeof(float);
+  const float* const p_local = p_host + plane_n * (dom->z0 - dom->glo);
+  const float* const v_local = vel_host + plane_n * (dom->z0 - dom->glo);
+  int result = stencil_init(&dom->ctx, 0 /*verbosity*/, STENCIL_DIRECT);
+  if (EXIT_SUCCESS == result) {
+    dom->ctx.instance = instance;
+    dom->ctx.tsteps = 1; /* slabs are launched per step */
+    result = stencil_configure(&dom->ctx, nx, ny, nzl);
+  }
+  if (EXIT_SUCCESS == result && (1 != dom->ctx.fp32 || 0 != dom->ctx.layout
+    || 0 != dom->ctx.blocked || 0 != dom->ctx.bf16s || 0 != dom->ctx.fp16))
+  {
+    fprintf(stderr, "ERROR ACC/STENCIL: domain decomposition requires FP32 and XYZ-layout.\n");
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result) result = stencil_precompute_operators(&dom->ctx, fd_weights, STENCIL_RADIUS);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_create(&dom->halo, "stencil_halo", 0);
+  if (EXIT_SUCCESS == result) {
+    result = libxstream_mem_dev_allocate_hint(&dom->p_buf[0], local_bytes, libxstream_opencl_mem_hint_compress);
+  }
+  if (EXIT_SUCCESS == result) {
+    result = libxstream_mem_dev_allocate_hint(&dom->p_buf[1], local_bytes, libxstream_opencl_mem_hint_compress);
+  }
+  if (EXIT_SUCCESS == result) {
+    result = libxstream_mem_dev_allocate_hint(&dom->vel, local_bytes, libxstream_opencl_mem_hint_compress);
+  }
+  { int parity, side;
+    for (parity = 0; parity < 2; ++parity) {
+      for (side = 0; side < 2 && EXIT_SUCCESS == result; ++side) {
+        if (0 != (0 == side ? dom->glo : dom->ghi)) {
+          result = libxstream_mem_host_allocate((void**)&dom->send[parity][side], send_bytes, dom->halo);
+        }
+      }
+    }
+  }
+  if (EXIT_SUCCESS == result) result = stencil_upload_field(&dom->ctx, dom->p_buf[0], p_local, 0, -1);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_zero(dom->p_buf[1], 0, local_bytes, dom->ctx.stream);
+  if (EXIT_SUCCESS == result) result = stencil_upload_field(&dom->ctx, dom->vel, v_local, 0, -1);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_sync(dom->ctx.stream);
+  dom->cur = 0;
+  return result;
+}
+
+
+/**
+ * First half of a step: boundary slabs (blocks holding the planes sent to a
+ * neighbor) are computed and downloaded on the halo stream, while the interior
+ * is enqueued on the context's stream. Returns once the sent planes arrived.
+ */
+static int stencil_domain_send(stencil_domain_t* dom, float dt2, float dh, int parity)
+{
+  const size_t plane_n = (size_t)dom->ctx.grid_size[0] * dom->ctx.grid_size[1];
+  const size_t send_bytes = plane_n * STENCIL_RADIUS * sizeof(float);
+  const int nblk = dom->ctx.nblocks[2];
+  const int lo1 = (0 < dom->glo) ? ((dom->glo + STENCIL_RADIUS - 1) / STENCIL_BLK + 1) : 0;
+  int up0 = (0 < dom->ghi) ? ((dom->glo + dom->nz - STENCIL_RADIUS) / STENCIL_BLK) : nblk;
+  void *const p_cur = dom->p_buf[dom->cur], *const p_new = dom->p_buf[1 - dom->cur];
+  const libxs_timer_tick_t t0 = libxs_timer_tick();
+  int result;
+  if (up0 < lo1) up0 = lo1; /* slabs meet: no interior */
+  result = stencil_apply_slab(&dom->ctx, dom->halo, p_cur, p_new, p_new, dom->vel, dt2, dh, 0, lo1);
+  if (EXIT_SUCCESS == result) {
+    result = stencil_apply_slab(&dom->ctx, dom->halo, p_cur, p_new, p_new, dom->vel, dt2, dh, up0, nblk);
+  }
+  if (EXIT_SUCCESS == result && 0 < dom->glo) {
+    result = libxstream_mem_copy_d2h((const float*)p_new + plane_n * dom->glo,
+      dom->send[parity][0], send_bytes, dom->halo);
+  }
+  if (EXIT_SUCCESS == result && 0 < dom->ghi) {
+    result = libxstream_mem_copy_d2h((const float*)p_new + plane_n * (dom->glo + dom->nz - STENCIL_RADIUS),
+      dom->send[parity][1], send_bytes, dom->halo);
+  }
+  if (EXIT_SUCCESS == result) {
+    result = stencil_apply_slab(&dom->ctx, dom->ctx.stream, p_cur, p_new, p_new, dom->vel, dt2, dh, lo1, up0);
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_stream_sync(dom->halo);
+  dom->t_halo += libxs_timer_duration(t0, libxs_timer_tick());
+  return result;
+}
+
+
+/**
+ * Second half of a step: ghost planes are uploaded from what the neighbors sent
+ * (same parity), and both streams are drained before the wavefields rotate.
+ */
+static int stencil_domain_recv(stencil_domain_t* dom, const stencil_domain_t* lower,
+                               const stencil_domain_t* upper, int parity)
+{
+  const size_t plane_n = (size_t)dom->ctx.grid_size[0] * dom->ctx.grid_size[1];
+  const size_t send_bytes = plane_n * STENCIL_RADIUS * sizeof(float);
+  float* const p_new = (float*)dom->p_buf[1 - dom->cur];
+  libxs_timer_tick_t t0 = libxs_timer_tick();
+  int result = EXIT_SUCCESS;
+  if (NULL != lower) {
+    result = libxstream_mem_copy_h2d(lower->send[parity][1], p_new, send_bytes, dom->halo);
+  }
+  if (EXIT_SUCCESS == result && NULL != upper) {
+    result = libxstream_mem_copy_h2d(upper->send[parity][0], p_new + plane_n * (dom->glo + dom->nz),
+      send_bytes, dom->halo);
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_stream_sync(dom->halo);
+  dom->t_halo += libxs_timer_duration(t0, libxs_timer_tick());
+  if (EXIT_SUCCESS == result) result = libxstream_stream_sync(dom->ctx.stream);
+  dom->cur = 1 - dom->cur;
+  return result;
+}
+
+
+static void stencil_domain_release(stencil_domain_t* dom)
+{
+  int parity, side;
+  for (parity = 0; parity < 2; ++parity) {
+    for (side = 0; side < 2; ++side) {
+      if (NULL != dom->send[parity][side]) libxstream_mem_host_deallocate(dom->send[parity][side], dom->halo);
+    }
+  }
+  if (NULL != dom->vel) libxstream_mem_dev_deallocate_hint(dom->vel);
+  if (NULL != dom->p_buf[1]) libxstream_mem_dev_deallocate_hint(dom->p_buf[1]);
+  if (NULL != dom->p_buf[0]) libxstream_mem_dev_deallocate_hint(dom->p_buf[0]);
+  if (NULL != dom->halo) libxstream_stream_destroy(dom->halo);
+  stencil_finalize(&dom->ctx);
+}
+
+
+int stencil_domain_run(int ndomains, int ndevices, const float* p_host, const float* vel_host,
+                       int nx, int ny, int nz, const double* fd_weights, float dt2, float dh,
+                       int nsteps, int warmup, float* p_result, stencil_domain_stats_t* stats)
+{
+  int result = EXIT_SUCCESS;
+#if defined(_OPENMP)
+  stencil_domain_t* domains = NULL;
+  int failed[] = {0, 0}; /* per step parity (see below) */
+  double t_elapsed = 0, t_halo = 0;
+  if (1 > ndomains || 1 > ndevices || NULL == p_host || NULL == vel_host || NULL == fd_weights
+    || nz < ndomains * STENCIL_RADIUS)
+  {
+    result = EXIT_FAILURE;
+  }
+  else {
+    domains = (stencil_domain_t*)calloc((size_t)ndomains, sizeof(stencil_domain_t));
+    if (NULL == domains) result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result) {
+    int d;
+    for (d = 0; d < ndomains; ++d) { /* remainder planes go to the first domains */
+      stencil_domain_t* const dom = domains + d;
+      dom->nz = nz / ndomains + (d < nz % ndomains ? 1 : 0);
+      dom->z0 = (0 < d ? (dom[-1].z0 + dom[-1].nz) : 0);
+      dom->glo = (0 < d ? STENCIL_RADIUS : 0);
+      dom->ghi = (d < ndomains - 1 ? STENCIL_RADIUS : 0);
+    }
+#   pragma omp parallel num_threads(ndomains)
+    {
+      const int d = omp_get_thread_num();
+      stencil_domain_t* const dom = domains + d;
+      const stencil_domain_t* const lower = (0 < d ? (dom - 1) : NULL);
+      const stencil_domain_t* const upper = (d < ndomains - 1 ? (dom + 1) : NULL);
+      libxs_timer_tick_t t0 = 0;
+      int r = (ndomains == omp_get_num_threads() ? libxstream_device_bind(d % ndevices) : EXIT_FAILURE);
+      int step, tagged = 0;
+      if (EXIT_SUCCESS == r) { /* tags are per thread (libxstream_mem_tag_push) */
+        r = libxstream_mem_tag_push("stencil");
+        if (EXIT_SUCCESS == r) tagged = 1;
+      }
+      if (EXIT_SUCCESS == r) {
+        /* initialization is not meant to be concurrent (libxstream_init_config) */
+#       pragma omp critical(stencil_domain)
+        r = stencil_domain_setup(dom, p_host, vel_host, nx, ny, fd_weights, 1 + d);
+      }
+      if (EXIT_SUCCESS != r) {
+#       pragma omp atomic write
+        failed[0] = 1;
+#       pragma omp atomic write
+        failed[1] = 1;
+      }
+      for (step = 0; step < warmup + nsteps; ++step) {
+        const int parity = (step & 1);
+        int stop;
+        if (warmup == step) { /* warmup excluded */
+#         pragma omp barrier
+          dom->t_halo = 0;
+          t0 = libxs_timer_tick();
+        }
+        /**
+         * A failure is raised in the flag of the step that reads it next: the
+         * flag read after this barrier is written before it only (send), and
+         * a failed receive raises the other one, read after the next barrier.
+         * No thread writes a flag while another may still read it, hence all
+         * threads leave at the same step. Flags are never reset.
+         */
+        if (EXIT_SUCCESS == r) r = stencil_domain_send(dom, dt2, dh, parity);
+        if (EXIT_SUCCESS != r) {
+#         pragma omp atomic write
+          failed[parity] = 1;
+        }
+#       pragma omp barrier
+#       pragma omp atomic read
+        stop = failed[parity];
+        if (0 != stop) break;
+        r = stencil_domain_recv(dom, lower, upper, parity);
+        if (EXIT_SUCCESS != r) {
+#         pragma omp atomic write
+          failed[1 - parity] = 1;
+        }
+        /* send buffers of one parity are reused after the next barrier only */
+      }
+#     pragma omp barrier
+      if (EXIT_SUCCESS == r && 0 == failed[0] && 0 == failed[1] && NULL != p_result) {
+        const size_t plane_n = (size_t)nx * ny;
+        r = libxstream_mem_copy_d2h((const float*)dom->p_buf[dom->cur] + plane_n * dom->glo,
+          p_result + plane_n * dom->z0, plane_n * dom->nz * sizeof(float), dom->ctx.stream);
+        if (EXIT_SUCCESS == r) r = libxstream_stream_sync(dom->ctx.stream);
+      }
+#     pragma omp critical(stencil_domain)
+      {
+        if (EXIT_SUCCESS != r) failed[0] = 1;
+        if (0 < nsteps) {
+          const double t = libxs_timer_duration(t0, libxs_timer_tick());
+          t_elapsed = LIBXS_MAX(t_elapsed, t);
+          t_halo = LIBXS_MAX(t_halo, dom->t_halo / nsteps);
+        }
+        stencil_domain_release(dom);
+      }
+      if (0 != tagged) libxstream_mem_tag_pop();
+    }
+    if (0 != failed[0] || 0 != failed[1]) result = EXIT_FAILURE;
+  }
+  free(domains);
+  if (NULL != stats) {
+    stats->t_elapsed = t_elapsed;
+    stats->t_halo = t_halo;
+    stats->ndomains = ndomains;
+    stats->ndevices = LIBXS_MIN(ndomains, ndevices);
+  }
+#else
+  LIBXS_UNUSED(ndomains); LIBXS_UNUSED(ndevices); LIBXS_UNUSED(p_host); LIBXS_UNUSED(vel_host);
+  LIBXS_UNUSED(nx); LIBXS_UNUSED(ny); LIBXS_UNUSED(nz); LIBXS_UNUSED(fd_weights);
+  LIBXS_UNUSED(dt2); LIBXS_UNUSED(dh); LIBXS_UNUSED(nsteps); LIBXS_UNUSED(warmup);
+  LIBXS_UNUSED(p_result);
+  if (NULL != stats) LIBXS_MEMZERO(stats);
+  fprintf(stderr, "ERROR ACC/STENCIL: domain decomposition requires OpenMP.\n");
+  result = EXIT_FAILURE;
+#endif
+  return result;
+}
@@ -17,10 +17,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if !defined(_WIN32)
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
 
 #define STENCIL_FP32_WG_X_DEFAULT 32
 #define STENCIL_FP32_WG_Y_DEFAULT 8
 #define STENCIL_FP32_SBLOCK_DEFAULT 2
+#define STENCIL_TSTEPS_MAX 4
+#define STENCIL_SNAP_BLK 256
 
 #define STENCIL_KEY_FP32_WGX(KEY) ((int)((unsigned int)(KEY).fp32_wg >> 16))
 #define STENCIL_KEY_FP32_WGY(KEY) ((int)((KEY).fp32_wg & 65535))
@@ -42,6 +49,15 @@ typedef char stencil_key_size_assert_t[
 #if !defined(OPENCL_KERNELS_SOURCE_STENCIL_INT8)
 # error "OpenCL kernel source not found (stencil_kernels.h must define OPENCL_KERNELS_SOURCE_STENCIL_INT8)"
 #endif
+#if !defined(OPENCL_KERNELS_SOURCE_STENCIL_LAYOUT)
+# error "OpenCL kernel source not found (stencil_kernels.h must define OPENCL_KERNELS_SOURCE_STENCIL_LAYOUT)"
+#endif
+#if !defined(OPENCL_KERNELS_SOURCE_STENCIL_SURVEY)
+# error "OpenCL kernel source not found (stencil_kernels.h must define OPENCL_KERNELS_SOURCE_STENCIL_SURVEY)"
+#endif
+#if !defined(OPENCL_KERNELS_SOURCE_STENCIL_SNAP)
+# error "OpenCL kernel source not found (stencil_kernels.h must define OPENCL_KERNELS_SOURCE_STENCIL_SNAP)"
+#endif
 
 
 typedef struct {
@@ -528,6 +544,632 @@ void stencil_pack_blocked(float* dst, const float* src,
 }
 
 
+/**
+ * The layout conversion does not depend on the kernel specialization (key):
+ * built once per device on first use, the grid and layout are runtime arguments.
+ */
+static cl_kernel stencil_get_layout_kernel(const stencil_context_t* ctx)
+{
+  static cl_kernel kernels[LIBXSTREAM_MAXNDEVS] /*= { NULL }*/;
+  static libxs_lock_t compile_lock /*= LIBXS_LOCK_INITIALIZER*/;
+  static int ready[LIBXSTREAM_MAXNDEVS] /*= { 0 }*/;
+  const int device = libxstream_opencl_device()->device_id; /* bound or active */
+
+  if (0 == LIBXS_ATOMIC_LOAD(ready + device, LIBXS_ATOMIC_SEQ_CST)) {
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK_DEFAULT, &compile_lock);
+    if (0 == ready[device]) {
+      const libxs_timer_tick_t t0 = libxs_timer_tick();
+      char flags[64];
+      int ok;
+      LIBXS_SNPRINTF(flags, sizeof(flags), "-DBLK=%d", STENCIL_BLK);
+      ok = libxstream_opencl_kernel(0 /*source_kind*/,
+        OPENCL_KERNELS_SOURCE_STENCIL_LAYOUT, "stencil_layout_convert", flags,
+        NULL /*options*/, NULL /*try*/, NULL /*try_ok*/, NULL /*exts*/, 0,
+        kernels + device);
+      if (2 <= ctx->verbosity || 0 > ctx->verbosity) {
+        const libxs_timer_tick_t t1 = libxs_timer_tick();
+        fprintf(stderr, "%s ACC/STENCIL: layout conversion -> ",
+          EXIT_SUCCESS == ok ? "INFO" : "ERROR");
+        if (EXIT_SUCCESS == ok) {
+          fprintf(stderr, "%.1f ms\n", 1E3 * libxs_timer_duration(t0, t1));
+        }
+        else {
+          fprintf(stderr, "FAILED!\n");
+        }
+      }
+      if (EXIT_SUCCESS != ok) kernels[device] = NULL; /* not retried */
+      LIBXS_ATOMIC_STORE(ready + device, 1, LIBXS_ATOMIC_SEQ_CST);
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK_DEFAULT, &compile_lock);
+  }
+  return kernels[device];
+}
+
+
+int stencil_upload_field(stencil_context_t* ctx, void* dst, const float* src,
+                         int padded, int ndigits)
+{
+  int result = EXIT_SUCCESS;
+  const int nx = ctx->grid_size[0], ny = ctx->grid_size[1], nz = ctx->grid_size[2];
+  const int layout = (0 != ctx->blocked) ? 1 : ((2 == ctx->layout) ? 2 : 0);
+  const int hx = (0 != padded && 2 == layout) ? ctx->halo[0] : 0;
+  const int hy = (0 != padded && 2 == layout) ? ctx->halo[1] : 0;
+  const int hz = (0 != padded && 2 == layout) ? ctx->halo[2] : 0;
+  const size_t grid_bytes = (size_t)nx * ny * nz * sizeof(float);
+
+  if (0 == layout && 0 > ndigits) { /* stored as given */
+    result = libxstream_mem_copy_h2d(src, dst, grid_bytes, ctx->stream);
+  }
+  else {
+    const cl_kernel kernel = stencil_get_layout_kernel(ctx);
+    size_t global[3];
+    void* raw = NULL;
+    cl_int i = 0;
+    int claimed = 0;
+    if (1 == layout) {
+      global[0] = (size_t)ctx->nblocks[0] * STENCIL_BLK;
+      global[1] = (size_t)ctx->nblocks[1] * STENCIL_BLK;
+      global[2] = (size_t)ctx->nblocks[2] * STENCIL_BLK;
+    }
+    else if (2 == layout) {
+      global[0] = (size_t)(nz + 2 * hz);
+      global[1] = (size_t)(ny + 2 * hy);
+      global[2] = (size_t)(nx + 2 * hx);
+    }
+    else {
+      global[0] = (size_t)nx;
+      global[1] = (size_t)ny;
+      global[2] = (size_t)nz;
+    }
+    if (NULL == kernel) result = EXIT_FAILURE;
+    if (EXIT_SUCCESS == result) { /* carve from the context's arena, or allocate */
+      claimed = libxstream_mem_arena_claim(&ctx->scratch, grid_bytes);
+      if (0 != claimed) raw = libxstream_mem_arena_alloc(&ctx->scratch, grid_bytes);
+      if (NULL == raw) result = libxstream_mem_allocate(&raw, grid_bytes);
+    }
+    if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(src, raw, grid_bytes, ctx->stream);
+    CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, raw));
+    CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, dst));
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &nx));
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &ny));
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &nz));
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &hx));
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &hy));
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &hz));
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &layout));
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &ndigits));
+    { const size_t npoints = global[0] * global[1] * global[2];
+      const size_t nstore = (0 > ndigits) ? sizeof(float) : ((size_t)LIBXS_MAX(ndigits, 1) * sizeof(cl_ushort));
+      CL_CHECK(result, libxstream_opencl_launch_work(ctx->stream, kernel,
+        3, NULL, global, NULL, 0, NULL, NULL, 0 /*nflops*/, grid_bytes + npoints * nstore));
+    }
+    if (NULL != raw || 0 != claimed) { /* scratch is released once the conversion completed */
+      const int result_sync = libxstream_stream_sync(ctx->stream);
+      if (EXIT_SUCCESS == result) result = result_sync;
+      if (NULL != raw && 0 == libxstream_mem_arena_owns(&ctx->scratch, raw)) libxstream_mem_deallocate(raw);
+      if (0 != claimed) {
+        LIBXS_ELIDE_RESULT(int, libxstream_mem_arena_release(&ctx->scratch, NULL /*synchronized*/));
+      }
+    }
+  }
+  return result;
+}
+
+
+
+/* Storage index of grid point (x, y, z) for the context's layout (as converted by stencil_upload_field). */
+static long stencil_storage_index(const stencil_context_t* ctx, int x, int y, int z)
+{
+  const int nx = ctx->grid_size[0], ny = ctx->grid_size[1], nz = ctx->grid_size[2];
+  long result;
+  if (0 != ctx->blocked) {
+    const int nbx = ctx->nblocks[0], nby = ctx->nblocks[1];
+    result = ((long)(z / STENCIL_BLK) * nby * nbx + (long)(y / STENCIL_BLK) * nbx + x / STENCIL_BLK)
+      * (STENCIL_BLK * STENCIL_BLK * STENCIL_BLK) + (long)(z % STENCIL_BLK) * (STENCIL_BLK * STENCIL_BLK)
+      + (y % STENCIL_BLK) * STENCIL_BLK + (x % STENCIL_BLK);
+  }
+  else if (2 == ctx->layout) {
+    const int hx = ctx->halo[0], hy = ctx->halo[1], hz = ctx->halo[2];
+    result = ((long)(x + hx) * (ny + 2 * hy) + (y + hy)) * (nz + 2 * hz) + (z + hz);
+  }
+  else {
+    result = ((long)z * ny + y) * nx + x;
+  }
+  return result;
+}
+
+
+/* Number of stored points (limb stride), and the storage type as passed to the device kernels. */
+static long stencil_storage_size(const stencil_context_t* ctx, int* ndigits)
+{
+  const int nx = ctx->grid_size[0], ny = ctx->grid_size[1], nz = ctx->grid_size[2];
+  long result;
+  if (0 != ctx->blocked) {
+    result = (long)ctx->nblocks[0] * ctx->nblocks[1] * ctx->nblocks[2]
+      * (STENCIL_BLK * STENCIL_BLK * STENCIL_BLK);
+  }
+  else if (2 == ctx->layout) {
+    result = (long)(nx + 2 * ctx->halo[0]) * (ny + 2 * ctx->halo[1]) * (nz + 2 * ctx->halo[2]);
+  }
+  else {
+    result = (long)nx * ny * nz;
+  }
+  if (NULL != ndigits) *ndigits = (0 != ctx->fp16) ? 0 : ((0 != ctx->bf16s) ? ctx->bf16s : -1);
+  return result;
+}
+
+
+/* Injection (0) and recording (1) kernel, built once per device like the layout conversion. */
+static cl_kernel stencil_get_survey_kernel(const stencil_context_t* ctx, int which)
+{
+  static cl_kernel kernels[LIBXSTREAM_MAXNDEVS][2] /*= { NULL }*/;
+  static libxs_lock_t compile_lock /*= LIBXS_LOCK_INITIALIZER*/;
+  static int ready[LIBXSTREAM_MAXNDEVS] /*= { 0 }*/;
+  const int device = libxstream_opencl_device()->device_id; /* bound or active */
+
+  if (0 == LIBXS_ATOMIC_LOAD(ready + device, LIBXS_ATOMIC_SEQ_CST)) {
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK_DEFAULT, &compile_lock);
+    if (0 == ready[device]) {
+      const libxs_timer_tick_t t0 = libxs_timer_tick();
+      cl_program program = NULL;
+      int ok = libxstream_opencl_program(0 /*source_kind*/,
+        OPENCL_KERNELS_SOURCE_STENCIL_SURVEY, "stencil_survey", NULL /*build_params*/,
+        NULL /*build_options*/, NULL /*try*/, NULL /*try_ok*/, NULL /*exts*/, 0,
+        &program);
+      if (EXIT_SUCCESS == ok) ok = libxstream_opencl_kernel_query(program, "stencil_inject", &kernels[device][0]);
+      if (EXIT_SUCCESS == ok) ok = libxstream_opencl_kernel_query(program, "stencil_record", &kernels[device][1]);
+      if (2 <= ctx->verbosity || 0 > ctx->verbosity) {
+        const libxs_timer_tick_t t1 = libxs_timer_tick();
+        fprintf(stderr, "%s ACC/STENCIL: sources and receivers -> ",
+          EXIT_SUCCESS == ok ? "INFO" : "ERROR");
+        if (EXIT_SUCCESS == ok) {
+          fprintf(stderr, "%.1f ms\n", 1E3 * libxs_timer_duration(t0, t1));
+        }
+        else {
+          fprintf(stderr, "FAILED!\n");
+        }
+      }
+      if (EXIT_SUCCESS != ok) { /* not retried */
+        kernels[device][0] = kernels[device][1] = NULL;
+      }
+      LIBXS_ATOMIC_STORE(ready + device, 1, LIBXS_ATOMIC_SEQ_CST);
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK_DEFAULT, &compile_lock);
+  }
+  return kernels[device][which];
+}
+
+
+void stencil_ricker(float* wavelet, int nsteps, float dt, float freq)
+{
+  const double pi_f = 3.14159265358979323846 * freq, t0 = 1.5 / freq;
+  int step;
+  for (step = 0; step < nsteps; ++step) {
+    const double a = pi_f * (step * (double)dt - t0);
+    wavelet[step] = (float)((1.0 - 2.0 * a * a) * exp(-a * a));
+  }
+}
+
+
+int stencil_survey_setup(stencil_context_t* ctx, stencil_survey_t* survey,
+                         const int* src_xyz, int nsrc, const int* rcv_xyz, int nrcv,
+                         const float* vel_host, float dt2, const float* wavelet,
+                         int nsteps, int batch)
+{
+  int result = EXIT_SUCCESS;
+  const int nx = ctx->grid_size[0], ny = ctx->grid_size[1], nz = ctx->grid_size[2];
+  const int n = LIBXS_MAX(nsrc, 0) + LIBXS_MAX(nrcv, 0);
+  cl_long* idx = (cl_long*)malloc(sizeof(cl_long) * LIBXS_MAX(n, 1)); /* storage may exceed 2^31 points */
+  float* amp = (float*)malloc(sizeof(float) * LIBXS_MAX(nsrc, 1));
+  int i, b;
+
+  LIBXS_MEMZERO(survey);
+  if (NULL == idx || NULL == amp || 0 > nsrc || 0 > nrcv || 0 >= nsteps || 0 >= batch
+    || (0 < nsrc && (NULL == src_xyz || NULL == vel_host || NULL == wavelet))
+    || (0 < nrcv && NULL == rcv_xyz) || NULL == ctx->stream)
+  {
+    result = EXIT_FAILURE;
+  }
+  for (i = 0; i < n && EXIT_SUCCESS == result; ++i) { /* layout is resolved once */
+    const int* const xyz = (i < nsrc ? (src_xyz + 3 * i) : (rcv_xyz + 3 * (i - nsrc)));
+    if (0 <= xyz[0] && xyz[0] < nx && 0 <= xyz[1] && xyz[1] < ny && 0 <= xyz[2] && xyz[2] < nz) {
+      idx[i] = (cl_long)stencil_storage_index(ctx, xyz[0], xyz[1], xyz[2]);
+      if (i < nsrc) {
+        const float v = vel_host[((long)xyz[2] * ny + xyz[1]) * nx + xyz[0]];
+        amp[i] = dt2 * v * v;
+      }
+    }
+    else result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result && (NULL == stencil_get_survey_kernel(ctx, 0) || NULL == stencil_get_survey_kernel(ctx, 1))) {
+    result = EXIT_FAILURE;
+  }
+  survey->nsrc = nsrc;
+  survey->nrcv = nrcv;
+  survey->nsteps = nsteps;
+  survey->batch = LIBXS_MIN(batch, nsteps);
+  if (EXIT_SUCCESS == result && 0 < nsrc) {
+    result = libxstream_mem_allocate(&survey->src_idx, sizeof(cl_long) * nsrc);
+    if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&survey->src_amp, sizeof(float) * nsrc);
+    if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&survey->wavelet, sizeof(float) * nsteps);
+    if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(idx, survey->src_idx, sizeof(cl_long) * nsrc, ctx->stream);
+    if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(amp, survey->src_amp, sizeof(float) * nsrc, ctx->stream);
+    if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(wavelet, survey->wavelet, sizeof(float) * nsteps, ctx->stream);
+  }
+  if (EXIT_SUCCESS == result && 0 < nrcv) {
+    const size_t batch_bytes = sizeof(float) * nrcv * survey->batch;
+    result = libxstream_mem_allocate(&survey->rcv_idx, sizeof(cl_long) * nrcv);
+    if (EXIT_SUCCESS == result) {
+      result = libxstream_mem_copy_h2d(idx + nsrc, survey->rcv_idx, sizeof(cl_long) * nrcv, ctx->stream);
+    }
+    for (b = 0; b < 2 && EXIT_SUCCESS == result; ++b) {
+      result = libxstream_mem_allocate(&survey->traces[b], batch_bytes);
+      if (EXIT_SUCCESS == result) result = libxstream_event_create(&survey->recorded[b]);
+      if (EXIT_SUCCESS == result) result = libxstream_event_create(&survey->drained[b]);
+    }
+    if (EXIT_SUCCESS == result) result = libxstream_stream_create(&survey->stream, "stencil_traces", 0);
+    if (EXIT_SUCCESS == result) {
+      result = libxstream_mem_host_allocate((void**)&survey->traces_host, sizeof(float) * nrcv * nsteps, survey->stream);
+    }
+  }
+  if (EXIT_SUCCESS == result) { /* index arrays are released below */
+    result = libxstream_stream_sync(ctx->stream);
+  }
+  free(amp);
+  free(idx);
+  if (EXIT_SUCCESS == result) ctx->survey = survey;
+  else {
+    ctx->survey = survey; /* release what was allocated */
+    stencil_survey_release(ctx);
+  }
+  return result;
+}
+
+
+/* Download trace batch batch_id (nrows steps) once the compute stream recorded it. */
+static int stencil_survey_drain(stencil_context_t* ctx, int batch_id, int nrows)
+{
+  stencil_survey_t* const survey = ctx->survey;
+  const int b = (batch_id & 1);
+  int result = libxstream_event_record(survey->recorded[b], ctx->stream);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_wait_event(survey->stream, survey->recorded[b]);
+  if (EXIT_SUCCESS == result) {
+    result = libxstream_mem_copy_d2h(survey->traces[b],
+      survey->traces_host + (size_t)batch_id * survey->batch * survey->nrcv,
+      sizeof(float) * survey->nrcv * nrows, survey->stream);
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_event_record(survey->drained[b], survey->stream);
+  if (EXIT_SUCCESS == result) survey->nbatches = batch_id + 1;
+  return result;
+}
+
+
+/* Inject and record after a step that wrote p_new (stencil_apply_steps). */
+static int stencil_survey_step(stencil_context_t* ctx, void* p_new)
+{
+  stencil_survey_t* const survey = ctx->survey;
+  int result = EXIT_SUCCESS;
+  if (survey->step < survey->nsteps) {
+    const int step = survey->step, batch_id = step / survey->batch, slot = step % survey->batch;
+    int ndigits;
+    const cl_long n = (cl_long)stencil_storage_size(ctx, &ndigits);
+    if (0 < survey->nsrc) {
+      const cl_kernel kernel = stencil_get_survey_kernel(ctx, 0);
+      const size_t global = ((size_t)survey->nsrc + 63) / 64 * 64;
+      cl_int i = 0;
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, p_new));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, survey->src_idx));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, survey->src_amp));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, survey->wavelet));
+      CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &step));
+      CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &survey->nsrc));
+      CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(cl_long), &n));
+      CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &ndigits));
+      CL_CHECK(result, libxstream_opencl_launch(ctx->stream, kernel, 1, NULL, &global, NULL, 0, NULL, NULL));
+    }
+    if (0 < survey->nrcv) {
+      const cl_kernel kernel = stencil_get_survey_kernel(ctx, 1);
+      const size_t global = ((size_t)survey->nrcv + 63) / 64 * 64;
+      const int b = (batch_id & 1);
+      cl_int i = 0;
+      if (0 == slot && 2 <= batch_id) { /* buffer still downloading? */
+        result = libxstream_stream_wait_event(ctx->stream, survey->drained[b]);
+      }
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, p_new));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, survey->rcv_idx));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, survey->traces[b]));
+      CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &slot));
+      CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &survey->nrcv));
+      CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(cl_long), &n));
+      CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &ndigits));
+      CL_CHECK(result, libxstream_opencl_launch(ctx->stream, kernel, 1, NULL, &global, NULL, 0, NULL, NULL));
+      if (EXIT_SUCCESS == result && slot + 1 == survey->batch) {
+        result = stencil_survey_drain(ctx, batch_id, survey->batch);
+      }
+    }
+    if (EXIT_SUCCESS == result) survey->step = step + 1;
+  }
+  return result;
+}
+
+
+int stencil_survey_finish(stencil_context_t* ctx)
+{
+  stencil_survey_t* const survey = (NULL != ctx ? ctx->survey : NULL);
+  int result = (NULL != survey ? EXIT_SUCCESS : EXIT_FAILURE);
+  if (EXIT_SUCCESS == result && 0 < survey->nrcv) {
+    const int nrows = survey->step % survey->batch;
+    if (0 != nrows) { /* partial batch */
+      result = stencil_survey_drain(ctx, survey->step / survey->batch, nrows);
+    }
+    if (EXIT_SUCCESS == result) result = libxstream_stream_sync(survey->stream);
+  }
+  return result;
+}
+
+
+void stencil_survey_release(stencil_context_t* ctx)
+{
+  stencil_survey_t* const survey = (NULL != ctx ? ctx->survey : NULL);
+  if (NULL != survey) {
+    int b;
+    if (NULL != survey->stream) libxstream_stream_sync(survey->stream);
+    if (NULL != ctx->stream) libxstream_stream_sync(ctx->stream);
+    for (b = 0; b < 2; ++b) {
+      if (NULL != survey->traces[b]) libxstream_mem_deallocate(survey->traces[b]);
+      if (NULL != survey->recorded[b]) libxstream_event_destroy(survey->recorded[b]);
+      if (NULL != survey->drained[b]) libxstream_event_destroy(survey->drained[b]);
+    }
+    if (NULL != survey->traces_host) libxstream_mem_host_deallocate(survey->traces_host, survey->stream);
+    if (NULL != survey->rcv_idx) libxstream_mem_deallocate(survey->rcv_idx);
+    if (NULL != survey->wavelet) libxstream_mem_deallocate(survey->wavelet);
+    if (NULL != survey->src_amp) libxstream_mem_deallocate(survey->src_amp);
+    if (NULL != survey->src_idx) libxstream_mem_deallocate(survey->src_idx);
+    if (NULL != survey->stream) libxstream_stream_destroy(survey->stream);
+    LIBXS_MEMZERO(survey);
+    ctx->survey = NULL;
+  }
+}
+
+/* Compression (0: BF16, 1: INT8) and decompression (2: BF16, 3: INT8) kernels, built once per device. */
+static cl_kernel stencil_get_snap_kernel(const stencil_context_t* ctx, int which)
+{
+  static const char* names[] = { "stencil_snap_bf16", "stencil_snap_int8", "stencil_unsnap_bf16", "stencil_unsnap_int8" };
+  static cl_kernel kernels[LIBXSTREAM_MAXNDEVS][4] /*= { NULL }*/;
+  static libxs_lock_t compile_lock /*= LIBXS_LOCK_INITIALIZER*/;
+  static int ready[LIBXSTREAM_MAXNDEVS] /*= { 0 }*/;
+  const int device = libxstream_opencl_device()->device_id; /* bound or active */
+
+  if (0 == LIBXS_ATOMIC_LOAD(ready + device, LIBXS_ATOMIC_SEQ_CST)) {
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK_DEFAULT, &compile_lock);
+    if (0 == ready[device]) {
+      const libxs_timer_tick_t t0 = libxs_timer_tick();
+      cl_program program = NULL;
+      char flags[64];
+      int ok, k;
+      LIBXS_SNPRINTF(flags, sizeof(flags), "-DSNAP_BLK=%d", STENCIL_SNAP_BLK);
+      ok = libxstream_opencl_program(0 /*source_kind*/,
+        OPENCL_KERNELS_SOURCE_STENCIL_SNAP, "stencil_snap", flags,
+        NULL /*build_options*/, NULL /*try*/, NULL /*try_ok*/, NULL /*exts*/, 0,
+        &program);
+      for (k = 0; k < 4 && EXIT_SUCCESS == ok; ++k) {
+        ok = libxstream_opencl_kernel_query(program, names[k], &kernels[device][k]);
+      }
+      if (2 <= ctx->verbosity || 0 > ctx->verbosity) {
+        const libxs_timer_tick_t t1 = libxs_timer_tick();
+        fprintf(stderr, "%s ACC/STENCIL: snapshot codecs -> ",
+          EXIT_SUCCESS == ok ? "INFO" : "ERROR");
+        if (EXIT_SUCCESS == ok) {
+          fprintf(stderr, "%.1f ms\n", 1E3 * libxs_timer_duration(t0, t1));
+        }
+        else {
+          fprintf(stderr, "FAILED!\n");
+        }
+      }
+      if (EXIT_SUCCESS != ok) { /* not retried */
+        for (k = 0; k < 4; ++k) kernels[device][k] = NULL;
+      }
+      LIBXS_ATOMIC_STORE(ready + device, 1, LIBXS_ATOMIC_SEQ_CST);
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK_DEFAULT, &compile_lock);
+  }
+  return kernels[device][which];
+}
+
+
+/* Enqueue (de-)compression between the FP32 wavefield p and dev[b] on the context's stream. */
+static int stencil_snap_convert(stencil_context_t* ctx, int b, void* p, int restore)
+{
+  stencil_snap_t* const snap = ctx->snap;
+  const int int8 = (STENCIL_SNAP_INT8 == snap->codec ? 1 : 0);
+  const cl_kernel kernel = stencil_get_snap_kernel(ctx, 2 * (0 != restore) + int8);
+  const cl_long n = (cl_long)snap->n;
+  const size_t nblk = ((size_t)snap->n + STENCIL_SNAP_BLK - 1) / STENCIL_SNAP_BLK;
+  const size_t global = nblk * STENCIL_SNAP_BLK, local = STENCIL_SNAP_BLK;
+  int result = (NULL != kernel ? EXIT_SUCCESS : EXIT_FAILURE);
+  cl_int i = 0;
+  if (0 != int8) { /* exponents follow the slices */
+    void *const slices = snap->dev[b], *const exps = (char*)snap->dev[b] + snap->n;
+    if (0 == restore) {
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, p));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, slices));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, exps));
+    }
+    else {
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, slices));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, exps));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, p));
+    }
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(cl_long), &n));
+  }
+  else {
+    const int ndigits = (STENCIL_SNAP_BF16X2 == snap->codec ? 2 : 1);
+    CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, 0 == restore ? p : snap->dev[b]));
+    CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, 0 == restore ? snap->dev[b] : p));
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(cl_long), &n));
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &ndigits));
+  }
+  CL_CHECK(result, libxstream_opencl_launch_work(ctx->stream, kernel, 1, NULL, &global,
+    0 != int8 ? &local : NULL, 0, NULL, NULL, 0 /*nflops*/, sizeof(float) * (size_t)snap->n + snap->nbytes));
+  if (EXIT_SUCCESS == result) result = libxstream_event_record(snap->compute[b], ctx->stream);
+  if (EXIT_SUCCESS == result) snap->recorded[b] |= 1;
+  return result;
+}
+
+
+int stencil_snap_setup(stencil_context_t* ctx, stencil_snap_t* snap, stencil_snap_codec_t codec,
+                       int every, int nsnaps, const char* path)
+{
+  int ndigits, result = EXIT_SUCCESS, b;
+  const long n = stencil_storage_size(ctx, &ndigits);
+  const size_t nblk = ((size_t)n + STENCIL_SNAP_BLK - 1) / STENCIL_SNAP_BLK;
+
+  LIBXS_MEMZERO(snap);
+  if (0 <= ndigits) { /* BF16 or FP16 storage is compressed already */
+    if (2 <= ctx->verbosity || 0 > ctx->verbosity) {
+      fprintf(stderr, "WARN ACC/STENCIL: snapshots require FP32 wavefield storage.\n");
+    }
+    result = EXIT_FAILURE;
+  }
+  if (0 >= every || 0 >= nsnaps || STENCIL_SNAP_BF16 > codec || STENCIL_SNAP_INT8 < codec) {
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result && NULL == stencil_get_snap_kernel(ctx, 0)) result = EXIT_FAILURE;
+  snap->n = n;
+  snap->codec = codec;
+  snap->every = every;
+  snap->nsnaps = nsnaps;
+  snap->nbytes = (STENCIL_SNAP_INT8 == codec ? ((size_t)n + nblk)
+    : ((size_t)n * sizeof(cl_ushort) * (STENCIL_SNAP_BF16X2 == codec ? 2 : 1)));
+  snap->store_bytes = snap->nbytes * nsnaps;
+  snap->resident[0] = snap->resident[1] = -1;
+  for (b = 0; b < 2 && EXIT_SUCCESS == result; ++b) {
+    result = libxstream_mem_allocate(&snap->dev[b], snap->nbytes);
+    if (EXIT_SUCCESS == result) result = libxstream_event_create(&snap->compute[b]);
+    if (EXIT_SUCCESS == result) result = libxstream_event_create(&snap->transfer[b]);
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_stream_create(&snap->stream, "stencil_snap", 0);
+  if (EXIT_SUCCESS == result && NULL != path && '\0' != *path) {
+#if !defined(_WIN32)
+    const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (0 <= fd && 0 == ftruncate(fd, (off_t)snap->store_bytes)) {
+      void* const map = mmap(NULL, snap->store_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (MAP_FAILED != map) {
+        snap->store = (char*)map;
+        snap->mapped = 1;
+      }
+    }
+    if (0 <= fd) close(fd); /* the mapping stays valid */
+#endif
+    if (NULL == snap->store) {
+      fprintf(stderr, "ERROR ACC/STENCIL: failed to map snapshot file \"%s\".\n", path);
+      result = EXIT_FAILURE;
+    }
+  }
+  else if (EXIT_SUCCESS == result) {
+    result = libxstream_mem_host_allocate((void**)&snap->store, snap->store_bytes, snap->stream);
+  }
+  ctx->snap = snap;
+  if (EXIT_SUCCESS != result) stencil_snap_release(ctx);
+  return result;
+}
+
+
+/* Compress the wavefield p into the next snapshot and download it (stencil_apply_steps). */
+static int stencil_snap_step(stencil_context_t* ctx, void* p)
+{
+  stencil_snap_t* const snap = ctx->snap;
+  int result = EXIT_SUCCESS;
+  ++snap->step;
+  if (0 == (snap->step % snap->every) && snap->count < snap->nsnaps) {
+    const int b = (snap->count & 1);
+    if (0 != (snap->recorded[b] & 2)) { /* dev[b] may still be downloading */
+      result = libxstream_stream_wait_event(ctx->stream, snap->transfer[b]);
+    }
+    if (EXIT_SUCCESS == result) result = stencil_snap_convert(ctx, b, p, 0 /*restore*/);
+    if (EXIT_SUCCESS == result) result = libxstream_stream_wait_event(snap->stream, snap->compute[b]);
+    if (EXIT_SUCCESS == result) {
+      result = libxstream_mem_copy_d2h(snap->dev[b], snap->store + snap->nbytes * snap->count,
+        snap->nbytes, snap->stream);
+    }
+    if (EXIT_SUCCESS == result) result = libxstream_event_record(snap->transfer[b], snap->stream);
+    if (EXIT_SUCCESS == result) { /* the device copy remains usable for restoring */
+      snap->recorded[b] |= 2;
+      snap->resident[b] = snap->count++;
+    }
+  }
+  return result;
+}
+
+
+int stencil_snap_finish(stencil_context_t* ctx)
+{
+  stencil_snap_t* const snap = (NULL != ctx ? ctx->snap : NULL);
+  return (NULL != snap ? libxstream_stream_sync(snap->stream) : EXIT_FAILURE);
+}
+
+
+int stencil_snap_prefetch(stencil_context_t* ctx, int index)
+{
+  stencil_snap_t* const snap = (NULL != ctx ? ctx->snap : NULL);
+  int result = ((NULL != snap && 0 <= index && index < snap->count) ? EXIT_SUCCESS : EXIT_FAILURE);
+  if (EXIT_SUCCESS == result && index != snap->resident[index & 1]) {
+    const int b = (index & 1);
+    if (0 != (snap->recorded[b] & 1)) { /* dev[b] may still be in use by the compute stream */
+      result = libxstream_stream_wait_event(snap->stream, snap->compute[b]);
+    }
+    if (EXIT_SUCCESS == result) {
+      result = libxstream_mem_copy_h2d(snap->store + snap->nbytes * index, snap->dev[b],
+        snap->nbytes, snap->stream);
+    }
+    if (EXIT_SUCCESS == result) result = libxstream_event_record(snap->transfer[b], snap->stream);
+    if (EXIT_SUCCESS == result) {
+      snap->recorded[b] |= 2;
+      snap->resident[b] = index;
+    }
+  }
+  return result;
+}
+
+
+int stencil_snap_restore(stencil_context_t* ctx, int index, void* p)
+{
+  int result = stencil_snap_prefetch(ctx, index);
+  if (EXIT_SUCCESS == result) {
+    stencil_snap_t* const snap = ctx->snap;
+    const int b = (index & 1);
+    result = libxstream_stream_wait_event(ctx->stream, snap->transfer[b]);
+    if (EXIT_SUCCESS == result) result = stencil_snap_convert(ctx, b, p, 1 /*restore*/);
+  }
+  return result;
+}
+
+
+void stencil_snap_release(stencil_context_t* ctx)
+{
+  stencil_snap_t* const snap = (NULL != ctx ? ctx->snap : NULL);
+  if (NULL != snap) {
+    int b;
+    if (NULL != snap->stream) libxstream_stream_sync(snap->stream);
+    if (NULL != ctx->stream) libxstream_stream_sync(ctx->stream);
+    if (NULL != snap->store) {
+#if !defined(_WIN32)
+      if (0 != snap->mapped) munmap(snap->store, snap->store_bytes);
+      else
+#endif
+      libxstream_mem_host_deallocate(snap->store, snap->stream);
+    }
+    for (b = 0; b < 2; ++b) {
+      if (NULL != snap->dev[b]) libxstream_mem_deallocate(snap->dev[b]);
+      if (NULL != snap->compute[b]) libxstream_event_destroy(snap->compute[b]);
+      if (NULL != snap->transfer[b]) libxstream_event_destroy(snap->transfer[b]);
+    }
+    if (NULL != snap->stream) libxstream_stream_destroy(snap->stream);
+    LIBXS_MEMZERO(snap);
+    ctx->snap = NULL;
+  }
+}
+
 static int stencil_valid_strips_per_wg(int value)
 {
   int result = value;
@@ -589,6 +1231,7 @@ static void stencil_key_pack(const stencil_context_t* ctx, stencil_opencl_key_t*
     && NULL != fp32_block_io_env && 0 != atoi(fp32_block_io_env));
   key->fp32_sblock = (signed char)fp32_sblock;
   key->ndigits_a = (signed char)ctx->ndigits_a;
+  key->tsteps = (signed char)ctx->tsteps;
 }
 
 
@@ -600,7 +1243,7 @@ static const stencil_kernels_t* stencil_get_kernels(stencil_context_t* ctx)
   static int base_ready /*= 0*/;
 
   const libxstream_opencl_config_t* config = &libxstream_opencl_config;
-  const libxstream_opencl_device_t* devinfo = &config->device;
+  const libxstream_opencl_device_t* devinfo = libxstream_opencl_device();
   stencil_opencl_key_t key;
   stencil_kernels_t* kptr;
 
@@ -633,6 +1276,9 @@ static const stencil_kernels_t* stencil_get_kernels(stencil_context_t* ctx)
   key.ndigits_x = ctx->ndigits_x;
   key.i8_op = ctx->i8_op;
   stencil_key_pack(ctx, &key);
+  /* programs belong to the calling thread's device, arguments to the instance */
+  key.device = (signed char)devinfo->device_id;
+  key.instance = (signed char)ctx->instance;
   if (0 != ctx->fp32) {
     int fp32_wgx, fp32_wgy;
     stencil_fp32_wg_dims(&fp32_wgx, &fp32_wgy);
@@ -743,10 +1389,10 @@ static const stencil_kernels_t* stencil_get_kernels(stencil_context_t* ctx)
       if (1 == ctx->fp32) {
         char fp32_flags[128];
         LIBXS_SNPRINTF(fp32_flags, sizeof(fp32_flags),
-          " -DWG_X=%d -DWG_Y=%d -DFP32_DISABLE_BLOCK_IO=%d -DFP32_SBLOCK=%d",
+          " -DWG_X=%d -DWG_Y=%d -DFP32_DISABLE_BLOCK_IO=%d -DFP32_SBLOCK=%d -DSTENCIL_TB=%d",
           STENCIL_KEY_FP32_WGX(key), STENCIL_KEY_FP32_WGY(key),
           (0 == key.fp32_block_io) ? 1 : 0,
-          key.fp32_sblock);
+          key.fp32_sblock, key.tsteps);
         strncat(flags, fp32_flags, sizeof(flags) - strlen(flags) - 1);
       }
 
@@ -767,6 +1413,9 @@ static const stencil_kernels_t* stencil_get_kernels(stencil_context_t* ctx)
       LIBXS_MEMZERO(&knl);
       if (EXIT_SUCCESS == ok && 1 == ctx->fp32) {
         ok = libxstream_opencl_kernel_query(program, "stencil_apply_direct", &knl.stencil_apply_direct);
+        if (EXIT_SUCCESS == ok && 1 < key.tsteps) {
+          ok = libxstream_opencl_kernel_query(program, "stencil_apply_temporal", &knl.stencil_apply_temporal);
+        }
       }
       else if (EXIT_SUCCESS == ok && 0 != key.int8) {
         ok = libxstream_opencl_kernel_query(program, "stencil_apply_int8", &knl.stencil_apply);
@@ -788,10 +1437,10 @@ static const stencil_kernels_t* stencil_get_kernels(stencil_context_t* ctx)
 
       if (2 <= ctx->verbosity || 0 > ctx->verbosity) {
         const libxs_timer_tick_t t1 = libxs_timer_tick();
-        fprintf(stderr, "%s ACC/STENCIL: method=%d k=%d r=%d strips=%d sg=%d grf256=%d -> ",
+        fprintf(stderr, "%s ACC/STENCIL: method=%d k=%d r=%d strips=%d sg=%d grf256=%d tsteps=%d -> ",
           EXIT_SUCCESS == ok ? "INFO" : "ERROR",
           key.method, key.k_steps, key.r_per_step, key.strips_per_wg,
-          key.sg, key.grf256);
+          key.sg, key.grf256, key.tsteps);
         if (EXIT_SUCCESS == ok) {
           fprintf(stderr, "%.1f ms\n", 1E3 * libxs_timer_duration(t0, t1));
         }
@@ -817,7 +1466,7 @@ int stencil_init(stencil_context_t* ctx, int verbosity, int method_override)
 
   libxstream_init_config_default(&cfg);
   result = libxstream_init_config(&cfg);
-  devinfo = &libxstream_opencl_config.device;
+  devinfo = libxstream_opencl_device();
   strips_env = getenv("STENCIL_STRIPS_PER_WG");
   blocked_env = getenv("STENCIL_BLOCKED");
   layout_env = getenv("STENCIL_LAYOUT");
@@ -832,6 +1481,7 @@ int stencil_init(stencil_context_t* ctx, int verbosity, int method_override)
   lu_env = getenv("STENCIL_LU");
 
   LIBXS_MEMZERO(ctx);
+  libxstream_mem_arena_init(&ctx->scratch, (size_t)-1 /*unbounded*/, libxstream_opencl_mem_hint_default);
   ctx->verbosity = verbosity;
 
   if (0 <= method_override) {
@@ -932,6 +1582,10 @@ int stencil_init(stencil_context_t* ctx, int verbosity, int method_override)
   { const char *const hint_env = getenv("STENCIL_HINT");
     ctx->hint = (NULL != hint_env) ? atoi(hint_env) : 0;
   }
+  { const char *const tsteps_env = getenv("STENCIL_TSTEPS");
+    const int tsteps = (NULL != tsteps_env) ? atoi(tsteps_env) : 1;
+    ctx->tsteps = LIBXS_MAX(LIBXS_MIN(tsteps, STENCIL_TSTEPS_MAX), 1);
+  }
 
   ctx->nterms = 3;
 
@@ -955,6 +1609,19 @@ static void stencil_pml_profile(float* profile, int n, int ndamp, float scale)
 }
 
 
+/** SLM of the temporal kernel: levels 1..tsteps-1 as rings of 2r+1 widened planes. */
+static size_t stencil_temporal_slm(int tsteps, int wg_x, int wg_y, int radius)
+{
+  size_t result = 0;
+  int t;
+  for (t = 1; t < tsteps; ++t) {
+    const int ext = radius * (tsteps - t);
+    result += (size_t)(2 * radius + 1) * (wg_x + 2 * ext) * (wg_y + 2 * ext) * sizeof(float);
+  }
+  return result;
+}
+
+
 int stencil_configure(stencil_context_t* ctx, int nx, int ny, int nz)
 {
   int result = EXIT_SUCCESS;
@@ -975,6 +1642,36 @@ int stencil_configure(stencil_context_t* ctx, int nx, int ny, int nz)
     ctx->nblocks[1] = (ny + STENCIL_BLK - 1) / STENCIL_BLK;
     ctx->nblocks[2] = (nz + STENCIL_BLK - 1) / STENCIL_BLK;
   }
+  if (EXIT_SUCCESS == result && 1 < ctx->tsteps) {
+    if (1 != ctx->fp32 || 0 != ctx->layout || 0 != ctx->blocked || 0 != ctx->pml
+      || 0 != ctx->bf16s || 0 != ctx->fp16 || 3 != ctx->nterms)
+    {
+      if (2 <= ctx->verbosity || 0 > ctx->verbosity) {
+        fprintf(stderr, "WARN ACC/STENCIL: temporal blocking requires FP32, XYZ-layout, no PML, and 3 terms.\n");
+      }
+      ctx->tsteps = 1;
+    }
+    else {
+      const cl_device_id device = libxstream_opencl_config.devices[libxstream_opencl_device()->device_id];
+      const int radius = (STENCIL_DIRECT == ctx->method) ? STENCIL_RADIUS : ctx->r_per_step;
+      cl_ulong slm_max = 0;
+      int wg_x, wg_y;
+      stencil_fp32_wg_dims(&wg_x, &wg_y);
+      if (CL_SUCCESS != clGetDeviceInfo(device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &slm_max, NULL)) {
+        slm_max = 0;
+      }
+      while (1 < ctx->tsteps && slm_max < stencil_temporal_slm(ctx->tsteps, wg_x, wg_y, radius)) {
+        --ctx->tsteps; /* fewer levels fit */
+      }
+    }
+  }
+  if (EXIT_SUCCESS == result && 1 < ctx->tsteps) {
+    const size_t grid_bytes = (size_t)nx * ny * nz * sizeof(float);
+    int tb;
+    for (tb = 0; tb < 2 && EXIT_SUCCESS == result; ++tb) {
+      result = libxstream_mem_dev_allocate_hint(&ctx->tb_buf[tb], grid_bytes, mem_hint);
+    }
+  }
   if (EXIT_SUCCESS == result && 0 != ctx->int8) {
     const int total_blocks = ctx->nblocks[0] * ctx->nblocks[1] * ctx->nblocks[2];
     const int nstrips = STENCIL_N_STRIPS;
@@ -1448,6 +2145,63 @@ int stencil_precompute_operators(stencil_context_t* ctx,
 }
 
 
+/**
+ * Enqueue the FP32 direct kernel for the slow-axis blocks [block_begin, block_end).
+ * The kernel derives its slab from the global ID in dimension 2 (local size 1),
+ * i.e., a launch offset selects the first block.
+ */
+static int stencil_launch_direct(const stencil_context_t* ctx, cl_kernel kernel,
+                                 libxstream_stream_t* stream,
+                                 void* p_cur, void* p_old, void* p_new, void* vel,
+                                 float dt2, float dh, int block_begin, int block_end)
+{
+  int result = EXIT_SUCCESS;
+  const int nx = ctx->grid_size[0];
+  const int ny = ctx->grid_size[1];
+  const int nz = ctx->grid_size[2];
+  size_t offset_direct[3], global_direct[3], local_direct[3];
+  int fp32_wgx, fp32_wgy;
+  cl_int i = 0;
+  stencil_fp32_wg_dims(&fp32_wgx, &fp32_wgy);
+  local_direct[0] = (size_t)fp32_wgx;
+  local_direct[1] = (size_t)fp32_wgy;
+  local_direct[2] = 1;
+  if (2 == ctx->layout) {
+    global_direct[0] = ((size_t)(nz + fp32_wgx - 1) / fp32_wgx) * fp32_wgx;
+    global_direct[1] = ((size_t)(ny + fp32_wgy - 1) / fp32_wgy) * fp32_wgy;
+  }
+  else {
+    global_direct[0] = ((size_t)(nx + fp32_wgx - 1) / fp32_wgx) * fp32_wgx;
+    global_direct[1] = ((size_t)(ny + fp32_wgy - 1) / fp32_wgy) * fp32_wgy;
+  }
+  global_direct[2] = (size_t)(block_end - block_begin);
+  offset_direct[0] = offset_direct[1] = 0;
+  offset_direct[2] = (size_t)block_begin;
+  CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, p_cur));
+  CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, p_old));
+  CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, p_new));
+  CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, vel));
+  CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, ctx->coeff));
+  if (0 != ctx->pml) {
+    const float hdx_2 = 0.25f / (dh * dh);
+    const float hdy_2 = 0.25f / (dh * dh);
+    const float hdz_2 = 0.25f / (dh * dh);
+    CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, ctx->eta));
+    CL_CHECK(result, libxstream_opencl_set_kernel_ptr(kernel, i++, ctx->phi));
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(float), &hdx_2));
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(float), &hdy_2));
+    CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(float), &hdz_2));
+  }
+  CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(float), &dt2));
+  CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &nx));
+  CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &ny));
+  CL_CHECK(result, clSetKernelArg(kernel, i++, sizeof(int), &nz));
+  CL_CHECK(result, libxstream_opencl_launch(stream, kernel,
+    3, 0 != block_begin ? offset_direct : NULL, global_direct, local_direct, 0, NULL, NULL));
+  return result;
+}
+
+
 int stencil_apply_laplacian(stencil_context_t* ctx,
                             void* p_cur, void* p_old, void* p_new,
                             void* vel, float dt2, float dh, int nterms)
@@ -1465,44 +2219,9 @@ int stencil_apply_laplacian(stencil_context_t* ctx,
   if (NULL == knl) result = EXIT_FAILURE;
 
   if (EXIT_SUCCESS == result && 1 == ctx->fp32 && NULL != knl->stencil_apply_direct) {
-    size_t global_direct[3], local_direct[3];
-    int fp32_wgx, fp32_wgy;
-    cl_int i = 0;
-    stencil_fp32_wg_dims(&fp32_wgx, &fp32_wgy);
-    local_direct[0] = (size_t)fp32_wgx;
-    local_direct[1] = (size_t)fp32_wgy;
-    local_direct[2] = 1;
-    if (2 == ctx->layout) {
-      global_direct[0] = ((size_t)(nz + fp32_wgx - 1) / fp32_wgx) * fp32_wgx;
-      global_direct[1] = ((size_t)(ny + fp32_wgy - 1) / fp32_wgy) * fp32_wgy;
-      global_direct[2] = (size_t)((nx + STENCIL_BLK - 1) / STENCIL_BLK);
-    }
-    else {
-      global_direct[0] = ((size_t)(nx + fp32_wgx - 1) / fp32_wgx) * fp32_wgx;
-      global_direct[1] = ((size_t)(ny + fp32_wgy - 1) / fp32_wgy) * fp32_wgy;
-      global_direct[2] = (size_t)((nz + STENCIL_BLK - 1) / STENCIL_BLK);
-    }
-    CL_CHECK(result, libxstream_opencl_set_kernel_ptr(knl->stencil_apply_direct, i++, p_cur));
-    CL_CHECK(result, libxstream_opencl_set_kernel_ptr(knl->stencil_apply_direct, i++, p_old));
-    CL_CHECK(result, libxstream_opencl_set_kernel_ptr(knl->stencil_apply_direct, i++, p_new));
-    CL_CHECK(result, libxstream_opencl_set_kernel_ptr(knl->stencil_apply_direct, i++, vel));
-    CL_CHECK(result, libxstream_opencl_set_kernel_ptr(knl->stencil_apply_direct, i++, ctx->coeff));
-    if (0 != ctx->pml) {
-      const float hdx_2 = 0.25f / (dh * dh);
-      const float hdy_2 = 0.25f / (dh * dh);
-      const float hdz_2 = 0.25f / (dh * dh);
-      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(knl->stencil_apply_direct, i++, ctx->eta));
-      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(knl->stencil_apply_direct, i++, ctx->phi));
-      CL_CHECK(result, clSetKernelArg(knl->stencil_apply_direct, i++, sizeof(float), &hdx_2));
-      CL_CHECK(result, clSetKernelArg(knl->stencil_apply_direct, i++, sizeof(float), &hdy_2));
-      CL_CHECK(result, clSetKernelArg(knl->stencil_apply_direct, i++, sizeof(float), &hdz_2));
-    }
-    CL_CHECK(result, clSetKernelArg(knl->stencil_apply_direct, i++, sizeof(float), &dt2));
-    CL_CHECK(result, clSetKernelArg(knl->stencil_apply_direct, i++, sizeof(int), &nx));
-    CL_CHECK(result, clSetKernelArg(knl->stencil_apply_direct, i++, sizeof(int), &ny));
-    CL_CHECK(result, clSetKernelArg(knl->stencil_apply_direct, i++, sizeof(int), &nz));
-    CL_CHECK(result, libxstream_opencl_launch(ctx->stream, knl->stencil_apply_direct,
-      3, NULL, global_direct, local_direct, 0, NULL, NULL));
+    const int nslow = (2 == ctx->layout) ? nx : nz;
+    result = stencil_launch_direct(ctx, knl->stencil_apply_direct, ctx->stream,
+      p_cur, p_old, p_new, vel, dt2, dh, 0, (nslow + STENCIL_BLK - 1) / STENCIL_BLK);
   }
   else if (EXIT_SUCCESS == result) {
     global_apply[0] = (size_t)ctx->nblocks[0] * ctx->sg;
@@ -1601,6 +2320,83 @@ int stencil_apply_laplacian(stencil_context_t* ctx,
 }
 
 
+int stencil_apply_slab(stencil_context_t* ctx, libxstream_stream_t* stream,
+                       void* p_cur, void* p_old, void* p_new, void* vel,
+                       float dt2, float dh, int block_begin, int block_end)
+{
+  int result = EXIT_SUCCESS;
+  const stencil_kernels_t* knl = stencil_get_kernels(ctx);
+  const int nslow = (2 == ctx->layout) ? ctx->grid_size[0] : ctx->grid_size[2];
+  if (NULL == knl || 1 != ctx->fp32 || NULL == knl->stencil_apply_direct
+    || 0 > block_begin || (nslow + STENCIL_BLK - 1) / STENCIL_BLK < block_end)
+  {
+    result = EXIT_FAILURE;
+  }
+  else if (block_begin < block_end) {
+    result = stencil_launch_direct(ctx, knl->stencil_apply_direct,
+      NULL != stream ? stream : ctx->stream,
+      p_cur, p_old, p_new, vel, dt2, dh, block_begin, block_end);
+  }
+  return result;
+}
+
+int stencil_apply_steps(stencil_context_t* ctx, void* p_buf[2], int* cur,
+                        void* vel, float dt2, float dh, int nterms, int nsteps)
+{
+  int result = EXIT_SUCCESS, step = 0;
+  const int tsteps = (3 == nterms) ? ctx->tsteps : 1;
+
+  if (1 < tsteps && tsteps <= nsteps && NULL == ctx->survey && NULL == ctx->snap) {
+    const stencil_kernels_t* knl = stencil_get_kernels(ctx);
+    const int nx = ctx->grid_size[0], ny = ctx->grid_size[1], nz = ctx->grid_size[2];
+    size_t global[3], local[3];
+    int wg_x, wg_y;
+    stencil_fp32_wg_dims(&wg_x, &wg_y);
+    local[0] = (size_t)wg_x;
+    local[1] = (size_t)wg_y;
+    local[2] = 1;
+    global[0] = ((size_t)(nx + wg_x - 1) / wg_x) * wg_x;
+    global[1] = ((size_t)(ny + wg_y - 1) / wg_y) * wg_y;
+    global[2] = (size_t)((nz + STENCIL_BLK - 1) / STENCIL_BLK);
+    if (NULL == knl || NULL == knl->stencil_apply_temporal) result = EXIT_FAILURE;
+    for (; step + tsteps <= nsteps && EXIT_SUCCESS == result; step += tsteps) {
+      void *const p_cur = p_buf[*cur], *const p_old = p_buf[1 - *cur];
+      cl_int i = 0;
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(knl->stencil_apply_temporal, i++, p_cur));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(knl->stencil_apply_temporal, i++, p_old));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(knl->stencil_apply_temporal, i++, ctx->tb_buf[0]));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(knl->stencil_apply_temporal, i++, ctx->tb_buf[1]));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(knl->stencil_apply_temporal, i++, vel));
+      CL_CHECK(result, libxstream_opencl_set_kernel_ptr(knl->stencil_apply_temporal, i++, ctx->coeff));
+      CL_CHECK(result, clSetKernelArg(knl->stencil_apply_temporal, i++, sizeof(float), &dt2));
+      CL_CHECK(result, clSetKernelArg(knl->stencil_apply_temporal, i++, sizeof(int), &nx));
+      CL_CHECK(result, clSetKernelArg(knl->stencil_apply_temporal, i++, sizeof(int), &ny));
+      CL_CHECK(result, clSetKernelArg(knl->stencil_apply_temporal, i++, sizeof(int), &nz));
+      CL_CHECK(result, libxstream_opencl_launch(ctx->stream, knl->stencil_apply_temporal,
+        3, NULL, global, local, 0, NULL, NULL));
+      if (EXIT_SUCCESS == result) { /* new levels become the wavefields, inputs the scratch */
+        p_buf[*cur] = ctx->tb_buf[0];
+        p_buf[1 - *cur] = ctx->tb_buf[1];
+        ctx->tb_buf[0] = p_cur;
+        ctx->tb_buf[1] = p_old;
+      }
+    }
+  }
+  for (; step < nsteps && EXIT_SUCCESS == result; ++step) {
+    result = stencil_apply_laplacian(ctx, p_buf[*cur], p_buf[1 - *cur], p_buf[1 - *cur],
+      vel, dt2, dh, nterms);
+    if (EXIT_SUCCESS == result && NULL != ctx->survey) {
+      result = stencil_survey_step(ctx, p_buf[1 - *cur]);
+    }
+    if (EXIT_SUCCESS == result && NULL != ctx->snap) {
+      result = stencil_snap_step(ctx, p_buf[1 - *cur]);
+    }
+    *cur = 1 - *cur;
+  }
+  return result;
+}
+
+
 void stencil_finalize(stencil_context_t* ctx)
 {
   int dim;
@@ -1614,6 +2410,11 @@ void stencil_finalize(stencil_context_t* ctx)
     if (NULL != ctx->coeff) libxstream_mem_dev_deallocate_hint(ctx->coeff);
     if (NULL != ctx->eta) libxstream_mem_dev_deallocate_hint(ctx->eta);
     if (NULL != ctx->phi) libxstream_mem_dev_deallocate_hint(ctx->phi);
+    if (NULL != ctx->tb_buf[0]) libxstream_mem_dev_deallocate_hint(ctx->tb_buf[0]);
+    if (NULL != ctx->tb_buf[1]) libxstream_mem_dev_deallocate_hint(ctx->tb_buf[1]);
+    stencil_survey_release(ctx);
+    stencil_snap_release(ctx);
+    libxstream_mem_arena_destroy(&ctx->scratch);
     if (NULL != ctx->stream) libxstream_stream_destroy(ctx->stream);
     LIBXS_MEMZERO(ctx);
   }
@@ -73,14 +73,67 @@ typedef struct {
   signed char fp32_block_io;
   signed char fp32_sblock;
   signed char ndigits_a;
+  signed char tsteps;
+  signed char device;
+  signed char instance;
 } stencil_opencl_key_t;
 
 typedef struct {
   cl_kernel stencil_apply;
   cl_kernel stencil_apply_tti;
   cl_kernel stencil_apply_direct;
+  cl_kernel stencil_apply_temporal;
 } stencil_kernels_t;
 
+/**
+ * Sparse sources and receivers attached to a context (stencil_survey_setup).
+ * Traces are recorded into device batches, which are downloaded on a stream of
+ * their own while the time loop continues (double-buffered).
+ */
+typedef struct {
+  void* src_idx;
+  void* src_amp;
+  void* wavelet;
+  void* rcv_idx;
+  void* traces[2];
+  /* pinned, nsteps rows of nrcv samples (complete after stencil_survey_finish) */
+  float* traces_host;
+  libxstream_stream_t* stream;
+  /* batch recorded (compute stream), respectively downloaded (trace stream) */
+  libxstream_event_t* recorded[2];
+  libxstream_event_t* drained[2];
+  int nsrc, nrcv, nsteps, batch, step, nbatches;
+} stencil_survey_t;
+
+typedef enum {
+  STENCIL_SNAP_BF16   = 0,
+  STENCIL_SNAP_BF16X2 = 1,
+  STENCIL_SNAP_INT8   = 2
+} stencil_snap_codec_t;
+
+/**
+ * Compressed wavefield snapshots attached to a context (stencil_snap_setup).
+ * Snapshots are compressed on the device into one of two buffers, which are
+ * transferred on a stream of their own (downloads, and prefetches in reverse).
+ */
+typedef struct {
+  void* dev[2];
+  /* nsnaps snapshots: pinned host memory, or a file mapped into memory */
+  char* store;
+  size_t store_bytes;
+  libxstream_stream_t* stream;
+  /* last use of dev[b] by the compute stream, respectively the transfer stream */
+  libxstream_event_t* compute[2];
+  libxstream_event_t* transfer[2];
+  /* bytes per snapshot, and number of stored (FP32) values */
+  size_t nbytes;
+  long n;
+  stencil_snap_codec_t codec;
+  int every, nsnaps, count, step, mapped;
+  /* snapshot held by dev[b] (or -1), and which events were recorded (bits) */
+  int resident[2], recorded[2];
+} stencil_snap_t;
+
 typedef struct {
   void* dk[3];
   void* dk_scale;
@@ -113,8 +166,19 @@ typedef struct {
   int halo[3];
   int pml;
   int hint;
+  /* time steps per launch (temporal blocking), and the wavefields it writes */
+  int tsteps;
+  void* tb_buf[2];
+  /* non-zero gives the context kernels of its own (concurrent contexts) */
+  int instance;
+  /* sources and receivers served after every step (disables temporal blocking) */
+  stencil_survey_t* survey;
+  /* snapshots taken after every n-th step (disables temporal blocking) */
+  stencil_snap_t* snap;
   void* eta;
   void* phi;
+  /* device scratch reused across calls (raw upload before a layout conversion) */
+  libxstream_mem_arena_t scratch;
   int verbosity;
 } stencil_context_t;
 
@@ -126,6 +190,23 @@ int stencil_precompute_operators(stencil_context_t* ctx,
 int stencil_apply_laplacian(stencil_context_t* ctx,
                             void* p_cur, void* p_old, void* p_new,
                             void* vel, float dt2, float dh, int nterms);
+/**
+ * FP32 direct path limited to the slow-axis blocks [block_begin, block_end) of
+ * STENCIL_BLK planes, enqueued on the given stream (NULL: the context's stream).
+ * Launches on different streams may overlap as long as their blocks differ.
+ */
+int stencil_apply_slab(stencil_context_t* ctx, libxstream_stream_t* stream,
+                       void* p_cur, void* p_old, void* p_new, void* vel,
+                       float dt2, float dh, int block_begin, int block_end);
+/**
+ * Advance nsteps time steps: p_buf[*cur] is the current and p_buf[1 - *cur] the
+ * previous wavefield (*cur is updated). Blocks of ctx->tsteps are fused into one
+ * launch writing the context's two scratch wavefields, which are then exchanged
+ * with p_buf, i.e., p_buf must be allocated by libxstream_mem_dev_allocate_hint.
+ * Remaining steps (or tsteps=1) use stencil_apply_laplacian.
+ */
+int stencil_apply_steps(stencil_context_t* ctx, void* p_buf[2], int* cur,
+                        void* vel, float dt2, float dh, int nterms, int nsteps);
 void stencil_finalize(stencil_context_t* ctx);
 
 int stencil_seed_exp_buf(stencil_context_t* ctx, const float* p_host,
@@ -145,5 +226,68 @@ void stencil_pack_bf16s_zyx(unsigned short* dst, const float* src,
                             int hx, int hy, int hz, int ndigits);
 void stencil_unpack_bf16s(float* dst, const unsigned short* src, size_t n,
                           int ndigits);
+/**
+ * Upload a linear field (x fastest, grid as configured) and convert it on the
+ * device into the context's storage: blocked tiles, ZYX (with the context's halo
+ * if padded is non-zero), or XYZ. ndigits as above, or -1 = FP32. The raw upload
+ * lands in a device scratch buffer, i.e., no host staging is needed, and the
+ * call returns once the scratch is released (conversion complete).
+ */
+int stencil_upload_field(stencil_context_t* ctx, void* dst, const float* src,
+                         int padded, int ndigits);
+
+/** Ricker wavelet of peak frequency freq, delayed by 1.5 / freq, sampled at step * dt. */
+void stencil_ricker(float* wavelet, int nsteps, float dt, float freq);
+/**
+ * Attach nsrc sources and nrcv receivers (x, y, z triplets of grid points) to
+ * the context: after each of the next nsteps steps, stencil_apply_steps adds
+ * dt2 * vel^2 * wavelet[step] at the sources (distinct points), and records the
+ * wavefield at the receivers. Traces are downloaded every batch steps.
+ */
+int stencil_survey_setup(stencil_context_t* ctx, stencil_survey_t* survey,
+                         const int* src_xyz, int nsrc, const int* rcv_xyz, int nrcv,
+                         const float* vel_host, float dt2, const float* wavelet,
+                         int nsteps, int batch);
+/** Download the pending (partial) batch and wait for all traces. */
+int stencil_survey_finish(stencil_context_t* ctx);
+/** Detach and release the survey (if any) of the context. */
+void stencil_survey_release(stencil_context_t* ctx);
+
+/**
+ * Attach snapshots to the context: after every "every" steps of stencil_apply_steps,
+ * the wavefield (FP32 storage) is compressed and downloaded, up to nsnaps times.
+ * The snapshots are kept in pinned host memory, or in a file mapped into memory
+ * (path, overwritten). Compression ratio vs. FP32: 2 (BF16), 1 (BF16X2), ~4 (INT8).
+ */
+int stencil_snap_setup(stencil_context_t* ctx, stencil_snap_t* snap, stencil_snap_codec_t codec,
+                       int every, int nsnaps, const char* path);
+/** Wait for the pending downloads. */
+int stencil_snap_finish(stencil_context_t* ctx);
+/** Upload snapshot index asynchronously (no-op if resident), e.g., ahead of the next restore. */
+int stencil_snap_prefetch(stencil_context_t* ctx, int index);
+/** Decompress snapshot index into the wavefield p (context's stream, prefetched if needed). */
+int stencil_snap_restore(stencil_context_t* ctx, int index, void* p);
+/** Detach and release the snapshots (if any) of the context. */
+void stencil_snap_release(stencil_context_t* ctx);
+
+typedef struct {
+  /* time of the measured steps, and per-step halo path (max. over domains) */
+  double t_elapsed, t_halo;
+  int ndomains, ndevices;
+} stencil_domain_stats_t;
+
+/**
+ * Decompose the grid along the slow axis (z) into ndomains slabs of whole planes,
+ * each run by an OpenMP thread bound to device (domain % ndevices), i.e., devices,
+ * sub-devices (LIBXSTREAM_DEVSPLIT), or several domains per device. A domain owns
+ * its planes and carries STENCIL_RADIUS ghost planes per neighbor, which are
+ * exchanged every step through pinned host memory: the boundary slabs are
+ * computed and downloaded on a second stream while the interior is computed on
+ * the context's stream. FP32 direct method and XYZ-layout only. The final
+ * wavefield is gathered into p_result (optional, nx * ny * nz values).
+ */
+int stencil_domain_run(int ndomains, int ndevices, const float* p_host, const float* vel_host,
+                       int nx, int ny, int nz, const double* fd_weights, float dt2, float dh,
+                       int nsteps, int warmup, float* p_result, stencil_domain_stats_t* stats);
 
 #endif /*STENCIL_OPENCL_H*/
@@ -62,7 +62,8 @@
 # endif
 
 
-LIBXSTREAM_APIVAR_DEFINE(char internal_libxstream_opencl_locks[LIBXS_CACHELINE * LIBXSTREAM_NLOCKS]);
+/* lock-domains (LIBXSTREAM_NLOCKS) followed by the lock of the memory accounting */
+LIBXSTREAM_APIVAR_DEFINE(char internal_libxstream_opencl_locks[LIBXS_CACHELINE * (LIBXSTREAM_NLOCKS + 1)]);
 /* global configuration discovered during initialization */
 LIBXSTREAM_APIVAR_PUBLIC_DEF(libxstream_opencl_config_t libxstream_opencl_config);
 /**
@@ -189,14 +190,158 @@ LIBXSTREAM_API_INTERN void libxstream_opencl_configure(void)
 }
 
 
+LIBXSTREAM_API int libxstream_opencl_local_rank(int* nlocal)
+{
+  static const char* const vars[][2] = {
+    {"MPI_LOCALRANKID", "MPI_LOCALNRANKS"}, /* Intel MPI, MPICH (Hydra) */
+    {"OMPI_COMM_WORLD_LOCAL_RANK", "OMPI_COMM_WORLD_LOCAL_SIZE"}, /* Open MPI */
+    {"PALS_LOCAL_RANKID", "PALS_LOCAL_SIZE"}, /* Cray PALS */
+    {"PMI_LOCAL_RANK", "PMI_LOCAL_SIZE"}, /* PMIx, Cray PMI */
+    {"SLURM_LOCALID", "SLURM_TASKS_PER_NODE"} /* srun: "4(x2),3" (first node) */
+  };
+  int result = -1, i = 0;
+  assert(NULL != nlocal);
+  *nlocal = 0;
+  for (; i < (int)(sizeof(vars) / sizeof(*vars)); ++i) {
+    const char* const env_rank = getenv(vars[i][0]);
+    if (NULL != env_rank && '\0' != *env_rank) {
+      const char* const env_size = getenv(vars[i][1]);
+      result = LIBXS_MAX(atoi(env_rank), 0);
+      if (NULL != env_size) *nlocal = LIBXS_MAX(atoi(env_size), result + 1);
+      break;
+    }
+  }
+  return result;
+}
+
+
+LIBXSTREAM_API int libxstream_opencl_cpulist(const char list[], unsigned char bitmap[], int nbits)
+{
+  int result = 0;
+  memset(bitmap, 0, LIBXS_UPDIV(nbits, 8));
+  while (NULL != list && '\0' != *list) {
+    char* end = NULL;
+    long lo = strtol(list, &end, 10), hi = lo;
+    if (end == list) break;
+    if ('-' == *end) {
+      list = end + 1;
+      hi = strtol(list, &end, 10);
+      if (end == list) break;
+    }
+    for (; 0 <= lo && lo <= hi && lo < nbits; ++lo, ++result) {
+      bitmap[lo >> 3] |= (unsigned char)(1U << (lo & 7));
+    }
+    if (',' != *end) break;
+    list = end + 1;
+  }
+  return result;
+}
+
+
+/**
+ * NUMA node holding all CPUs the process is allowed to run on (negative if the
+ * mask spans nodes or the topology is unknown). The offset of the first allowed
+ * CPU among the node's CPUs, the node's number of CPUs, and the number of CPUs
+ * allowed tell where the rank sits within the node.
+ */
+LIBXSTREAM_API_INTERN int libxstream_opencl_affinity_node(int* offset, int* ncpus, int* nallowed);
+LIBXSTREAM_API_INTERN int libxstream_opencl_affinity_node(int* offset, int* ncpus, int* nallowed)
+{
+  int result = -1;
+  assert(NULL != offset && NULL != ncpus && NULL != nallowed);
+  *offset = *ncpus = *nallowed = 0;
+# if defined(__linux__)
+  {
+    unsigned char allowed[512], cpus[sizeof(allowed)]; /* up to 4096 CPUs */
+    const int nbits = (int)(8 * sizeof(allowed));
+    char line[LIBXSTREAM_BUFFERSIZE];
+    FILE* file = fopen("/proc/self/status", "r");
+    int node = 0;
+    if (NULL != file) {
+      while (NULL != fgets(line, sizeof(line), file)) {
+        if (0 == strncmp(line, "Cpus_allowed_list:", 18)) {
+          *nallowed = libxstream_opencl_cpulist(line + 18 + strspn(line + 18, " \t"), allowed, nbits);
+          break;
+        }
+      }
+      fclose(file);
+    }
+    for (; 0 < *nallowed && 0 > result; ++node) {
+      char path[64];
+      LIBXS_SNPRINTF(path, sizeof(path), "/sys/devices/system/node/node%i/cpulist", node);
+      file = fopen(path, "r");
+      if (NULL == file) break;
+      if (NULL != fgets(line, sizeof(line), file)) {
+        const int n = libxstream_opencl_cpulist(line, cpus, nbits);
+        int i = 0, k = 0;
+        for (; i < (int)sizeof(allowed); ++i) {
+          if (0 != (allowed[i] & ~cpus[i])) break; /* allowed CPU not on node */
+        }
+        if ((int)sizeof(allowed) == i && 0 < n) {
+          for (i = 0; i < nbits && 0 == (allowed[i >> 3] & (1U << (i & 7))); ++i) {
+            if (0 != (cpus[i >> 3] & (1U << (i & 7)))) ++k;
+          }
+          *offset = k;
+          *ncpus = n;
+          result = node;
+        }
+      }
+      fclose(file);
+    }
+  }
+# endif
+  return result;
+}
+
+
+/**
+ * Device for the node-local rank: round-robin by rank unless the rank's CPUs
+ * are a part of a NUMA node with devices attached. Such devices are shared by
+ * the ranks on that node according to where the rank's CPUs sit (neighboring
+ * ranks share a device), which holds for block and cyclic placement alike. A
+ * rank bound to the whole node cannot tell its index among the node's ranks
+ * (the local rank counts ranks of all nodes), hence takes the round-robin.
+ */
+LIBXSTREAM_API_INTERN int libxstream_opencl_rank_device(int lrank, int* node);
+LIBXSTREAM_API_INTERN int libxstream_opencl_rank_device(int lrank, int* node)
+{
+  const int ndevices = libxstream_opencl_config.ndevices;
+  int result = lrank % ndevices, offset = 0, ncpus = 0, nallowed = 0;
+  assert(0 <= lrank && 0 < ndevices && NULL != node);
+  *node = libxstream_opencl_affinity_node(&offset, &ncpus, &nallowed);
+  if (0 <= *node) {
+    int candidates[LIBXSTREAM_MAXNDEVS], ncandidates = 0, i = 0;
+    for (; i < ndevices; ++i) {
+      int devnode = -1;
+      if (EXIT_SUCCESS == libxstream_opencl_device_numa(libxstream_opencl_config.devices[i], &devnode) && devnode == *node) {
+        candidates[ncandidates] = i;
+        ++ncandidates;
+      }
+    }
+    if (0 < ncandidates && nallowed < ncpus) { /* part of the node: by position among its CPUs */
+      result = candidates[offset * ncandidates / ncpus];
+    }
+  }
+  return result;
+}
+
+
 /** Setup to run prior to touching OpenCL runtime. */
 LIBXSTREAM_API_INTERN void libxstream_opencl_setup(void);
 LIBXSTREAM_API_INTERN void libxstream_opencl_setup(void)
 {
   const char *const env_devsplit = getenv("LIBXSTREAM_DEVSPLIT"), *const env_nlocks = getenv("LIBXSTREAM_NLOCKS");
+  const char* const env_rankmap = getenv("LIBXSTREAM_RANKMAP");
   const char* const env_dump_acc = getenv("LIBXSTREAM_DUMP");
   const char *const env_debug = getenv("LIBXSTREAM_DEBUG"), *const env_profile = getenv("LIBXSTREAM_PROFILE");
   const char* const env_profile_mem = getenv("LIBXSTREAM_PROFILE_MEM");
+  const char* const env_graph = getenv("LIBXSTREAM_GRAPH");
+  const char* const env_elide = getenv("LIBXSTREAM_ELIDE");
+  const char* const env_hostfn = getenv("LIBXSTREAM_HOSTFN");
+  const char* const env_numa = getenv("LIBXSTREAM_NUMA");
+  const char* const env_batch = getenv("LIBXSTREAM_BATCH");
+  const char* const env_memtag = getenv("LIBXSTREAM_MEMTAG");
+  const char* const env_membudget = getenv("LIBXSTREAM_MEMBUDGET");
   const char* const env_dump = (NULL != env_dump_acc ? env_dump_acc : getenv("IGC_ShaderDumpEnable"));
   const char *const env_neo = getenv("NEOReadDebugKeys"), *const env_wa = getenv("LIBXSTREAM_WA");
   static char neo_enable_debug_keys[] = "NEOReadDebugKeys=1";
@@ -244,7 +389,7 @@ LIBXSTREAM_API_INTERN void libxstream_opencl_setup(void)
   assert(NULL == libxstream_opencl_config.lock_main); /* test condition to avoid initializing multiple times */
   libxs_init(); /* before using LIBXSMM's functionality */
   assert(sizeof(libxs_lock_t) <= LIBXS_CACHELINE);
-  for (i = 0; i < LIBXSTREAM_NLOCKS; ++i) {
+  for (i = 0; i < (LIBXSTREAM_NLOCKS + 1); ++i) {
     LIBXS_LOCK_ATTR_TYPE(LIBXS_LOCK) acc_opencl_attr_;
     LIBXS_LOCK_ATTR_INIT(LIBXS_LOCK, &acc_opencl_attr_);
     LIBXS_LOCK_INIT(LIBXS_LOCK, (libxs_lock_t*)(internal_libxstream_opencl_locks + LIBXS_CACHELINE * i), &acc_opencl_attr_);
@@ -260,13 +405,27 @@ LIBXSTREAM_API_INTERN void libxstream_opencl_setup(void)
   libxstream_opencl_config.lock_event = /* 4th lock-domain */
     (3 < LIBXS_MIN(nlocks, LIBXSTREAM_NLOCKS) ? ((libxs_lock_t*)(internal_libxstream_opencl_locks + LIBXS_CACHELINE * 3))
                                               : libxstream_opencl_config.lock_main);
+  /* never shared with a domain: accounting runs per allocation, pooled or not */
+  libxstream_opencl_config.lock_memtag = (libxs_lock_t*)(internal_libxstream_opencl_locks + LIBXS_CACHELINE * LIBXSTREAM_NLOCKS);
   libxstream_opencl_configure(); /* verbosity is used below */
   libxstream_opencl_config.devsplit = (NULL == env_devsplit ? (/*1 < libxs_nranks() ? -1 :*/ 0) : atoi(env_devsplit));
+  libxstream_opencl_config.rankmap = (NULL == env_rankmap ? /*default*/ 3 : atoi(env_rankmap));
+  if (NULL != env_devsplit) libxstream_opencl_config.rankmap &= ~2; /* explicit split wins */
+  libxstream_opencl_config.lrank = (0 != libxstream_opencl_config.rankmap
+    ? libxstream_opencl_local_rank(&libxstream_opencl_config.nlocal) : -1);
 # if defined(LIBXSTREAM_STREAM_PRIORITIES)
   libxstream_opencl_config.priority = (NULL == env_priority ? /*default*/ 3 : atoi(env_priority));
 # endif
   libxstream_opencl_config.profile = (NULL == env_profile ? /*default*/ 0 : atoi(env_profile));
   libxstream_opencl_config.profile_mem = (NULL == env_profile_mem ? /*default*/ 0 : atoi(env_profile_mem));
+  libxstream_opencl_config.graph = (NULL == env_graph ? /*default*/ 1 : atoi(env_graph));
+  libxstream_opencl_config.elide = (NULL == env_elide ? /*default*/ 1 : atoi(env_elide));
+  libxstream_opencl_config.nhostfn = (NULL == env_hostfn ? /*default*/ 2 : atoi(env_hostfn));
+  libxstream_opencl_config.numa = (NULL == env_numa ? /*default*/ 1 : atoi(env_numa));
+  libxstream_opencl_config.batch = (NULL == env_batch ? /*measure*/ -1 : LIBXS_MAX(atoi(env_batch), 0));
+  libxstream_opencl_config.memtag = (NULL == env_memtag ? /*default*/ 1 : atoi(env_memtag));
+  libxstream_opencl_config.mem_budget = (NULL == env_membudget ? 0 : ((size_t)LIBXS_MAX(atoi(env_membudget), 0) << 20));
+  if (0 != libxstream_opencl_config.mem_budget) libxstream_opencl_config.memtag = 1; /* budget relies on accounting */
   libxstream_opencl_config.xhints = (NULL == env_xhints ? xhints_default : atoi(env_xhints));
   libxstream_opencl_config.async = (NULL == env_async ? async_default : atoi(env_async));
   libxstream_opencl_config.dump = (NULL == env_dump ? /*default*/ 0 : atoi(env_dump));
@@ -511,6 +670,12 @@ LIBXSTREAM_API int libxstream_init(void)
               cl_device_partition_property properties[] = {
                 CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN, CL_DEVICE_AFFINITY_DOMAIN_NUMA, /*terminator*/ 0};
               cl_uint nunits = 0, n = 0;
+              cl_device_type devtype = 0;
+              /* ranks outnumber devices: split GPU by affinity domain (e.g., tiles) */
+              const int autosplit = (0 != (2 & libxstream_opencl_config.rankmap) &&
+                                     ndevices < (cl_uint)libxstream_opencl_config.nlocal &&
+                                     EXIT_SUCCESS == clGetDeviceInfo(devices[j], CL_DEVICE_TYPE, sizeof(devtype), &devtype, NULL) &&
+                                     0 != (CL_DEVICE_TYPE_GPU & devtype));
               if ((1 < libxstream_opencl_config.devsplit || 0 > libxstream_opencl_config.devsplit) &&
                   /* Intel CPU (e.g., out of two sockets) yields thread-count of both sockets */
                   EXIT_SUCCESS == clGetDeviceInfo(devices[j], CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &nunits, NULL) &&
@@ -521,7 +686,7 @@ LIBXSTREAM_API int libxstream_init(void)
                 properties[0] = CL_DEVICE_PARTITION_EQUALLY;
                 properties[1] = LIBXS_UPDIV(nunits, n);
               }
-              if (0 == libxstream_opencl_config.devsplit || 1 == libxstream_opencl_config.devsplit ||
+              if ((0 == autosplit && (0 == libxstream_opencl_config.devsplit || 1 == libxstream_opencl_config.devsplit)) ||
                   (libxstream_opencl_config.ndevices + 1) == LIBXSTREAM_MAXNDEVS ||
                   EXIT_SUCCESS != clCreateSubDevices(devices[j], properties, 0, NULL, &n))
 # endif
@@ -716,11 +881,11 @@ LIBXSTREAM_API int libxstream_init(void)
         }
         /* allocate and initialize events registry */
         libxstream_opencl_config.nevents = nhandles;
-        libxstream_opencl_config.events = (cl_event**)malloc(sizeof(cl_event*) * nhandles);
-        libxstream_opencl_config.event_data = (cl_event*)malloc(sizeof(cl_event) * nhandles);
+        libxstream_opencl_config.events = (libxstream_event_t**)malloc(sizeof(libxstream_event_t*) * nhandles);
+        libxstream_opencl_config.event_data = (libxstream_event_t*)malloc(sizeof(libxstream_event_t) * nhandles);
         if (NULL != libxstream_opencl_config.events && NULL != libxstream_opencl_config.event_data) {
-          libxs_pmalloc_init(sizeof(cl_event*), &libxstream_opencl_config.nevents, (void**)libxstream_opencl_config.events,
-            libxstream_opencl_config.event_data);
+          libxs_pmalloc_init(sizeof(libxstream_event_t), &libxstream_opencl_config.nevents,
+            (void**)libxstream_opencl_config.events, libxstream_opencl_config.event_data);
         }
         else {
           free(libxstream_opencl_config.events);
@@ -730,6 +895,23 @@ LIBXSTREAM_API int libxstream_init(void)
           libxstream_opencl_config.nevents = 0;
           result = EXIT_FAILURE;
         }
+        /* per-thread event-handle caches; optional (the shared pool remains) */
+        libxstream_opencl_config.event_cache = (libxstream_opencl_event_cache_t*)calloc(
+          libxstream_opencl_config.nthreads, sizeof(libxstream_opencl_event_cache_t));
+        /* per-thread default streams and stream lists; optional (the registry scan remains) */
+        libxstream_opencl_config.stream_cache = (libxstream_opencl_stream_cache_t*)calloc(
+          libxstream_opencl_config.nthreads, sizeof(libxstream_opencl_stream_cache_t));
+        /* per-thread device binding (libxstream_device_bind); optional like the profile records */
+        libxstream_opencl_config.bound = (libxstream_opencl_device_t**)calloc(
+          libxstream_opencl_config.nthreads, sizeof(libxstream_opencl_device_t*));
+        libxstream_opencl_config.nbound = 0;
+        /* per-thread memory tags; optional (allocations are accounted as untagged) */
+        if (0 != libxstream_opencl_config.memtag) {
+          libxstream_opencl_config.tag_stack = (libxstream_opencl_tag_stack_t*)calloc(
+            libxstream_opencl_config.nthreads, sizeof(libxstream_opencl_tag_stack_t));
+        }
+        LIBXS_SNPRINTF(libxstream_opencl_config.tags[0].name, LIBXSTREAM_MAXSTRLEN, "untagged");
+        libxstream_opencl_config.ntags = 1;
         /* allocate and initialize per-launch profile records (only if profiling) */
         if (EXIT_SUCCESS == result && 0 != libxstream_opencl_config.profile) {
           libxstream_opencl_config.nlaunch_infos = nhandles;
@@ -755,7 +937,47 @@ LIBXSTREAM_API int libxstream_init(void)
             (libxs_malloc_xfn)libxstream_mem_hst_xmalloc,
             (libxs_free_xfn)libxstream_mem_hst_xfree, libxstream_opencl_config.nthreads);
           if (NULL == libxstream_opencl_config.pool_hst) result = EXIT_FAILURE;
+          libxstream_opencl_config.pool_hst_node[0] = libxstream_opencl_config.pool_hst;
+          libxstream_opencl_config.nnodes = 1;
+        }
+# if defined(__linux__)
+        /**
+         * Per-node pools are only worth their footprint with several nodes: each
+         * pool keeps its own free blocks, and a block never changes its node.
+         */
+        if (EXIT_SUCCESS == result && 0 != libxstream_opencl_config.numa) {
+          /* online nodes may be sparse (e.g., "0,2-3"), i.e., pools are indexed by node ID */
+          unsigned char online[LIBXS_UPDIV(LIBXSTREAM_MAXNNODES, 8)] = {0};
+          FILE* const file = fopen("/sys/devices/system/node/online", "r");
+          int nnodes = 0;
+          if (NULL != file) {
+            char line[LIBXSTREAM_BUFFERSIZE];
+            if (NULL != fgets(line, sizeof(line), file) &&
+                1 < libxstream_opencl_cpulist(line, online, LIBXSTREAM_MAXNNODES))
+            {
+              int node = 0;
+              for (; node < LIBXSTREAM_MAXNNODES; ++node) {
+                if (0 != (online[node >> 3] & (1U << (node & 7)))) nnodes = node + 1;
+              }
+            }
+            fclose(file);
+          }
+          if (1 < nnodes) {
+            int node = 0;
+            for (; node < nnodes; ++node) {
+              libxstream_opencl_config.pool_hst_nodeid[node] = node;
+              if (0 != node) {
+                if (0 == (online[node >> 3] & (1U << (node & 7)))) continue; /* offline: no pool */
+                libxstream_opencl_config.pool_hst_node[node] = libxs_malloc_xpool((libxs_malloc_xfn)libxstream_mem_hst_xmalloc,
+                  (libxs_free_xfn)libxstream_mem_hst_xfree, libxstream_opencl_config.nthreads);
+                if (NULL == libxstream_opencl_config.pool_hst_node[node]) break; /* fewer pools rather than failing */
+              }
+              libxs_malloc_arg(libxstream_opencl_config.pool_hst_node[node], libxstream_opencl_config.pool_hst_nodeid + node);
+            }
+            libxstream_opencl_config.nnodes = node;
+          }
         }
+# endif
         if (0 != libxstream_opencl_config.profile_mem) {
           const int profile = LIBXS_MAX(LIBXS_ABS(libxstream_opencl_config.profile_mem), 2);
           /**
@@ -777,15 +999,19 @@ LIBXSTREAM_API int libxstream_init(void)
           libxstream_opencl_config.hist_d2h = libxs_hist_create(profile + 1, 3, update);
           libxstream_opencl_config.hist_d2d = libxs_hist_create(profile + 1, 3, update);
           libxstream_opencl_config.hist_zero = libxs_hist_create(profile + 1, 3, update);
+          libxstream_opencl_config.hist_p2p = libxs_hist_create(profile + 1, 3, update);
         }
         else {
           assert(NULL == libxstream_opencl_config.hist_h2d);
           assert(NULL == libxstream_opencl_config.hist_d2h);
           assert(NULL == libxstream_opencl_config.hist_d2d);
           assert(NULL == libxstream_opencl_config.hist_zero);
+          assert(NULL == libxstream_opencl_config.hist_p2p);
         }
         if (EXIT_SUCCESS == result) { /* lastly, print list of devices and actived device */
-          const unsigned int nrank = libxs_nrank();
+          const char* const env_rank = getenv("PMI_RANK"); /* global rank (not a local one) */
+          const unsigned int nrank = ((0 != libxs_nrank() || NULL == env_rank) ? libxs_nrank()
+                                                                              : (unsigned int)LIBXS_MAX(atoi(env_rank), 0));
 # if defined(LIBXSTREAM_ACTIVATE) && (0 <= LIBXSTREAM_ACTIVATE)
           if (LIBXSTREAM_ACTIVATE < libxstream_opencl_config.ndevices) {
             result = libxstream_opencl_set_active_device(NULL /*lock*/, LIBXSTREAM_ACTIVATE);
@@ -793,7 +1019,23 @@ LIBXSTREAM_API int libxstream_init(void)
           else
 # endif
           { /* auto-select initial device */
-            if (0 < nrank && 1 < libxstream_opencl_config.ndevices) {
+            if (0 != (1 & libxstream_opencl_config.rankmap) && 0 <= libxstream_opencl_config.lrank && 0 > cfg_device &&
+                1 < libxstream_opencl_config.ndevices)
+            {
+              int node = -1;
+              device_id = libxstream_opencl_rank_device(libxstream_opencl_config.lrank, &node);
+              if (2 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity) {
+                fprintf(stderr, "INFO ACC/OpenCL: RANK %i of %i (numa=%i) -> DEVICE %i\n", libxstream_opencl_config.lrank,
+                  libxstream_opencl_config.nlocal, node, device_id);
+              }
+              if (0 != libxstream_opencl_config.verbosity && 0 == libxstream_opencl_config.lrank &&
+                  libxstream_opencl_config.ndevices < libxstream_opencl_config.nlocal)
+              {
+                fprintf(stderr, "WARN ACC/OpenCL: %i ranks share %i devices per node\n", libxstream_opencl_config.nlocal,
+                  libxstream_opencl_config.ndevices);
+              }
+            }
+            else if (0 < nrank && 1 < libxstream_opencl_config.ndevices) {
               device_id = nrank % libxstream_opencl_config.ndevices;
             }
             result = libxstream_opencl_set_active_device(NULL /*lock*/, device_id);
@@ -943,7 +1185,7 @@ LIBXSTREAM_API_INTERN int libxstream_opencl_print_hist(
 LIBXSTREAM_API_INTERN int libxstream_opencl_print_transfers(FILE* ostream, const libxs_hist_t* hist[], int nhist);
 LIBXSTREAM_API_INTERN int libxstream_opencl_print_transfers(FILE* ostream, const libxs_hist_t* hist[], int nhist)
 {
-  const char *const kind[] = { "H2D", "D2H", "D2D", "ZERO" };
+  const char *const kind[] = { "H2D", "D2H", "D2D", "ZERO", "P2P" };
   int nrows = 0, i;
   assert(nhist <= (int)(sizeof(kind) / sizeof(*kind)));
   for (i = 0; i < nhist; ++i) {
@@ -1015,12 +1257,47 @@ LIBXSTREAM_API_INTERN int libxstream_opencl_print_floor(FILE* ostream)
 }
 
 
+/**
+ * Release the devices bound by threads (libxstream_device_bind). A pool is
+ * drained while its devinfo is bound to the calling thread, because the pool's
+ * free-function resolves the device like any other caller does.
+ */
+LIBXSTREAM_API_INTERN void libxstream_opencl_device_release(void);
+LIBXSTREAM_API_INTERN void libxstream_opencl_device_release(void)
+{
+  const int tid = libxs_tid();
+  int i = 0;
+  for (; i < LIBXSTREAM_MAXNDEVS; ++i) {
+    libxstream_opencl_device_t* const devinfo = libxstream_opencl_config.devinfos[i];
+    if (NULL != devinfo) {
+      if (NULL != devinfo->pool_dev && NULL != libxstream_opencl_config.bound && 0 <= tid &&
+          tid < libxstream_opencl_config.nthreads)
+      {
+        libxstream_opencl_config.bound[tid] = devinfo;
+        libxstream_opencl_config.nbound = 1;
+        libxs_free_pool(devinfo->pool_dev);
+      }
+      if (NULL != devinfo->stream.queue) clReleaseCommandQueue(devinfo->stream.queue); /* ignore return code */
+      if (NULL != devinfo->memptr_kernel) clReleaseKernel(devinfo->memptr_kernel); /* ignore return code */
+      libxstream_mem_pack_release(devinfo);
+      if (NULL != devinfo->context) clReleaseContext(devinfo->context); /* ignore return code */
+      libxstream_opencl_config.devinfos[i] = NULL;
+      free(devinfo);
+    }
+  }
+  if (NULL != libxstream_opencl_config.bound) {
+    memset(libxstream_opencl_config.bound, 0, sizeof(libxstream_opencl_device_t*) * libxstream_opencl_config.nthreads);
+  }
+  libxstream_opencl_config.nbound = 0;
+}
+
+
 /* attempt to automatically finalize backend */
 LIBXSTREAM_API_INTERN LIBXS_ATTRIBUTE_DTOR void libxstream_opencl_finalize(void)
 {
   assert(libxstream_opencl_config.ndevices < LIBXSTREAM_MAXNDEVS);
   if (0 != libxstream_opencl_config.ndevices) {
-    const libxs_hist_t* hist[] = { NULL, NULL, NULL, NULL };
+    const libxs_hist_t* hist[] = { NULL, NULL, NULL, NULL, NULL };
     const int nhist = (int)(sizeof(hist) / sizeof(*hist));
     /**
      * A completion callback can still be delivered while this runs: completion of
@@ -1032,10 +1309,12 @@ LIBXSTREAM_API_INTERN LIBXS_ATTRIBUTE_DTOR void libxstream_opencl_finalize(void)
      */
     const int keep = (0 != libxstream_opencl_config.profile || 0 != libxstream_opencl_config.profile_mem);
     int i;
+    libxstream_hostfn_finalize(); /* host functions may still use any resource */
     hist[0] = libxstream_opencl_config.hist_h2d;
     hist[1] = libxstream_opencl_config.hist_d2h;
     hist[2] = libxstream_opencl_config.hist_d2d;
     hist[3] = libxstream_opencl_config.hist_zero;
+    hist[4] = libxstream_opencl_config.hist_p2p;
     /**
      * Print only what was requested: kernel rows for LIBXSTREAM_PROFILE and
      * transfer rows for LIBXSTREAM_PROFILE_MEM. The two mix only when both are
@@ -1061,6 +1340,56 @@ LIBXSTREAM_API_INTERN LIBXS_ATTRIBUTE_DTOR void libxstream_opencl_finalize(void)
       fprintf(stderr, "INFO ACC/OpenCL: %lu of %lu host allocations registered with the CUDA runtime\n",
         (unsigned long)libxstream_opencl_config.nhostreg_ok, (unsigned long)libxstream_opencl_config.nhostreg);
     }
+    /**
+     * Per node, the bytes obtained from the runtime (xmalloc) and the pool's
+     * own view: an unbalanced placement is a process whose threads were not
+     * spread as intended, or whose device policy ignored a remote node.
+     */
+    if (1 < libxstream_opencl_config.nnodes &&
+        (2 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity))
+    {
+      for (i = 0; i < libxstream_opencl_config.nnodes; ++i) {
+        libxs_malloc_pool_info_t info;
+        if (NULL != libxstream_opencl_config.pool_hst_node[i] &&
+            EXIT_SUCCESS == libxs_malloc_pool_info(libxstream_opencl_config.pool_hst_node[i], &info)) {
+          fprintf(stderr, "INFO ACC/OpenCL: host pool node%i obtained %i MB (peak %i MB, %i MB held, %lu allocations)\n", i,
+            (int)LIBXS_UPDIV(libxstream_opencl_config.pool_hst_nbytes[i], (size_t)1 << 20),
+            (int)LIBXS_UPDIV(info.peak, (size_t)1 << 20), (int)LIBXS_UPDIV(info.size, (size_t)1 << 20),
+            (unsigned long)info.nmallocs);
+        }
+      }
+    }
+    /**
+     * Per tag, what is still allocated (a leak unless the application frees at
+     * exit) and the high-water mark, i.e., what to look at after running out
+     * of device memory. Untagged memory is listed only if anything was tagged.
+     */
+    if (0 != libxstream_opencl_config.memtag &&
+        (2 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity))
+    {
+      for (i = (1 < libxstream_opencl_config.ntags ? 0 : 1); i < libxstream_opencl_config.ntags; ++i) {
+        const libxstream_opencl_tag_t* const tag = libxstream_opencl_config.tags + i;
+        if (0 != tag->nallocs) {
+          fprintf(stderr, "INFO ACC/OpenCL: memory tag \"%s\" peak %i MB (%i MB live, %lu allocations)\n",
+            tag->name, (int)LIBXS_UPDIV(tag->peak, (size_t)1 << 20),
+            (int)LIBXS_UPDIV(tag->live, (size_t)1 << 20), (unsigned long)tag->nallocs);
+        }
+      }
+    }
+    if ((0 != libxstream_opencl_config.nreclaim_calls || 0 != libxstream_opencl_config.nbudget_denied) &&
+        (2 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity))
+    {
+      fprintf(stderr, "INFO ACC/OpenCL: memory pressure asked reclaimers %lu times (%i MB released), %lu allocations denied\n",
+        (unsigned long)libxstream_opencl_config.nreclaim_calls,
+        (int)LIBXS_UPDIV(libxstream_opencl_config.nreclaim_bytes, (size_t)1 << 20),
+        (unsigned long)libxstream_opencl_config.nbudget_denied);
+    }
+    if ((0 != libxstream_opencl_config.nmarker_elided || 0 != libxstream_opencl_config.nwait_elided) &&
+        (2 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity))
+    {
+      fprintf(stderr, "INFO ACC/OpenCL: %lu event markers and %lu device-side waits elided\n",
+        (unsigned long)libxstream_opencl_config.nmarker_elided, (unsigned long)libxstream_opencl_config.nwait_elided);
+    }
     if (0 == keep) {
       for (i = 0; i < LIBXSTREAM_MAXNDEVS; ++i) {
         const cl_device_id device_id = libxstream_opencl_config.devices[i];
@@ -1075,6 +1404,7 @@ LIBXSTREAM_API_INTERN LIBXS_ATTRIBUTE_DTOR void libxstream_opencl_finalize(void)
       libxs_hist_destroy(libxstream_opencl_config.hist_d2h);
       libxs_hist_destroy(libxstream_opencl_config.hist_d2d);
       libxs_hist_destroy(libxstream_opencl_config.hist_zero);
+      libxs_hist_destroy(libxstream_opencl_config.hist_p2p);
       for (i = 0; i < LIBXS_CAST_INT(libxstream_opencl_config.nkernels); ++i) {
         void* name;
         libxs_hist_destroy(libxstream_opencl_config.hist_kernel[i]);
@@ -1088,7 +1418,14 @@ LIBXSTREAM_API_INTERN LIBXS_ATTRIBUTE_DTOR void libxstream_opencl_finalize(void)
       libxstream_opencl_config.launch_info_data = NULL;
       libxstream_opencl_config.launch_infos = NULL;
       libxstream_opencl_config.nlaunch_infos = 0;
+      libxstream_opencl_device_release();
       libxs_free_pool(libxstream_opencl_config.pool_dev);
+      for (i = 1; i < libxstream_opencl_config.nnodes; ++i) {
+        if (NULL != libxstream_opencl_config.pool_hst_node[i]) libxs_free_pool(libxstream_opencl_config.pool_hst_node[i]);
+      }
+      memset(libxstream_opencl_config.pool_hst_nbytes, 0, sizeof(libxstream_opencl_config.pool_hst_nbytes));
+      memset(libxstream_opencl_config.pool_hst_node, 0, sizeof(libxstream_opencl_config.pool_hst_node));
+      libxstream_opencl_config.nnodes = 0;
       libxs_free_pool(libxstream_opencl_config.pool_hst);
       if (NULL != libxstream_opencl_config.pool_hst_queue) {
         clReleaseCommandQueue(libxstream_opencl_config.pool_hst_queue); /* ignore return code */
@@ -1104,12 +1441,13 @@ LIBXSTREAM_API_INTERN LIBXS_ATTRIBUTE_DTOR void libxstream_opencl_finalize(void)
         libxstream_opencl_config.device.memptr_kernel = NULL;
         libxstream_opencl_config.device.memptr_context = NULL;
       }
+      libxstream_mem_pack_release(&libxstream_opencl_config.device);
       if (NULL != libxstream_opencl_config.device.context) {
         const cl_context context = libxstream_opencl_config.device.context;
         libxstream_opencl_config.device.context = NULL;
         clReleaseContext(context); /* ignore return code */
       }
-      for (i = 0; i < LIBXSTREAM_NLOCKS; ++i) { /* destroy locks */
+      for (i = 0; i < (LIBXSTREAM_NLOCKS + 1); ++i) { /* destroy locks */
         LIBXS_LOCK_DESTROY(LIBXS_LOCK, (libxs_lock_t*)(internal_libxstream_opencl_locks + LIBXS_CACHELINE * i));
       }
       /**
@@ -1123,6 +1461,11 @@ LIBXSTREAM_API_INTERN LIBXS_ATTRIBUTE_DTOR void libxstream_opencl_finalize(void)
       free(libxstream_opencl_config.stream_data);
       free(libxstream_opencl_config.events);
       free(libxstream_opencl_config.event_data);
+      free(libxstream_opencl_config.event_cache);
+      free(libxstream_opencl_config.stream_cache);
+      free(libxstream_opencl_config.bound);
+      free(libxstream_opencl_config.tag_stack);
+      free(libxstream_opencl_config.tag_ptrs);
       /* clear entire configuration structure */
       memset(&libxstream_opencl_config, 0, sizeof(libxstream_opencl_config));
     }
@@ -1244,6 +1587,55 @@ LIBXSTREAM_API int libxstream_opencl_device_vendor(cl_device_id device, const ch
 }
 
 
+LIBXSTREAM_API int libxstream_opencl_device_numa(cl_device_id device, int* node)
+{
+  int result = EXIT_FAILURE;
+  if (NULL != node) {
+    *node = -1;
+# if defined(__linux__)
+    if (NULL != device) {
+      struct { cl_uint domain, bus, device, function; } pci;
+      if (EXIT_SUCCESS == clGetDeviceInfo(device, 0x410F /*CL_DEVICE_PCI_BUS_INFO_KHR*/, sizeof(pci), &pci, NULL) ||
+          EXIT_SUCCESS == clGetDeviceInfo(device, 0x420F /*CL_DEVICE_PCI_BUS_INFO_INTEL*/, sizeof(pci), &pci, NULL))
+      {
+        result = EXIT_SUCCESS;
+      }
+      else { /* slot encodes device and function (device << 3 | function) */
+        cl_uint domain = 0, bus = 0, slot = 0;
+        if (EXIT_SUCCESS == clGetDeviceInfo(device, 0x4008 /*CL_DEVICE_PCI_BUS_ID_NV*/, sizeof(cl_uint), &bus, NULL) &&
+            EXIT_SUCCESS == clGetDeviceInfo(device, 0x4009 /*CL_DEVICE_PCI_SLOT_ID_NV*/, sizeof(cl_uint), &slot, NULL))
+        {
+          if (EXIT_SUCCESS != clGetDeviceInfo(device, 0x400A /*CL_DEVICE_PCI_DOMAIN_ID_NV*/, sizeof(cl_uint), &domain, NULL)) {
+            domain = 0;
+          }
+          pci.domain = domain;
+          pci.bus = bus;
+          pci.device = slot >> 3;
+          pci.function = slot & 7;
+          result = EXIT_SUCCESS;
+        }
+      }
+      if (EXIT_SUCCESS == result) {
+        char path[64];
+        FILE* file;
+        LIBXS_SNPRINTF(path, sizeof(path), "/sys/bus/pci/devices/%04x:%02x:%02x.%x/numa_node", pci.domain, pci.bus,
+          pci.device, pci.function);
+        file = fopen(path, "r");
+        if (NULL != file) {
+          if (1 != fscanf(file, "%i", node)) *node = -1;
+          fclose(file);
+        }
+        if (0 > *node) result = EXIT_FAILURE; /* single node reports -1 */
+      }
+    }
+# else
+    LIBXS_UNUSED(device);
+# endif
+  }
+  return result;
+}
+
+
 LIBXSTREAM_API int libxstream_opencl_device_uid(cl_device_id device, const char devname[], unsigned int* uid)
 {
   int result;
@@ -1514,10 +1906,10 @@ LIBXSTREAM_API int libxstream_opencl_create_context(cl_device_id active_id, cl_c
 }
 
 
-LIBXSTREAM_API int libxstream_opencl_set_active_device(libxs_lock_t* lock, int device_id)
+LIBXSTREAM_API int libxstream_opencl_device_activate(libxs_lock_t* lock, libxstream_opencl_device_t* devinfo, int device_id)
 {
-  libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
   int result = EXIT_SUCCESS;
+  assert(NULL != devinfo);
   assert(libxstream_opencl_config.ndevices < LIBXSTREAM_MAXNDEVS);
   if (0 <= device_id && device_id < libxstream_opencl_config.ndevices) {
     /* accessing devices is thread-safe (array is fixed after initialization) */
@@ -1527,8 +1919,8 @@ LIBXSTREAM_API int libxstream_opencl_set_active_device(libxs_lock_t* lock, int d
       if (NULL != lock) LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, lock);
       context = devinfo->context;
       if (NULL != context) {
-        if (device_id != libxstream_opencl_config.device_id) {
-          const cl_device_id context_id = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
+        if (device_id != devinfo->device_id) {
+          const cl_device_id context_id = libxstream_opencl_config.devices[devinfo->device_id];
           assert(NULL != context_id);
 # if defined(CL_VERSION_1_2)
           LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseDevice(context_id));
@@ -1538,17 +1930,18 @@ LIBXSTREAM_API int libxstream_opencl_set_active_device(libxs_lock_t* lock, int d
             devinfo->memptr_kernel = NULL;
             devinfo->memptr_context = NULL;
           }
+          libxstream_mem_pack_release(devinfo);
           result = clReleaseContext(context);
           if (EXIT_SUCCESS == result) devinfo->context = NULL;
           context = NULL;
         }
       }
-      if (EXIT_SUCCESS == result && (NULL == devinfo->context || device_id != libxstream_opencl_config.device_id)) {
+      if (EXIT_SUCCESS == result && (NULL == devinfo->context || device_id != devinfo->device_id)) {
         result = libxstream_opencl_create_context(active_id, &context);
         assert(NULL != context || EXIT_SUCCESS != result);
       }
       /* update/cache device-specific information */
-      if (EXIT_SUCCESS == result && (NULL == devinfo->context || device_id != libxstream_opencl_config.device_id)) {
+      if (EXIT_SUCCESS == result && (NULL == devinfo->context || device_id != devinfo->device_id)) {
         if (NULL != devinfo->stream.queue) { /* release private stream */
           LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseCommandQueue(devinfo->stream.queue));
         }
@@ -1594,6 +1987,10 @@ LIBXSTREAM_API int libxstream_opencl_set_active_device(libxs_lock_t* lock, int d
           { const char* const env_nv = getenv("LIBXSTREAM_NV");
             if (NULL != env_nv) devinfo->nv = atoi(env_nv);
           }
+          { int numa = -1; /* unknown node is not an error */
+            LIBXS_ELIDE_RESULT(int, libxstream_opencl_device_numa(active_id, &numa));
+            devinfo->numa = numa;
+          }
           if (EXIT_SUCCESS != libxstream_opencl_device_name(active_id, devname, LIBXSTREAM_BUFFERSIZE, NULL /*platform*/,
                                 0 /*platform_maxlen*/, /*cleanup*/ 1) ||
               EXIT_SUCCESS != libxstream_opencl_device_uid(active_id, devname, &devinfo->uid))
@@ -1746,6 +2143,11 @@ LIBXSTREAM_API int libxstream_opencl_set_active_device(libxs_lock_t* lock, int d
                   LIBXS_ASSIGN(&devinfo->clSharedMemAllocINTEL, ptr + 4);
                   LIBXS_ASSIGN(&devinfo->clHostMemAllocINTEL, ptr + 5);
                   LIBXS_ASSIGN(&devinfo->clMemFreeINTEL, ptr + 6);
+                  /* optional: migration is a hint, hence missing functions are not inconsistent */
+                  ptr[7] = clGetExtensionFunctionAddressForPlatform(platform, "clEnqueueMigrateMemINTEL");
+                  LIBXS_ASSIGN(&devinfo->clEnqueueMigrateMemINTEL, ptr + 7);
+                  ptr[7] = clGetExtensionFunctionAddressForPlatform(platform, "clGetMemAllocInfoINTEL");
+                  LIBXS_ASSIGN(&devinfo->clGetMemAllocInfoINTEL, ptr + 7);
                 }
                 else if (0 != n) {
                   fprintf(stderr, "WARN ACC/OpenCL: inconsistent state discovered!\n");
@@ -1813,11 +2215,13 @@ LIBXSTREAM_API int libxstream_opencl_set_active_device(libxs_lock_t* lock, int d
           properties[1] = 0;
           if (EXIT_SUCCESS == result) {
             devinfo->stream.queue = LIBXSTREAM_CREATE_COMMAND_QUEUE(context, active_id, properties, &result);
+            devinfo->stream.devinfo = devinfo;
           }
         }
         if (EXIT_SUCCESS == result) {
-          if (NULL == devinfo->context || device_id != libxstream_opencl_config.device_id) {
-            libxstream_opencl_config.device_id = device_id;
+          if (NULL == devinfo->context || device_id != devinfo->device_id) {
+            if (&libxstream_opencl_config.device == devinfo) libxstream_opencl_config.device_id = device_id;
+            devinfo->device_id = device_id;
             devinfo->context = context;
           }
         }
@@ -1833,6 +2237,12 @@ LIBXSTREAM_API int libxstream_opencl_set_active_device(libxs_lock_t* lock, int d
 }
 
 
+LIBXSTREAM_API int libxstream_opencl_set_active_device(libxs_lock_t* lock, int device_id)
+{
+  return libxstream_opencl_device_activate(lock, &libxstream_opencl_config.device, device_id);
+}
+
+
 LIBXSTREAM_API int libxstream_device_set_active(int device_id)
 {
   int result = EXIT_SUCCESS;
@@ -1860,6 +2270,135 @@ LIBXSTREAM_API int libxstream_device_set_active(int device_id)
 }
 
 
+LIBXSTREAM_API libxstream_opencl_device_t* libxstream_opencl_device_thread(int thread_id)
+{
+  libxstream_opencl_device_t* result = &libxstream_opencl_config.device;
+  if (0 != libxstream_opencl_config.nbound && 0 <= thread_id && thread_id < libxstream_opencl_config.nthreads) {
+    libxstream_opencl_device_t* const bound = libxstream_opencl_config.bound[thread_id];
+    if (NULL != bound) result = bound;
+  }
+  return result;
+}
+
+
+LIBXSTREAM_API libxstream_opencl_device_t* libxstream_opencl_device(void)
+{
+  return (0 == libxstream_opencl_config.nbound ? &libxstream_opencl_config.device
+                                               : libxstream_opencl_device_thread(libxs_tid()));
+}
+
+
+LIBXSTREAM_API libxstream_opencl_device_t* libxstream_opencl_device_owner(const void* dev_mem)
+{
+  libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
+  libxstream_opencl_device_t* result = NULL;
+  int i = 0;
+  for (; i < libxstream_opencl_config.ndevices; ++i) { /* any device bound besides the active one? */
+    if (NULL != libxstream_opencl_config.devinfos[i]) break;
+  }
+  /**
+   * Only a process that ever bound another device can hold memory of several
+   * contexts. The calling thread's device is probed first (the common case),
+   * then the remaining ones. USM allocations are recognized by their context
+   * (CL_MEM_ALLOC_TYPE_INTEL is unknown for a foreign pointer); buffers are
+   * registered process-wide, hence any device without USM releases them.
+   */
+  if (NULL != dev_mem && i < libxstream_opencl_config.ndevices) {
+    libxstream_opencl_device_t* other = NULL;
+    for (i = -2; i < libxstream_opencl_config.ndevices && NULL == result; ++i) {
+      libxstream_opencl_device_t* const candidate = (-2 == i   ? devinfo
+                                                     : -1 == i ? &libxstream_opencl_config.device
+                                                               : libxstream_opencl_config.devinfos[i]);
+      if (NULL != candidate && NULL != candidate->context && (-2 == i || devinfo != candidate)) {
+# if (1 >= LIBXSTREAM_USM)
+        if (NULL != candidate->clDeviceMemAllocINTEL || NULL != candidate->clSharedMemAllocINTEL) {
+          cl_uint kind = 0x4196 /*CL_MEM_TYPE_UNKNOWN_INTEL*/;
+          if (NULL != candidate->clGetMemAllocInfoINTEL &&
+              CL_SUCCESS == candidate->clGetMemAllocInfoINTEL(candidate->context, dev_mem, 0x419A /*CL_MEM_ALLOC_TYPE_INTEL*/,
+                              sizeof(kind), &kind, NULL) &&
+              0x4196 /*CL_MEM_TYPE_UNKNOWN_INTEL*/ != kind)
+          {
+            result = candidate;
+          }
+        }
+        else
+# endif
+# if (0 != LIBXSTREAM_USM)
+        if (0 == candidate->usm) /* SVM cannot be attributed */
+# endif
+        {
+          if (NULL == other) other = candidate;
+        }
+      }
+    }
+    if (NULL == result) result = (NULL != other ? other : devinfo);
+  }
+  else result = devinfo;
+  return result;
+}
+
+
+LIBXSTREAM_API int libxstream_device_bind(int device_id)
+{
+  int result = EXIT_SUCCESS;
+  if (0 == libxstream_opencl_config.ndevices) { /* not initialized */
+    result = libxstream_init();
+  }
+  if (EXIT_SUCCESS == result && device_id < libxstream_opencl_config.ndevices && NULL != libxstream_opencl_config.bound) {
+    const int tid = libxs_tid();
+    if (0 <= tid && tid < libxstream_opencl_config.nthreads) {
+      libxstream_opencl_device_t* devinfo = NULL;
+      LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_main);
+      /**
+       * Binding the active device is the same as following it: the thread then
+       * shares the active context and its pools, which is what makes memory of
+       * the main thread usable by a worker bound to the same device.
+       */
+      if (0 <= device_id && device_id != libxstream_opencl_config.device_id) {
+        devinfo = libxstream_opencl_config.devinfos[device_id];
+        if (NULL == devinfo) { /* create on first use */
+          devinfo = (libxstream_opencl_device_t*)calloc(1, sizeof(libxstream_opencl_device_t));
+          if (NULL != devinfo) {
+            result = libxstream_opencl_device_activate(NULL /*lock*/, devinfo, device_id);
+            if (EXIT_SUCCESS == result && (
+# if (1 >= LIBXSTREAM_USM)
+                NULL != devinfo->clDeviceMemAllocINTEL ||
+                NULL != devinfo->clSharedMemAllocINTEL ||
+# endif
+# if (0 != LIBXSTREAM_USM)
+                0 != devinfo->usm ||
+# endif
+                0 /*sentinel*/))
+            {
+              devinfo->pool_dev = libxs_malloc_xpool(
+                (libxs_malloc_xfn)libxstream_mem_dev_xmalloc,
+                (libxs_free_xfn)libxstream_mem_dev_xfree, libxstream_opencl_config.nthreads);
+            }
+            if (EXIT_SUCCESS == result) libxstream_opencl_config.devinfos[device_id] = devinfo;
+            else {
+              free(devinfo);
+              devinfo = NULL;
+            }
+          }
+          else result = EXIT_FAILURE;
+        }
+      }
+      if (EXIT_SUCCESS == result) {
+        if (NULL == libxstream_opencl_config.bound[tid]) {
+          if (NULL != devinfo) ++libxstream_opencl_config.nbound;
+        }
+        else if (NULL == devinfo) --libxstream_opencl_config.nbound;
+        libxstream_opencl_config.bound[tid] = devinfo;
+      }
+      LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_main);
+    }
+    else result = EXIT_FAILURE;
+  }
+  else if (EXIT_SUCCESS == result) result = EXIT_FAILURE;
+  CL_RETURN(result, "");
+}
+
+
 LIBXSTREAM_API int libxstream_opencl_flags_atomics(const libxstream_opencl_device_t* devinfo, libxstream_opencl_atomic_fp_t kind,
   const char* exts[], size_t* exts_maxlen, char flags[], size_t flags_maxlen)
 {
@@ -1872,7 +2411,7 @@ LIBXSTREAM_API int libxstream_opencl_flags_atomics(const libxstream_opencl_devic
     if (NULL == exts[ext2] || '\0' == *exts[ext2]) break;
   }
   if (NULL != devinfo && NULL != exts_maxlen && ext2 < *exts_maxlen) {
-    const cl_device_id device_id = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
+    const cl_device_id device_id = libxstream_opencl_config.devices[devinfo->device_id];
     const char* atomic_type = "";
     switch (kind) {
       case libxstream_opencl_atomic_fp_64: {
@@ -2010,7 +2549,7 @@ LIBXSTREAM_API int libxstream_opencl_flags_atomics(const libxstream_opencl_devic
 
 LIBXSTREAM_API int libxstream_opencl_defines(const char defines[], char buffer[], size_t buffer_size, int cleanup)
 {
-  const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
   int result = 0;
   if (NULL != buffer && NULL != devinfo->context) {
     const int std_clevel = 100 * devinfo->std_clevel[0] + 10 * devinfo->std_clevel[1];
@@ -2037,7 +2576,7 @@ LIBXSTREAM_API int libxstream_opencl_defines(const char defines[], char buffer[]
 LIBXSTREAM_API int libxstream_opencl_kernel_flags(const char build_params[], const char build_options[], const char try_options[],
   cl_program program, char buffer[], size_t buffer_size)
 {
-  const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
   int result = EXIT_SUCCESS, nchar = 0;
   assert(NULL != program && (NULL != buffer || 0 == buffer_size));
   nchar = libxstream_opencl_defines(build_params, buffer, buffer_size, 1 /*cleanup*/);
@@ -2055,7 +2594,7 @@ LIBXSTREAM_API int libxstream_opencl_kernel_flags(const char build_params[], con
     else nchar = n;
   }
   if (0 <= nchar && LIBXS_CAST_INT(buffer_size) > nchar) { /* check if internal flags apply */
-    const cl_device_id device_id = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
+    const cl_device_id device_id = libxstream_opencl_config.devices[devinfo->device_id];
     result = clBuildProgram(program, 1 /*num_devices*/, &device_id, buffer, NULL /*callback*/, NULL /*user_data*/);
     if (EXIT_SUCCESS != result) { /* failed to apply internal flags */
       LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseProgram(program)); /* avoid unclean state */
@@ -2127,8 +2666,8 @@ LIBXSTREAM_API int libxstream_opencl_program(size_t source_kind, const char sour
   cl_program* program)
 {
   char buffer[LIBXSTREAM_BUFFERSIZE] = "", buffer_name[LIBXSTREAM_MAXSTRLEN * 2];
-  const cl_device_id device_id = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
-  const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
+  const cl_device_id device_id = libxstream_opencl_config.devices[devinfo->device_id];
   int result = ((NULL != source && NULL != name && '\0' != *name) ? EXIT_SUCCESS : EXIT_FAILURE);
   int ok = EXIT_SUCCESS, source_is_cl = (2 > source_kind), nchar = 0;
   size_t size_src = 0, size = 0;
@@ -2540,7 +3079,7 @@ LIBXSTREAM_API_INTERN cl_mem libxstream_opencl_subbuffer(cl_mem parent, size_t o
 
 LIBXSTREAM_API int libxstream_opencl_set_kernel_ptr(cl_kernel kernel, cl_uint arg_index, const void* arg_value)
 {
-  const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
   int result = EXIT_FAILURE;
   assert(NULL != devinfo->context);
 # if (1 >= LIBXSTREAM_USM)
@@ -2569,7 +3108,7 @@ LIBXSTREAM_API int libxstream_opencl_set_kernel_ptr(cl_kernel kernel, cl_uint ar
      * a concurrent free tear it down mid-use.
      */
     LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
-    info = libxstream_opencl_info_devptr_modify(NULL, nc, 1 /*elsize*/, NULL /*amount*/, &offset);
+    info = libxstream_opencl_info_devptr_modify(NULL /*device*/, NULL, nc, 1 /*elsize*/, NULL /*amount*/, &offset);
     if (NULL != info) {
       if (0 == offset) {
         result = clSetKernelArg(kernel, arg_index, sizeof(cl_mem), &info->memory);
@@ -2723,23 +3262,25 @@ LIBXSTREAM_API_INTERN size_t libxstream_kernel_slot(cl_kernel kernel)
 }
 
 
-LIBXSTREAM_API int libxstream_opencl_launch_work(libxstream_stream_t* stream, cl_kernel kernel, cl_uint work_dim,
-  const size_t* global_work_offset, const size_t* global_work_size, const size_t* local_work_size,
-  cl_uint num_events_in_wait_list, const cl_event* event_wait_list, cl_event* event, size_t nflops, size_t nbytes)
+LIBXSTREAM_API_INTERN int libxstream_opencl_enqueue_kernel(const libxstream_opencl_stream_t* str, cl_kernel kernel,
+  cl_kernel kernel_id, cl_uint work_dim, const size_t* global_work_offset, const size_t* global_work_size,
+  const size_t* local_work_size, cl_uint num_events_in_wait_list, const cl_event* event_wait_list, cl_event* event,
+  size_t nflops, size_t nbytes)
 {
-  libxstream_opencl_stream_t* const str = (libxstream_opencl_stream_t*)stream;
-  int result = EXIT_SUCCESS;
-  if (NULL != str && NULL != kernel) {
-    /**
+  libxstream_opencl_launch_info_t* info = NULL;
+  cl_event evt = NULL;
+  int result;
+  assert(NULL != str && NULL != kernel && NULL != kernel_id);
+  { /**
      * Profile only if requested. The record is taken from the pool before the
      * launch and returned by the callback, so an exhausted pool skips profiling
      * rather than the launch. The pool bounds launches *in flight*, not total
-     * launches: a record lives only until its completion callback runs.
+     * launches: a record lives only until its completion callback runs. The
+     * profile is keyed by kernel_id, which differs from kernel for a launch
+     * replayed by a graph (the graph launches its snapshot of the kernel).
      */
-    libxstream_opencl_launch_info_t* info = NULL;
-    cl_event evt = NULL;
     if (0 != libxstream_opencl_config.profile && NULL != libxstream_opencl_config.launch_infos) {
-      const size_t slot = libxstream_kernel_slot(kernel);
+      const size_t slot = libxstream_kernel_slot(kernel_id);
       if (slot < LIBXSTREAM_MAXNKERNELS) {
         info = (libxstream_opencl_launch_info_t*)libxs_pmalloc_lock(
           (void**)libxstream_opencl_config.launch_infos, &libxstream_opencl_config.nlaunch_infos,
@@ -2751,8 +3292,10 @@ LIBXSTREAM_API int libxstream_opencl_launch_work(libxstream_stream_t* stream, cl
         }
       }
     }
+    libxstream_opencl_stream_busy(str);
     result = clEnqueueNDRangeKernel(str->queue, kernel, work_dim, global_work_offset, global_work_size, local_work_size,
       num_events_in_wait_list, event_wait_list, (NULL != info || NULL != event) ? &evt : NULL);
+    if (EXIT_SUCCESS == result) libxstream_opencl_stream_mark(str, evt); /* the profile's event doubles as marker */
     if (EXIT_SUCCESS == result && NULL != info) {
       /* retain when the caller keeps the event: the callback releases its own
          reference, and the caller releases theirs */
@@ -2776,6 +3319,26 @@ LIBXSTREAM_API int libxstream_opencl_launch_work(libxstream_stream_t* stream, cl
     if (NULL != event) *event = evt;
     else if (NULL != evt && NULL == info) LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(evt));
   }
+  return result;
+}
+
+
+LIBXSTREAM_API int libxstream_opencl_launch_work(libxstream_stream_t* stream, cl_kernel kernel, cl_uint work_dim,
+  const size_t* global_work_offset, const size_t* global_work_size, const size_t* local_work_size,
+  cl_uint num_events_in_wait_list, const cl_event* event_wait_list, cl_event* event, size_t nflops, size_t nbytes)
+{
+  const libxstream_opencl_stream_t* const str = stream;
+  int result = EXIT_SUCCESS;
+  if (NULL != str && NULL != kernel) {
+    if (NULL == str->capture) {
+      result = libxstream_opencl_enqueue_kernel(str, kernel, kernel, work_dim, global_work_offset, global_work_size,
+        local_work_size, num_events_in_wait_list, event_wait_list, event, nflops, nbytes);
+    }
+    else { /* recorded rather than executed (libxstream_stream_begin_capture) */
+      result = libxstream_graph_record_kernel(str->capture, kernel, work_dim, global_work_offset, global_work_size,
+        local_work_size, num_events_in_wait_list, event, nflops, nbytes);
+    }
+  }
   else result = EXIT_FAILURE;
   CL_RETURN(result, "");
 }
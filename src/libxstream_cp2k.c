@@ -34,7 +34,16 @@ LIBXSTREAM_API offloadError_t offloadGetLastError(void)
 
 LIBXSTREAM_API void offloadMemsetAsync(void* ptr, int val, size_t size, offloadStream_t stream)
 {
-  const int result = libxstream_opencl_memset(ptr, val, 0 /*offset*/, size, (libxstream_stream_t*)stream);
+  int result = EXIT_SUCCESS;
+# if defined(__OFFLOAD_UNIFIED_MEMORY)
+  /* overwritten entirely: place on the device without migrating the content */
+  result = libxstream_mem_advise(ptr, size, LIBXSTREAM_MEM_ADVISE_DEVICE | LIBXSTREAM_MEM_ADVISE_DISCARD,
+    (libxstream_stream_t*)stream);
+  if (EXIT_SUCCESS == result)
+# endif
+  {
+    result = libxstream_opencl_memset(ptr, val, 0 /*offset*/, size, (libxstream_stream_t*)stream);
+  }
   OFFLOAD_EXPECT(result, "offloadMemsetAsync");
 }
 
@@ -47,14 +56,36 @@ LIBXSTREAM_API void offloadMemset(void* ptr, int val, size_t size)
 
 LIBXSTREAM_API void offloadMemcpyAsyncHtoD(void* ptr_dev, const void* ptr_hst, size_t size, offloadStream_t stream)
 {
-  const int result = libxstream_mem_copy_h2d(ptr_hst, ptr_dev, size, (libxstream_stream_t*)stream);
+  int result;
+# if defined(__OFFLOAD_UNIFIED_MEMORY)
+  /**
+   * Unified memory: CP2K passes the same pointer for both sides, and the "copy"
+   * is where the operand is needed next (migrate ahead of the kernels enqueued
+   * after), whereas a distinct destination is overwritten anyway.
+   */
+  if (ptr_dev == ptr_hst) result = libxstream_mem_prefetch(ptr_dev, size, 1 /*to_device*/, (libxstream_stream_t*)stream);
+  else {
+    result = libxstream_mem_advise(ptr_dev, size, LIBXSTREAM_MEM_ADVISE_DEVICE | LIBXSTREAM_MEM_ADVISE_DISCARD,
+      (libxstream_stream_t*)stream);
+    if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(ptr_hst, ptr_dev, size, (libxstream_stream_t*)stream);
+  }
+# else
+  result = libxstream_mem_copy_h2d(ptr_hst, ptr_dev, size, (libxstream_stream_t*)stream);
+# endif
   OFFLOAD_EXPECT(result, "offloadMemcpyAsyncHtoD");
 }
 
 
 LIBXSTREAM_API void offloadMemcpyAsyncDtoH(void* ptr_hst, const void* ptr_dev, size_t size, offloadStream_t stream)
 {
-  const int result = libxstream_mem_copy_d2h(ptr_dev, ptr_hst, size, (libxstream_stream_t*)stream);
+  int result;
+# if defined(__OFFLOAD_UNIFIED_MEMORY)
+  if (ptr_dev == ptr_hst) result = libxstream_mem_prefetch(ptr_hst, size, 0 /*to_device*/, (libxstream_stream_t*)stream);
+  else
+# endif
+  {
+    result = libxstream_mem_copy_d2h(ptr_dev, ptr_hst, size, (libxstream_stream_t*)stream);
+  }
   OFFLOAD_EXPECT(result, "offloadMemcpyAsyncDtoH");
 }
 
@@ -161,7 +192,10 @@ LIBXSTREAM_API void offloadMallocHost(void** ptr, size_t size)
 
 LIBXSTREAM_API void offloadMalloc(void** ptr, size_t size)
 {
-  const int result = libxstream_mem_allocate(ptr, size);
+  int result;
+  libxstream_mem_tag_push("offload");
+  result = libxstream_mem_allocate(ptr, size);
+  libxstream_mem_tag_pop();
   OFFLOAD_EXPECT(result, "offloadMalloc");
 }
 
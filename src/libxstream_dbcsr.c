@@ -208,7 +208,9 @@ LIBXSTREAM_API int c_dbcsr_acc_dev_mem_allocate(void** dev_mem, size_t nbytes)
 {
   int result;
   LIBXSTREAM_PROFILE_BEGIN;
+  libxstream_mem_tag_push("dbcsr");
   result = libxstream_mem_allocate(dev_mem, nbytes);
+  libxstream_mem_tag_pop();
   LIBXSTREAM_PROFILE_END;
   return result;
 }
@@ -13,11 +13,20 @@
 
 LIBXSTREAM_API int libxstream_event_create(libxstream_event_t** event_p)
 {
+  const int tid = libxs_tid();
   int result = EXIT_SUCCESS;
   assert(NULL != libxstream_opencl_config.events && NULL != event_p);
-  *event_p = (libxstream_event_t*)libxs_pmalloc_lock(
-    (void**)libxstream_opencl_config.events, &libxstream_opencl_config.nevents, libxstream_opencl_config.lock_event);
-  if (NULL != *event_p) (*event_p)->cl_evt = NULL;
+  if (NULL != libxstream_opencl_config.event_cache && tid < libxstream_opencl_config.nthreads &&
+      0 < libxstream_opencl_config.event_cache[tid].n)
+  { /* recycle a handle released by this thread */
+    libxstream_opencl_event_cache_t* const cache = libxstream_opencl_config.event_cache + tid;
+    *event_p = cache->slot[--cache->n];
+  }
+  else {
+    *event_p = (libxstream_event_t*)libxs_pmalloc_lock(
+      (void**)libxstream_opencl_config.events, &libxstream_opencl_config.nevents, libxstream_opencl_config.lock_event);
+  }
+  if (NULL != *event_p) LIBXS_MEMZERO(*event_p);
   else result = EXIT_FAILURE;
   CL_RETURN(result, "");
 }
@@ -27,14 +36,23 @@ LIBXSTREAM_API int libxstream_event_destroy(libxstream_event_t* event)
 {
   int result = EXIT_SUCCESS;
   if (NULL != event) {
+    const int tid = libxs_tid();
     cl_event clevent;
     assert(NULL != libxstream_opencl_config.events);
     LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
     clevent = event->cl_evt;
     event->cl_evt = NULL;
     LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
-    libxs_pfree_lock(
-      event, (void**)libxstream_opencl_config.events, &libxstream_opencl_config.nevents, libxstream_opencl_config.lock_event);
+    if (NULL != libxstream_opencl_config.event_cache && tid < libxstream_opencl_config.nthreads &&
+        LIBXSTREAM_EVENT_NCACHE > libxstream_opencl_config.event_cache[tid].n)
+    {
+      libxstream_opencl_event_cache_t* const cache = libxstream_opencl_config.event_cache + tid;
+      cache->slot[cache->n++] = event;
+    }
+    else {
+      libxs_pfree_lock(
+        event, (void**)libxstream_opencl_config.events, &libxstream_opencl_config.nevents, libxstream_opencl_config.lock_event);
+    }
     if (NULL != clevent) {
       result = clReleaseEvent(clevent);
     }
@@ -43,38 +61,96 @@ LIBXSTREAM_API int libxstream_event_destroy(libxstream_event_t* event)
 }
 
 
+LIBXSTREAM_API_INTERN void libxstream_opencl_stream_busy(const libxstream_opencl_stream_t* stream)
+{
+  libxstream_opencl_stream_t* const str = (libxstream_opencl_stream_t*)stream;
+  assert(NULL != str);
+  if (0 != libxstream_opencl_config.elide) { /* neither marker nor idle state otherwise */
+    cl_event marker;
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+    marker = str->marker;
+    str->marker = NULL;
+    str->idle = 0;
+    ++str->nsubmit;
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+    if (NULL != marker) LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(marker));
+  }
+}
+
+
+LIBXSTREAM_API_INTERN void libxstream_opencl_stream_mark(const libxstream_opencl_stream_t* stream, cl_event event)
+{
+  libxstream_opencl_stream_t* const str = (libxstream_opencl_stream_t*)stream;
+  assert(NULL != str);
+  if (0 != libxstream_opencl_config.elide && NULL != event && NULL == str->marker) { /* unlocked peek */
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+    if (NULL == str->marker && 0 == str->idle && EXIT_SUCCESS == clRetainEvent(event)) {
+      str->marker = event; /* own reference */
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+  }
+}
+
+
 LIBXSTREAM_API int libxstream_stream_wait_event(libxstream_stream_t* stream, libxstream_event_t* event)
 { /* wait for an event (device-side) */
   int result = EXIT_SUCCESS;
   const libxstream_opencl_stream_t* str = NULL;
+  cl_command_queue queue = NULL;
   cl_event clevent = NULL;
+  int done;
   str = (NULL != stream ? stream : libxstream_opencl_stream_default());
   assert(NULL != str && NULL != str->queue && NULL != event);
-  LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
-  clevent = event->cl_evt;
-  if (NULL != clevent) clRetainEvent(clevent);
-  LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
-  if (NULL != clevent) {
+  if (NULL != str->capture) { /* not recorded: a launch of the graph would miss the dependency */
+    result = EXIT_FAILURE;
+  }
+  else {
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+    clevent = event->cl_evt;
+    queue = event->queue;
+    done = event->done;
+    if (NULL != clevent) clRetainEvent(clevent);
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+    if (NULL != clevent && 0 != libxstream_opencl_config.elide) {
+      /**
+       * An in-order queue executes the recorded work before anything enqueued
+       * later. A queue is not freed while it has pending commands, hence its
+       * address showing up again means the recorded work is complete as well.
+       */
+      if (queue == str->queue) done = 1;
+      else {
+        cl_int status = CL_COMPLETE + 1;
+        done = (EXIT_SUCCESS == clGetEventInfo(clevent, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL) &&
+                CL_COMPLETE == status);
+      }
+    }
+    if (0 != done) {
+      LIBXS_ATOMIC_SIZE(LIBXS_ATOMIC_ADD_FETCH)(&libxstream_opencl_config.nwait_elided, 1, LIBXS_ATOMIC_RELAXED);
+      if (NULL != clevent) clReleaseEvent(clevent);
+    }
+    else if (NULL != clevent) {
+      libxstream_opencl_stream_busy(str);
 # if defined(CL_VERSION_1_2)
-    result = clEnqueueBarrierWithWaitList(str->queue, 1, &clevent, NULL);
+      result = clEnqueueBarrierWithWaitList(str->queue, 1, &clevent, NULL);
 # else
-    result = clEnqueueWaitForEvents(str->queue, 1, &clevent);
+      result = clEnqueueWaitForEvents(str->queue, 1, &clevent);
 # endif
-    if (EXIT_SUCCESS != result) {
-      LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
-      if (clevent == event->cl_evt) {
-        event->cl_evt = NULL;
-        LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
-        LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(clevent));
-      }
-      else {
-        LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+      if (EXIT_SUCCESS != result) {
+        LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+        if (clevent == event->cl_evt) {
+          event->cl_evt = NULL;
+          LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+          LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(clevent));
+        }
+        else {
+          LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+        }
       }
+      clReleaseEvent(clevent);
+    }
+    else if (3 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity) {
+      fprintf(stderr, "WARN ACC/OpenCL: libxstream_stream_wait_event discovered an empty event.\n");
     }
-    clReleaseEvent(clevent);
-  }
-  else if (3 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity) {
-    fprintf(stderr, "WARN ACC/OpenCL: libxstream_stream_wait_event discovered an empty event.\n");
   }
   CL_RETURN(result, "");
 }
@@ -85,29 +161,57 @@ LIBXSTREAM_API int libxstream_event_record(libxstream_event_t* event, libxstream
   int result = EXIT_SUCCESS;
   const libxstream_opencl_stream_t* str = NULL;
   cl_event clevent = NULL, clevent_result = NULL;
+  int done = 0;
   str = (NULL != stream ? stream : libxstream_opencl_stream_default());
   assert(NULL != str && NULL != str->queue && NULL != event);
+  if (NULL != str->capture) { /* not recorded: a launch of the graph would miss the dependency */
+    result = EXIT_FAILURE;
+  }
+  else {
+    if (0 != libxstream_opencl_config.elide) { /* share the previous marker, or none if drained */
+      LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+      if (0 != str->idle) done = 1;
+      else if (NULL != str->marker) {
+        clevent_result = str->marker;
+        clRetainEvent(clevent_result);
+      }
+      LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+    }
+    if (0 != done || NULL != clevent_result) {
+      LIBXS_ATOMIC_SIZE(LIBXS_ATOMIC_ADD_FETCH)(&libxstream_opencl_config.nmarker_elided, 1, LIBXS_ATOMIC_RELAXED);
+    }
+    else {
 # if defined(CL_VERSION_1_2)
-  result = clEnqueueMarkerWithWaitList(str->queue, 0, NULL, &clevent_result);
+      result = clEnqueueMarkerWithWaitList(str->queue, 0, NULL, &clevent_result);
 # else
-  result = clEnqueueMarker(str->queue, &clevent_result);
+      result = clEnqueueMarker(str->queue, &clevent_result);
 # endif
-  LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
-  clevent = event->cl_evt;
-  if (EXIT_SUCCESS == result) {
-    assert(NULL != clevent_result);
-    event->cl_evt = clevent_result;
-  }
-  else {
-    event->cl_evt = NULL;
-  }
-  LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
-  if (NULL != clevent) {
-    const int result_release = clReleaseEvent(clevent);
-    if (EXIT_SUCCESS == result) result = result_release;
-  }
-  if (EXIT_SUCCESS != result && NULL != clevent_result) {
-    LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(clevent_result));
+    }
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+    clevent = event->cl_evt;
+    if (EXIT_SUCCESS == result) {
+      assert(NULL != clevent_result || 0 != done);
+      event->cl_evt = clevent_result;
+      event->queue = str->queue; /* every queue is in-order, including the internal stream */
+      event->done = done;
+      if (0 != libxstream_opencl_config.elide && NULL != clevent_result && NULL == str->marker) {
+        ((libxstream_opencl_stream_t*)str)->marker = clevent_result; /* own reference */
+        clRetainEvent(clevent_result);
+      }
+    }
+    else {
+      event->cl_evt = NULL;
+      event->queue = NULL;
+      event->done = 0;
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+    if (NULL != clevent) {
+      const int result_release = clReleaseEvent(clevent);
+      if (EXIT_SUCCESS == result) result = result_release;
+    }
+    if (EXIT_SUCCESS != result && NULL != clevent_result) {
+      LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(clevent_result));
+    }
   }
   CL_RETURN(result, "");
 }
@@ -117,17 +221,18 @@ LIBXSTREAM_API int libxstream_event_query(libxstream_event_t* event, int* has_oc
 {
   cl_int status = CL_COMPLETE;
   cl_event clevent;
-  int result;
+  int result, done;
   assert(NULL != event && NULL != has_occurred);
   LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
   clevent = event->cl_evt;
   if (NULL != clevent) clRetainEvent(clevent);
+  done = event->done;
   LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
   if (NULL != clevent) {
     result = clGetEventInfo(clevent, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
     clReleaseEvent(clevent);
   }
-  else result = EXIT_FAILURE;
+  else result = (0 != done ? EXIT_SUCCESS : EXIT_FAILURE);
   if (EXIT_SUCCESS == result && 0 <= status) *has_occurred = (CL_COMPLETE == status ? 1 : 0);
   else { /* error state */
     result = EXIT_SUCCESS; /* soft-error */
@@ -139,12 +244,13 @@ LIBXSTREAM_API int libxstream_event_query(libxstream_event_t* event, int* has_oc
 
 LIBXSTREAM_API int libxstream_event_sync(libxstream_event_t* event)
 { /* waits on the host-side */
-  int result = EXIT_SUCCESS;
+  int result = EXIT_SUCCESS, done;
   cl_event clevent;
   assert(NULL != event);
   LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
   clevent = event->cl_evt;
   if (NULL != clevent) clRetainEvent(clevent);
+  done = event->done;
   LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
   if (NULL != clevent) {
     if (0 == (64 & libxstream_opencl_config.wa)) {
@@ -162,7 +268,7 @@ LIBXSTREAM_API int libxstream_event_sync(libxstream_event_t* event)
     }
     clReleaseEvent(clevent);
   }
-  else if (3 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity) {
+  else if (0 == done && (3 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity)) {
     fprintf(stderr, "WARN ACC/OpenCL: libxstream_event_sync discovered an empty event.\n");
   }
   CL_RETURN(result, "");
@@ -0,0 +1,360 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# include <libxstream/libxstream_opencl.h>
+
+/* Initial number of recorded operations (doubled on demand). */
+#if !defined(LIBXSTREAM_GRAPH_NOPS)
+# define LIBXSTREAM_GRAPH_NOPS 16
+#endif
+/**
+ * cl_khr_command_buffer is provisional and its header has changed shape across
+ * revisions, hence the entry points are declared here and resolved at runtime
+ * rather than taken from a header: only the subset whose signature is stable
+ * across revisions is used (kernel commands), and the handles are opaque.
+ */
+#if !defined(CL_COMMAND_BUFFER_FLAGS_KHR)
+# define CL_COMMAND_BUFFER_FLAGS_KHR 0x1293
+#endif
+#if !defined(CL_COMMAND_BUFFER_SIMULTANEOUS_USE_KHR)
+# define CL_COMMAND_BUFFER_SIMULTANEOUS_USE_KHR (1 << 0)
+#endif
+
+
+/** Recorded operation: kernel launch (kind none), copy, or fill (kind zero). */
+typedef struct libxstream_graph_op_t {
+  libxstream_event_kind_t kind;
+  /** Snapshot of the kernel (clCloneKernel) and the original (profile key). */
+  cl_kernel kernel, kernel_id;
+  size_t offset[3], gws[3], lws[3];
+  cl_uint work_dim;
+  /** Non-zero if offset respectively lws was given. */
+  int has_offset, has_lws;
+  size_t nflops, nbytes;
+  /** Copy or fill: source (host or device), destination, and fill-value. */
+  const void* src;
+  void* dst;
+  size_t dst_offset;
+  int value;
+} libxstream_graph_op_t;
+
+struct libxstream_graph_t {
+  libxstream_graph_op_t* ops;
+  size_t nops, size;
+  /** First error during capture (poisons the graph). */
+  int result;
+  /** Command buffer (cl_khr_command_buffer) recorded for queue, or NULL. */
+  /*cl_command_buffer_khr*/ void* cmdbuf;
+  cl_command_queue queue;
+  cl_int (*clEnqueueCommandBufferKHR)(cl_uint, cl_command_queue*, void*, cl_uint, const cl_event*, cl_event*);
+  cl_int (*clReleaseCommandBufferKHR)(void*);
+};
+
+
+LIBXSTREAM_API_INTERN libxstream_graph_op_t* libxstream_graph_push(libxstream_graph_t* /*graph*/);
+LIBXSTREAM_API_INTERN libxstream_graph_op_t* libxstream_graph_push(libxstream_graph_t* graph)
+{
+  libxstream_graph_op_t* result = NULL;
+  assert(NULL != graph);
+  if (graph->nops == graph->size) {
+    const size_t size = LIBXS_MAX(2 * graph->size, LIBXSTREAM_GRAPH_NOPS);
+    libxstream_graph_op_t* const ops = (libxstream_graph_op_t*)realloc(graph->ops, size * sizeof(libxstream_graph_op_t));
+    if (NULL != ops) {
+      graph->ops = ops;
+      graph->size = size;
+    }
+  }
+  if (graph->nops < graph->size) {
+    result = graph->ops + graph->nops++;
+    LIBXS_MEMZERO(result);
+  }
+  return result;
+}
+
+
+LIBXSTREAM_API_INTERN int libxstream_graph_record_kernel(libxstream_graph_t* graph, cl_kernel kernel, cl_uint work_dim,
+  const size_t* global_work_offset, const size_t* global_work_size, const size_t* local_work_size,
+  cl_uint num_events_in_wait_list, cl_event* event, size_t nflops, size_t nbytes)
+{
+  int result;
+  assert(NULL != graph && NULL != kernel);
+  result = graph->result;
+  /**
+   * Events are not recorded: a wait-list would refer to a particular submission
+   * and an event returned now cannot stand for every replay. An in-order stream
+   * orders the recorded work anyway, and libxstream_event_record after a launch
+   * of the graph covers the whole sequence.
+   */
+  if (EXIT_SUCCESS == result && (0 != num_events_in_wait_list || NULL != event || NULL == global_work_size ||
+                                  0 == work_dim || 3 < work_dim))
+  {
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result) {
+    libxstream_graph_op_t* const op = libxstream_graph_push(graph);
+    if (NULL != op) {
+      cl_uint i;
+      /**
+       * Snapshot the arguments: a clone carries the arguments set so far, hence
+       * the caller may rebind the original (e.g., swap time levels) and record
+       * the next launch. Replay then issues no clSetKernelArg at all.
+       */
+# if defined(CL_VERSION_2_1)
+      op->kernel = clCloneKernel(kernel, &result);
+# else
+      result = EXIT_FAILURE;
+# endif
+      if (EXIT_SUCCESS == result) {
+        op->kernel_id = kernel;
+        LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clRetainKernel(kernel)); /* profile key must stay unique */
+        op->kind = libxstream_event_kind_none;
+        op->work_dim = work_dim;
+        op->has_offset = (NULL != global_work_offset ? 1 : 0);
+        op->has_lws = (NULL != local_work_size ? 1 : 0);
+        for (i = 0; i < work_dim; ++i) {
+          op->offset[i] = (NULL != global_work_offset ? global_work_offset[i] : 0);
+          op->gws[i] = global_work_size[i];
+          op->lws[i] = (NULL != local_work_size ? local_work_size[i] : 0);
+        }
+        op->nflops = nflops;
+        op->nbytes = nbytes;
+      }
+      else {
+        --graph->nops;
+        if (0 != libxstream_opencl_config.verbosity) {
+          fprintf(stderr, "ERROR ACC/OpenCL: capturing a kernel requires clCloneKernel (OpenCL 2.1).\n");
+        }
+      }
+    }
+    else result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS != result) graph->result = result;
+  return result;
+}
+
+
+LIBXSTREAM_API_INTERN int libxstream_graph_record_copy(libxstream_graph_t* graph, libxstream_event_kind_t kind, const void* src,
+  void* dst, size_t dst_offset, size_t nbytes, int value)
+{
+  int result;
+  assert(NULL != graph);
+  result = graph->result;
+  if (EXIT_SUCCESS == result) {
+    libxstream_graph_op_t* const op = libxstream_graph_push(graph);
+    if (NULL != op) {
+      op->kind = kind;
+      op->src = src;
+      op->dst = dst;
+      op->dst_offset = dst_offset;
+      op->nbytes = nbytes;
+      op->value = value;
+    }
+    else graph->result = result = EXIT_FAILURE;
+  }
+  return result;
+}
+
+
+/**
+ * Record the graph into a command buffer for the queue it was captured on, so a
+ * launch is a single enqueue. Only graphs consisting of kernel launches qualify:
+ * copy and fill commands changed their signature between revisions of the
+ * extension, which would make a wrong guess an ABI mismatch rather than an
+ * error code. Profiling keeps the launch-by-launch replay as it needs an event
+ * per kernel. Any failure leaves the graph without a command buffer.
+ */
+LIBXSTREAM_API_INTERN void libxstream_graph_command_buffer(libxstream_graph_t* /*graph*/, cl_command_queue /*queue*/);
+LIBXSTREAM_API_INTERN void libxstream_graph_command_buffer(libxstream_graph_t* graph, cl_command_queue queue)
+{
+  cl_device_id device = NULL;
+  cl_platform_id platform = NULL;
+  size_t size = 0, i;
+  int result = EXIT_SUCCESS;
+  assert(NULL != graph && NULL == graph->cmdbuf && NULL != queue);
+  if (0 == libxstream_opencl_config.graph || 0 != libxstream_opencl_config.profile || 0 == graph->nops) result = EXIT_FAILURE;
+  for (i = 0; i < graph->nops && EXIT_SUCCESS == result; ++i) {
+    if (libxstream_event_kind_none != graph->ops[i].kind) result = EXIT_FAILURE;
+  }
+  CL_CHECK(result, clGetCommandQueueInfo(queue, CL_QUEUE_DEVICE, sizeof(cl_device_id), &device, NULL));
+  CL_CHECK(result, clGetDeviceInfo(device, CL_DEVICE_PLATFORM, sizeof(cl_platform_id), &platform, NULL));
+  CL_CHECK(result, clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, 0, NULL, &size));
+  if (EXIT_SUCCESS == result) {
+    char* const extensions = (char*)malloc(size + 1);
+    if (NULL != extensions) {
+      if (EXIT_SUCCESS != clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, size, extensions, NULL) ||
+          NULL == strstr(extensions, "cl_khr_command_buffer"))
+      {
+        result = EXIT_FAILURE;
+      }
+      free(extensions);
+    }
+    else result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result) {
+    void* (*create)(cl_uint, const cl_command_queue*, const cl_bitfield*, cl_int*) = NULL;
+    cl_int (*command)(void*, cl_command_queue, const cl_bitfield*, cl_kernel, cl_uint, const size_t*, const size_t*,
+      const size_t*, cl_uint, const cl_uint*, cl_uint*, void*) = NULL;
+    cl_int (*finalize)(void*) = NULL;
+    void* ptr[5] = {NULL};
+    ptr[0] = clGetExtensionFunctionAddressForPlatform(platform, "clCreateCommandBufferKHR");
+    ptr[1] = clGetExtensionFunctionAddressForPlatform(platform, "clCommandNDRangeKernelKHR");
+    ptr[2] = clGetExtensionFunctionAddressForPlatform(platform, "clFinalizeCommandBufferKHR");
+    ptr[3] = clGetExtensionFunctionAddressForPlatform(platform, "clEnqueueCommandBufferKHR");
+    ptr[4] = clGetExtensionFunctionAddressForPlatform(platform, "clReleaseCommandBufferKHR");
+    if (NULL != ptr[0] && NULL != ptr[1] && NULL != ptr[2] && NULL != ptr[3] && NULL != ptr[4]) {
+      /* a launch may be enqueued while the previous one is still pending */
+      const cl_bitfield properties[] = {CL_COMMAND_BUFFER_FLAGS_KHR, CL_COMMAND_BUFFER_SIMULTANEOUS_USE_KHR, 0};
+      cl_uint sync = 0, sync_prev = 0;
+      LIBXS_ASSIGN(&create, ptr + 0);
+      LIBXS_ASSIGN(&command, ptr + 1);
+      LIBXS_ASSIGN(&finalize, ptr + 2);
+      LIBXS_ASSIGN(&graph->clEnqueueCommandBufferKHR, ptr + 3);
+      LIBXS_ASSIGN(&graph->clReleaseCommandBufferKHR, ptr + 4);
+      graph->cmdbuf = create(1, &queue, properties, &result);
+      if (NULL == graph->cmdbuf) { /* later revisions dropped the flag (always simultaneous) */
+        result = EXIT_SUCCESS;
+        graph->cmdbuf = create(1, &queue, NULL, &result);
+      }
+      if (NULL == graph->cmdbuf && EXIT_SUCCESS == result) result = EXIT_FAILURE;
+      for (i = 0; i < graph->nops && EXIT_SUCCESS == result; ++i) {
+        const libxstream_graph_op_t* const op = graph->ops + i;
+        /* chained sync-points keep the order of the stream regardless of the queue's properties */
+        result = command(graph->cmdbuf, NULL /*queue*/, NULL /*properties*/, op->kernel, op->work_dim,
+          0 != op->has_offset ? op->offset : NULL, op->gws, 0 != op->has_lws ? op->lws : NULL, 0 != i ? 1 : 0,
+          0 != i ? &sync_prev : NULL, &sync, NULL /*mutable_handle*/);
+        sync_prev = sync;
+      }
+      if (EXIT_SUCCESS == result) result = finalize(graph->cmdbuf);
+      if (EXIT_SUCCESS == result) graph->queue = queue;
+      else if (NULL != graph->cmdbuf) {
+        LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == graph->clReleaseCommandBufferKHR(graph->cmdbuf));
+        graph->cmdbuf = NULL;
+      }
+    }
+  }
+  if (2 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity) {
+    fprintf(stderr, "INFO ACC/OpenCL: graph with %i operation%s %s.\n", (int)graph->nops, 1 != graph->nops ? "s" : "",
+      NULL != graph->cmdbuf ? "recorded as command buffer" : "replayed per operation");
+  }
+}
+
+
+LIBXSTREAM_API int libxstream_stream_begin_capture(libxstream_stream_t* stream)
+{
+  int result = EXIT_SUCCESS;
+  if (NULL != stream && NULL == stream->capture) {
+    libxstream_graph_t* const graph = (libxstream_graph_t*)calloc(1, sizeof(libxstream_graph_t));
+    if (NULL != graph) stream->capture = graph;
+    else result = EXIT_FAILURE;
+  }
+  else result = EXIT_FAILURE; /* default stream cannot capture, and no nested capture */
+  CL_RETURN(result, "");
+}
+
+
+LIBXSTREAM_API int libxstream_stream_end_capture(libxstream_stream_t* stream, libxstream_graph_t** graph)
+{
+  int result = EXIT_SUCCESS;
+  if (NULL != stream && NULL != stream->capture && NULL != graph) {
+    libxstream_graph_t* const captured = stream->capture;
+    stream->capture = NULL;
+    result = captured->result;
+    if (EXIT_SUCCESS == result) {
+      libxstream_graph_command_buffer(captured, stream->queue);
+      *graph = captured;
+    }
+    else {
+      libxstream_graph_destroy(captured);
+      *graph = NULL;
+    }
+  }
+  else {
+    if (NULL != graph) *graph = NULL;
+    result = EXIT_FAILURE;
+  }
+  CL_RETURN(result, "");
+}
+
+
+LIBXSTREAM_API int libxstream_graph_launch(libxstream_graph_t* graph, libxstream_stream_t* stream)
+{
+  int result = EXIT_SUCCESS;
+  if (NULL != graph) {
+    libxstream_stream_t* const str = (NULL != stream ? stream : (libxstream_stream_t*)libxstream_opencl_stream_default());
+    int replay = 1;
+    size_t i;
+    assert(NULL != str && NULL != str->queue);
+    if (NULL != graph->cmdbuf && str->queue == graph->queue && NULL == str->capture) {
+      cl_command_queue queue = str->queue;
+      libxstream_opencl_stream_busy(str);
+      if (EXIT_SUCCESS == graph->clEnqueueCommandBufferKHR(1, &queue, graph->cmdbuf, 0, NULL, NULL)) replay = 0;
+      else { /* fall back for good: the replay below is equivalent */
+        LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == graph->clReleaseCommandBufferKHR(graph->cmdbuf));
+        graph->cmdbuf = NULL;
+        if (0 != libxstream_opencl_config.verbosity) {
+          fprintf(stderr, "WARN ACC/OpenCL: command buffer rejected, graph is replayed per operation.\n");
+        }
+      }
+    }
+    for (i = 0; i < graph->nops && EXIT_SUCCESS == result && 0 != replay; ++i) {
+      const libxstream_graph_op_t* const op = graph->ops + i;
+      switch (op->kind) {
+        case libxstream_event_kind_h2d: {
+          result = libxstream_mem_copy_h2d(op->src, op->dst, op->nbytes, str);
+        } break;
+        case libxstream_event_kind_d2h: {
+          result = libxstream_mem_copy_d2h(op->src, op->dst, op->nbytes, str);
+        } break;
+        case libxstream_event_kind_d2d: {
+          result = libxstream_mem_copy_d2d(op->src, op->dst, op->nbytes, str);
+        } break;
+        case libxstream_event_kind_zero: {
+          result = libxstream_opencl_memset(op->dst, op->value, op->dst_offset, op->nbytes, str);
+        } break;
+        default: {
+          const size_t* const offset = (0 != op->has_offset ? op->offset : NULL);
+          const size_t* const lws = (0 != op->has_lws ? op->lws : NULL);
+          if (NULL == str->capture) { /* profile is keyed by the original kernel */
+            result = libxstream_opencl_enqueue_kernel(
+              str, op->kernel, op->kernel_id, op->work_dim, offset, op->gws, lws, 0, NULL, NULL, op->nflops, op->nbytes);
+          }
+          else { /* launched into another capture */
+            result = libxstream_opencl_launch_work(
+              str, op->kernel, op->work_dim, offset, op->gws, lws, 0, NULL, NULL, op->nflops, op->nbytes);
+          }
+        }
+      }
+    }
+  }
+  else result = EXIT_FAILURE;
+  CL_RETURN(result, "");
+}
+
+
+LIBXSTREAM_API int libxstream_graph_destroy(libxstream_graph_t* graph)
+{
+  int result = EXIT_SUCCESS;
+  if (NULL != graph) {
+    size_t i;
+    if (NULL != graph->cmdbuf) result = graph->clReleaseCommandBufferKHR(graph->cmdbuf);
+    for (i = 0; i < graph->nops; ++i) {
+      const libxstream_graph_op_t* const op = graph->ops + i;
+      if (libxstream_event_kind_none == op->kind) {
+        const int result_kernel = clReleaseKernel(op->kernel), result_id = clReleaseKernel(op->kernel_id);
+        if (EXIT_SUCCESS == result) result = (EXIT_SUCCESS != result_kernel ? result_kernel : result_id);
+      }
+    }
+    free(graph->ops);
+    free(graph);
+  }
+  CL_RETURN(result, "");
+}
+
+#endif /*__OPENCL*/
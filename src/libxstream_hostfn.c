@@ -0,0 +1,244 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# include <libxstream/libxstream_opencl.h>
+# if !defined(_WIN32)
+#   include <pthread.h>
+# endif
+
+/* Upper bound for LIBXSTREAM_HOSTFN (number of workers). */
+#if !defined(LIBXSTREAM_HOSTFN_MAXNTHREADS)
+# define LIBXSTREAM_HOSTFN_MAXNTHREADS 8
+#endif
+
+
+/** Host function pending on a marker, and the user event gating the stream. */
+typedef struct libxstream_hostfn_item_t {
+  struct libxstream_hostfn_pool_t* pool;
+  struct libxstream_hostfn_item_t* next;
+  libxstream_host_fn_t fn;
+  void* arg;
+  cl_event gate;
+  /** Execution status of the marker (CL_COMPLETE or an error). */
+  cl_int status;
+} libxstream_hostfn_item_t;
+
+typedef struct libxstream_hostfn_pool_t {
+# if !defined(_WIN32)
+  pthread_t threads[LIBXSTREAM_HOSTFN_MAXNTHREADS];
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+# endif
+  /** FIFO of host functions whose marker completed. */
+  libxstream_hostfn_item_t *head, *tail;
+  /** Host functions enqueued but not yet run (callbacks may be undelivered). */
+  size_t npending;
+  int nthreads, shutdown;
+} libxstream_hostfn_pool_t;
+
+
+LIBXSTREAM_API_INTERN void libxstream_hostfn_run(libxstream_hostfn_item_t* /*item*/);
+LIBXSTREAM_API_INTERN void libxstream_hostfn_run(libxstream_hostfn_item_t* item)
+{
+  libxstream_hostfn_pool_t* const pool = item->pool;
+  const cl_event gate = item->gate;
+  /* an erroneous marker skips the function and fails the gated commands */
+  const cl_int status = (0 > item->status ? item->status : CL_COMPLETE);
+  assert(NULL != pool && NULL != gate);
+  if (CL_COMPLETE == status) item->fn(item->arg);
+  else if (0 != libxstream_opencl_config.verbosity) {
+    fprintf(stderr, "ERROR ACC/OpenCL: host function skipped (status %i).\n", (int)item->status);
+  }
+  free(item);
+  LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clSetUserEventStatus(gate, status));
+  LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(gate));
+  LIBXS_ATOMIC_SIZE(LIBXS_ATOMIC_SUB_FETCH)(&pool->npending, 1, LIBXS_ATOMIC_RELAXED);
+}
+
+
+LIBXSTREAM_API_INTERN void CL_CALLBACK libxstream_hostfn_notify(cl_event /*event*/, cl_int /*event_status*/, void* /*data*/);
+LIBXSTREAM_API_INTERN void CL_CALLBACK libxstream_hostfn_notify(cl_event event, cl_int event_status, void* data)
+{ /* runs on a thread of the OpenCL runtime: hand over rather than run */
+  libxstream_hostfn_item_t* const item = (libxstream_hostfn_item_t*)data;
+  libxstream_hostfn_pool_t* const pool = item->pool;
+  int direct = 1;
+  assert(NULL != pool);
+  item->status = event_status;
+  item->next = NULL;
+# if !defined(_WIN32)
+  if (0 < pool->nthreads) {
+    pthread_mutex_lock(&pool->mutex);
+    if (0 == pool->shutdown) {
+      if (NULL != pool->tail) pool->tail->next = item;
+      else pool->head = item;
+      pool->tail = item;
+      pthread_cond_signal(&pool->cond);
+      direct = 0;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+  }
+# endif
+  if (0 != direct) libxstream_hostfn_run(item); /* workers were shut down (libxstream_finalize) */
+  LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(event));
+}
+
+
+# if !defined(_WIN32)
+LIBXSTREAM_API_INTERN void* libxstream_hostfn_worker(void* /*arg*/);
+LIBXSTREAM_API_INTERN void* libxstream_hostfn_worker(void* arg)
+{
+  libxstream_hostfn_pool_t* const pool = (libxstream_hostfn_pool_t*)arg;
+  for (;;) {
+    libxstream_hostfn_item_t* item;
+    pthread_mutex_lock(&pool->mutex);
+    while (NULL == pool->head && 0 == pool->shutdown) pthread_cond_wait(&pool->cond, &pool->mutex);
+    item = pool->head; /* drain before leaving */
+    if (NULL != item) {
+      pool->head = item->next;
+      if (NULL == pool->head) pool->tail = NULL;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    if (NULL != item) libxstream_hostfn_run(item);
+    else break; /* shutdown */
+  }
+  return NULL;
+}
+# endif
+
+
+LIBXSTREAM_API_INTERN libxstream_hostfn_pool_t* libxstream_hostfn_pool(void);
+LIBXSTREAM_API_INTERN libxstream_hostfn_pool_t* libxstream_hostfn_pool(void)
+{
+  libxstream_hostfn_pool_t* result = libxstream_opencl_config.hostfn;
+  if (NULL == result) { /* start workers on first use */
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_main);
+    result = libxstream_opencl_config.hostfn;
+    if (NULL == result) {
+      result = (libxstream_hostfn_pool_t*)calloc(1, sizeof(libxstream_hostfn_pool_t));
+      if (NULL != result) {
+# if !defined(_WIN32)
+        const int nthreads = LIBXS_MIN(LIBXS_MAX(libxstream_opencl_config.nhostfn, 0), LIBXSTREAM_HOSTFN_MAXNTHREADS);
+        if (0 < nthreads && 0 == pthread_mutex_init(&result->mutex, NULL)) {
+          if (0 == pthread_cond_init(&result->cond, NULL)) {
+            for (; result->nthreads < nthreads; ++result->nthreads) {
+              if (0 != pthread_create(result->threads + result->nthreads, NULL, libxstream_hostfn_worker, result)) break;
+            }
+          }
+          if (0 == result->nthreads) {
+            pthread_mutex_destroy(&result->mutex);
+          }
+        }
+# endif
+        if (0 == result->nthreads && 0 != libxstream_opencl_config.verbosity) {
+          fprintf(stderr, "WARN ACC/OpenCL: no worker for host functions, which are refused.\n");
+        }
+        libxstream_opencl_config.hostfn = result;
+      }
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_main);
+  }
+  return result;
+}
+
+
+LIBXSTREAM_API_INTERN void libxstream_hostfn_finalize(void)
+{
+  libxstream_hostfn_pool_t* const pool = libxstream_opencl_config.hostfn;
+  if (NULL != pool) {
+# if !defined(_WIN32)
+    if (0 < pool->nthreads) {
+      int i;
+      pthread_mutex_lock(&pool->mutex);
+      pool->shutdown = 1;
+      pthread_cond_broadcast(&pool->cond);
+      pthread_mutex_unlock(&pool->mutex);
+      for (i = 0; i < pool->nthreads; ++i) pthread_join(pool->threads[i], NULL);
+    }
+# endif
+    libxstream_opencl_config.hostfn = NULL;
+    /**
+     * A marker that has not completed still holds its callback, which then runs
+     * the function directly (shutdown) and must find the pool: it is abandoned
+     * rather than released, like the profile records at exit.
+     */
+    if (0 == pool->npending) {
+# if !defined(_WIN32)
+      if (0 < pool->nthreads) {
+        pthread_cond_destroy(&pool->cond);
+        pthread_mutex_destroy(&pool->mutex);
+      }
+# endif
+      free(pool);
+    }
+  }
+}
+
+
+LIBXSTREAM_API int libxstream_stream_enqueue_host_fn(libxstream_stream_t* stream, libxstream_host_fn_t fn, void* arg)
+{
+  int result = EXIT_SUCCESS;
+  const libxstream_opencl_stream_t* str = NULL;
+  libxstream_hostfn_pool_t* pool = NULL;
+  libxstream_hostfn_item_t* item = NULL;
+  cl_context context = NULL;
+  cl_event marker = NULL, gate = NULL;
+  str = (NULL != stream ? stream : libxstream_opencl_stream_default());
+  assert(NULL != str && NULL != str->queue);
+  if (NULL == fn || NULL != str->capture) { /* a graph records no host function */
+    result = EXIT_FAILURE;
+  }
+  else {
+    pool = libxstream_hostfn_pool();
+    item = (libxstream_hostfn_item_t*)malloc(sizeof(libxstream_hostfn_item_t));
+    /* without a worker, fn would run on a thread of the OpenCL runtime */
+    if (NULL == pool || 0 == pool->nthreads || NULL == item) result = EXIT_FAILURE;
+  }
+  CL_CHECK(result, clGetCommandQueueInfo(str->queue, CL_QUEUE_CONTEXT, sizeof(cl_context), &context, NULL));
+  if (EXIT_SUCCESS == result) gate = clCreateUserEvent(context, &result);
+  if (EXIT_SUCCESS == result) {
+    libxstream_opencl_stream_busy(str);
+# if defined(CL_VERSION_1_2)
+    result = clEnqueueMarkerWithWaitList(str->queue, 0, NULL, &marker);
+# else
+    result = clEnqueueMarker(str->queue, &marker);
+# endif
+  }
+  if (EXIT_SUCCESS == result) {
+    item->pool = pool;
+    item->fn = fn;
+    item->arg = arg;
+    item->gate = gate; /* reference released by libxstream_hostfn_run */
+    item->status = CL_COMPLETE;
+    LIBXS_ATOMIC_SIZE(LIBXS_ATOMIC_ADD_FETCH)(&pool->npending, 1, LIBXS_ATOMIC_RELAXED);
+    CL_CHECK(result, clRetainEvent(gate)); /* the barrier below may follow the callback */
+    CL_CHECK(result, clSetEventCallback(marker, CL_COMPLETE, libxstream_hostfn_notify, item));
+    if (EXIT_SUCCESS == result) { /* callback owns item and marker */
+      item = NULL;
+      marker = NULL;
+      /* later commands wait for the function; flush to have the marker complete at all */
+# if defined(CL_VERSION_1_2)
+      result = clEnqueueBarrierWithWaitList(str->queue, 1, &gate, NULL);
+# else
+      result = clEnqueueWaitForEvents(str->queue, 1, &gate);
+# endif
+      CL_CHECK(result, clFlush(str->queue));
+    }
+    else { /* nothing was gated: undo */
+      LIBXS_ATOMIC_SIZE(LIBXS_ATOMIC_SUB_FETCH)(&pool->npending, 1, LIBXS_ATOMIC_RELAXED);
+      LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(gate));
+    }
+  }
+  if (NULL != marker) LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(marker));
+  if (NULL != gate) LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(gate));
+  free(item);
+  CL_RETURN(result, "");
+}
+
+#endif /*__OPENCL*/
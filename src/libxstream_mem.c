@@ -18,11 +18,14 @@
 #     include <sys/sysctl.h>
 #   endif
 #   include <unistd.h>
+#   if defined(__linux__)
+#     include <sys/syscall.h>
+#   endif
 # endif
 
 # if !defined(LIBXSTREAM_MEM_ALLOC)
 #   if 1
-#     define LIBXSTREAM_MEM_ALLOC(SIZE, ALIGNMENT) libxs_malloc(libxstream_opencl_config.pool_hst, SIZE, ALIGNMENT)
+#     define LIBXSTREAM_MEM_ALLOC(SIZE, ALIGNMENT) libxs_malloc(libxstream_mem_hst_pool(), SIZE, ALIGNMENT)
 #     define LIBXSTREAM_MEM_FREE(PTR) libxs_free(PTR)
 #   else
 #     define LIBXSTREAM_MEM_ALLOC(SIZE, ALIGNMENT) aligned_alloc(ALIGNMENT, SIZE)
@@ -32,6 +35,16 @@
 # if !defined(LIBXSTREAM_MEM_ALIGNSCALE)
 #   define LIBXSTREAM_MEM_ALIGNSCALE 8
 # endif
+# if !defined(LIBXSTREAM_MEM_PACK_WGSIZE)
+#   define LIBXSTREAM_MEM_PACK_WGSIZE 64
+# endif
+/* items per size, and largest item measured for the batched H2D crossover */
+# if !defined(LIBXSTREAM_MEM_BATCH_NCALIB)
+#   define LIBXSTREAM_MEM_BATCH_NCALIB 8
+# endif
+# if !defined(LIBXSTREAM_MEM_BATCH_MAXSIZE)
+#   define LIBXSTREAM_MEM_BATCH_MAXSIZE (256 << 10)
+# endif
 # if !defined(LIBXSTREAM_MEM_SVM_INTEL) && 0
 #   define LIBXSTREAM_MEM_SVM_INTEL
 # endif
@@ -57,7 +70,7 @@ LIBXSTREAM_API_INTERN int libxstream_memptr_register(cl_mem memory, void** mempt
     "  const size_t i = get_global_id(0);\n"
     "  ptr[i] = cast.u + i;\n"
     "}\n";
-  libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
   libxstream_opencl_info_memptr_t* info = NULL;
   const size_t size = 1;
   int result = EXIT_SUCCESS;
@@ -149,12 +162,63 @@ LIBXSTREAM_API_INTERN void libxstream_mem_host_unregister(void* memptr)
 }
 
 
+/**
+ * NUMA node of the calling thread, or negative if unknown. The thread may move
+ * later on, i.e., the node only matters at the time memory is placed.
+ */
+LIBXSTREAM_API_INTERN int libxstream_mem_hst_node(void);
+LIBXSTREAM_API_INTERN int libxstream_mem_hst_node(void)
+{
+  int result = -1;
+# if defined(__linux__) && defined(SYS_getcpu)
+  unsigned int cpu = 0, node = 0;
+  if (0 == syscall(SYS_getcpu, &cpu, &node, NULL)) result = (int)node;
+# endif
+  return result;
+}
+
+
+LIBXSTREAM_API_INTERN libxs_malloc_pool_t* libxstream_mem_hst_pool(void)
+{
+  libxs_malloc_pool_t* result = libxstream_opencl_config.pool_hst;
+  if (1 < libxstream_opencl_config.nnodes) {
+    /* device's node (LIBXSTREAM_NUMA=2) if known, calling thread's node otherwise */
+    int node = (2 == libxstream_opencl_config.numa ? libxstream_opencl_device()->numa : -1);
+    if (0 > node) node = libxstream_mem_hst_node();
+    if (0 <= node && node < libxstream_opencl_config.nnodes && NULL != libxstream_opencl_config.pool_hst_node[node]) {
+      result = libxstream_opencl_config.pool_hst_node[node];
+    }
+  }
+  return result;
+}
+
+
+/**
+ * The node's preference is installed for the calling thread while xmalloc runs,
+ * which also covers memory the runtime allocates on behalf of this thread, and
+ * malloc'ed pages are touched so the preference takes effect (first touch).
+ * Preferred rather than bound: a full node falls back instead of failing.
+ */
 LIBXSTREAM_API_INTERN void* libxstream_mem_hst_xmalloc(size_t size, const void* extra)
 {
   const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  const int node = (NULL != extra ? *(const int*)extra : -1);
   void* result = NULL;
   int status = EXIT_SUCCESS;
-  LIBXS_UNUSED(extra);
+# if defined(__linux__) && defined(SYS_get_mempolicy) && defined(SYS_set_mempolicy)
+  unsigned long mask[1024 / (8 * sizeof(unsigned long))], mask_saved[1024 / (8 * sizeof(unsigned long))];
+  const unsigned long maxnode = 8 * sizeof(mask);
+  int mode_saved = -1;
+  if (0 <= node && node < (int)maxnode) {
+    memset(mask, 0, sizeof(mask));
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    if (0 != syscall(SYS_get_mempolicy, &mode_saved, mask_saved, maxnode, NULL, 0) ||
+        0 != syscall(SYS_set_mempolicy, 1 /*MPOL_PREFERRED*/, mask, maxnode))
+    {
+      mode_saved = -1;
+    }
+  }
+# endif
   if (libxstream_opencl_mem_hst_unknown == libxstream_opencl_config.mem_hst) {
     LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
     if (libxstream_opencl_mem_hst_unknown == libxstream_opencl_config.mem_hst) {
@@ -243,6 +307,22 @@ LIBXSTREAM_API_INTERN void* libxstream_mem_hst_xmalloc(size_t size, const void*
     } break;
   }
   if (EXIT_SUCCESS != status) result = NULL;
+  if (NULL != result && 0 <= node && node < libxstream_opencl_config.nnodes) {
+# if defined(__linux__) && defined(_SC_PAGE_SIZE)
+    if (libxstream_opencl_mem_hst_malloc == libxstream_opencl_config.mem_hst) {
+      const long page_size = sysconf(_SC_PAGE_SIZE);
+      const size_t stride = (0 < page_size ? (size_t)page_size : 4096);
+      size_t offset = 0;
+      for (; offset < size; offset += stride) ((volatile char*)result)[offset] = 0;
+    }
+# endif
+    LIBXS_ATOMIC_SIZE(LIBXS_ATOMIC_ADD_FETCH)(libxstream_opencl_config.pool_hst_nbytes + node, size, LIBXS_ATOMIC_RELAXED);
+  }
+# if defined(__linux__) && defined(SYS_get_mempolicy) && defined(SYS_set_mempolicy)
+  if (0 <= mode_saved) {
+    LIBXS_ELIDE_RESULT(long, syscall(SYS_set_mempolicy, mode_saved, mask_saved, maxnode));
+  }
+# endif
   /**
    * Registered here rather than per libxs_malloc, because the pool hands out
    * pointers into these blocks: registration is page-granular, so two
@@ -287,13 +367,14 @@ LIBXSTREAM_API_INTERN void libxstream_mem_hst_xfree(void* pointer, const void* e
 
 LIBXSTREAM_API_INTERN void* libxstream_mem_dev_xmalloc(size_t size, const void* extra)
 {
-  const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  /* the pool is per device, and its xmalloc runs on the allocating thread */
+  const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
   void* result = NULL;
   int status = EXIT_SUCCESS;
   LIBXS_UNUSED(extra);
 # if (1 >= LIBXSTREAM_USM)
   if (NULL != devinfo->clDeviceMemAllocINTEL) {
-    const cl_device_id did = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
+    const cl_device_id did = libxstream_opencl_config.devices[devinfo->device_id];
 #   if defined(LIBXSTREAM_XHINTS)
     if (0 != (8 & libxstream_opencl_config.xhints) && 0 != devinfo->intel && 0 == devinfo->unified) {
       const cl_ulong props[] = {0x4195 /*CL_MEM_ALLOC_FLAGS_INTEL*/, (1u << 22), 0};
@@ -307,7 +388,7 @@ LIBXSTREAM_API_INTERN void* libxstream_mem_dev_xmalloc(size_t size, const void*
     }
   }
   else if (NULL != devinfo->clSharedMemAllocINTEL) {
-    const cl_device_id did = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
+    const cl_device_id did = libxstream_opencl_config.devices[devinfo->device_id];
 #   if defined(LIBXSTREAM_XHINTS)
     if (0 != (8 & libxstream_opencl_config.xhints) && 0 != devinfo->intel && 0 == devinfo->unified) {
       const cl_ulong props[] = {0x4195 /*CL_MEM_ALLOC_FLAGS_INTEL*/, (1u << 22), 0};
@@ -348,7 +429,7 @@ LIBXSTREAM_API_INTERN void* libxstream_mem_dev_xmalloc(size_t size, const void*
 
 LIBXSTREAM_API_INTERN void libxstream_mem_dev_xfree(void* pointer, const void* extra)
 {
-  const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device_owner(pointer);
   /**
    * The stream recorded at allocation time need not outlive the buffer: the
    * pool is drained at finalization, after the application destroyed its
@@ -398,9 +479,138 @@ LIBXSTREAM_API_INTERN void libxstream_opencl_subbuffer_release(cl_mem parent)
 }
 
 
-LIBXSTREAM_API int libxstream_mem_dev_allocate_hint(void** dev_mem, size_t nbytes, libxstream_opencl_mem_hint_t hint)
+/** Slot of a live allocation (libxstream_opencl_tag_ptr_t); capacity is a power of two. */
+#define LIBXSTREAM_MEM_TAG_SLOT(POINTER, CAPACITY) \
+  ((size_t)(((uintptr_t)(POINTER) >> 6) * 2654435761u) & ((CAPACITY) - 1))
+
+
+/** Tag stack of the calling thread, or NULL (accounting disabled or thread beyond nthreads). */
+LIBXSTREAM_API_INTERN libxstream_opencl_tag_stack_t* libxstream_mem_tag_stack(void);
+LIBXSTREAM_API_INTERN libxstream_opencl_tag_stack_t* libxstream_mem_tag_stack(void)
+{
+  const int tid = libxs_tid();
+  return ((NULL != libxstream_opencl_config.tag_stack && 0 <= tid && tid < libxstream_opencl_config.nthreads)
+            ? (libxstream_opencl_config.tag_stack + tid)
+            : NULL);
+}
+
+
+/**
+ * Grow the table of live allocations to keep it at most half full (linear
+ * probing). The caller holds lock_memtag. A failed growth leaves the table as
+ * is, and an allocation that does not fit is simply not accounted.
+ */
+LIBXSTREAM_API_INTERN void libxstream_mem_tag_grow(void);
+LIBXSTREAM_API_INTERN void libxstream_mem_tag_grow(void)
+{
+  const size_t n = libxstream_opencl_config.ntag_ptrs, m = LIBXS_MAX(2 * n, (size_t)1024);
+  libxstream_opencl_tag_ptr_t* const ptrs = (libxstream_opencl_tag_ptr_t*)calloc(m, sizeof(libxstream_opencl_tag_ptr_t));
+  if (NULL != ptrs) {
+    size_t i = 0;
+    for (; i < n; ++i) {
+      const libxstream_opencl_tag_ptr_t* const entry = libxstream_opencl_config.tag_ptrs + i;
+      if (NULL != entry->pointer) {
+        size_t j = LIBXSTREAM_MEM_TAG_SLOT(entry->pointer, m);
+        while (NULL != ptrs[j].pointer) j = (j + 1) & (m - 1);
+        ptrs[j] = *entry;
+      }
+    }
+    free(libxstream_opencl_config.tag_ptrs);
+    libxstream_opencl_config.tag_ptrs = ptrs;
+    libxstream_opencl_config.ntag_ptrs = m;
+  }
+}
+
+
+LIBXSTREAM_API_INTERN void libxstream_mem_tag_alloc(const void* memory, size_t nbytes)
+{
+  if (NULL != memory && 0 != libxstream_opencl_config.memtag) {
+    const libxstream_opencl_tag_stack_t* const stack = libxstream_mem_tag_stack();
+    const int tag = ((NULL != stack && 0 < stack->n) ? stack->tag[LIBXS_MIN(stack->n, LIBXSTREAM_MEM_NTAGDEPTH) - 1] : 0);
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memtag);
+    if (libxstream_opencl_config.ntag_ptrs < 2 * (libxstream_opencl_config.ntag_live + 1)) libxstream_mem_tag_grow();
+    if (libxstream_opencl_config.ntag_live + 1 < libxstream_opencl_config.ntag_ptrs) {
+      const size_t mask = libxstream_opencl_config.ntag_ptrs - 1;
+      libxstream_opencl_tag_t* const info = libxstream_opencl_config.tags + tag;
+      size_t i = LIBXSTREAM_MEM_TAG_SLOT(memory, libxstream_opencl_config.ntag_ptrs);
+      while (NULL != libxstream_opencl_config.tag_ptrs[i].pointer) i = (i + 1) & mask;
+      libxstream_opencl_config.tag_ptrs[i].pointer = memory;
+      libxstream_opencl_config.tag_ptrs[i].nbytes = nbytes;
+      libxstream_opencl_config.tag_ptrs[i].tag = tag;
+      ++libxstream_opencl_config.ntag_live;
+      libxstream_opencl_config.mem_live += nbytes;
+      info->live += nbytes;
+      if (info->peak < info->live) info->peak = info->live;
+      ++info->nallocs;
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memtag);
+  }
+}
+
+
+LIBXSTREAM_API_INTERN void libxstream_mem_tag_free(const void* memory)
+{
+  if (NULL != memory && 0 != libxstream_opencl_config.memtag) {
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memtag);
+    if (0 != libxstream_opencl_config.ntag_live) {
+      libxstream_opencl_tag_ptr_t* const ptrs = libxstream_opencl_config.tag_ptrs;
+      const size_t mask = libxstream_opencl_config.ntag_ptrs - 1;
+      size_t i = LIBXSTREAM_MEM_TAG_SLOT(memory, libxstream_opencl_config.ntag_ptrs), j;
+      while (NULL != ptrs[i].pointer && memory != ptrs[i].pointer) i = (i + 1) & mask;
+      if (NULL != ptrs[i].pointer) {
+        libxstream_opencl_config.tags[ptrs[i].tag].live -= ptrs[i].nbytes;
+        libxstream_opencl_config.mem_live -= ptrs[i].nbytes;
+        --libxstream_opencl_config.ntag_live;
+        /* backward-shift deletion: close the gap for entries probed past slot i */
+        for (j = (i + 1) & mask; NULL != ptrs[j].pointer; j = (j + 1) & mask) {
+          const size_t k = LIBXSTREAM_MEM_TAG_SLOT(ptrs[j].pointer, libxstream_opencl_config.ntag_ptrs);
+          if (i <= j ? (k <= i || j < k) : (k <= i && j < k)) {
+            ptrs[i] = ptrs[j];
+            i = j;
+          }
+        }
+        LIBXS_MEMZERO(ptrs + i);
+      }
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memtag);
+  }
+}
+
+
+/**
+ * Admit an allocation of nbytes against the budget, asking the reclaimers for
+ * the excess first. The budget is checked rather than reserved, i.e., threads
+ * allocating concurrently may exceed it by what they allocate at once.
+ */
+LIBXSTREAM_API_INTERN int libxstream_mem_budget(size_t /*nbytes*/);
+LIBXSTREAM_API_INTERN int libxstream_mem_budget(size_t nbytes)
+{
+  const size_t budget = libxstream_opencl_config.mem_budget;
+  int result = EXIT_SUCCESS;
+  if (0 != budget && 0 != nbytes) {
+    const size_t live = LIBXS_ATOMIC_LOAD(&libxstream_opencl_config.mem_live, LIBXS_ATOMIC_RELAXED);
+    if (budget < live + nbytes) {
+      if (nbytes <= budget) LIBXS_ELIDE_RESULT(size_t, libxstream_mem_reclaim(live + nbytes - budget));
+      if (budget < LIBXS_ATOMIC_LOAD(&libxstream_opencl_config.mem_live, LIBXS_ATOMIC_RELAXED) + nbytes) {
+        LIBXS_ATOMIC_SIZE(LIBXS_ATOMIC_ADD_FETCH)(&libxstream_opencl_config.nbudget_denied, 1, LIBXS_ATOMIC_RELAXED);
+        if (0 != libxstream_opencl_config.verbosity) {
+          fprintf(stderr, "ERROR ACC/OpenCL: size=%llu exceeds the budget of %i MB (%i MB live)\n", (unsigned long long)nbytes,
+            (int)(budget >> 20), (int)LIBXS_UPDIV(libxstream_opencl_config.mem_live, (size_t)1 << 20));
+        }
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+  return result;
+}
+
+
+LIBXSTREAM_API_INTERN int libxstream_mem_dev_allocate_hint_internal(
+  void** /*dev_mem*/, size_t /*nbytes*/, libxstream_opencl_mem_hint_t /*hint*/);
+LIBXSTREAM_API_INTERN int libxstream_mem_dev_allocate_hint_internal(
+  void** dev_mem, size_t nbytes, libxstream_opencl_mem_hint_t hint)
 {
-  libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
   int result = EXIT_SUCCESS;
   void* memptr = NULL;
   assert(NULL != dev_mem && NULL != devinfo->context);
@@ -410,7 +620,7 @@ LIBXSTREAM_API int libxstream_mem_dev_allocate_hint(void** dev_mem, size_t nbyte
   if (0 != nbytes) {
 # if (1 >= LIBXSTREAM_USM)
     if (NULL != devinfo->clDeviceMemAllocINTEL) {
-      const cl_device_id did = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
+      const cl_device_id did = libxstream_opencl_config.devices[devinfo->device_id];
       cl_int status = CL_SUCCESS;
 #   if defined(LIBXSTREAM_XHINTS)
       if (libxstream_opencl_mem_hint_compress != hint && 0 != devinfo->intel && 0 == devinfo->unified) {
@@ -426,7 +636,7 @@ LIBXSTREAM_API int libxstream_mem_dev_allocate_hint(void** dev_mem, size_t nbyte
       }
     }
     else if (NULL != devinfo->clSharedMemAllocINTEL) {
-      const cl_device_id did = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
+      const cl_device_id did = libxstream_opencl_config.devices[devinfo->device_id];
       cl_int status = CL_SUCCESS;
 #   if defined(LIBXSTREAM_XHINTS)
       if (libxstream_opencl_mem_hint_compress != hint && 0 != devinfo->intel && 0 == devinfo->unified) {
@@ -481,15 +691,33 @@ LIBXSTREAM_API int libxstream_mem_dev_allocate_hint(void** dev_mem, size_t nbyte
     }
   }
   *dev_mem = memptr;
+  return result;
+}
+
+
+LIBXSTREAM_API int libxstream_mem_dev_allocate_hint(void** dev_mem, size_t nbytes, libxstream_opencl_mem_hint_t hint)
+{
+  int result = libxstream_mem_budget(nbytes);
+  assert(NULL != dev_mem);
+  if (EXIT_SUCCESS == result) {
+    result = libxstream_mem_dev_allocate_hint_internal(dev_mem, nbytes, hint);
+    if (EXIT_SUCCESS != result && 0 != libxstream_opencl_config.nreclaim) {
+      LIBXS_ELIDE_RESULT(size_t, libxstream_mem_reclaim(nbytes));
+      result = libxstream_mem_dev_allocate_hint_internal(dev_mem, nbytes, hint);
+    }
+    if (EXIT_SUCCESS == result && NULL != *dev_mem) libxstream_mem_tag_alloc(*dev_mem, nbytes);
+  }
+  else *dev_mem = NULL;
   CL_RETURN(result, "");
 }
 
 
 LIBXSTREAM_API int libxstream_mem_dev_deallocate_hint(void* dev_mem)
 {
-  const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device_owner(dev_mem);
   int result = EXIT_SUCCESS;
   if (NULL != dev_mem) {
+    libxstream_mem_tag_free(dev_mem);
 # if (1 >= LIBXSTREAM_USM)
     if (NULL != devinfo->clMemFreeINTEL) {
       result = devinfo->clMemFreeINTEL(devinfo->context, dev_mem);
@@ -505,7 +733,7 @@ LIBXSTREAM_API int libxstream_mem_dev_deallocate_hint(void* dev_mem)
     {
       libxstream_opencl_info_memptr_t* info = NULL;
       LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
-      info = libxstream_opencl_info_devptr_modify(NULL, dev_mem, 1, NULL, NULL);
+      info = libxstream_opencl_info_devptr_modify(devinfo, NULL, dev_mem, 1, NULL, NULL);
       if (NULL != info && info->memptr == dev_mem && NULL != info->memory) {
         libxstream_opencl_info_memptr_t* const pfree = libxstream_opencl_config.memptrs[libxstream_opencl_config.nmemptrs];
         /* sub-buffers of this buffer are owned here (see libxstream_opencl_subbuffer) */
@@ -522,6 +750,139 @@ LIBXSTREAM_API int libxstream_mem_dev_deallocate_hint(void* dev_mem)
 }
 
 
+LIBXSTREAM_API void libxstream_mem_arena_init(libxstream_mem_arena_t* arena, size_t limit, libxstream_opencl_mem_hint_t hint)
+{
+  assert(NULL != arena);
+  LIBXS_MEMZERO(arena);
+  arena->limit = limit;
+  arena->hint = hint;
+  arena->owned = 1;
+}
+
+
+LIBXSTREAM_API void libxstream_mem_arena_destroy(libxstream_mem_arena_t* arena)
+{
+  if (NULL != arena) {
+    if (0 != arena->owned && NULL != arena->ptr) {
+      libxstream_mem_dev_deallocate_hint(arena->ptr);
+    }
+    arena->ptr = NULL;
+    arena->size = arena->used = 0;
+  }
+}
+
+
+/**
+ * Growth happens here and nowhere else: a reallocation part-way through a call
+ * would dangle the pieces already handed out. Resizing frees the previous
+ * arena without waiting for the device: the claim succeeded, so the previous
+ * holder has released it, and a release only follows the completion of the
+ * stream that used its pieces.
+ */
+LIBXSTREAM_API int libxstream_mem_arena_claim(libxstream_mem_arena_t* arena, size_t nbytes)
+{
+  int result = 0;
+  if (NULL != arena && 0 != arena->limit && 0 != LIBXS_ATOMIC_TRYLOCK(&arena->busy, LIBXS_ATOMIC_LOCKORDER)) {
+    arena->used = 0;
+    if (arena->window < nbytes) arena->window = nbytes;
+    if (arena->peak < nbytes) arena->peak = nbytes;
+    if (0 != arena->owned && nbytes <= arena->limit) {
+      size_t size = 0;
+      if (arena->size < nbytes) { /* grow: by half again at least, within the limit */
+        size = LIBXS_MIN(
+          LIBXS_UP2(LIBXS_MAX(nbytes, arena->size + arena->size / 2), LIBXSTREAM_MEM_ARENA_ALIGN), arena->limit);
+        arena->nclaims = 0;
+      }
+      else if (LIBXSTREAM_MEM_ARENA_WINDOW <= ++arena->nclaims) { /* shrink: the whole window stayed below a quarter */
+        if (arena->window < arena->size / 4) size = LIBXS_UP2(arena->window + arena->window / 2, LIBXSTREAM_MEM_ARENA_ALIGN);
+        arena->window = nbytes;
+        arena->nclaims = 0;
+      }
+      if (0 != size) {
+        void* ptr = NULL;
+        if (EXIT_SUCCESS == libxstream_mem_dev_allocate_hint(&ptr, size, arena->hint)) {
+          if (arena->size < size) ++arena->ngrow;
+          else ++arena->nshrink;
+          if (NULL != arena->ptr) libxstream_mem_dev_deallocate_hint(arena->ptr);
+          arena->ptr = ptr;
+          arena->size = size;
+        }
+      }
+    }
+    if (NULL != arena->ptr) result = 1; /* pieces beyond its size are allocated per buffer */
+    else LIBXS_ATOMIC_RELEASE(&arena->busy, LIBXS_ATOMIC_LOCKORDER);
+  }
+  return result;
+}
+
+
+LIBXSTREAM_API void* libxstream_mem_arena_alloc(libxstream_mem_arena_t* arena, size_t nbytes)
+{
+  const size_t need = LIBXS_UP2(nbytes, LIBXSTREAM_MEM_ARENA_ALIGN);
+  void* result = NULL;
+  assert(NULL != arena);
+  if (NULL != arena->ptr && need <= (arena->size - arena->used)) {
+    result = (char*)arena->ptr + arena->used;
+    arena->used += need;
+  }
+  return result;
+}
+
+
+LIBXSTREAM_API int libxstream_mem_arena_release(libxstream_mem_arena_t* arena, libxstream_stream_t* stream)
+{
+  int result = EXIT_SUCCESS;
+  assert(NULL != arena);
+  if (NULL != stream) result = libxstream_stream_sync(stream);
+  arena->used = 0;
+  LIBXS_ATOMIC_RELEASE(&arena->busy, LIBXS_ATOMIC_LOCKORDER);
+  return result;
+}
+
+
+LIBXSTREAM_API int libxstream_mem_arena_owns(const libxstream_mem_arena_t* arena, const void* ptr)
+{
+  return (NULL != arena && NULL != arena->ptr && NULL != ptr && (const char*)ptr >= (const char*)arena->ptr &&
+          (const char*)ptr < ((const char*)arena->ptr + arena->size));
+}
+
+
+LIBXSTREAM_API int libxstream_mem_arena_set(libxstream_mem_arena_t* arena, void* dev_mem, size_t nbytes)
+{
+  assert(NULL != arena);
+  LIBXS_ATOMIC_ACQUIRE(&arena->busy, LIBXS_SYNC_NPAUSE, LIBXS_ATOMIC_LOCKORDER);
+  if (0 != arena->owned && NULL != arena->ptr) {
+    libxstream_mem_dev_deallocate_hint(arena->ptr);
+  }
+  arena->ptr = dev_mem;
+  arena->size = (NULL != dev_mem) ? nbytes : 0;
+  arena->used = 0;
+  arena->owned = (NULL != dev_mem) ? 0 : 1;
+  LIBXS_ATOMIC_RELEASE(&arena->busy, LIBXS_ATOMIC_LOCKORDER);
+  return EXIT_SUCCESS;
+}
+
+
+LIBXSTREAM_API size_t libxstream_mem_arena_trim(libxstream_mem_arena_t* arena)
+{
+  size_t result = 0;
+  if (NULL != arena && 0 != arena->owned && NULL != arena->ptr &&
+      0 != LIBXS_ATOMIC_TRYLOCK(&arena->busy, LIBXS_ATOMIC_LOCKORDER))
+  {
+    if (0 != arena->owned && NULL != arena->ptr) {
+      libxstream_mem_dev_deallocate_hint(arena->ptr);
+      result = arena->size;
+      arena->ptr = NULL;
+      arena->size = 0;
+      arena->window = 0;
+      arena->nclaims = 0;
+    }
+    LIBXS_ATOMIC_RELEASE(&arena->busy, LIBXS_ATOMIC_LOCKORDER);
+  }
+  return result;
+}
+
+
 LIBXSTREAM_API libxstream_opencl_info_memptr_t* libxstream_opencl_info_hostptr(const void* memory)
 {
   libxstream_opencl_info_memptr_t* result = NULL;
@@ -539,23 +900,24 @@ LIBXSTREAM_API libxstream_opencl_info_memptr_t* libxstream_opencl_info_hostptr(c
 
 
 LIBXSTREAM_API libxstream_opencl_info_memptr_t* libxstream_opencl_info_devptr_modify(
-  libxs_lock_t* lock, void* memory, size_t elsize, const size_t* amount, size_t* offset)
+  const libxstream_opencl_device_t* device, libxs_lock_t* lock, void* memory, size_t elsize, const size_t* amount, size_t* offset)
 {
+  const libxstream_opencl_device_t* const devinfo = (NULL != device ? device : libxstream_opencl_device());
   libxstream_opencl_info_memptr_t* result = NULL;
 # if !defined(LIBXSTREAM_MEM_DEBUG)
   LIBXS_UNUSED(amount);
 # endif
   if (NULL != memory) {
-    assert(NULL != libxstream_opencl_config.device.context);
+    assert(NULL != devinfo->context);
     if (/* USM-pointer */
 # if (0 != LIBXSTREAM_USM)
-      0 != libxstream_opencl_config.device.usm ||
+      0 != devinfo->usm ||
 # endif
-      NULL != libxstream_opencl_config.device.clDeviceMemAllocINTEL ||
-      NULL != libxstream_opencl_config.device.clSharedMemAllocINTEL)
+      NULL != devinfo->clDeviceMemAllocINTEL ||
+      NULL != devinfo->clSharedMemAllocINTEL)
     { /* assume only first item of libxstream_opencl_info_memptr_t is accessed */
-      assert(0 != libxstream_opencl_config.device.usm || NULL != libxstream_opencl_config.device.clDeviceMemAllocINTEL ||
-        NULL != libxstream_opencl_config.device.clSharedMemAllocINTEL);
+      assert(0 != devinfo->usm || NULL != devinfo->clDeviceMemAllocINTEL ||
+        NULL != devinfo->clSharedMemAllocINTEL);
       result = NULL; /*(libxstream_opencl_info_memptr_t*)memory*/
       if (NULL != offset) *offset = 0;
     }
@@ -564,8 +926,8 @@ LIBXSTREAM_API libxstream_opencl_info_memptr_t* libxstream_opencl_info_devptr_mo
       const size_t n = LIBXSTREAM_MAXNITEMS * libxstream_opencl_config.nthreads;
       size_t hit = (size_t)-1, i;
       const libxstream_opencl_info_memptr_t* miss = NULL;
-      assert(0 == libxstream_opencl_config.device.usm && NULL == libxstream_opencl_config.device.clDeviceMemAllocINTEL &&
-        NULL == libxstream_opencl_config.device.clSharedMemAllocINTEL);
+      assert(0 == devinfo->usm && NULL == devinfo->clDeviceMemAllocINTEL &&
+        NULL == devinfo->clSharedMemAllocINTEL);
       assert(NULL != libxstream_opencl_config.memptrs);
       if (NULL != lock) LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, lock);
       for (i = libxstream_opencl_config.nmemptrs; i < n; ++i) {
@@ -621,19 +983,20 @@ LIBXSTREAM_API libxstream_opencl_info_memptr_t* libxstream_opencl_info_devptr_mo
 LIBXSTREAM_API int libxstream_opencl_info_devptr_lock(libxstream_opencl_info_memptr_t* info, libxs_lock_t* lock, const void* memory,
   size_t elsize, const size_t* amount, size_t* offset)
 {
+  const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
   const libxstream_opencl_info_memptr_t* meminfo = NULL;
   int result = EXIT_SUCCESS;
   void* non_const;
   LIBXS_UNION_ASSIGN(void*, non_const, const void*, memory);
-  meminfo = libxstream_opencl_info_devptr_modify(lock, non_const, elsize, amount, offset);
+  meminfo = libxstream_opencl_info_devptr_modify(NULL /*device*/, lock, non_const, elsize, amount, offset);
   assert(NULL != info);
   if (NULL == meminfo) { /* USM-pointer */
     if (
 # if (0 != LIBXSTREAM_USM)
-      0 != libxstream_opencl_config.device.usm ||
+      0 != devinfo->usm ||
 # endif
-      NULL != libxstream_opencl_config.device.clDeviceMemAllocINTEL ||
-      NULL != libxstream_opencl_config.device.clSharedMemAllocINTEL)
+      NULL != devinfo->clDeviceMemAllocINTEL ||
+      NULL != devinfo->clSharedMemAllocINTEL)
     {
       LIBXS_MEMZERO(info);
       info->memory = (cl_mem)non_const;
@@ -641,7 +1004,7 @@ LIBXSTREAM_API int libxstream_opencl_info_devptr_lock(libxstream_opencl_info_mem
     else result = EXIT_FAILURE;
   }
   else { /* info-augmented pointer */
-    assert(NULL != libxstream_opencl_config.device.context);
+    assert(NULL != devinfo->context);
     LIBXS_ASSIGN(info, meminfo);
     info->memory = (cl_mem)meminfo->memptr;
   }
@@ -652,11 +1015,12 @@ LIBXSTREAM_API int libxstream_opencl_info_devptr_lock(libxstream_opencl_info_mem
 LIBXSTREAM_API int libxstream_opencl_info_devptr(
   libxstream_opencl_info_memptr_t* info, const void* memory, size_t elsize, const size_t* amount, size_t* offset)
 {
+  const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
   libxs_lock_t* const lock_memory = ((
 # if (0 != LIBXSTREAM_USM)
-                                       0 != libxstream_opencl_config.device.usm ||
+                                       0 != devinfo->usm ||
 # endif
-                                       NULL != libxstream_opencl_config.device.clSetKernelArgMemPointerINTEL)
+                                       NULL != devinfo->clSetKernelArgMemPointerINTEL)
                                        ? NULL /* no lock required */
                                        : libxstream_opencl_config.lock_memory);
   return libxstream_opencl_info_devptr_lock(info, lock_memory, memory, elsize, amount, offset);
@@ -714,7 +1078,7 @@ LIBXSTREAM_API int libxstream_mem_host_allocate(void** host_mem, size_t nbytes,
 # endif
         NULL == devinfo->context))
     {
-      result_ptr = libxs_malloc(libxstream_opencl_config.pool_hst, nbytes, LIBXS_MALLOC_NATIVE);
+      result_ptr = libxs_malloc(libxstream_mem_hst_pool(), nbytes, LIBXS_MALLOC_NATIVE);
     }
     else if (NULL != devinfo->context) {
       const libxstream_opencl_stream_t* str;
@@ -726,6 +1090,8 @@ LIBXSTREAM_API int libxstream_mem_host_allocate(void** host_mem, size_t nbytes,
       int memflags = CL_MEM_ALLOC_HOST_PTR;
       str = (NULL != stream ? stream : libxstream_opencl_stream_default());
       assert(NULL != str);
+      /* host memory is pinned against the active device, hence mapped on its queue */
+      if (devinfo != str->devinfo) str = &devinfo->stream;
       if ((LIBXSTREAM_MEM_ALIGNSCALE * LIBXS_CACHELINE) <= nbytes) {
         const int a = ((LIBXSTREAM_MEM_ALIGNSCALE * LIBXSTREAM_MAXALIGN) <= nbytes ? LIBXSTREAM_MAXALIGN : LIBXS_CACHELINE);
         if (alignment < a) alignment = a;
@@ -781,16 +1147,18 @@ LIBXSTREAM_API int libxstream_mem_host_deallocate(void* host_mem, libxstream_str
       libxs_free(host_mem);
     }
     else { /* info-augmented pointer (clCreateBuffer path) */
-      const libxstream_opencl_stream_t* const str = (NULL != stream ? stream : libxstream_opencl_stream_default());
+      const libxstream_opencl_stream_t* str = (NULL != stream ? stream : libxstream_opencl_stream_default());
       const libxstream_opencl_info_memptr_t info = *meminfo;
       int result_release = EXIT_SUCCESS;
       void* host_ptr = NULL;
       assert(NULL != str);
+      if (&libxstream_opencl_config.device != str->devinfo) str = &libxstream_opencl_config.device.stream;
       libxstream_mem_host_unregister(info.memptr);
       if (EXIT_SUCCESS == clGetMemObjectInfo(info.memory, CL_MEM_HOST_PTR, sizeof(void*), &host_ptr, NULL) && NULL != host_ptr) {
         LIBXSTREAM_MEM_FREE(host_ptr);
       }
       else {
+        libxstream_opencl_stream_busy(str);
         result = clEnqueueUnmapMemObject(str->queue, info.memory, info.memptr, 0, NULL, NULL);
       }
       result_release = clReleaseMemObject(info.memory);
@@ -862,6 +1230,10 @@ LIBXSTREAM_API_INTERN void CL_CALLBACK libxstream_mem_copy_notify(cl_event event
           hist = libxstream_opencl_config.hist_zero;
           name = "ZERO";
         } break;
+        case libxstream_event_kind_p2p: {
+          hist = libxstream_opencl_config.hist_p2p;
+          name = "P2P";
+        } break;
         default: assert(libxstream_event_kind_none == kind); /* should not happen */
       }
     }
@@ -893,53 +1265,73 @@ LIBXSTREAM_API_INTERN void CL_CALLBACK libxstream_mem_copy_notify(cl_event event
 }
 
 
-LIBXSTREAM_API int libxstream_mem_allocate(void** dev_mem, size_t nbytes)
+/** Allocate device memory (pool or buffer), report: print an error if the runtime fails. */
+LIBXSTREAM_API_INTERN void* libxstream_mem_dev_allocate(
+  libxstream_opencl_device_t* /*devinfo*/, libxs_malloc_pool_t* /*pool*/, size_t /*nbytes*/, int /*report*/);
+LIBXSTREAM_API_INTERN void* libxstream_mem_dev_allocate(
+  libxstream_opencl_device_t* devinfo, libxs_malloc_pool_t* pool, size_t nbytes, int report)
 {
-  /* assume no lock is needed to protect against context/device changes */
-  libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
-  int result = EXIT_SUCCESS;
   void* memptr = NULL;
-  assert(NULL != dev_mem && NULL != devinfo->context);
-  if (0 != nbytes) {
-    if (NULL != libxstream_opencl_config.pool_dev && (
+  if (NULL != pool && (
 # if (1 >= LIBXSTREAM_USM)
-        NULL != devinfo->clDeviceMemAllocINTEL ||
-        NULL != devinfo->clSharedMemAllocINTEL ||
+      NULL != devinfo->clDeviceMemAllocINTEL ||
+      NULL != devinfo->clSharedMemAllocINTEL ||
 # endif
 # if (0 != LIBXSTREAM_USM)
-        0 != devinfo->usm ||
+      0 != devinfo->usm ||
 # endif
-        0 /*sentinel*/))
-    {
-      memptr = libxs_malloc(libxstream_opencl_config.pool_dev, nbytes, LIBXS_MALLOC_NATIVE);
-    }
-    else {
-      cl_mem memory = NULL;
+      0 /*sentinel*/))
+  {
+    memptr = libxs_malloc(pool, nbytes, LIBXS_MALLOC_NATIVE);
+  }
+  else {
+    int result = EXIT_SUCCESS;
+    cl_mem memory = NULL;
 # if defined(LIBXSTREAM_XHINTS)
-      const int devuid = devinfo->uid, devuids = (0x4905 == devuid || 0x020a == devuid || (0x0bd0 <= devuid && 0x0bdb >= devuid));
-      const int try_flag = ((0 != (8 & libxstream_opencl_config.xhints) && 0 != devinfo->intel && 0 == devinfo->unified &&
-                              (devuids || NULL != (LIBXSTREAM_XHINTS)))
-                              ? (1u << 22)
-                              : 0);
-      memory = clCreateBuffer(devinfo->context, (cl_mem_flags)(CL_MEM_READ_WRITE | try_flag), nbytes, NULL /*host_ptr*/, &result);
-      if (0 != try_flag && EXIT_SUCCESS != result) /* retry without try_flag */
+    const int devuid = devinfo->uid, devuids = (0x4905 == devuid || 0x020a == devuid || (0x0bd0 <= devuid && 0x0bdb >= devuid));
+    const int try_flag = ((0 != (8 & libxstream_opencl_config.xhints) && 0 != devinfo->intel && 0 == devinfo->unified &&
+                            (devuids || NULL != (LIBXSTREAM_XHINTS)))
+                            ? (1u << 22)
+                            : 0);
+    memory = clCreateBuffer(devinfo->context, (cl_mem_flags)(CL_MEM_READ_WRITE | try_flag), nbytes, NULL /*host_ptr*/, &result);
+    if (0 != try_flag && EXIT_SUCCESS != result) /* retry without try_flag */
 # endif
-      {
-        memory = clCreateBuffer(devinfo->context, CL_MEM_READ_WRITE, nbytes, NULL /*host_ptr*/, &result);
-      }
-      if (EXIT_SUCCESS == result) {
-        result = libxstream_memptr_register(memory, &memptr);
-      }
-      if (EXIT_SUCCESS != result) {
-        if (0 != libxstream_opencl_config.verbosity) {
-          fprintf(stderr, "ERROR ACC/OpenCL: memory=%p pointer=%p size=%llu failed to allocate (%s, code=%i)\n",
-            (const void*)memory, memptr, (unsigned long long)nbytes,
-            libxstream_opencl_strerror(result), result);
-        }
-        if (NULL != memory) LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseMemObject(memory));
-        memptr = NULL;
+    {
+      memory = clCreateBuffer(devinfo->context, CL_MEM_READ_WRITE, nbytes, NULL /*host_ptr*/, &result);
+    }
+    if (EXIT_SUCCESS == result) {
+      result = libxstream_memptr_register(memory, &memptr);
+    }
+    if (EXIT_SUCCESS != result) {
+      if (0 != report && 0 != libxstream_opencl_config.verbosity) {
+        fprintf(stderr, "ERROR ACC/OpenCL: memory=%p pointer=%p size=%llu failed to allocate (%s, code=%i)\n",
+          (const void*)memory, memptr, (unsigned long long)nbytes,
+          libxstream_opencl_strerror(result), result);
       }
+      if (NULL != memory) LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseMemObject(memory));
+      memptr = NULL;
+    }
+  }
+  return memptr;
+}
+
+
+LIBXSTREAM_API int libxstream_mem_allocate(void** dev_mem, size_t nbytes)
+{
+  /* assume no lock is needed to protect against context/device changes */
+  libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
+  libxs_malloc_pool_t* const pool = (&libxstream_opencl_config.device == devinfo ? libxstream_opencl_config.pool_dev
+                                                                               : devinfo->pool_dev);
+  void* memptr = NULL;
+  assert(NULL != dev_mem && NULL != devinfo->context);
+  if (0 != nbytes && EXIT_SUCCESS == libxstream_mem_budget(nbytes)) {
+    /* a failure is reported once the reclaimers (if any) had their chance */
+    memptr = libxstream_mem_dev_allocate(devinfo, pool, nbytes, 0 == libxstream_opencl_config.nreclaim);
+    if (NULL == memptr && 0 != libxstream_opencl_config.nreclaim) {
+      LIBXS_ELIDE_RESULT(size_t, libxstream_mem_reclaim(nbytes));
+      memptr = libxstream_mem_dev_allocate(devinfo, pool, nbytes, 1 /*report*/);
     }
+    if (NULL != memptr) libxstream_mem_tag_alloc(memptr, nbytes);
   }
   *dev_mem = memptr;
   return (NULL != memptr || 0 == nbytes) ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -948,11 +1340,13 @@ LIBXSTREAM_API int libxstream_mem_allocate(void** dev_mem, size_t nbytes)
 
 LIBXSTREAM_API int libxstream_mem_deallocate(void* dev_mem)
 {
-  const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  /* not necessarily the calling thread's device, e.g., a host function releasing a batch */
+  const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device_owner(dev_mem);
   int result = EXIT_SUCCESS;
   if (NULL != dev_mem) {
     assert(NULL != devinfo->context);
-    if (NULL != libxstream_opencl_config.pool_dev && (
+    libxstream_mem_tag_free(dev_mem);
+    if (NULL != (&libxstream_opencl_config.device == devinfo ? libxstream_opencl_config.pool_dev : devinfo->pool_dev) && (
 # if (1 >= LIBXSTREAM_USM)
         NULL != devinfo->clDeviceMemAllocINTEL ||
         NULL != devinfo->clSharedMemAllocINTEL ||
@@ -967,7 +1361,7 @@ LIBXSTREAM_API int libxstream_mem_deallocate(void* dev_mem)
     else {
       libxstream_opencl_info_memptr_t* info = NULL;
       LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
-      info = libxstream_opencl_info_devptr_modify(NULL, dev_mem, 1 /*elsize*/, NULL /*amount*/, NULL /*offset*/);
+      info = libxstream_opencl_info_devptr_modify(devinfo, NULL, dev_mem, 1 /*elsize*/, NULL /*amount*/, NULL /*offset*/);
       if (NULL != info && info->memptr == dev_mem && NULL != info->memory) {
         libxstream_opencl_info_memptr_t* const pfree = libxstream_opencl_config.memptrs[libxstream_opencl_config.nmemptrs];
         /* sub-buffers of this buffer are owned here (see libxstream_opencl_subbuffer) */
@@ -1001,11 +1395,12 @@ LIBXSTREAM_API int libxstream_mem_offset(void** dev_mem, void* other, size_t off
 
 /* like libxstream_mem_copy_h2d, but apply some async workaround. */
 LIBXSTREAM_API_INTERN int libxstream_opencl_mem_copy_h2d(const void* /*host_mem*/, void* /*dev_mem*/, size_t /*nbytes*/,
-  cl_command_queue /*queue*/, int /*blocking*/, cl_event* /*event*/);
+  const libxstream_opencl_stream_t* /*str*/, int /*blocking*/, cl_event* /*event*/);
 LIBXSTREAM_API_INTERN int libxstream_opencl_mem_copy_h2d(
-  const void* host_mem, void* dev_mem, size_t nbytes, cl_command_queue queue, int blocking, cl_event* event)
+  const void* host_mem, void* dev_mem, size_t nbytes, const libxstream_opencl_stream_t* str, int blocking, cl_event* event)
 {
-  const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  const libxstream_opencl_device_t* const devinfo = str->devinfo;
+  const cl_command_queue queue = str->queue;
 # if defined(LIBXSTREAM_ASYNC)
   const cl_bool finish = (0 != blocking || 0 == (1 & libxstream_opencl_config.async) || LIBXSTREAM_WA_UNIFIED(devinfo));
 # else
@@ -1043,7 +1438,7 @@ LIBXSTREAM_API_INTERN int libxstream_opencl_mem_copy_h2d(
 # endif
   {
     size_t offset = 0;
-    libxstream_opencl_info_memptr_t* const info = libxstream_opencl_info_devptr_modify(
+    libxstream_opencl_info_memptr_t* const info = libxstream_opencl_info_devptr_modify(devinfo,
       NULL, dev_mem, 1 /*elsize*/, &nbytes, &offset);
     if (NULL != info) {
       result = clEnqueueWriteBuffer(queue, info->memory, finish, offset, nbytes, host_mem, 0, NULL, event);
@@ -1073,7 +1468,7 @@ LIBXSTREAM_API_INTERN int libxstream_opencl_mem_copy_h2d(
 # endif
     {
       size_t offset = 0;
-      libxstream_opencl_info_memptr_t* const info = libxstream_opencl_info_devptr_modify(
+      libxstream_opencl_info_memptr_t* const info = libxstream_opencl_info_devptr_modify(devinfo,
         NULL, dev_mem, 1 /*elsize*/, &nbytes, &offset);
       if (NULL != info) {
         result_sync = clEnqueueWriteBuffer(queue, info->memory, CL_TRUE, offset, nbytes, host_mem, 0, NULL, event);
@@ -1095,8 +1490,11 @@ LIBXSTREAM_API int libxstream_mem_copy_h2d(const void* host_mem, void* dev_mem,
 {
   int result = EXIT_SUCCESS;
   assert((NULL != host_mem && NULL != dev_mem) || 0 == nbytes);
-  assert(NULL != libxstream_opencl_config.device.context);
-  if (
+  assert(NULL != libxstream_opencl_device()->context);
+  if (NULL != stream && NULL != stream->capture) { /* libxstream_stream_begin_capture */
+    result = libxstream_graph_record_copy(stream->capture, libxstream_event_kind_h2d, host_mem, dev_mem, 0, nbytes, 0);
+  }
+  else if (
 # if (0 != LIBXSTREAM_USM)
     host_mem != dev_mem && /* fast-path only sensible without offsets */
 # endif
@@ -1106,14 +1504,16 @@ LIBXSTREAM_API int libxstream_mem_copy_h2d(const void* host_mem, void* dev_mem,
     const libxstream_opencl_stream_t* str;
     cl_event event = NULL;
     LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
-    str = (NULL != stream ? stream : libxstream_opencl_stream(NULL, libxs_tid()));
+    str = (NULL != stream ? stream : libxstream_opencl_stream_default_lock(NULL));
     assert(NULL != str);
+    libxstream_opencl_stream_busy(str);
     result = libxstream_opencl_mem_copy_h2d(
-      host_mem, dev_mem, nbytes, str->queue, finish, NULL == libxstream_opencl_config.hist_h2d ? NULL : &event);
+      host_mem, dev_mem, nbytes, str, finish, NULL == libxstream_opencl_config.hist_h2d ? NULL : &event);
     LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
     if (NULL != event) { /* libxstream_mem_copy_notify must be outside of locked region */
       if (EXIT_SUCCESS == result) {
         void* const data = LIBXSTREAM_EVENT_DATA(nbytes, libxstream_event_kind_h2d);
+        libxstream_opencl_stream_mark(str, event);
         assert(NULL != libxstream_opencl_config.hist_h2d);
         if (!finish) { /* asynchronous */
           result = clSetEventCallback(event, CL_COMPLETE, libxstream_mem_copy_notify, data);
@@ -1129,11 +1529,13 @@ LIBXSTREAM_API int libxstream_mem_copy_h2d(const void* host_mem, void* dev_mem,
 
 /* like libxstream_mem_copy_d2h, but apply some async workaround. */
 LIBXSTREAM_API_INTERN int libxstream_opencl_mem_copy_d2h(const void* /*dev_mem*/, void* /*host_mem*/, size_t /*offset*/,
-  size_t /*nbytes*/, cl_command_queue /*queue*/, int /*blocking*/, cl_event* /*event*/);
+  size_t /*nbytes*/, const libxstream_opencl_stream_t* /*str*/, int /*blocking*/, cl_event* /*event*/);
 LIBXSTREAM_API_INTERN int libxstream_opencl_mem_copy_d2h(
-  const void* dev_mem, void* host_mem, size_t offset, size_t nbytes, cl_command_queue queue, int blocking, cl_event* event)
+  const void* dev_mem, void* host_mem, size_t offset, size_t nbytes, const libxstream_opencl_stream_t* str, int blocking,
+  cl_event* event)
 {
-  const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  const libxstream_opencl_device_t* const devinfo = str->devinfo;
+  const cl_command_queue queue = str->queue;
 # if defined(LIBXSTREAM_ASYNC)
   const cl_bool finish = (0 != blocking || 0 == (2 & libxstream_opencl_config.async) || LIBXSTREAM_WA_UNIFIED(devinfo));
 # else
@@ -1201,7 +1603,10 @@ LIBXSTREAM_API int libxstream_mem_copy_d2h(const void* dev_mem, void* host_mem,
 {
   int result = EXIT_SUCCESS;
   assert((NULL != dev_mem && NULL != host_mem) || 0 == nbytes);
-  if (
+  if (NULL != stream && NULL != stream->capture) { /* libxstream_stream_begin_capture */
+    result = libxstream_graph_record_copy(stream->capture, libxstream_event_kind_d2h, dev_mem, host_mem, 0, nbytes, 0);
+  }
+  else if (
 # if (0 != LIBXSTREAM_USM)
     host_mem != dev_mem && /* fast-path only sensible without offsets */
 # endif
@@ -1215,21 +1620,23 @@ LIBXSTREAM_API int libxstream_mem_copy_d2h(const void* dev_mem, void* host_mem,
     const libxstream_opencl_stream_t* str;
     LIBXS_UNION_ASSIGN(void*, nconst, const void*, dev_mem);
     LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
-    str = (NULL != stream ? stream : libxstream_opencl_stream(NULL, libxs_tid()));
+    str = (NULL != stream ? stream : libxstream_opencl_stream_default_lock(NULL));
     assert(NULL != str);
-    info = libxstream_opencl_info_devptr_modify(NULL, nconst, 1 /*elsize*/, &nbytes, &offset);
+    libxstream_opencl_stream_busy(str);
+    info = libxstream_opencl_info_devptr_modify(str->devinfo, NULL, nconst, 1 /*elsize*/, &nbytes, &offset);
     if (NULL == info) { /* USM-pointer: info_devptr_modify returns NULL when USM is active */
       result = libxstream_opencl_mem_copy_d2h(
-        dev_mem, host_mem, offset, nbytes, str->queue, finish, NULL == libxstream_opencl_config.hist_d2h ? NULL : &event);
+        dev_mem, host_mem, offset, nbytes, str, finish, NULL == libxstream_opencl_config.hist_d2h ? NULL : &event);
     }
     else {
       result = libxstream_opencl_mem_copy_d2h(
-        info->memory, host_mem, offset, nbytes, str->queue, finish, NULL == libxstream_opencl_config.hist_d2h ? NULL : &event);
+        info->memory, host_mem, offset, nbytes, str, finish, NULL == libxstream_opencl_config.hist_d2h ? NULL : &event);
     }
     LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
     if (NULL != event) { /* libxstream_mem_copy_notify must be outside of locked region */
       if (EXIT_SUCCESS == result) {
         void* const data = LIBXSTREAM_EVENT_DATA(nbytes, libxstream_event_kind_d2h);
+        libxstream_opencl_stream_mark(str, event);
         assert(NULL != libxstream_opencl_config.hist_d2h);
         if (!finish) { /* asynchronous */
           result = clSetEventCallback(event, CL_COMPLETE, libxstream_mem_copy_notify, data);
@@ -1247,19 +1654,25 @@ LIBXSTREAM_API int libxstream_mem_copy_d2d(const void* devmem_src, void* devmem_
 {
   int result = EXIT_SUCCESS;
   assert((NULL != devmem_src && NULL != devmem_dst) || 0 == nbytes);
-  if (NULL != devmem_src && NULL != devmem_dst && devmem_src != devmem_dst && 0 != nbytes) {
+  if (NULL != stream && NULL != stream->capture) { /* libxstream_stream_begin_capture */
+    result = libxstream_graph_record_copy(stream->capture, libxstream_event_kind_d2d, devmem_src, devmem_dst, 0, nbytes, 0);
+  }
+  else if (NULL != devmem_src && NULL != devmem_dst && devmem_src != devmem_dst && 0 != nbytes) {
 # if defined(LIBXSTREAM_ASYNC)
     cl_event event = NULL, *const pevent = (0 == (4 & libxstream_opencl_config.async) || NULL == stream) ? &event : NULL;
 # else
     cl_event event = NULL, *const pevent = NULL;
 # endif
-    const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+    const libxstream_opencl_device_t* devinfo;
     void* nconst;
     const libxstream_opencl_stream_t* str;
     LIBXS_UNION_ASSIGN(void*, nconst, const void*, devmem_src);
     LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
-    str = (NULL != stream ? stream : libxstream_opencl_stream(NULL, libxs_tid()));
-    assert(NULL != str && NULL != devinfo->context);
+    str = (NULL != stream ? stream : libxstream_opencl_stream_default_lock(NULL));
+    assert(NULL != str && NULL != str->devinfo);
+    libxstream_opencl_stream_busy(str);
+    devinfo = str->devinfo;
+    assert(NULL != devinfo->context);
 # if (1 >= LIBXSTREAM_USM)
     if (NULL != devinfo->clEnqueueMemcpyINTEL) {
       result = devinfo->clEnqueueMemcpyINTEL(str->queue, CL_FALSE /*blocking*/, devmem_dst, devmem_src, nbytes, 0, NULL,
@@ -1281,9 +1694,9 @@ LIBXSTREAM_API int libxstream_mem_copy_d2d(const void* devmem_src, void* devmem_
 # endif
     {
       size_t offset_src = 0, offset_dst = 0;
-      libxstream_opencl_info_memptr_t* const info_src = libxstream_opencl_info_devptr_modify(
+      libxstream_opencl_info_memptr_t* const info_src = libxstream_opencl_info_devptr_modify(devinfo,
         NULL, nconst, 1 /*elsize*/, &nbytes, &offset_src);
-      libxstream_opencl_info_memptr_t* const info_dst = libxstream_opencl_info_devptr_modify(
+      libxstream_opencl_info_memptr_t* const info_dst = libxstream_opencl_info_devptr_modify(devinfo,
         NULL, devmem_dst, 1 /*elsize*/, &nbytes, &offset_dst);
       if (NULL != info_src && NULL != info_dst) {
         result = clEnqueueCopyBuffer(str->queue, info_src->memory, info_dst->memory, offset_src, offset_dst, nbytes, 0, NULL,
@@ -1295,6 +1708,7 @@ LIBXSTREAM_API int libxstream_mem_copy_d2d(const void* devmem_src, void* devmem_
     if (NULL != event) { /* libxstream_mem_copy_notify must be outside of locked region */
       if (EXIT_SUCCESS == result) {
         void* const data = LIBXSTREAM_EVENT_DATA(nbytes, libxstream_event_kind_d2d);
+        libxstream_opencl_stream_mark(str, event);
         if (NULL == pevent) { /* asynchronous */
           assert(NULL != libxstream_opencl_config.hist_d2d);
           result = clSetEventCallback(event, CL_COMPLETE, libxstream_mem_copy_notify, data);
@@ -1317,61 +1731,255 @@ LIBXSTREAM_API int libxstream_mem_copy_d2d(const void* devmem_src, void* devmem_
 }
 
 
-LIBXSTREAM_API int libxstream_opencl_memset(void* dev_mem, int value, size_t offset, size_t nbytes, libxstream_stream_t* stream)
+/**
+ * Whether the destination's context addresses the source directly, i.e., a USM
+ * allocation the destination's runtime knows although it belongs to another
+ * device (contexts are per device, hence this is up to the runtime).
+ */
+LIBXSTREAM_API_INTERN int libxstream_mem_p2p_direct(const libxstream_opencl_device_t* /*dst*/, const void* /*devmem_src*/);
+LIBXSTREAM_API_INTERN int libxstream_mem_p2p_direct(const libxstream_opencl_device_t* dst, const void* devmem_src)
 {
-  int result = EXIT_SUCCESS;
-  assert(NULL != dev_mem || 0 == nbytes);
-  if (0 != nbytes) {
-# if defined(LIBXSTREAM_ASYNC)
-    const cl_bool wait = (0 == (8 & libxstream_opencl_config.async) || NULL == stream);
-# else
-    const cl_bool wait = CL_TRUE;
-# endif
-    /**
-     * An event is needed either to wait on the fill, or to time it for the ZERO
-     * histogram. Timing must not force a wait: that would serialize the fill
-     * against the enqueuing thread and change what is being measured.
-     */
-    const int measure = (0 == value && NULL != libxstream_opencl_config.hist_zero);
-    cl_event event = NULL, *const pevent = (0 != wait || 0 != measure) ? &event : NULL;
-    const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
-    const libxstream_opencl_stream_t* str;
-    size_t base = 0, vsize = 1;
-    if (0 == LIBXS_MOD2(nbytes, 4)) vsize = 4;
-    else if (0 == LIBXS_MOD2(nbytes, 2)) vsize = 2;
-    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
-    str = (NULL != stream ? stream : libxstream_opencl_stream(NULL, libxs_tid()));
-    assert(NULL != str && NULL != devinfo->context);
+  int result = 0;
 # if (1 >= LIBXSTREAM_USM)
-    if (NULL != devinfo->clEnqueueMemFillINTEL) {
-      result = devinfo->clEnqueueMemFillINTEL(str->queue, (char*)dev_mem + offset, &value, vsize, nbytes, 0, NULL, pevent);
-    }
-    else
+  if (NULL != dst->clEnqueueMemcpyINTEL && NULL != dst->clGetMemAllocInfoINTEL) {
+    cl_uint kind = 0;
+    result = (CL_SUCCESS == dst->clGetMemAllocInfoINTEL(dst->context, devmem_src, 0x419A /*CL_MEM_ALLOC_TYPE_INTEL*/,
+                              sizeof(kind), &kind, NULL) &&
+              0x4196 /*CL_MEM_TYPE_UNKNOWN_INTEL*/ != kind && 0 != kind);
+  }
+# else
+  LIBXS_UNUSED(dst);
+  LIBXS_UNUSED(devmem_src);
 # endif
-# if (0 != LIBXSTREAM_USM)
-      if (0 != devinfo->usm)
-    {
-#   if (1 >= LIBXSTREAM_USM) || defined(LIBXSTREAM_MEM_SVM_USM)
-      result = clEnqueueSVMMemFill(str->queue, (char*)dev_mem + offset, &value, vsize, nbytes, 0, NULL, pevent);
-#   else
-      memset((char*)dev_mem + offset, value, nbytes);
-#   endif
+  return result;
+}
+
+
+/**
+ * Cross-device copy relayed through two pinned chunks: the source stream reads
+ * chunk i while the destination stream writes chunk i-1. A queue cannot wait
+ * on an event of another context, hence the host hands over every chunk. The
+ * source is resolved once against its device (buffer and offset, or a USM
+ * pointer) like libxstream_mem_copy_d2h, and the destination per chunk by
+ * libxstream_opencl_mem_copy_h2d against the destination's device.
+ */
+LIBXSTREAM_API_INTERN int libxstream_mem_p2p_staged(const void* /*devmem_src*/, void* /*devmem_dst*/, size_t /*nbytes*/,
+  const libxstream_opencl_stream_t* /*str_src*/, const libxstream_opencl_stream_t* /*str_dst*/, size_t /*chunk*/);
+LIBXSTREAM_API_INTERN int libxstream_mem_p2p_staged(const void* devmem_src, void* devmem_dst, size_t nbytes,
+  const libxstream_opencl_stream_t* str_src, const libxstream_opencl_stream_t* str_dst, size_t chunk)
+{
+  cl_event read[] = {NULL, NULL}, write[] = {NULL, NULL};
+  const libxstream_opencl_info_memptr_t* info;
+  const void* src = devmem_src;
+  size_t size_chunk, nchunks, src_offset = 0, i;
+  char* stage = NULL;
+  int result = EXIT_SUCCESS;
+  void* nconst;
+  LIBXS_UNION_ASSIGN(void*, nconst, const void*, devmem_src);
+  LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+  info = libxstream_opencl_info_devptr_modify(str_src->devinfo, NULL, nconst, 1 /*elsize*/, &nbytes, &src_offset);
+  if (NULL != info) src = info->memory; /* USM-pointer otherwise */
+  LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+  size_chunk = LIBXS_MIN(chunk, nbytes);
+  nchunks = (0 != size_chunk ? LIBXS_UPDIV(nbytes, size_chunk) : 0);
+  if (0 != nchunks) result = libxstream_mem_host_allocate((void**)&stage, 2 * size_chunk, NULL);
+  for (i = 0; i <= nchunks && EXIT_SUCCESS == result; ++i) {
+    const size_t b = (i & 1), c = 1 - b;
+    if (i < nchunks) { /* read chunk i once the write of chunk i-2 released the buffer */
+      const size_t offset = i * size_chunk, size = LIBXS_MIN(size_chunk, nbytes - offset);
+      if (NULL != write[b]) {
+        result = clWaitForEvents(1, write + b);
+        LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(write[b]));
+        write[b] = NULL;
+      }
+      if (EXIT_SUCCESS == result) {
+        LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+        libxstream_opencl_stream_busy(str_src);
+        result = libxstream_opencl_mem_copy_d2h(
+          src, stage + b * size_chunk, src_offset + offset, size, str_src, 0 /*blocking*/, read + b);
+        LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+      }
     }
-    else
-# endif
-    {
-      const libxstream_opencl_info_memptr_t* const info = libxstream_opencl_info_devptr_modify(
-        NULL, dev_mem, 1 /*elsize*/, &nbytes, &base);
-      if (NULL != info) {
-        result = clEnqueueFillBuffer(str->queue, info->memory, &value, vsize, base + offset, nbytes, 0, NULL, pevent);
-        dev_mem = info->memptr;
+    if (0 < i && EXIT_SUCCESS == result) { /* write chunk i-1 once it was read */
+      const size_t offset = (i - 1) * size_chunk, size = LIBXS_MIN(size_chunk, nbytes - offset);
+      if (NULL != read[c]) {
+        result = clWaitForEvents(1, read + c);
+        LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(read[c]));
+        read[c] = NULL;
+      }
+      if (EXIT_SUCCESS == result) {
+        LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+        libxstream_opencl_stream_busy(str_dst);
+        result = libxstream_opencl_mem_copy_h2d(
+          stage + c * size_chunk, (char*)devmem_dst + offset, size, str_dst, 0 /*blocking*/, write + c);
+        LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
       }
-      else result = EXIT_FAILURE;
     }
-    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
-    if (NULL != event) {
-      if (0 != wait) {
-        int result_release;
+  }
+  for (i = 0; i < 2; ++i) { /* drain (also after an error): the staging buffer is released below */
+    if (NULL != read[i]) {
+      LIBXS_ELIDE_RESULT(cl_int, clWaitForEvents(1, read + i));
+      LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(read[i]));
+    }
+    if (NULL != write[i]) {
+      const int result_wait = clWaitForEvents(1, write + i);
+      if (EXIT_SUCCESS == result) result = result_wait;
+      LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(write[i]));
+    }
+  }
+  if (NULL != stage) libxstream_mem_host_deallocate(stage, NULL);
+  return result;
+}
+
+
+LIBXSTREAM_API int libxstream_opencl_mem_copy_p2p(const void* devmem_src, void* devmem_dst, size_t nbytes,
+  libxstream_stream_t* src_stream, libxstream_stream_t* dst_stream, size_t chunk)
+{
+  int result = EXIT_SUCCESS;
+  if ((NULL != src_stream && NULL != src_stream->capture) || (NULL != dst_stream && NULL != dst_stream->capture)) {
+    result = EXIT_FAILURE; /* not recorded (a graph is replayed on a single stream) */
+  }
+  else if (0 != nbytes && (NULL == devmem_src || NULL == devmem_dst)) {
+    result = EXIT_FAILURE;
+  }
+  else if (0 != nbytes) {
+    const libxstream_opencl_stream_t *str_src, *str_dst;
+    int direct = 0;
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+    str_src = (NULL != src_stream ? src_stream : libxstream_opencl_stream_default_lock(NULL));
+    str_dst = (NULL != dst_stream ? dst_stream : libxstream_opencl_stream_default_lock(NULL));
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+    assert(NULL != str_src && NULL != str_src->devinfo && NULL != str_dst && NULL != str_dst->devinfo);
+    if (0 == chunk) {
+      if (str_src->devinfo->context == str_dst->devinfo->context) direct = 1; /* same device */
+      else if (0 != libxstream_mem_p2p_direct(str_dst->devinfo, devmem_src)) direct = 2;
+    }
+    /* a direct copy is enqueued on the destination stream: work on the source stream completes first */
+    if (1 == direct && str_src != str_dst) { /* same context: the destination queue waits for a marker */
+      cl_event marker = NULL;
+      result = clEnqueueMarkerWithWaitList(str_src->queue, 0, NULL, &marker);
+      if (EXIT_SUCCESS == result) {
+        libxstream_opencl_stream_busy(str_dst);
+        result = clEnqueueBarrierWithWaitList(str_dst->queue, 1, &marker, NULL);
+        LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(marker));
+      }
+    }
+    else if (2 == direct && str_src != str_dst) { /* a queue cannot wait on an event of another context */
+      result = clFinish(str_src->queue);
+    }
+    if (EXIT_SUCCESS != result) { /* source stream failed */
+      assert(0 != direct);
+    }
+    else if (1 == direct) {
+      result = libxstream_mem_copy_d2d(devmem_src, devmem_dst, nbytes, dst_stream);
+    }
+    else if (2 == direct) {
+      const int sync = (NULL == dst_stream);
+      cl_event event = NULL;
+      LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+      libxstream_opencl_stream_busy(str_dst);
+      result = str_dst->devinfo->clEnqueueMemcpyINTEL(str_dst->queue, CL_FALSE /*blocking*/, devmem_dst, devmem_src, nbytes, 0,
+        NULL, (0 != sync || NULL != libxstream_opencl_config.hist_p2p) ? &event : NULL);
+      LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+      if (NULL != event) { /* libxstream_mem_copy_notify must be outside of locked region */
+        void* const data = LIBXSTREAM_EVENT_DATA(nbytes, libxstream_event_kind_p2p);
+        if (EXIT_SUCCESS == result && 0 != sync) result = clWaitForEvents(1, &event);
+        if (EXIT_SUCCESS != result || NULL == libxstream_opencl_config.hist_p2p) {
+          LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(event));
+        }
+        else if (0 != sync) libxstream_mem_copy_notify(event, CL_COMPLETE, data);
+        else result = clSetEventCallback(event, CL_COMPLETE, libxstream_mem_copy_notify, data);
+      }
+    }
+    else { /* relayed through host memory, i.e., timed on the host */
+      const libxs_timer_tick_t start = libxs_timer_tick();
+      result = libxstream_mem_p2p_staged(
+        devmem_src, devmem_dst, nbytes, str_src, str_dst, 0 != chunk ? chunk : LIBXSTREAM_MEM_P2PCHUNK);
+      if (EXIT_SUCCESS == result && NULL != libxstream_opencl_config.hist_p2p) {
+        double vals[3]; /* {size, size, duration} like libxstream_mem_copy_notify */
+        vals[0] = vals[1] = 1E-6 * nbytes;
+        vals[2] = 1E6 * libxs_timer_duration(start, libxs_timer_tick());
+        libxs_hist_push(libxstream_opencl_config.lock_memory, libxstream_opencl_config.hist_p2p, vals);
+        LIBXS_ATOMIC_ADD_FETCH(&libxstream_opencl_config.nprofile, 1, LIBXS_ATOMIC_RELAXED);
+        if (0 > libxstream_opencl_config.profile_mem) {
+          fprintf(stderr, "PROF ACC/OpenCL: P2P mb=%.1f us=%.0f (staged)\n", vals[1], vals[2]);
+        }
+      }
+    }
+  }
+  return result;
+}
+
+
+LIBXSTREAM_API int libxstream_mem_copy_p2p(const void* devmem_src, void* devmem_dst, size_t nbytes,
+  libxstream_stream_t* src_stream, libxstream_stream_t* dst_stream)
+{
+  const int result = libxstream_opencl_mem_copy_p2p(devmem_src, devmem_dst, nbytes, src_stream, dst_stream, 0 /*chunk*/);
+  CL_RETURN(result, "");
+}
+
+
+LIBXSTREAM_API int libxstream_opencl_memset(void* dev_mem, int value, size_t offset, size_t nbytes, libxstream_stream_t* stream)
+{
+  int result = EXIT_SUCCESS;
+  assert(NULL != dev_mem || 0 == nbytes);
+  if (NULL != stream && NULL != stream->capture) { /* libxstream_stream_begin_capture */
+    result = libxstream_graph_record_copy(stream->capture, libxstream_event_kind_zero, NULL, dev_mem, offset, nbytes, value);
+  }
+  else if (0 != nbytes) {
+# if defined(LIBXSTREAM_ASYNC)
+    const cl_bool wait = (0 == (8 & libxstream_opencl_config.async) || NULL == stream);
+# else
+    const cl_bool wait = CL_TRUE;
+# endif
+    /**
+     * An event is needed either to wait on the fill, or to time it for the ZERO
+     * histogram. Timing must not force a wait: that would serialize the fill
+     * against the enqueuing thread and change what is being measured.
+     */
+    const int measure = (0 == value && NULL != libxstream_opencl_config.hist_zero);
+    cl_event event = NULL, *const pevent = (0 != wait || 0 != measure) ? &event : NULL;
+    const libxstream_opencl_device_t* devinfo;
+    const libxstream_opencl_stream_t* str;
+    size_t base = 0, vsize = 1;
+    if (0 == LIBXS_MOD2(nbytes, 4)) vsize = 4;
+    else if (0 == LIBXS_MOD2(nbytes, 2)) vsize = 2;
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+    str = (NULL != stream ? stream : libxstream_opencl_stream_default_lock(NULL));
+    assert(NULL != str && NULL != str->devinfo);
+    libxstream_opencl_stream_busy(str);
+    devinfo = str->devinfo;
+    assert(NULL != devinfo->context);
+# if (1 >= LIBXSTREAM_USM)
+    if (NULL != devinfo->clEnqueueMemFillINTEL) {
+      result = devinfo->clEnqueueMemFillINTEL(str->queue, (char*)dev_mem + offset, &value, vsize, nbytes, 0, NULL, pevent);
+    }
+    else
+# endif
+# if (0 != LIBXSTREAM_USM)
+      if (0 != devinfo->usm)
+    {
+#   if (1 >= LIBXSTREAM_USM) || defined(LIBXSTREAM_MEM_SVM_USM)
+      result = clEnqueueSVMMemFill(str->queue, (char*)dev_mem + offset, &value, vsize, nbytes, 0, NULL, pevent);
+#   else
+      memset((char*)dev_mem + offset, value, nbytes);
+#   endif
+    }
+    else
+# endif
+    {
+      const libxstream_opencl_info_memptr_t* const info = libxstream_opencl_info_devptr_modify(devinfo,
+        NULL, dev_mem, 1 /*elsize*/, &nbytes, &base);
+      if (NULL != info) {
+        result = clEnqueueFillBuffer(str->queue, info->memory, &value, vsize, base + offset, nbytes, 0, NULL, pevent);
+        dev_mem = info->memptr;
+      }
+      else result = EXIT_FAILURE;
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+    if (NULL != event) {
+      if (0 != wait) {
+        int result_release;
         CL_CHECK(result, clWaitForEvents(1, &event));
         if (0 != measure && EXIT_SUCCESS == result) {
           /* Completed already: account for it directly (callback would never fire later). */
@@ -1403,6 +2011,651 @@ LIBXSTREAM_API int libxstream_mem_zero(void* dev_mem, size_t offset, size_t nbyt
 }
 
 
+LIBXSTREAM_API int libxstream_mem_advise(const void* mem, size_t nbytes, int advice, libxstream_stream_t* stream)
+{
+  const int where = ((LIBXSTREAM_MEM_ADVISE_DEVICE | LIBXSTREAM_MEM_ADVISE_HOST) & advice);
+  int result = EXIT_SUCCESS;
+  if (LIBXSTREAM_MEM_ADVISE_DEVICE != where && LIBXSTREAM_MEM_ADVISE_HOST != where) {
+    result = EXIT_FAILURE; /* exactly one location */
+  }
+  else if (NULL != stream && NULL != stream->capture) { /* hint: not recorded */
+  }
+  else if (NULL != mem && 0 != nbytes) {
+    const cl_mem_migration_flags flags = (LIBXSTREAM_MEM_ADVISE_HOST == where ? CL_MIGRATE_MEM_OBJECT_HOST : 0) |
+                                         (0 != (LIBXSTREAM_MEM_ADVISE_DISCARD & advice) ? CL_MIGRATE_MEM_OBJECT_CONTENT_UNDEFINED : 0);
+    cl_event event = NULL, *const pevent = (NULL == stream ? &event : NULL);
+    const libxstream_opencl_device_t* devinfo;
+    const libxstream_opencl_stream_t* str;
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+    str = (NULL != stream ? stream : libxstream_opencl_stream_default_lock(NULL));
+    assert(NULL != str && NULL != str->devinfo);
+    devinfo = str->devinfo;
+    assert(NULL != devinfo->context);
+# if (1 >= LIBXSTREAM_USM)
+    if (NULL != devinfo->clEnqueueMigrateMemINTEL) {
+      cl_uint kind = 0; /* only shared allocations migrate (device and host allocations stay) */
+      if (NULL == devinfo->clGetMemAllocInfoINTEL ||
+          (CL_SUCCESS == devinfo->clGetMemAllocInfoINTEL(devinfo->context, mem, 0x419A /*CL_MEM_ALLOC_TYPE_INTEL*/,
+                           sizeof(kind), &kind, NULL) &&
+            0x4199 /*CL_MEM_TYPE_SHARED_INTEL*/ == kind))
+      {
+        libxstream_opencl_stream_busy(str);
+        result = devinfo->clEnqueueMigrateMemINTEL(str->queue, mem, nbytes, flags, 0, NULL, pevent);
+      }
+    }
+    else
+# endif
+# if (0 != LIBXSTREAM_USM) && defined(CL_VERSION_2_1)
+      /* clEnqueueSVMMigrateMem is OpenCL 2.1 (SVM itself is 2.0) */
+      if (0 != devinfo->usm && (2 < devinfo->std_level[0] || (2 == devinfo->std_level[0] && 1 <= devinfo->std_level[1])))
+    {
+      libxstream_opencl_stream_busy(str);
+      result = clEnqueueSVMMigrateMem(str->queue, 1, &mem, &nbytes, flags, 0, NULL, pevent);
+      if (CL_INVALID_VALUE == result) result = EXIT_SUCCESS; /* not an SVM pointer */
+    }
+    else
+# endif
+    {
+      LIBXS_UNUSED(flags);
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+    if (NULL != event) { /* NULL-stream: synchronous */
+      if (EXIT_SUCCESS == result) result = clWaitForEvents(1, &event);
+      LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(event));
+    }
+  }
+  CL_RETURN(result, "");
+}
+
+
+LIBXSTREAM_API int libxstream_mem_prefetch(const void* mem, size_t nbytes, int to_device, libxstream_stream_t* stream)
+{
+  return libxstream_mem_advise(
+    mem, nbytes, 0 != to_device ? LIBXSTREAM_MEM_ADVISE_DEVICE : LIBXSTREAM_MEM_ADVISE_HOST, stream);
+}
+
+
+/* Linear copy between USM/SVM pointers (h2d, d2h, or d2d), as libxstream_mem_copy_* issue it. */
+LIBXSTREAM_API_INTERN int libxstream_opencl_mem_copy_usm(const libxstream_opencl_device_t* /*devinfo*/,
+  cl_command_queue /*queue*/, cl_bool /*blocking*/, void* /*dst*/, const void* /*src*/, size_t /*nbytes*/, cl_event* /*event*/);
+LIBXSTREAM_API_INTERN int libxstream_opencl_mem_copy_usm(const libxstream_opencl_device_t* devinfo, cl_command_queue queue,
+  cl_bool blocking, void* dst, const void* src, size_t nbytes, cl_event* event)
+{
+  int result = EXIT_SUCCESS;
+  assert(NULL != devinfo);
+# if (1 >= LIBXSTREAM_USM)
+  if (NULL != devinfo->clEnqueueMemcpyINTEL) {
+    result = devinfo->clEnqueueMemcpyINTEL(queue, blocking, dst, src, nbytes, 0, NULL, event);
+  }
+  else
+# endif
+  {
+# if (0 != LIBXSTREAM_USM) && ((1 >= LIBXSTREAM_USM) || defined(LIBXSTREAM_MEM_SVM_USM))
+    result = clEnqueueSVMMemcpy(queue, blocking, dst, src, nbytes, 0, NULL, event);
+# else
+    LIBXS_UNUSED(queue);
+    LIBXS_UNUSED(blocking);
+    memcpy(dst, src, nbytes);
+    if (NULL != event) *event = NULL;
+# endif
+  }
+  return result;
+}
+
+
+/**
+ * Rectangular copy of the given kind. Buffers take the Rect-commands of OpenCL
+ * 1.1, which accept the offset of an info-augmented pointer as part of the
+ * origin. USM/SVM pointers have no such command: dimensions that are packed on
+ * both sides are merged, and the remainder is issued as linear copies per row
+ * (per slice if rows are contiguous), where the last copy blocks if requested.
+ */
+LIBXSTREAM_API_INTERN int libxstream_opencl_mem_copy_rect(libxstream_event_kind_t /*kind*/, const void* /*src*/, void* /*dst*/,
+  const size_t* /*src_origin*/, const size_t* /*dst_origin*/, const size_t* /*region*/, size_t /*src_row_pitch*/,
+  size_t /*src_slice_pitch*/, size_t /*dst_row_pitch*/, size_t /*dst_slice_pitch*/, libxstream_stream_t* /*stream*/);
+LIBXSTREAM_API_INTERN int libxstream_opencl_mem_copy_rect(libxstream_event_kind_t kind, const void* src, void* dst,
+  const size_t* src_origin, const size_t* dst_origin, const size_t* region, size_t src_row_pitch, size_t src_slice_pitch,
+  size_t dst_row_pitch, size_t dst_slice_pitch, libxstream_stream_t* stream)
+{
+  int result = EXIT_SUCCESS;
+  const size_t nbytes = (NULL != region ? (region[0] * region[1] * region[2]) : 0);
+  assert(NULL != src_origin && NULL != dst_origin);
+  if (0 != nbytes) { /* zero pitch: packed */
+    if (0 == src_row_pitch) src_row_pitch = region[0];
+    if (0 == src_slice_pitch) src_slice_pitch = region[1] * src_row_pitch;
+    if (0 == dst_row_pitch) dst_row_pitch = region[0];
+    if (0 == dst_slice_pitch) dst_slice_pitch = region[1] * dst_row_pitch;
+  }
+  if (NULL != stream && NULL != stream->capture) { /* not recorded (libxstream_graph_record_copy is linear) */
+    result = EXIT_FAILURE;
+  }
+  else if (0 != nbytes && (NULL == src || NULL == dst || region[0] > src_row_pitch || region[0] > dst_row_pitch ||
+                            region[1] * src_row_pitch > src_slice_pitch || region[1] * dst_row_pitch > dst_slice_pitch))
+  {
+    result = EXIT_FAILURE;
+  }
+  else if (0 != nbytes) {
+    const cl_bool finish = (NULL != stream ? CL_FALSE : CL_TRUE);
+    libxs_hist_t* const hist = (libxstream_event_kind_h2d == kind   ? libxstream_opencl_config.hist_h2d
+                                : libxstream_event_kind_d2h == kind ? libxstream_opencl_config.hist_d2h
+                                                                    : libxstream_opencl_config.hist_d2d);
+    const libxstream_opencl_device_t* devinfo;
+    const libxstream_opencl_stream_t* str;
+    cl_event event = NULL;
+    int usm = 0;
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+    str = (NULL != stream ? stream : libxstream_opencl_stream_default_lock(NULL));
+    assert(NULL != str && NULL != str->devinfo);
+    libxstream_opencl_stream_busy(str);
+    devinfo = str->devinfo;
+    assert(NULL != devinfo->context);
+# if (1 >= LIBXSTREAM_USM)
+    if (NULL != devinfo->clEnqueueMemcpyINTEL) usm = 1;
+# endif
+# if (0 != LIBXSTREAM_USM)
+    if (0 != devinfo->usm) usm = 1;
+# endif
+    if (0 != usm) {
+      const char* const s = (const char*)src + src_origin[2] * src_slice_pitch + src_origin[1] * src_row_pitch + src_origin[0];
+      char* const d = (char*)dst + dst_origin[2] * dst_slice_pitch + dst_origin[1] * dst_row_pitch + dst_origin[0];
+      size_t width = region[0], nrows = region[1], nslices = region[2], y, z;
+      if (region[0] == src_row_pitch && region[0] == dst_row_pitch) { /* rows are contiguous */
+        width *= nrows;
+        nrows = 1;
+        if (width == src_slice_pitch && width == dst_slice_pitch) { /* slices as well */
+          width *= nslices;
+          nslices = 1;
+        }
+      }
+      for (z = 0; z < nslices && EXIT_SUCCESS == result; ++z) {
+        for (y = 0; y < nrows && EXIT_SUCCESS == result; ++y) {
+          const int last = (z + 1 == nslices && y + 1 == nrows);
+          result = libxstream_opencl_mem_copy_usm(devinfo, str->queue, (0 != last ? finish : CL_FALSE),
+            d + z * dst_slice_pitch + y * dst_row_pitch, s + z * src_slice_pitch + y * src_row_pitch, width,
+            /* a rate is only meaningful for a single command */
+            (0 != last && 1 == nslices && 1 == nrows && NULL != hist) ? &event : NULL);
+        }
+      }
+    }
+    else { /* info-augmented pointers: the offset is a linear displacement within the origin */
+      size_t src_offset = 0, dst_offset = 0, so[3], dso[3];
+      libxstream_opencl_info_memptr_t* info_src = NULL;
+      libxstream_opencl_info_memptr_t* info_dst = NULL;
+      void* nconst;
+      LIBXS_UNION_ASSIGN(void*, nconst, const void*, src);
+      if (libxstream_event_kind_h2d != kind) {
+        info_src = libxstream_opencl_info_devptr_modify(devinfo, NULL, nconst, 1 /*elsize*/, NULL, &src_offset);
+      }
+      if (libxstream_event_kind_d2h != kind) {
+        info_dst = libxstream_opencl_info_devptr_modify(devinfo, NULL, dst, 1 /*elsize*/, NULL, &dst_offset);
+      }
+      so[0] = src_origin[0] + src_offset;
+      so[1] = src_origin[1];
+      so[2] = src_origin[2];
+      dso[0] = dst_origin[0] + dst_offset;
+      dso[1] = dst_origin[1];
+      dso[2] = dst_origin[2];
+      if (libxstream_event_kind_h2d == kind && NULL != info_dst) {
+        result = clEnqueueWriteBufferRect(str->queue, info_dst->memory, finish, dso, src_origin, region, dst_row_pitch,
+          dst_slice_pitch, src_row_pitch, src_slice_pitch, src, 0, NULL, NULL != hist ? &event : NULL);
+      }
+      else if (libxstream_event_kind_d2h == kind && NULL != info_src) {
+        result = clEnqueueReadBufferRect(str->queue, info_src->memory, finish, so, dst_origin, region, src_row_pitch,
+          src_slice_pitch, dst_row_pitch, dst_slice_pitch, dst, 0, NULL, NULL != hist ? &event : NULL);
+      }
+      else if (libxstream_event_kind_d2d == kind && NULL != info_src && NULL != info_dst) {
+        result = clEnqueueCopyBufferRect(str->queue, info_src->memory, info_dst->memory, so, dso, region, src_row_pitch,
+          src_slice_pitch, dst_row_pitch, dst_slice_pitch, 0, NULL, (NULL != hist || finish) ? &event : NULL);
+        if (EXIT_SUCCESS == result && finish) result = clWaitForEvents(1, &event); /* no blocking form */
+      }
+      else result = EXIT_FAILURE;
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+    if (NULL != event) { /* libxstream_mem_copy_notify must be outside of locked region */
+      if (EXIT_SUCCESS == result && NULL != hist) {
+        void* const data = LIBXSTREAM_EVENT_DATA(nbytes, kind);
+        libxstream_opencl_stream_mark(str, event);
+        if (!finish) { /* asynchronous */
+          result = clSetEventCallback(event, CL_COMPLETE, libxstream_mem_copy_notify, data);
+        }
+        else libxstream_mem_copy_notify(event, CL_COMPLETE, data); /* synchronous */
+      }
+      else LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(event));
+    }
+  }
+  return result;
+}
+
+
+LIBXSTREAM_API int libxstream_mem_copy_h2d_rect(const void* host_mem, void* dev_mem, const size_t host_origin[3],
+  const size_t dev_origin[3], const size_t region[3], size_t host_row_pitch, size_t host_slice_pitch, size_t dev_row_pitch,
+  size_t dev_slice_pitch, libxstream_stream_t* stream)
+{
+  const int result = libxstream_opencl_mem_copy_rect(libxstream_event_kind_h2d, host_mem, dev_mem, host_origin, dev_origin,
+    region, host_row_pitch, host_slice_pitch, dev_row_pitch, dev_slice_pitch, stream);
+  CL_RETURN(result, "");
+}
+
+
+LIBXSTREAM_API int libxstream_mem_copy_d2h_rect(const void* dev_mem, void* host_mem, const size_t dev_origin[3],
+  const size_t host_origin[3], const size_t region[3], size_t dev_row_pitch, size_t dev_slice_pitch, size_t host_row_pitch,
+  size_t host_slice_pitch, libxstream_stream_t* stream)
+{
+  const int result = libxstream_opencl_mem_copy_rect(libxstream_event_kind_d2h, dev_mem, host_mem, dev_origin, host_origin,
+    region, dev_row_pitch, dev_slice_pitch, host_row_pitch, host_slice_pitch, stream);
+  CL_RETURN(result, "");
+}
+
+
+LIBXSTREAM_API int libxstream_mem_copy_d2d_rect(const void* devmem_src, void* devmem_dst, const size_t src_origin[3],
+  const size_t dst_origin[3], const size_t region[3], size_t src_row_pitch, size_t src_slice_pitch, size_t dst_row_pitch,
+  size_t dst_slice_pitch, libxstream_stream_t* stream)
+{
+  const int result = libxstream_opencl_mem_copy_rect(libxstream_event_kind_d2d, devmem_src, devmem_dst, src_origin, dst_origin,
+    region, src_row_pitch, src_slice_pitch, dst_row_pitch, dst_slice_pitch, stream);
+  CL_RETURN(result, "");
+}
+
+
+LIBXSTREAM_API_INTERN void libxstream_mem_pack_release(libxstream_opencl_device_t* devinfo)
+{
+  int i = 0;
+  assert(NULL != devinfo);
+  for (; i < (int)(sizeof(devinfo->pack_kernel) / sizeof(*devinfo->pack_kernel)); ++i) {
+    if (NULL != devinfo->pack_kernel[i]) {
+      clReleaseKernel(devinfo->pack_kernel[i]); /* ignore return code */
+      devinfo->pack_kernel[i] = NULL;
+    }
+  }
+  devinfo->pack_context = NULL;
+}
+
+
+/** Pointer argument of the pack kernel: a buffer if given, a USM/SVM pointer otherwise. */
+LIBXSTREAM_API_INTERN int libxstream_mem_pack_arg(const libxstream_opencl_device_t* /*devinfo*/, cl_kernel /*kernel*/,
+  cl_uint /*arg_index*/, const void* /*pointer*/, cl_mem /*memory*/);
+LIBXSTREAM_API_INTERN int libxstream_mem_pack_arg(
+  const libxstream_opencl_device_t* devinfo, cl_kernel kernel, cl_uint arg_index, const void* pointer, cl_mem memory)
+{
+  int result = EXIT_FAILURE;
+  if (NULL != memory) result = clSetKernelArg(kernel, arg_index, sizeof(cl_mem), &memory);
+# if (1 >= LIBXSTREAM_USM)
+  else if (NULL != devinfo->clSetKernelArgMemPointerINTEL) {
+    result = devinfo->clSetKernelArgMemPointerINTEL(kernel, arg_index, pointer);
+  }
+# endif
+# if (0 != LIBXSTREAM_USM)
+  else if (0 != devinfo->usm) result = clSetKernelArgSVMPointer(kernel, arg_index, pointer);
+# endif
+  return result;
+}
+
+
+/**
+ * Builds the pack kernel for the given device, which is the device of the
+ * stream and not necessarily the calling thread's (libxstream_opencl_kernel).
+ */
+LIBXSTREAM_API_INTERN int libxstream_mem_pack_kernel(const libxstream_opencl_device_t* /*devinfo*/, const char /*source*/[],
+  const char /*tname*/[], cl_kernel* /*kernel*/);
+LIBXSTREAM_API_INTERN int libxstream_mem_pack_kernel(
+  const libxstream_opencl_device_t* devinfo, const char source[], const char tname[], cl_kernel* kernel)
+{
+  const cl_device_id device_id = libxstream_opencl_config.devices[devinfo->device_id];
+  char build_params[32];
+  cl_program program;
+  int result = EXIT_SUCCESS;
+  assert(NULL != kernel && NULL != devinfo->context);
+  LIBXS_SNPRINTF(build_params, sizeof(build_params), "-DT=%s", tname);
+  program = clCreateProgramWithSource(devinfo->context, 1 /*nlines*/, &source, NULL, &result);
+  if (EXIT_SUCCESS == result) {
+    result = clBuildProgram(program, 1 /*num_devices*/, &device_id, build_params, NULL /*callback*/, NULL /*user_data*/);
+    if (EXIT_SUCCESS == result) *kernel = clCreateKernel(program, "pack", &result);
+    LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseProgram(program));
+  }
+  return result;
+}
+
+
+/**
+ * Block gather (or scatter) of the given kind. One work-group moves one block,
+ * and the element type is the widest (up to 16 bytes) dividing the type size
+ * as well as the base offsets, i.e., the index is scaled to that width by the
+ * kernel. The kernel object is shared per device (the stream's), hence
+ * arguments are set and the kernel is enqueued under lock_memory (like
+ * libxstream_memptr_register).
+ */
+LIBXSTREAM_API_INTERN int libxstream_opencl_mem_pack(int /*gather*/, const void* /*src*/, void* /*dst*/,
+  const size_t* /*index*/, size_t /*count*/, size_t /*typesize*/, libxstream_stream_t* /*stream*/);
+LIBXSTREAM_API_INTERN int libxstream_opencl_mem_pack(int gather, const void* src, void* dst,
+  const size_t* index, size_t count, size_t typesize, libxstream_stream_t* stream)
+{
+  static const char source[] =
+    "kernel void pack(global const T* restrict src, global T* restrict dst, global const ulong* restrict index,\n"
+    "  ulong src_base, ulong dst_base, ulong index_base, ulong scale, int gather)\n"
+    "{\n"
+    "  global const ulong* const block = index + index_base + 3 * get_group_id(0);\n"
+    "  const ulong s = src_base + scale * block[0 != gather ? 0 : 1];\n"
+    "  const ulong d = dst_base + scale * block[0 != gather ? 1 : 0];\n"
+    "  const ulong n = scale * block[2];\n"
+    "  ulong i = get_local_id(0);\n"
+    "  for (; i < n; i += get_local_size(0)) dst[d + i] = src[s + i];\n"
+    "}\n";
+  static const char* const tnames[] = {"uchar", "ushort", "uint", "uint2", "uint4"};
+  int result = EXIT_SUCCESS;
+  if (NULL != stream && NULL != stream->capture) { /* not recorded (libxstream_graph_record_copy is linear) */
+    result = EXIT_FAILURE;
+  }
+  else if (0 != count && (NULL == src || NULL == dst || NULL == index || 0 == typesize)) {
+    result = EXIT_FAILURE;
+  }
+  else if (0 != count) {
+    const void* const ptr[] = {src, dst, index};
+    size_t base[] = {0, 0, 0}, width = 16, wgsize = LIBXSTREAM_MEM_PACK_WGSIZE, gsize, align;
+    cl_mem memory[] = {NULL, NULL, NULL};
+    const libxstream_opencl_stream_t* str;
+    libxstream_opencl_device_t* devinfo;
+    cl_event event = NULL;
+    cl_kernel kernel = NULL;
+    int usm, k = 4, i;
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+    str = (NULL != stream ? stream : libxstream_opencl_stream_default_lock(NULL));
+    assert(NULL != str && NULL != str->devinfo);
+    devinfo = str->devinfo; /* kernel, pointers and queue belong to the stream's device */
+    /* same criterion as libxstream_opencl_info_devptr_modify */
+    usm = (NULL != devinfo->clDeviceMemAllocINTEL || NULL != devinfo->clSharedMemAllocINTEL);
+# if (0 != LIBXSTREAM_USM)
+    if (0 != devinfo->usm) usm = 1;
+# endif
+    if (NULL == devinfo->context) result = EXIT_FAILURE;
+    for (i = 0; i < 3 && EXIT_SUCCESS == result && 0 == usm; ++i) {
+      libxstream_opencl_info_memptr_t* info;
+      void* nconst;
+      LIBXS_UNION_ASSIGN(void*, nconst, const void*, ptr[i]);
+      info = libxstream_opencl_info_devptr_modify(devinfo, NULL, nconst, 1 /*elsize*/, NULL, base + i);
+      if (NULL != info) memory[i] = info->memory;
+      else result = EXIT_FAILURE;
+    }
+    align = (0 == usm ? (typesize | base[0] | base[1]) : (typesize | (size_t)(uintptr_t)src | (size_t)(uintptr_t)dst));
+    for (; 1 < width && 0 != (align & (width - 1)); width >>= 1) --k;
+    if (0 != ((0 == usm ? base[2] : (size_t)(uintptr_t)index) & (sizeof(cl_ulong) - 1))) result = EXIT_FAILURE;
+    if (EXIT_SUCCESS == result) {
+      if (devinfo->context != devinfo->pack_context) libxstream_mem_pack_release(devinfo);
+      if (NULL == devinfo->pack_kernel[k]) {
+        result = libxstream_mem_pack_kernel(devinfo, source, tnames[k], devinfo->pack_kernel + k);
+# if defined(CL_VERSION_2_0)
+        if (EXIT_SUCCESS == result && NULL != devinfo->clDeviceMemAllocINTEL) { /* blocks of a batch span allocations */
+          const cl_bool indirect = CL_TRUE;
+          result = clSetKernelExecInfo(devinfo->pack_kernel[k], 0x4201 /*CL_KERNEL_EXEC_INFO_INDIRECT_DEVICE_ACCESS_INTEL*/,
+            sizeof(cl_bool), &indirect);
+          CL_CHECK(result, clSetKernelExecInfo(devinfo->pack_kernel[k], 0x4202 /*CL_KERNEL_EXEC_INFO_INDIRECT_SHARED_ACCESS_INTEL*/,
+            sizeof(cl_bool), &indirect));
+          if (EXIT_SUCCESS != result) {
+            clReleaseKernel(devinfo->pack_kernel[k]); /* ignore return code */
+            devinfo->pack_kernel[k] = NULL;
+          }
+        }
+# endif
+        if (EXIT_SUCCESS == result) devinfo->pack_context = devinfo->context;
+      }
+      kernel = devinfo->pack_kernel[k];
+    }
+    if (EXIT_SUCCESS == result) {
+      const cl_ulong src_base = base[0] / width, dst_base = base[1] / width, index_base = base[2] / sizeof(cl_ulong);
+      const cl_ulong scale = typesize / width;
+      const cl_int kind = gather;
+      for (i = 0; i < 3 && EXIT_SUCCESS == result; ++i) {
+        result = libxstream_mem_pack_arg(devinfo, kernel, (cl_uint)i, ptr[i], memory[i]);
+      }
+      CL_CHECK(result, clSetKernelArg(kernel, 3, sizeof(cl_ulong), &src_base));
+      CL_CHECK(result, clSetKernelArg(kernel, 4, sizeof(cl_ulong), &dst_base));
+      CL_CHECK(result, clSetKernelArg(kernel, 5, sizeof(cl_ulong), &index_base));
+      CL_CHECK(result, clSetKernelArg(kernel, 6, sizeof(cl_ulong), &scale));
+      CL_CHECK(result, clSetKernelArg(kernel, 7, sizeof(cl_int), &kind));
+      if (EXIT_SUCCESS == result) {
+        if (0 < devinfo->wgsize[0] && devinfo->wgsize[0] < wgsize) wgsize = devinfo->wgsize[0];
+        gsize = count * wgsize;
+        libxstream_opencl_stream_busy(str);
+        result = clEnqueueNDRangeKernel(str->queue, kernel, 1, NULL, &gsize, &wgsize, 0, NULL, NULL == stream ? &event : NULL);
+      }
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memory);
+    if (NULL != event) { /* NULL-stream: synchronous */
+      if (EXIT_SUCCESS == result) result = clWaitForEvents(1, &event);
+      LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(event));
+    }
+  }
+  return result;
+}
+
+
+LIBXSTREAM_API int libxstream_mem_gather(
+  const void* devmem_src, void* devmem_packed, const size_t* dev_index, size_t count, size_t typesize, libxstream_stream_t* stream)
+{
+  const int result = libxstream_opencl_mem_pack(1 /*gather*/, devmem_src, devmem_packed, dev_index, count, typesize, stream);
+  CL_RETURN(result, "");
+}
+
+
+LIBXSTREAM_API int libxstream_mem_scatter(
+  const void* devmem_packed, void* devmem_dst, const size_t* dev_index, size_t count, size_t typesize, libxstream_stream_t* stream)
+{
+  const int result = libxstream_opencl_mem_pack(0 /*scatter*/, devmem_packed, devmem_dst, dev_index, count, typesize, stream);
+  CL_RETURN(result, "");
+}
+
+
+/** Release the staging buffers of a batch ({host, device}), once the stream has passed the batch. */
+LIBXSTREAM_API_INTERN void libxstream_mem_batch_release(void* /*arg*/);
+LIBXSTREAM_API_INTERN void libxstream_mem_batch_release(void* arg)
+{
+  void** const staged = (void**)arg;
+  LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == libxstream_mem_deallocate(staged[1]));
+  LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == libxstream_mem_host_deallocate(staged[0], NULL));
+  free(staged);
+}
+
+
+/**
+ * Items up to the crossover are copied into a pinned staging buffer at 16-byte
+ * aligned offsets, followed by the index, and uploaded at once. Consecutive
+ * items landing in the same buffer (info-augmented pointers) are scattered by
+ * one launch. Under Intel USM, consecutive items are scattered by one launch
+ * whatever allocation they land in: their index holds the distance to the
+ * lowest destination, and the pack kernel accesses allocations indirectly. A
+ * group of a single item, as well as every item under SVM, takes a
+ * device-side copy. Staging is released by a host function
+ * (libxstream_stream_enqueue_host_fn), or after synchronizing the stream if
+ * there is no worker, i.e., the caller's buffers can be reused on return as
+ * opposed to an individual copy.
+ */
+LIBXSTREAM_API int libxstream_opencl_mem_copy_h2d_batch(int n, const void* const host_mem[], void* const dev_mem[],
+  const size_t nbytes[], size_t crossover, libxstream_stream_t* stream)
+{
+  void** staged = NULL;
+  size_t size = 0, index_offset = 0;
+  int result = EXIT_SUCCESS, nsmall = 0, i;
+  if (0 < n && (NULL == host_mem || NULL == dev_mem || NULL == nbytes)) result = EXIT_FAILURE;
+  if (NULL != stream && NULL != stream->capture) crossover = 0; /* recorded as individual copies */
+  for (i = 0; i < n && EXIT_SUCCESS == result; ++i) {
+    if (0 != nbytes[i] && nbytes[i] <= crossover) {
+      size = LIBXS_UP2(size, 16) + nbytes[i];
+      ++nsmall;
+    }
+  }
+  if (1 < nsmall) { /* a single item is better off copied directly */
+    index_offset = LIBXS_UP2(size, 16);
+    size = index_offset + 3 * sizeof(size_t) * nsmall;
+    staged = (void**)calloc(2, sizeof(void*));
+    if (NULL == staged || EXIT_SUCCESS != libxstream_mem_host_allocate(staged + 0, size, stream) ||
+        EXIT_SUCCESS != libxstream_mem_allocate(staged + 1, size))
+    { /* fall back to individual copies */
+      if (NULL != staged) {
+        if (NULL != staged[0]) LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == libxstream_mem_host_deallocate(staged[0], stream));
+        free(staged);
+        staged = NULL;
+      }
+    }
+  }
+  for (i = 0; i < n && EXIT_SUCCESS == result; ++i) {
+    if (0 != nbytes[i] && (NULL == staged || crossover < nbytes[i])) {
+      result = libxstream_mem_copy_h2d(host_mem[i], dev_mem[i], nbytes[i], stream);
+    }
+  }
+  if (NULL != staged) {
+    const libxstream_opencl_device_t* const devinfo = (NULL != stream ? stream->devinfo : libxstream_opencl_device());
+# if defined(CL_VERSION_2_0) /* clSetKernelExecInfo (libxstream_opencl_mem_pack) */
+    const int absolute = (NULL != devinfo->clDeviceMemAllocINTEL);
+# else
+    const int absolute = 0;
+# endif
+    char* const data = (char*)staged[0];
+    size_t* const index = (size_t*)(data + index_offset);
+    void** const base = (void**)malloc(sizeof(void*) * nsmall);
+    size_t* const width = (size_t*)malloc(sizeof(size_t) * nsmall);
+    size_t offset = 0, j;
+    int k = 0, g;
+    if (NULL == base || NULL == width) result = EXIT_FAILURE;
+    for (i = 0; i < n && EXIT_SUCCESS == result; ++i) { /* index: {offset in destination, staged offset, size} */
+      if (0 != nbytes[i] && nbytes[i] <= crossover) {
+        const libxstream_opencl_info_memptr_t* info;
+        size_t dst_offset = 0;
+        offset = LIBXS_UP2(offset, 16);
+        memcpy(data + offset, host_mem[i], nbytes[i]);
+        info = libxstream_opencl_info_devptr_modify(devinfo, libxstream_opencl_config.lock_memory, dev_mem[i], 1 /*elsize*/,
+          NULL /*amount*/, &dst_offset);
+        /* destination relative to its buffer, a USM pointer stands for itself (absolute: relative to the group's lowest) */
+        base[k] = (NULL != info ? info->memptr : (0 != absolute ? NULL : dev_mem[i]));
+        index[3 * k + 0] = (NULL != info ? dst_offset : (0 != absolute ? (size_t)(uintptr_t)dev_mem[i] : 0));
+        index[3 * k + 1] = offset;
+        index[3 * k + 2] = nbytes[i];
+        offset += nbytes[i];
+        ++k;
+      }
+    }
+    for (k = 0; k < nsmall && EXIT_SUCCESS == result; k = g) { /* groups: index in units of the common width */
+      size_t w = 16;
+      for (g = k; g < nsmall && base[g] == base[k]; ++g) {
+        const size_t align = index[3 * g + 0] | index[3 * g + 1] | index[3 * g + 2];
+        for (; 1 < w && 0 != (align & (w - 1)); w >>= 1);
+      }
+      if (NULL == base[k]) { /* absolute addresses: the lowest becomes the base of the group */
+        size_t lo = index[3 * k + 0];
+        for (j = (size_t)k + 1; j < (size_t)g; ++j) lo = LIBXS_MIN(lo, index[3 * j + 0]);
+        for (j = (size_t)k; j < (size_t)g; ++j) {
+          index[3 * j + 0] -= lo;
+          base[j] = (void*)(uintptr_t)lo;
+        }
+      }
+      if (1 == g - k) w = 1; /* device-side copy */
+      for (j = 3 * (size_t)k; j < 3 * (size_t)g; ++j) index[j] /= w;
+      width[k] = w;
+    }
+    if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(data, staged[1], size, stream);
+    for (k = 0; k < nsmall && EXIT_SUCCESS == result; k = g) {
+      for (g = k; g < nsmall && base[g] == base[k]; ++g);
+      if (1 < g - k) {
+        result = libxstream_opencl_mem_pack(0 /*scatter*/, staged[1], base[k],
+          (const size_t*)((char*)staged[1] + index_offset + 3 * sizeof(size_t) * k), (size_t)(g - k), width[k], stream);
+      }
+      else {
+        result = libxstream_mem_copy_d2d((const char*)staged[1] + index[3 * k + 1], (char*)base[k] + index[3 * k + 0],
+          index[3 * k + 2], stream);
+      }
+    }
+    free(width);
+    free(base);
+    if (NULL != stream) {
+      const int result_release = libxstream_stream_enqueue_host_fn(stream, libxstream_mem_batch_release, staged);
+      if (EXIT_SUCCESS != result_release) { /* release synchronously, e.g., no worker (LIBXSTREAM_HOSTFN=0) */
+        const int result_sync = libxstream_stream_sync(stream);
+        libxstream_mem_batch_release(staged);
+        if (EXIT_SUCCESS == result) result = result_sync;
+      }
+    }
+    else {
+      const int result_sync = libxstream_stream_sync(NULL);
+      libxstream_mem_batch_release(staged);
+      if (EXIT_SUCCESS == result) result = result_sync;
+    }
+  }
+  return result;
+}
+
+
+/**
+ * Crossover of libxstream_mem_copy_h2d_batch (in bytes). Unless LIBXSTREAM_BATCH
+ * sets it, it is measured once, on first use rather than by libxstream_init,
+ * so a process that never batches pays nothing: items of a given size are
+ * copied individually and batched on a private stream, and the crossover is
+ * the largest size for which batching was faster (zero if it never is). Other
+ * threads copy individually while the measurement runs.
+ */
+LIBXSTREAM_API_INTERN size_t libxstream_mem_batch_crossover(void);
+LIBXSTREAM_API_INTERN size_t libxstream_mem_batch_crossover(void)
+{
+  int batch = LIBXS_ATOMIC_LOAD(&libxstream_opencl_config.batch, LIBXS_ATOMIC_SEQ_CST);
+  if (0 > batch) {
+    batch = 0;
+    if (1 == LIBXS_ATOMIC_ADD_FETCH(&libxstream_opencl_config.batch_calib, 1, LIBXS_ATOMIC_SEQ_CST)) {
+      const void* src[LIBXSTREAM_MEM_BATCH_NCALIB];
+      void* dst[LIBXSTREAM_MEM_BATCH_NCALIB] = {NULL};
+      size_t sizes[LIBXSTREAM_MEM_BATCH_NCALIB], size = 256;
+      char* const host = (char*)malloc((size_t)LIBXSTREAM_MEM_BATCH_NCALIB * LIBXSTREAM_MEM_BATCH_MAXSIZE);
+      libxstream_stream_t* stream = NULL;
+      int result = (NULL != host ? libxstream_stream_create(&stream, "batch", LIBXSTREAM_STREAM_DEFAULT) : EXIT_FAILURE);
+      int i, r;
+      for (i = 0; i < LIBXSTREAM_MEM_BATCH_NCALIB && EXIT_SUCCESS == result; ++i) { /* separate buffers like A, B, stack */
+        src[i] = host + (size_t)i * LIBXSTREAM_MEM_BATCH_MAXSIZE;
+        result = libxstream_mem_allocate(dst + i, LIBXSTREAM_MEM_BATCH_MAXSIZE);
+      }
+      if (EXIT_SUCCESS == result) memset(host, 0, (size_t)LIBXSTREAM_MEM_BATCH_NCALIB * LIBXSTREAM_MEM_BATCH_MAXSIZE);
+      for (; size <= LIBXSTREAM_MEM_BATCH_MAXSIZE && EXIT_SUCCESS == result; size <<= 2) {
+        double t_single = 0, t_batch = 0;
+        for (i = 0; i < LIBXSTREAM_MEM_BATCH_NCALIB; ++i) sizes[i] = size;
+        for (r = 0; r < 3 && EXIT_SUCCESS == result; ++r) { /* best of three, the first warms up */
+          libxs_timer_tick_t t0 = libxs_timer_tick();
+          double d;
+          for (i = 0; i < LIBXSTREAM_MEM_BATCH_NCALIB && EXIT_SUCCESS == result; ++i) {
+            result = libxstream_mem_copy_h2d(src[i], dst[i], size, stream);
+          }
+          if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+          d = libxs_timer_duration(t0, libxs_timer_tick());
+          if (0 == r || d < t_single) t_single = d;
+          t0 = libxs_timer_tick();
+          if (EXIT_SUCCESS == result) {
+            result = libxstream_opencl_mem_copy_h2d_batch(LIBXSTREAM_MEM_BATCH_NCALIB, src, dst, sizes, size, stream);
+          }
+          if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+          d = libxs_timer_duration(t0, libxs_timer_tick());
+          if (0 == r || d < t_batch) t_batch = d;
+        }
+        if (EXIT_SUCCESS == result && t_batch < t_single) batch = (int)size;
+        else break; /* larger items gain even less */
+      }
+      for (i = 0; i < LIBXSTREAM_MEM_BATCH_NCALIB; ++i) {
+        if (NULL != dst[i]) LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == libxstream_mem_deallocate(dst[i]));
+      }
+      if (NULL != stream) LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == libxstream_stream_destroy(stream));
+      free(host);
+      if (2 <= libxstream_opencl_config.verbosity || 0 > libxstream_opencl_config.verbosity) {
+        fprintf(stderr, "INFO ACC/OpenCL: batched H2D stages items up to %i bytes\n", batch);
+      }
+      LIBXS_ATOMIC_STORE(&libxstream_opencl_config.batch, batch, LIBXS_ATOMIC_SEQ_CST);
+    }
+  }
+  return (size_t)batch;
+}
+
+
+LIBXSTREAM_API int libxstream_mem_copy_h2d_batch(
+  int n, const void* const host_mem[], void* const dev_mem[], const size_t nbytes[], libxstream_stream_t* stream)
+{
+  const int result = libxstream_opencl_mem_copy_h2d_batch(
+    n, host_mem, dev_mem, nbytes, 1 < n ? libxstream_mem_batch_crossover() : 0, stream);
+  CL_RETURN(result, "");
+}
+
+
 LIBXSTREAM_API int libxstream_opencl_info_devmem(
   cl_device_id device, size_t* mem_free, size_t* mem_total, size_t* mem_local, int* mem_unified)
 {
@@ -1474,10 +2727,146 @@ LIBXSTREAM_API int libxstream_opencl_info_devmem(
 
 LIBXSTREAM_API int libxstream_mem_info(size_t* mem_free, size_t* mem_total)
 {
-  const cl_device_id device_id = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
+  const cl_device_id device_id = libxstream_opencl_config.devices[libxstream_opencl_device()->device_id];
   int result;
   result = libxstream_opencl_info_devmem(device_id, mem_free, mem_total, NULL /*mem_local*/, NULL /*mem_unified*/);
   CL_RETURN(result, "");
 }
 
+
+/**
+ * Tags are resolved when pushed (not per allocation): the registered names are
+ * scanned without a lock since a name is complete before ntags counts it, and
+ * only a new name takes lock_memtag. Without accounting (LIBXSTREAM_MEMTAG=0),
+ * or for threads beyond nthreads, pushing and popping has no effect.
+ */
+LIBXSTREAM_API int libxstream_mem_tag_push(const char* tag)
+{
+  libxstream_opencl_tag_stack_t* const stack = libxstream_mem_tag_stack();
+  int result = EXIT_SUCCESS;
+  if (NULL != stack) {
+    int ntags = LIBXS_ATOMIC_LOAD(&libxstream_opencl_config.ntags, LIBXS_ATOMIC_SEQ_CST), i = 1;
+    if (NULL != tag && '\0' != *tag) {
+      for (; i < ntags; ++i) {
+        if (0 == strncmp(libxstream_opencl_config.tags[i].name, tag, LIBXSTREAM_MAXSTRLEN - 1)) break;
+      }
+      if (i == ntags) { /* register (or find what another thread registered meanwhile) */
+        LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memtag);
+        ntags = libxstream_opencl_config.ntags;
+        for (; i < ntags; ++i) {
+          if (0 == strncmp(libxstream_opencl_config.tags[i].name, tag, LIBXSTREAM_MAXSTRLEN - 1)) break;
+        }
+        if (i == ntags) {
+          if (LIBXSTREAM_MAXNTAGS > ntags) {
+            LIBXS_SNPRINTF(libxstream_opencl_config.tags[i].name, LIBXSTREAM_MAXSTRLEN, "%s", tag);
+            LIBXS_ATOMIC_STORE(&libxstream_opencl_config.ntags, ntags + 1, LIBXS_ATOMIC_SEQ_CST);
+          }
+          else i = 0; /* untagged */
+        }
+        LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memtag);
+      }
+    }
+    else i = 0;
+    if (LIBXSTREAM_MEM_NTAGDEPTH > stack->n) stack->tag[stack->n] = i;
+    ++stack->n;
+  }
+  return result;
+}
+
+
+LIBXSTREAM_API int libxstream_mem_tag_pop(void)
+{
+  libxstream_opencl_tag_stack_t* const stack = libxstream_mem_tag_stack();
+  int result = EXIT_SUCCESS;
+  if (NULL != stack) {
+    if (0 < stack->n) --stack->n;
+    else result = EXIT_FAILURE; /* unbalanced */
+  }
+  return result;
+}
+
+
+LIBXSTREAM_API int libxstream_mem_tag_info(int index, libxstream_mem_tag_info_t* info)
+{
+  int result = EXIT_SUCCESS;
+  if (NULL != info && 0 <= index && index < LIBXS_ATOMIC_LOAD(&libxstream_opencl_config.ntags, LIBXS_ATOMIC_SEQ_CST)) {
+    const libxstream_opencl_tag_t* const tag = libxstream_opencl_config.tags + index;
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_memtag);
+    info->name = tag->name;
+    info->live = tag->live;
+    info->peak = tag->peak;
+    info->nallocs = tag->nallocs;
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_memtag);
+  }
+  else result = EXIT_FAILURE;
+  return result;
+}
+
+
+LIBXSTREAM_API int libxstream_mem_reclaim_register(libxstream_mem_reclaim_fn_t fn, void* arg, int priority)
+{
+  int result = EXIT_SUCCESS;
+  if (NULL != fn) {
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_main);
+    if (LIBXSTREAM_MAXNRECLAIM > libxstream_opencl_config.nreclaim) {
+      libxstream_opencl_reclaim_t* const reclaim = libxstream_opencl_config.reclaim;
+      int i = libxstream_opencl_config.nreclaim;
+      for (; 0 < i && priority < reclaim[i - 1].priority; --i) reclaim[i] = reclaim[i - 1]; /* insertion (stable) */
+      reclaim[i].fn = fn;
+      reclaim[i].arg = arg;
+      reclaim[i].priority = priority;
+      ++libxstream_opencl_config.nreclaim;
+    }
+    else result = EXIT_FAILURE;
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_main);
+  }
+  else result = EXIT_FAILURE;
+  CL_RETURN(result, "");
+}
+
+
+/**
+ * Once removed, a reclaimer is no longer picked up, but a caller may still run
+ * the copy it took; waiting for such callers means arg can be released when
+ * this returns (hence not from within a reclaimer).
+ */
+LIBXSTREAM_API int libxstream_mem_reclaim_unregister(libxstream_mem_reclaim_fn_t fn, void* arg)
+{
+  int result = EXIT_FAILURE, i = 0;
+  if (0 != libxstream_opencl_config.nreclaim) { /* nothing registered, or finalized already */
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_main);
+    for (; i < libxstream_opencl_config.nreclaim; ++i) {
+      if (fn == libxstream_opencl_config.reclaim[i].fn && arg == libxstream_opencl_config.reclaim[i].arg) {
+        for (--libxstream_opencl_config.nreclaim; i < libxstream_opencl_config.nreclaim; ++i) {
+          libxstream_opencl_config.reclaim[i] = libxstream_opencl_config.reclaim[i + 1];
+        }
+        result = EXIT_SUCCESS;
+      }
+    }
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_main);
+    while (0 != LIBXS_ATOMIC_LOAD(&libxstream_opencl_config.nreclaiming, LIBXS_ATOMIC_SEQ_CST)) LIBXS_SYNC_PAUSE;
+  }
+  return result;
+}
+
+
+LIBXSTREAM_API size_t libxstream_mem_reclaim(size_t nbytes)
+{
+  size_t result = 0;
+  if (0 != libxstream_opencl_config.nreclaim && 0 != nbytes) {
+    libxstream_opencl_reclaim_t reclaim[LIBXSTREAM_MAXNRECLAIM];
+    int n, i = 0;
+    LIBXS_ATOMIC_ADD_FETCH(&libxstream_opencl_config.nreclaiming, 1, LIBXS_ATOMIC_SEQ_CST);
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_main);
+    n = libxstream_opencl_config.nreclaim; /* run a copy: no lock is held while reclaiming */
+    memcpy(reclaim, libxstream_opencl_config.reclaim, sizeof(libxstream_opencl_reclaim_t) * n);
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_main);
+    for (; i < n && result < nbytes; ++i) result += reclaim[i].fn(nbytes - result, reclaim[i].arg);
+    LIBXS_ATOMIC_SUB_FETCH(&libxstream_opencl_config.nreclaiming, 1, LIBXS_ATOMIC_SEQ_CST);
+    LIBXS_ATOMIC_SIZE(LIBXS_ATOMIC_ADD_FETCH)(&libxstream_opencl_config.nreclaim_calls, 1, LIBXS_ATOMIC_RELAXED);
+    LIBXS_ATOMIC_SIZE(LIBXS_ATOMIC_ADD_FETCH)(&libxstream_opencl_config.nreclaim_bytes, result, LIBXS_ATOMIC_RELAXED);
+  }
+  return result;
+}
+
 #endif /*__OPENCL*/
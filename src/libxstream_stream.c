@@ -16,6 +16,8 @@ LIBXSTREAM_API const libxstream_opencl_stream_t* libxstream_opencl_stream(libxs_
 {
   const libxstream_opencl_stream_t *result = NULL, *result_main = NULL;
   const size_t n = LIBXSTREAM_MAXNITEMS * libxstream_opencl_config.nthreads;
+  /* only a stream on the thread's device qualifies (libxstream_device_bind) */
+  const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device_thread(thread_id);
   size_t i;
   assert(NULL != libxstream_opencl_config.streams);
   assert(thread_id < libxstream_opencl_config.nthreads);
@@ -23,37 +25,83 @@ LIBXSTREAM_API const libxstream_opencl_stream_t* libxstream_opencl_stream(libxs_
   for (i = libxstream_opencl_config.nstreams; i < n; ++i) {
     const libxstream_opencl_stream_t* const str = libxstream_opencl_config.streams[i];
     if (NULL != str && NULL != str->queue) {
-      if (str->tid == thread_id || 0 > thread_id) { /* hit */
-        result = str;
-        break;
-      }
-      else if (NULL == result_main && 0 == str->tid) {
-        result_main = str;
+      if (devinfo == str->devinfo) {
+        if (str->tid == thread_id || 0 > thread_id) { /* hit */
+          result = str;
+          break;
+        }
+        else if (NULL == result_main && 0 == str->tid) {
+          result_main = str;
+        }
       }
     }
     else break; /* error */
   }
   if (NULL == result) { /* fallback */
-    assert(NULL != libxstream_opencl_config.device.context);
-    result = (NULL != result_main ? result_main : &libxstream_opencl_config.device.stream);
+    assert(NULL != devinfo->context);
+    result = (NULL != result_main ? result_main : &devinfo->stream);
   }
   if (NULL != lock) LIBXS_LOCK_RELEASE(LIBXS_LOCK, lock);
   return result;
 }
 
 
-LIBXSTREAM_API const libxstream_opencl_stream_t* libxstream_opencl_stream_default(void)
+LIBXSTREAM_API const libxstream_opencl_stream_t* libxstream_opencl_stream_default_lock(libxs_lock_t* lock)
 {
   const libxstream_opencl_stream_t* result = NULL;
-  result = libxstream_opencl_stream(libxstream_opencl_config.lock_stream, libxs_tid());
+  const int tid = libxs_tid();
+  if (NULL != libxstream_opencl_config.stream_cache && tid < libxstream_opencl_config.nthreads) {
+    libxstream_opencl_stream_cache_t* const cache = libxstream_opencl_config.stream_cache + tid;
+    const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device_thread(tid);
+    /* epoch is loaded before a scan: a stream created or destroyed meanwhile invalidates the result */
+    const cl_int epoch = LIBXS_ATOMIC_LOAD(&libxstream_opencl_config.stream_epoch, LIBXS_ATOMIC_SEQ_CST);
+    if (NULL != cache->stream && epoch == cache->epoch && devinfo == cache->devinfo) result = cache->stream;
+    else {
+      result = libxstream_opencl_stream(lock, tid);
+      cache->stream = result;
+      cache->devinfo = devinfo;
+      cache->epoch = epoch;
+    }
+  }
+  else result = libxstream_opencl_stream(lock, tid);
   assert(NULL != result);
   return result;
 }
 
 
+LIBXSTREAM_API const libxstream_opencl_stream_t* libxstream_opencl_stream_default(void)
+{
+  return libxstream_opencl_stream_default_lock(libxstream_opencl_config.lock_stream);
+}
+
+
+/* Add (or remove) the stream to (from) the list of its thread-ID; lock_stream must be held. */
+static void libxstream_opencl_stream_list(libxstream_opencl_stream_t* str, int add)
+{
+  if (NULL != libxstream_opencl_config.stream_cache && 0 <= str->tid && str->tid < libxstream_opencl_config.nthreads) {
+    libxstream_opencl_stream_cache_t* const cache = libxstream_opencl_config.stream_cache + str->tid;
+    if (0 != add) {
+      if (LIBXSTREAM_STREAM_NCACHE > cache->n) cache->slot[cache->n++] = str;
+      else cache->n = LIBXSTREAM_STREAM_NCACHE + 1; /* sticky overflow: scan */
+    }
+    else if (LIBXSTREAM_STREAM_NCACHE >= cache->n) {
+      int i;
+      for (i = 0; i < cache->n; ++i) {
+        if (str == cache->slot[i]) {
+          cache->slot[i] = cache->slot[--cache->n];
+          cache->slot[cache->n] = NULL;
+          break;
+        }
+      }
+    }
+  }
+  LIBXS_ATOMIC_ADD_FETCH(&libxstream_opencl_config.stream_epoch, 1, LIBXS_ATOMIC_SEQ_CST);
+}
+
+
 LIBXSTREAM_API int libxstream_stream_create(libxstream_stream_t** stream_p, const char* name, int flags)
 {
-  const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+  libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
   LIBXSTREAM_STREAM_PROPERTIES_TYPE properties[9] = {
     CL_QUEUE_PROPERTIES, 0 /*placeholder*/, 0 /* terminator */
   };
@@ -104,7 +152,7 @@ LIBXSTREAM_API int libxstream_stream_create(libxstream_stream_t** stream_p, cons
   }
 # endif
   if (NULL != devinfo->context) {
-    const cl_device_id device_id = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
+    const cl_device_id device_id = libxstream_opencl_config.devices[devinfo->device_id];
     /* any profile needs timestamps on this queue: kernel durations come from the
        launch events, transfer rates from the copy events */
     if (0 != (LIBXSTREAM_STREAM_PROFILING & flags) || 0 != libxstream_opencl_config.profile ||
@@ -153,10 +201,16 @@ LIBXSTREAM_API int libxstream_stream_create(libxstream_stream_t** stream_p, cons
       LIBXS_MEMZERO(str);
 # endif
       str->queue = queue;
+      str->devinfo = devinfo;
+      str->capture = NULL;
+      str->marker = NULL;
+      str->idle = 1; /* nothing enqueued yet */
+      str->nsubmit = 0;
       str->tid = tid;
 # if defined(LIBXSTREAM_STREAM_PRIORITIES)
       str->priority = priority;
 # endif
+      libxstream_opencl_stream_list(str, 1 /*add*/);
     }
     else result = EXIT_FAILURE;
   }
@@ -175,6 +229,15 @@ LIBXSTREAM_API int libxstream_stream_destroy(libxstream_stream_t* stream)
   if (NULL != stream) {
     const libxstream_opencl_stream_t* const str = stream;
     const cl_command_queue queue = str->queue;
+    if (NULL != str->marker) LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(str->marker));
+    if (NULL != str->capture) { /* abandoned capture */
+      LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == libxstream_graph_destroy(str->capture));
+    }
+    if (NULL != libxstream_opencl_config.streams) { /* invalidate cached default streams */
+      LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_stream);
+      libxstream_opencl_stream_list((libxstream_opencl_stream_t*)stream, 0 /*remove*/);
+      LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_stream);
+    }
     /**
      * Clear unconditionally, not just when asserts are on: a cleared queue is
      * how a destroyed stream is recognized later. Device buffers record the
@@ -201,8 +264,8 @@ LIBXSTREAM_API int libxstream_stream_priority_range(int* least, int* greatest)
   assert(NULL == least || NULL == greatest || least != greatest); /* no alias */
 # if defined(LIBXSTREAM_STREAM_PRIORITIES)
   if (0 < libxstream_opencl_config.ndevices) {
-    const cl_device_id device_id = libxstream_opencl_config.devices[libxstream_opencl_config.device_id];
-    const libxstream_opencl_device_t* const devinfo = &libxstream_opencl_config.device;
+    const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
+    const cl_device_id device_id = libxstream_opencl_config.devices[devinfo->device_id];
     char buffer[LIBXSTREAM_BUFFERSIZE];
     cl_platform_id platform = NULL;
     assert(NULL != devinfo->context);
@@ -228,8 +291,14 @@ LIBXSTREAM_API int libxstream_stream_sync(libxstream_stream_t* stream)
 {
   const libxstream_opencl_stream_t* str = NULL;
   int result = EXIT_SUCCESS;
+  size_t nsubmit = 0;
   str = (NULL != stream ? stream : libxstream_opencl_stream_default());
   assert(NULL != str && NULL != str->queue);
+  if (0 != libxstream_opencl_config.elide) { /* submissions covered by the wait */
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+    nsubmit = str->nsubmit;
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+  }
   if (0 == (32 & libxstream_opencl_config.wa)) result = clFinish(str->queue);
   else {
     cl_event event = NULL;
@@ -244,6 +313,12 @@ LIBXSTREAM_API int libxstream_stream_sync(libxstream_stream_t* stream)
     }
     if (NULL != event) LIBXS_EXPECT_DEBUG(EXIT_SUCCESS == clReleaseEvent(event));
   }
+  if (EXIT_SUCCESS == result && 0 != libxstream_opencl_config.elide) { /* drained: libxstream_event_record */
+    LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+    /* another thread submitted meanwhile: its command may be pending, i.e., not idle */
+    if (nsubmit == str->nsubmit) ((libxstream_opencl_stream_t*)str)->idle = 1;
+    LIBXS_LOCK_RELEASE(LIBXS_LOCK, libxstream_opencl_config.lock_event);
+  }
   CL_RETURN(result, "");
 }
 
@@ -251,11 +326,25 @@ LIBXSTREAM_API int libxstream_stream_sync(libxstream_stream_t* stream)
 LIBXSTREAM_API int libxstream_opencl_device_synchronize(libxs_lock_t* lock, int thread_id)
 {
   int result = EXIT_SUCCESS;
-  const size_t n = LIBXSTREAM_MAXNITEMS * libxstream_opencl_config.nthreads;
+  size_t n = LIBXSTREAM_MAXNITEMS * libxstream_opencl_config.nthreads;
   size_t i;
   assert(thread_id < libxstream_opencl_config.nthreads);
   assert(NULL != libxstream_opencl_config.streams);
   if (NULL != lock) LIBXS_LOCK_ACQUIRE(LIBXS_LOCK, lock);
+  if (0 <= thread_id && NULL != libxstream_opencl_config.stream_cache &&
+      LIBXSTREAM_STREAM_NCACHE >= libxstream_opencl_config.stream_cache[thread_id].n)
+  { /* streams of the thread-ID (no scan) */
+    const libxstream_opencl_stream_cache_t* const cache = libxstream_opencl_config.stream_cache + thread_id;
+    int j;
+    for (j = 0; j < cache->n; ++j) {
+      const libxstream_opencl_stream_t* const str = cache->slot[j];
+      if (NULL != str && NULL != str->queue) {
+        result = clFinish(str->queue);
+        if (EXIT_SUCCESS != result) break;
+      }
+    }
+    n = 0; /* skip the scan */
+  }
   for (i = libxstream_opencl_config.nstreams; i < n; ++i) {
     const libxstream_opencl_stream_t* const str = libxstream_opencl_config.streams[i];
     if (NULL != str && NULL != str->queue) {
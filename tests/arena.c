@@ -0,0 +1,106 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NBYTES ((size_t)1 << 20)
+
+#if defined(__OPENCL)
+
+/**
+ * Two pieces carved from a claimed arena are disjoint and owned by it, a second
+ * claim is refused while the first is held, and a claim of more than the arena
+ * holds grows it by at least half again. Data written through a piece reads
+ * back. The default test build carries no OpenCL backend and skips; run
+ * "make OCL=1" to exercise this.
+ */
+int main(void)
+{
+  libxstream_mem_arena_t arena;
+  libxstream_stream_t* stream = NULL;
+  char hst[256], chk[256];
+  void *a = NULL, *b = NULL;
+  int result = libxstream_init(), ndevices = 0, i;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices) {
+    printf("arena: skipped (no OpenCL device)\n");
+    return EXIT_SUCCESS;
+  }
+  for (i = 0; i < (int)sizeof(hst); ++i) hst[i] = (char)i;
+  libxstream_mem_arena_init(&arena, (size_t)-1, libxstream_opencl_mem_hint_default);
+  result = libxstream_device_set_active(0);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_create(&stream, "arena", LIBXSTREAM_STREAM_DEFAULT);
+  if (EXIT_SUCCESS == result && 0 == libxstream_mem_arena_claim(&arena, 2 * NBYTES)) {
+    fprintf(stderr, "ERROR: arena not claimed\n");
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result) {
+    a = libxstream_mem_arena_alloc(&arena, NBYTES);
+    b = libxstream_mem_arena_alloc(&arena, NBYTES);
+    if (NULL == a || NULL == b || a == b || 0 == libxstream_mem_arena_owns(&arena, a) ||
+        0 == libxstream_mem_arena_owns(&arena, b) || 0 != libxstream_mem_arena_owns(&arena, hst))
+    {
+      fprintf(stderr, "ERROR: pieces not carved from the arena\n");
+      result = EXIT_FAILURE;
+    }
+    else if (0 != libxstream_mem_arena_claim(&arena, NBYTES)) {
+      fprintf(stderr, "ERROR: arena claimed twice\n");
+      result = EXIT_FAILURE;
+    }
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(hst, b, sizeof(hst), stream);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(b, chk, sizeof(chk), stream);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_arena_release(&arena, stream);
+  if (EXIT_SUCCESS == result) {
+    for (i = 0; i < (int)sizeof(hst); ++i) {
+      if (hst[i] != chk[i]) break;
+    }
+    if ((int)sizeof(hst) != i) {
+      fprintf(stderr, "ERROR: data mismatch at %i\n", i);
+      result = EXIT_FAILURE;
+    }
+  }
+  if (EXIT_SUCCESS == result) {
+    const size_t size = arena.size;
+    if (0 == libxstream_mem_arena_claim(&arena, size + 1)) {
+      fprintf(stderr, "ERROR: arena not claimed after release\n");
+      result = EXIT_FAILURE;
+    }
+    else {
+      if (arena.size < (size + size / 2) || 2 != arena.ngrow) {
+        fprintf(stderr, "ERROR: arena grew to %lu bytes\n", (unsigned long)arena.size);
+        result = EXIT_FAILURE;
+      }
+      libxstream_mem_arena_release(&arena, NULL);
+    }
+  }
+  libxstream_mem_arena_destroy(&arena);
+  if (NULL != stream) libxstream_stream_destroy(stream);
+  libxstream_finalize();
+  if (EXIT_SUCCESS == result) printf("arena: OK\n");
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("arena: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,99 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* items per batch, and the size staged when forcing the staged path */
+#define NITEMS 9
+#define CROSSOVER 4096
+
+#if defined(__OPENCL)
+
+/**
+ * Items of mixed size, some of which land in the same device buffer, are
+ * copied as a batch with a forced crossover (staged and individual items in
+ * one call) and with the measured one (public API), and read back. The
+ * default test build carries no OpenCL backend and skips; run "make OCL=1" to
+ * exercise this.
+ */
+int main(void)
+{
+  /* the first four items share dev[0] (one scatter, or one for all items under Intel USM), odd sizes included */
+  const size_t nbytes[NITEMS] = {24, 1000, 8, 333, 65536, 1, 2048, 4096, 4097};
+  const size_t offset[NITEMS] = {0, 64, 1064, 1200, 0, 0, 0, 0, 0};
+  const void* src[NITEMS];
+  void *dst[NITEMS], *dev[NITEMS] = {NULL};
+  unsigned char *host = NULL, *back = NULL;
+  libxstream_stream_t* stream = NULL;
+  size_t total = 0, i, j;
+  int result = libxstream_init(), ndevices = 0, pass;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices) {
+    printf("batch: skipped (no OpenCL device)\n");
+    return EXIT_SUCCESS;
+  }
+  for (i = 0; i < NITEMS; ++i) total += nbytes[i];
+  host = (unsigned char*)malloc(total);
+  back = (unsigned char*)malloc(65536 + 4096);
+  if (NULL == host || NULL == back) result = EXIT_FAILURE;
+  if (EXIT_SUCCESS == result) result = libxstream_device_set_active(0);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_create(&stream, "batch", LIBXSTREAM_STREAM_DEFAULT);
+  for (i = 0; i < NITEMS && EXIT_SUCCESS == result; ++i) { /* dev[0] holds items 0-3 */
+    if (4 <= i || 0 == i) result = libxstream_mem_allocate(dev + i, 4 > i ? 2048 : nbytes[i]);
+    dst[i] = (char*)dev[4 <= i ? i : 0] + offset[i];
+  }
+  for (pass = 0; pass < 2 && EXIT_SUCCESS == result; ++pass) {
+    size_t o = 0;
+    for (i = 0; i < NITEMS; ++i) {
+      for (j = 0; j < nbytes[i]; ++j) host[o + j] = (unsigned char)(pass * 101 + i * 31 + j);
+      src[i] = host + o;
+      o += nbytes[i];
+    }
+    if (0 == pass) { /* staged and individual items in one call */
+      result = libxstream_opencl_mem_copy_h2d_batch(NITEMS, src, dst, nbytes, CROSSOVER, stream);
+      if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+    }
+    else result = libxstream_mem_copy_h2d_batch(NITEMS, src, dst, nbytes, NULL);
+    for (i = 0, o = 0; i < NITEMS && EXIT_SUCCESS == result; o += nbytes[i++]) {
+      result = libxstream_mem_copy_d2h(dst[i], back, nbytes[i], NULL);
+      if (EXIT_SUCCESS == result && 0 != memcmp(back, host + o, nbytes[i])) {
+        fprintf(stderr, "ERROR: batch (pass %i) mismatch in item %i\n", pass, (int)i);
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+  for (i = 0; i < NITEMS; ++i) {
+    if (NULL != dev[i]) libxstream_mem_deallocate(dev[i]);
+  }
+  if (NULL != stream) libxstream_stream_destroy(stream);
+  libxstream_finalize();
+  free(host);
+  free(back);
+  if (EXIT_SUCCESS == result) printf("batch: OK\n");
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("batch: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,298 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* largest copy (argv[1] overrides, e.g., 1073741824) */
+#if !defined(MAXSIZE)
+# define MAXSIZE (16 << 20)
+#endif
+/* repetitions of the latency measurements */
+#if !defined(NREPEAT)
+# define NREPEAT 200
+#endif
+/* bytes moved per point of the bandwidth curve (1 to NREPEAT copies) */
+#if !defined(NBYTES_POINT)
+# define NBYTES_POINT (64 << 20)
+#endif
+/* results kept for the baseline comparison */
+#if !defined(NRESULTS)
+# define NRESULTS 1024
+#endif
+
+#if defined(__OPENCL)
+
+typedef struct bench_result_t {
+  char key[64];
+  double value;
+} bench_result_t;
+
+static bench_result_t bench_results[NRESULTS];
+static int bench_nresults;
+
+
+/* Keys ending in "_us" are latencies (lower is better), "_gbs" are bandwidths (higher is better). */
+static void bench_record(FILE* json, const char* prefix, const char* name, double value)
+{
+  if (NRESULTS > bench_nresults) {
+    bench_result_t* const r = bench_results + bench_nresults;
+    LIBXS_SNPRINTF(r->key, sizeof(r->key), "%s.%s", prefix, name);
+    r->value = value;
+    fprintf(json, "%s\n  \"%s\": %.6g", 0 < bench_nresults ? "," : "", r->key, value);
+    ++bench_nresults;
+  }
+}
+
+
+static int bench_kernel(const char* prefix, FILE* json)
+{
+  static const char source[] = "kernel void bench_empty(void) {}\n";
+  const size_t global = 1;
+  libxstream_stream_t* stream = NULL;
+  libxstream_event_t* event = NULL;
+  cl_kernel kernel = NULL;
+  libxs_timer_tick_t t0;
+  int result = libxstream_opencl_kernel(0 /*source_kind*/, source, "bench_empty", NULL /*build_params*/,
+    NULL /*build_options*/, NULL /*try*/, NULL /*try_ok*/, NULL /*exts*/, 0, &kernel);
+  int i;
+  if (EXIT_SUCCESS == result) result = libxstream_stream_create(&stream, "bench", LIBXSTREAM_STREAM_DEFAULT);
+  if (EXIT_SUCCESS == result) result = libxstream_event_create(&event);
+  if (EXIT_SUCCESS == result) { /* warmup */
+    result = libxstream_opencl_launch(stream, kernel, 1, NULL, &global, NULL, 0, NULL, NULL);
+    if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+  }
+  if (EXIT_SUCCESS == result) { /* submission: back-to-back launches */
+    t0 = libxs_timer_tick();
+    for (i = 0; i < NREPEAT && EXIT_SUCCESS == result; ++i) {
+      result = libxstream_opencl_launch(stream, kernel, 1, NULL, &global, NULL, 0, NULL, NULL);
+    }
+    if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+    bench_record(json, prefix, "launch_us", 1E6 * libxs_timer_duration(t0, libxs_timer_tick()) / NREPEAT);
+  }
+  if (EXIT_SUCCESS == result) { /* latency: launch and wait */
+    t0 = libxs_timer_tick();
+    for (i = 0; i < NREPEAT && EXIT_SUCCESS == result; ++i) {
+      result = libxstream_opencl_launch(stream, kernel, 1, NULL, &global, NULL, 0, NULL, NULL);
+      if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+    }
+    bench_record(json, prefix, "launch_sync_us", 1E6 * libxs_timer_duration(t0, libxs_timer_tick()) / NREPEAT);
+  }
+  if (EXIT_SUCCESS == result) { /* event round trip after a launch (not elided) */
+    double t_event = 0;
+    for (i = 0; i < NREPEAT && EXIT_SUCCESS == result; ++i) {
+      libxstream_bool_t occurred = 0;
+      result = libxstream_opencl_launch(stream, kernel, 1, NULL, &global, NULL, 0, NULL, NULL);
+      t0 = libxs_timer_tick();
+      if (EXIT_SUCCESS == result) result = libxstream_event_record(event, stream);
+      if (EXIT_SUCCESS == result) result = libxstream_event_query(event, &occurred);
+      if (EXIT_SUCCESS == result) result = libxstream_event_sync(event);
+      t_event += libxs_timer_duration(t0, libxs_timer_tick());
+    }
+    bench_record(json, prefix, "event_us", 1E6 * t_event / NREPEAT);
+  }
+  if (EXIT_SUCCESS == result) { /* stream creation and destruction */
+    t0 = libxs_timer_tick();
+    for (i = 0; i < NREPEAT && EXIT_SUCCESS == result; ++i) {
+      libxstream_stream_t* tmp = NULL;
+      result = libxstream_stream_create(&tmp, "bench_tmp", LIBXSTREAM_STREAM_DEFAULT);
+      if (EXIT_SUCCESS == result) result = libxstream_stream_destroy(tmp);
+    }
+    bench_record(json, prefix, "stream_us", 1E6 * libxs_timer_duration(t0, libxs_timer_tick()) / NREPEAT);
+  }
+  if (NULL != event) libxstream_event_destroy(event);
+  if (NULL != stream) libxstream_stream_destroy(stream);
+  if (NULL != kernel) clReleaseKernel(kernel);
+  return result;
+}
+
+
+static int bench_alloc(const char* prefix, FILE* json, size_t maxsize)
+{
+  int result = EXIT_SUCCESS;
+  size_t size;
+  for (size = 1024; size <= maxsize && EXIT_SUCCESS == result; size <<= 4) {
+    const libxs_timer_tick_t t0 = libxs_timer_tick();
+    char name[32];
+    int i;
+    for (i = 0; i < NREPEAT && EXIT_SUCCESS == result; ++i) {
+      void* p = NULL;
+      result = libxstream_mem_allocate(&p, size);
+      if (EXIT_SUCCESS == result) result = libxstream_mem_deallocate(p);
+    }
+    LIBXS_SNPRINTF(name, sizeof(name), "alloc.%lu_us", (unsigned long)size);
+    bench_record(json, prefix, name, 1E6 * libxs_timer_duration(t0, libxs_timer_tick()) / NREPEAT);
+  }
+  return result;
+}
+
+
+/* Bandwidth of h2d and d2h from 4 B to maxsize (factor 4) for the given host memory. */
+static int bench_copy(const char* prefix, FILE* json, size_t maxsize, char* host, void* dev, const char* kind)
+{
+  libxstream_stream_t* stream = NULL;
+  int result = libxstream_stream_create(&stream, "bench_copy", LIBXSTREAM_STREAM_DEFAULT);
+  size_t size;
+  for (size = 4; size <= maxsize && EXIT_SUCCESS == result; size <<= 2) {
+    const int nrep = (int)LIBXS_MIN(LIBXS_MAX(NBYTES_POINT / size, 1), NREPEAT);
+    double t[2] = { 0, 0 };
+    int d, i;
+    for (d = 0; d < 2 && EXIT_SUCCESS == result; ++d) {
+      const libxs_timer_tick_t t0 = libxs_timer_tick();
+      for (i = 0; i < nrep && EXIT_SUCCESS == result; ++i) {
+        result = (0 == d ? libxstream_mem_copy_h2d(host, dev, size, stream) : libxstream_mem_copy_d2h(dev, host, size, stream));
+      }
+      if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+      t[d] = libxs_timer_duration(t0, libxs_timer_tick());
+    }
+    if (EXIT_SUCCESS == result) {
+      char name[48];
+      LIBXS_SNPRINTF(name, sizeof(name), "copy.%s_h2d.%lu_gbs", kind, (unsigned long)size);
+      bench_record(json, prefix, name, 0 < t[0] ? (1E-9 * size * nrep / t[0]) : 0);
+      LIBXS_SNPRINTF(name, sizeof(name), "copy.%s_d2h.%lu_gbs", kind, (unsigned long)size);
+      bench_record(json, prefix, name, 0 < t[1] ? (1E-9 * size * nrep / t[1]) : 0);
+    }
+  }
+  if (NULL != stream) libxstream_stream_destroy(stream);
+  return result;
+}
+
+
+/**
+ * Compare with a baseline written by an earlier run (one "key": value per line),
+ * and count the results worse than the relative tolerance.
+ */
+static int bench_compare(const char* path, double tolerance)
+{
+  FILE* const file = fopen(path, "r");
+  char line[256], key[64];
+  int nworse = 0, ncompared = 0;
+  double base;
+  if (NULL == file) {
+    fprintf(stderr, "ERROR: cannot read baseline \"%s\"\n", path);
+    return -1;
+  }
+  while (NULL != fgets(line, sizeof(line), file)) {
+    if (2 == sscanf(line, " \"%63[^\"]\": %lf", key, &base) && 0 < base) {
+      const size_t len = strlen(key);
+      const int lower = (3 < len && 0 == strcmp(key + len - 3, "_us"));
+      int i;
+      for (i = 0; i < bench_nresults; ++i) {
+        if (0 == strcmp(key, bench_results[i].key)) {
+          const double value = bench_results[i].value;
+          const double ratio = (0 != lower ? (value / base) : (0 < value ? (base / value) : 2 + tolerance));
+          if (1 + tolerance < ratio) {
+            fprintf(stderr, "REGRESSION: %s %.6g vs. %.6g (%.0f%% worse)\n", key, value, base, 100 * (ratio - 1));
+            ++nworse;
+          }
+          ++ncompared;
+          break;
+        }
+      }
+    }
+  }
+  fclose(file);
+  fprintf(stderr, "bench: %i of %i results compared are worse than the baseline (tolerance %.0f%%)\n",
+    nworse, ncompared, 100 * tolerance);
+  return nworse;
+}
+
+
+/**
+ * Overheads of the library itself, per USM level (each run initializes anew;
+ * levels the device does not offer, and levels resolving to an earlier one,
+ * are skipped). Results are written as JSON to stdout (or BENCH_JSON), and
+ * compared with BENCH_BASELINE (a file written earlier) if given, failing
+ * beyond BENCH_TOLERANCE (default: 0.5, i.e., 50% worse). Runs on any OpenCL
+ * device including a CPU runtime. The default test build carries no OpenCL
+ * backend and skips; run "make OCL=1" to exercise this.
+ */
+int main(int argc, char* argv[])
+{
+  const char *const json_env = getenv("BENCH_JSON"), *const base_env = getenv("BENCH_BASELINE");
+  const char* const tol_env = getenv("BENCH_TOLERANCE");
+  const size_t maxsize = (1 < argc ? (size_t)strtoul(argv[1], NULL, 10) : (size_t)MAXSIZE);
+  const double tolerance = (NULL == tol_env ? 0.5 : atof(tol_env));
+  FILE* const json = (NULL == json_env ? stdout : fopen(json_env, "w"));
+  int result = (NULL != json && 4 <= maxsize) ? EXIT_SUCCESS : EXIT_FAILURE;
+  int seen[8] = { 0 }, nseen = 0, nruns = 0, level;
+  if (EXIT_SUCCESS != result) {
+    fprintf(stderr, "ERROR: invalid arguments or output \"%s\"\n", NULL != json_env ? json_env : "");
+    return result;
+  }
+  fprintf(json, "{");
+  for (level = 0; level <= 3 && EXIT_SUCCESS == result; ++level) {
+    libxstream_init_config_t cfg;
+    int ndevices = 0, state, i;
+    libxstream_init_config_default(&cfg);
+    cfg.usm = level;
+    if (EXIT_SUCCESS != libxstream_init_config(&cfg) || EXIT_SUCCESS != libxstream_device_count(&ndevices) ||
+        0 >= ndevices || EXIT_SUCCESS != libxstream_device_set_active(0))
+    {
+      libxstream_finalize();
+      continue;
+    }
+    /* what the level resolved to: Intel USM, SVM capabilities, or buffers */
+    state = (NULL != libxstream_opencl_config.device.clMemFreeINTEL ? 1 : (2 + (int)libxstream_opencl_config.device.usm));
+    for (i = 0; i < nseen && state != seen[i]; ++i);
+    if (i == nseen && nseen < (int)(sizeof(seen) / sizeof(*seen))) {
+      const size_t devsize = LIBXS_MAX(maxsize, 1024);
+      char prefix[16], *pinned = NULL, *pageable = (char*)malloc(devsize);
+      void* dev = NULL;
+      seen[nseen++] = state;
+      LIBXS_SNPRINTF(prefix, sizeof(prefix), "usm%i", level);
+      result = bench_kernel(prefix, json);
+      if (EXIT_SUCCESS == result) result = bench_alloc(prefix, json, maxsize);
+      if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&dev, devsize);
+      if (EXIT_SUCCESS == result) result = libxstream_mem_host_allocate((void**)&pinned, devsize, NULL);
+      if (EXIT_SUCCESS == result && NULL == pageable) result = EXIT_FAILURE;
+      if (EXIT_SUCCESS == result) {
+        memset(pageable, 1, devsize);
+        memset(pinned, 1, devsize);
+        result = bench_copy(prefix, json, maxsize, pinned, dev, "pinned");
+      }
+      if (EXIT_SUCCESS == result) result = bench_copy(prefix, json, maxsize, pageable, dev, "pageable");
+      if (NULL != pinned) libxstream_mem_host_deallocate(pinned, NULL);
+      if (NULL != dev) libxstream_mem_deallocate(dev);
+      free(pageable);
+      ++nruns;
+    }
+    libxstream_finalize();
+  }
+  fprintf(json, "\n}\n");
+  if (NULL != json_env) fclose(json);
+  if (EXIT_SUCCESS == result && 0 == nruns) {
+    fprintf(stderr, "bench: skipped (no OpenCL device)\n");
+  }
+  else if (EXIT_SUCCESS == result && NULL != base_env) {
+    if (0 != bench_compare(base_env, tolerance)) result = EXIT_FAILURE;
+  }
+  else if (EXIT_SUCCESS != result) {
+    fprintf(stderr, "ERROR: bench failed\n");
+  }
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("bench: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
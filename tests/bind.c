@@ -0,0 +1,106 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined(NVALUES)
+# define NVALUES 4096
+#endif
+
+#if defined(__OPENCL)
+
+/**
+ * Binds the last device to the calling thread, allocates and uploads on a
+ * stream of that device, then follows the active device again: the download
+ * through the bound stream and the free must still resolve the memory of the
+ * bound device (as a host function or another thread would). An ID beyond the
+ * number of devices is refused. The default test build carries no OpenCL
+ * backend and skips; run "make OCL=1" to exercise this.
+ */
+int main(void)
+{
+  const size_t nbytes = sizeof(int) * NVALUES;
+  int *src = (int*)malloc(nbytes), *dst = (int*)malloc(nbytes);
+  libxstream_stream_t* stream = NULL;
+  libxstream_opencl_device_t* bound = NULL;
+  void* dev = NULL;
+  int result = libxstream_init(), ndevices = 0, i;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices || NULL == src || NULL == dst) {
+    printf("bind: skipped (no OpenCL device)\n");
+    free(src);
+    free(dst);
+    return EXIT_SUCCESS;
+  }
+  for (i = 0; i < NVALUES; ++i) {
+    src[i] = i;
+    dst[i] = -1;
+  }
+  result = libxstream_device_set_active(0);
+  if (EXIT_SUCCESS == result && EXIT_SUCCESS == libxstream_device_bind(ndevices)) {
+    fprintf(stderr, "ERROR: bound a device that does not exist\n");
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_device_bind(ndevices - 1);
+  if (EXIT_SUCCESS == result) {
+    bound = libxstream_opencl_device();
+    if (ndevices - 1 != bound->device_id) {
+      fprintf(stderr, "ERROR: thread follows device %i rather than %i\n", bound->device_id, ndevices - 1);
+      result = EXIT_FAILURE;
+    }
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_stream_create(&stream, "bind", LIBXSTREAM_STREAM_DEFAULT);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&dev, nbytes);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(src, dev, nbytes, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_device_bind(-1);
+  if (EXIT_SUCCESS == result && libxstream_opencl_device() != &libxstream_opencl_config.device) {
+    fprintf(stderr, "ERROR: thread still bound\n");
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result && bound != libxstream_opencl_device_owner(dev)) {
+    fprintf(stderr, "ERROR: memory not attributed to the bound device\n");
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(dev, dst, nbytes, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+  for (i = 0; i < NVALUES && EXIT_SUCCESS == result; ++i) {
+    if (i != dst[i]) {
+      fprintf(stderr, "ERROR: data mismatch at %i (%i)\n", i, dst[i]);
+      result = EXIT_FAILURE;
+    }
+  }
+  if (NULL != dev) { /* freed without the binding */
+    const int result_free = libxstream_mem_deallocate(dev);
+    if (EXIT_SUCCESS == result) result = result_free;
+  }
+  if (NULL != stream) libxstream_stream_destroy(stream);
+  libxstream_finalize();
+  free(src);
+  free(dst);
+  if (EXIT_SUCCESS == result) printf("bind: OK\n");
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("bind: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
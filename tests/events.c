@@ -0,0 +1,137 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined(NVALUES)
+# define NVALUES 4096
+#endif
+
+#if defined(__OPENCL)
+
+/**
+ * A record on a drained stream needs no marker, a second record without a
+ * command in between shares the first marker, and a wait on the stream the
+ * event was recorded on is implied (the internal stream included); the
+ * elision counters account for all of it. A destroyed event handle is
+ * recycled by the next create on the same thread. The default test build
+ * carries no OpenCL backend and skips; run "make OCL=1" to exercise this.
+ */
+int main(void)
+{
+  const size_t nbytes = sizeof(int) * NVALUES;
+  int* const hst = (int*)calloc(NVALUES, sizeof(int));
+  libxstream_stream_t* stream = NULL;
+  libxstream_event_t *a = NULL, *b = NULL, *c = NULL;
+  size_t nmarker = 0, nwait = 0;
+  void* dev = NULL;
+  libxstream_bool_t occurred = 0;
+  int result = libxstream_init(), ndevices = 0;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices || NULL == hst) {
+    printf("events: skipped (no OpenCL device)\n");
+    free(hst);
+    return EXIT_SUCCESS;
+  }
+  if (0 == libxstream_opencl_config.elide) {
+    printf("events: skipped (LIBXSTREAM_ELIDE=0)\n");
+    libxstream_finalize();
+    free(hst);
+    return EXIT_SUCCESS;
+  }
+  result = libxstream_device_set_active(0);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_create(&stream, "events", LIBXSTREAM_STREAM_DEFAULT);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&dev, nbytes);
+  if (EXIT_SUCCESS == result) result = libxstream_event_create(&a);
+  if (EXIT_SUCCESS == result) result = libxstream_event_create(&b);
+  if (EXIT_SUCCESS == result) { /* idle stream */
+    nmarker = libxstream_opencl_config.nmarker_elided;
+    result = libxstream_event_record(a, stream);
+    if (EXIT_SUCCESS == result) result = libxstream_event_query(a, &occurred);
+    if (EXIT_SUCCESS == result && (NULL != a->cl_evt || 0 == occurred ||
+        nmarker + 1 != libxstream_opencl_config.nmarker_elided))
+    {
+      fprintf(stderr, "ERROR: record on an idle stream enqueued a marker\n");
+      result = EXIT_FAILURE;
+    }
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(hst, dev, nbytes, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_event_record(a, stream);
+  if (EXIT_SUCCESS == result) { /* no command since */
+    nmarker = libxstream_opencl_config.nmarker_elided;
+    result = libxstream_event_record(b, stream);
+    if (EXIT_SUCCESS == result && (NULL == a->cl_evt || a->cl_evt != b->cl_evt ||
+        nmarker + 1 != libxstream_opencl_config.nmarker_elided))
+    {
+      fprintf(stderr, "ERROR: marker not shared\n");
+      result = EXIT_FAILURE;
+    }
+  }
+  if (EXIT_SUCCESS == result) { /* same in-order stream */
+    nwait = libxstream_opencl_config.nwait_elided;
+    result = libxstream_stream_wait_event(stream, b);
+    if (EXIT_SUCCESS == result && nwait + 1 != libxstream_opencl_config.nwait_elided) {
+      fprintf(stderr, "ERROR: wait on the recording stream not elided\n");
+      result = EXIT_FAILURE;
+    }
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(hst, dev, nbytes, NULL);
+  if (EXIT_SUCCESS == result) result = libxstream_event_record(b, NULL);
+  if (EXIT_SUCCESS == result) { /* internal stream is in-order as well */
+    nwait = libxstream_opencl_config.nwait_elided;
+    result = libxstream_stream_wait_event(NULL, b);
+    if (EXIT_SUCCESS == result && nwait + 1 != libxstream_opencl_config.nwait_elided) {
+      fprintf(stderr, "ERROR: wait on the internal stream not elided\n");
+      result = EXIT_FAILURE;
+    }
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+  if (EXIT_SUCCESS == result) { /* recycled handle */
+    result = libxstream_event_destroy(b);
+    b = NULL;
+    if (EXIT_SUCCESS == result) result = libxstream_event_create(&c);
+    if (EXIT_SUCCESS == result && NULL != libxstream_opencl_config.event_cache) {
+      libxstream_event_t* const d = c;
+      result = libxstream_event_destroy(c);
+      c = NULL;
+      if (EXIT_SUCCESS == result) result = libxstream_event_create(&c);
+      if (EXIT_SUCCESS == result && (d != c || NULL != c->cl_evt)) {
+        fprintf(stderr, "ERROR: event handle not recycled\n");
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+  if (NULL != c) libxstream_event_destroy(c);
+  if (NULL != b) libxstream_event_destroy(b);
+  if (NULL != a) libxstream_event_destroy(a);
+  if (NULL != dev) libxstream_mem_deallocate(dev);
+  if (NULL != stream) libxstream_stream_destroy(stream);
+  libxstream_finalize();
+  free(hst);
+  if (EXIT_SUCCESS == result) printf("events: OK\n");
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("events: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
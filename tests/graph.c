@@ -0,0 +1,120 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined(NVALUES)
+# define NVALUES 4096
+#endif
+#if !defined(NREPLAY)
+# define NREPLAY 2
+#endif
+
+#if defined(__OPENCL) && defined(CL_VERSION_2_1) /* clCloneKernel */
+
+/**
+ * Captures an upload, a kernel, and a download, and replays the graph with new
+ * host data each time: the copies read and write host memory at launch, while
+ * the kernel keeps the argument it had at capture (changed afterwards). Events
+ * are refused while capturing. The default test build carries no OpenCL backend
+ * and skips; run "make OCL=1" to exercise this.
+ */
+int main(void)
+{
+  static const char source[] = "kernel void graph_axpb(global int* a, int s) {\n"
+                               "  const size_t i = get_global_id(0);\n"
+                               "  a[i] = s * a[i] + 1;\n"
+                               "}\n";
+  const size_t nbytes = sizeof(int) * NVALUES, global = NVALUES;
+  int *src = (int*)malloc(nbytes), *dst = (int*)malloc(nbytes);
+  libxstream_stream_t* stream = NULL;
+  libxstream_graph_t* graph = NULL;
+  libxstream_event_t* event = NULL;
+  cl_kernel kernel = NULL;
+  void* dev = NULL;
+  int result = libxstream_init(), ndevices = 0, scale = 2, replay, i;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices || NULL == src || NULL == dst) {
+    printf("graph: skipped (no OpenCL device)\n");
+    free(src);
+    free(dst);
+    return EXIT_SUCCESS;
+  }
+  result = libxstream_device_set_active(0);
+  if (EXIT_SUCCESS == result) {
+    result = libxstream_opencl_kernel(0 /*source_kind*/, source, "graph_axpb", NULL /*build_params*/, NULL /*build_options*/,
+      NULL /*try*/, NULL /*try_ok*/, NULL /*exts*/, 0, &kernel);
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_stream_create(&stream, "graph", LIBXSTREAM_STREAM_DEFAULT);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&dev, nbytes);
+  if (EXIT_SUCCESS == result) result = libxstream_opencl_set_kernel_ptr(kernel, 0, dev);
+  if (EXIT_SUCCESS == result) result = clSetKernelArg(kernel, 1, sizeof(int), &scale);
+  if (EXIT_SUCCESS == result) result = libxstream_event_create(&event);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_begin_capture(stream);
+  if (EXIT_SUCCESS == result && (EXIT_SUCCESS == libxstream_event_record(event, stream) ||
+      EXIT_SUCCESS == libxstream_stream_wait_event(stream, event)))
+  {
+    fprintf(stderr, "ERROR: event recorded or waited on while capturing\n");
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(src, dev, nbytes, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_opencl_launch(stream, kernel, 1, NULL, &global, NULL, 0, NULL, NULL);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(dev, dst, nbytes, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_end_capture(stream, &graph);
+  if (EXIT_SUCCESS == result) { /* not part of the graph */
+    const int other = scale + 1;
+    result = clSetKernelArg(kernel, 1, sizeof(int), &other);
+  }
+  for (replay = 0; replay < NREPLAY && EXIT_SUCCESS == result; ++replay) {
+    for (i = 0; i < NVALUES; ++i) {
+      src[i] = i + replay;
+      dst[i] = -1;
+    }
+    result = libxstream_graph_launch(graph, stream);
+    if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+    for (i = 0; i < NVALUES && EXIT_SUCCESS == result; ++i) {
+      if (scale * (i + replay) + 1 != dst[i]) {
+        fprintf(stderr, "ERROR: replay %i mismatch at %i (%i)\n", replay, i, dst[i]);
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+  if (NULL != graph) libxstream_graph_destroy(graph);
+  if (NULL != event) libxstream_event_destroy(event);
+  if (NULL != dev) libxstream_mem_deallocate(dev);
+  if (NULL != stream) libxstream_stream_destroy(stream);
+  if (NULL != kernel) clReleaseKernel(kernel);
+  libxstream_finalize();
+  free(src);
+  free(dst);
+  if (EXIT_SUCCESS == result) printf("graph: OK\n");
+  return result;
+}
+
+#else
+
+int main(void)
+{
+# if defined(__OPENCL)
+  printf("graph: skipped (OpenCL 2.1 or later required)\n");
+# else
+  printf("graph: skipped (OpenCL backend not compiled in)\n");
+# endif
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,164 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(NVALUES)
+# define NVALUES 4096
+#endif
+#if !defined(NCALLS)
+# define NCALLS 16
+#endif
+
+#if defined(__OPENCL)
+
+typedef struct hostfn_data_t {
+  const int* dst; /* expected to be complete */
+  int* src; /* rewritten before the next copy */
+  int value, nerrors;
+  int order[NCALLS], n;
+} hostfn_data_t;
+
+typedef struct hostfn_call_t {
+  hostfn_data_t* data;
+  int index;
+} hostfn_call_t;
+
+
+/* Work enqueued before the function has completed: the downloaded values are present. */
+static void hostfn_check(void* arg)
+{
+  hostfn_data_t* const data = (hostfn_data_t*)arg;
+  int i;
+  for (i = 0; i < NVALUES; ++i) {
+    if (data->value != data->dst[i]) {
+      ++data->nerrors;
+      break;
+    }
+  }
+}
+
+
+/* Work enqueued after the function waits for it: the upload reads what is written here. */
+static void hostfn_modify(void* arg)
+{
+  hostfn_data_t* const data = (hostfn_data_t*)arg;
+  int i;
+  for (i = 0; i < NVALUES; ++i) data->src[i] = data->value + 1;
+}
+
+
+static void hostfn_order(void* arg)
+{
+  const hostfn_call_t* const call = (const hostfn_call_t*)arg;
+  hostfn_data_t* const data = call->data;
+  if (data->n < NCALLS) data->order[data->n] = call->index;
+  ++data->n;
+}
+
+
+/**
+ * Runs on any OpenCL device, including a CPU runtime (e.g., PoCL) as found in
+ * CI. The default test build carries no OpenCL backend and skips; run "make
+ * OCL=1" to exercise this.
+ */
+int main(void)
+{
+  const size_t nbytes = sizeof(int) * NVALUES;
+  int *src = (int*)malloc(nbytes), *dst = (int*)malloc(nbytes);
+  libxstream_stream_t* stream = NULL;
+  void* dev = NULL;
+  hostfn_call_t calls[NCALLS];
+  hostfn_data_t data;
+  int result = libxstream_init(), ndevices = 0, i;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices || NULL == src || NULL == dst) {
+    printf("hostfn: skipped (no OpenCL device)\n");
+    free(src);
+    free(dst);
+    return EXIT_SUCCESS;
+  }
+  memset(&data, 0, sizeof(data));
+  data.dst = dst;
+  data.src = src;
+  data.value = 42;
+  for (i = 0; i < NVALUES; ++i) {
+    src[i] = data.value;
+    dst[i] = 0;
+  }
+  result = libxstream_device_set_active(0);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_create(&stream, "hostfn", LIBXSTREAM_STREAM_DEFAULT);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&dev, nbytes);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(src, dev, nbytes, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(dev, dst, nbytes, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_enqueue_host_fn(stream, hostfn_check, &data);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_enqueue_host_fn(stream, hostfn_modify, &data);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(src, dev, nbytes, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(dev, dst, nbytes, stream);
+  for (i = 0; i < NCALLS && EXIT_SUCCESS == result; ++i) {
+    calls[i].data = &data;
+    calls[i].index = i;
+    result = libxstream_stream_enqueue_host_fn(stream, hostfn_order, calls + i);
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+  if (EXIT_SUCCESS == result) { /* sync covers the functions as well */
+    if (0 != data.nerrors) {
+      fprintf(stderr, "ERROR: host function ran before the preceding download completed\n");
+      result = EXIT_FAILURE;
+    }
+    for (i = 0; i < NVALUES && EXIT_SUCCESS == result; ++i) {
+      if (data.value + 1 != dst[i]) {
+        fprintf(stderr, "ERROR: upload did not wait for the host function (%i: %i)\n", i, dst[i]);
+        result = EXIT_FAILURE;
+      }
+    }
+    if (EXIT_SUCCESS == result && NCALLS != data.n) {
+      fprintf(stderr, "ERROR: %i of %i host functions ran\n", data.n, NCALLS);
+      result = EXIT_FAILURE;
+    }
+    for (i = 0; i < NCALLS && EXIT_SUCCESS == result; ++i) {
+      if (i != data.order[i]) {
+        fprintf(stderr, "ERROR: host functions ran out of order\n");
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+  if (EXIT_SUCCESS == result) { /* a function is required */
+    if (EXIT_SUCCESS == libxstream_stream_enqueue_host_fn(stream, NULL, &data)) {
+      fprintf(stderr, "ERROR: expected refusal of a NULL function\n");
+      result = EXIT_FAILURE;
+    }
+  }
+  if (NULL != dev) libxstream_mem_deallocate(dev);
+  if (NULL != stream) libxstream_stream_destroy(stream);
+  libxstream_finalize();
+  free(src);
+  free(dst);
+  if (EXIT_SUCCESS == result) printf("hostfn: OK\n");
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("hostfn: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,112 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* allocations per tag (more than the initial table, which must grow) */
+#define NALLOCS 1500
+#define NBYTES 4096
+
+#if defined(__OPENCL)
+
+/** Index of the named tag, or a negative value if not registered. */
+static int tag_index(const char* name, libxstream_mem_tag_info_t* info)
+{
+  int i = 0;
+  for (; EXIT_SUCCESS == libxstream_mem_tag_info(i, info); ++i) {
+    if (0 == strcmp(name, info->name)) return i;
+  }
+  return -1;
+}
+
+
+/**
+ * Allocations under nested tags are attributed to the innermost tag, and freed
+ * in a different order (and scope) than allocated: live bytes must return to
+ * zero while the peak and the number of allocations remain. The default test
+ * build carries no OpenCL backend and skips; run "make OCL=1" to exercise this.
+ */
+int main(void)
+{
+  static void *outer[NALLOCS], *inner[NALLOCS];
+  libxstream_mem_tag_info_t info;
+  int result = libxstream_init(), ndevices = 0, i;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices) {
+    printf("memtag: skipped (no OpenCL device)\n");
+    return EXIT_SUCCESS;
+  }
+  if (0 == libxstream_opencl_config.memtag) {
+    libxstream_finalize();
+    printf("memtag: skipped (LIBXSTREAM_MEMTAG=0)\n");
+    return EXIT_SUCCESS;
+  }
+  result = libxstream_device_set_active(0);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_tag_push("memtag-outer");
+  for (i = 0; i < NALLOCS && EXIT_SUCCESS == result; ++i) {
+    result = libxstream_mem_allocate(outer + i, NBYTES);
+    if (EXIT_SUCCESS == result) { /* interleaved with the inner tag */
+      result = libxstream_mem_tag_push("memtag-inner");
+      if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(inner + i, 2 * NBYTES);
+      if (EXIT_SUCCESS == result) result = libxstream_mem_tag_pop();
+    }
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_mem_tag_pop();
+  if (EXIT_SUCCESS == result && EXIT_SUCCESS == libxstream_mem_tag_pop()) {
+    fprintf(stderr, "ERROR: unbalanced pop succeeded\n");
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result && (0 > tag_index("memtag-outer", &info) || (size_t)NALLOCS * NBYTES != info.live)) {
+    fprintf(stderr, "ERROR: outer tag accounts %lu bytes\n", (unsigned long)info.live);
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result && (0 > tag_index("memtag-inner", &info) || (size_t)NALLOCS * 2 * NBYTES != info.live)) {
+    fprintf(stderr, "ERROR: inner tag accounts %lu bytes\n", (unsigned long)info.live);
+    result = EXIT_FAILURE;
+  }
+  for (i = NALLOCS - 1; 0 <= i; --i) { /* reverse order, no tag pushed */
+    if (NULL != inner[i]) libxstream_mem_deallocate(inner[i]);
+  }
+  for (i = 0; i < NALLOCS; ++i) {
+    if (NULL != outer[i]) libxstream_mem_deallocate(outer[i]);
+  }
+  if (EXIT_SUCCESS == result) {
+    const char* const name[] = {"memtag-outer", "memtag-inner"};
+    for (i = 0; i < 2 && EXIT_SUCCESS == result; ++i) {
+      const size_t peak = (size_t)NALLOCS * (i + 1) * NBYTES;
+      if (0 > tag_index(name[i], &info) || 0 != info.live || peak != info.peak || NALLOCS != info.nallocs) {
+        fprintf(stderr, "ERROR: tag \"%s\" live=%lu peak=%lu nallocs=%lu after release\n", name[i],
+          (unsigned long)info.live, (unsigned long)info.peak, (unsigned long)info.nallocs);
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+  libxstream_finalize();
+  if (EXIT_SUCCESS == result) printf("memtag: OK\n");
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("memtag: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,107 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined(NBYTES)
+# define NBYTES (4 << 20)
+#endif
+
+#if defined(__OPENCL)
+
+/**
+ * Host memory follows the node of the calling thread's device (LIBXSTREAM_NUMA=2):
+ * the device is attributed to each node in turn, and the bytes the node's pool
+ * obtains must grow while every other node stays put. Pools exist for online
+ * nodes only and carry their node ID. A host with a single node checks the one
+ * pool. The default test build carries no OpenCL backend and skips; run "make
+ * OCL=1" to exercise this.
+ */
+int main(void)
+{
+  void* mem[LIBXSTREAM_MAXNNODES] = {NULL};
+  libxstream_opencl_device_t* devinfo = NULL;
+  int result = libxstream_init(), ndevices = 0, node, i;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices) {
+    printf("numa: skipped (no OpenCL device)\n");
+    return EXIT_SUCCESS;
+  }
+  result = libxstream_device_set_active(0);
+  if (EXIT_SUCCESS == result && (1 > libxstream_opencl_config.nnodes ||
+      LIBXSTREAM_MAXNNODES < libxstream_opencl_config.nnodes ||
+      libxstream_opencl_config.pool_hst != libxstream_opencl_config.pool_hst_node[0]))
+  {
+    fprintf(stderr, "ERROR: no host pool for node0 (%i nodes)\n", libxstream_opencl_config.nnodes);
+    result = EXIT_FAILURE;
+  }
+  for (node = 1; node < libxstream_opencl_config.nnodes && EXIT_SUCCESS == result; ++node) {
+    if (NULL != libxstream_opencl_config.pool_hst_node[node] && node != libxstream_opencl_config.pool_hst_nodeid[node]) {
+      fprintf(stderr, "ERROR: host pool node%i carries node %i\n", node, libxstream_opencl_config.pool_hst_nodeid[node]);
+      result = EXIT_FAILURE;
+    }
+  }
+  if (EXIT_SUCCESS == result) {
+    const cl_int numa = libxstream_opencl_config.numa;
+    cl_int devnuma;
+    devinfo = libxstream_opencl_device();
+    devnuma = devinfo->numa;
+    libxstream_opencl_config.numa = 2;
+    for (node = 0; node < libxstream_opencl_config.nnodes && EXIT_SUCCESS == result; ++node) {
+      size_t nbytes[LIBXSTREAM_MAXNNODES];
+      libxs_malloc_pool_info_t info;
+      if (NULL == libxstream_opencl_config.pool_hst_node[node]) continue; /* offline */
+      for (i = 0; i < libxstream_opencl_config.nnodes; ++i) nbytes[i] = libxstream_opencl_config.pool_hst_nbytes[i];
+      devinfo->numa = node;
+      result = libxstream_mem_host_allocate(mem + node, NBYTES, NULL);
+      for (i = 0; i < libxstream_opencl_config.nnodes && EXIT_SUCCESS == result; ++i) {
+        const int grown = (nbytes[i] < libxstream_opencl_config.pool_hst_nbytes[i]);
+        if (1 < libxstream_opencl_config.nnodes && (i == node) != grown) {
+          fprintf(stderr, "ERROR: memory for node%i %s node%i\n", node, grown ? "placed on" : "not placed on", i);
+          result = EXIT_FAILURE;
+        }
+      }
+      if (EXIT_SUCCESS == result &&
+          (EXIT_SUCCESS != libxs_malloc_pool_info(libxstream_opencl_config.pool_hst_node[node], &info) || NBYTES > info.peak))
+      {
+        fprintf(stderr, "ERROR: statistics of host pool node%i\n", node);
+        result = EXIT_FAILURE;
+      }
+    }
+    devinfo->numa = devnuma;
+    libxstream_opencl_config.numa = numa;
+  }
+  for (node = 0; node < LIBXSTREAM_MAXNNODES; ++node) {
+    if (NULL != mem[node]) {
+      const int result_free = libxstream_mem_host_deallocate(mem[node], NULL);
+      if (EXIT_SUCCESS == result) result = result_free;
+    }
+  }
+  libxstream_finalize();
+  if (EXIT_SUCCESS == result) printf("numa: OK\n");
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("numa: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,90 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* bytes copied (not a multiple of the chunk), and the chunk forced */
+#define NBYTES (3 * 65536 + 123)
+#define CHUNK 65536
+
+#if defined(__OPENCL)
+
+/**
+ * A buffer is copied between devices and read back: relayed through host
+ * memory with a forced chunk (also on a single device), and with the public
+ * API, which copies directly where it can. With two devices or more, the
+ * destination is allocated and read by a stream of the second device. The
+ * default test build carries no OpenCL backend and skips; run "make OCL=1".
+ */
+int main(void)
+{
+  libxstream_stream_t *src_stream = NULL, *dst_stream = NULL;
+  unsigned char *host = NULL, *back = NULL;
+  void *src = NULL, *dst = NULL;
+  int result = libxstream_init(), ndevices = 0, pass, i;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices) {
+    printf("p2p: skipped (no OpenCL device)\n");
+    return EXIT_SUCCESS;
+  }
+  host = (unsigned char*)malloc(NBYTES);
+  back = (unsigned char*)malloc(NBYTES);
+  if (NULL == host || NULL == back) result = EXIT_FAILURE;
+  if (EXIT_SUCCESS == result) result = libxstream_device_set_active(0);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_create(&src_stream, "p2p-src", LIBXSTREAM_STREAM_DEFAULT);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&src, NBYTES);
+  if (EXIT_SUCCESS == result && 1 < ndevices) result = libxstream_device_bind(1);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_create(&dst_stream, "p2p-dst", LIBXSTREAM_STREAM_DEFAULT);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&dst, NBYTES);
+  if (EXIT_SUCCESS == result && 1 < ndevices) result = libxstream_device_bind(-1);
+  for (pass = 0; pass < 2 && EXIT_SUCCESS == result; ++pass) {
+    for (i = 0; i < NBYTES; ++i) host[i] = (unsigned char)(pass * 7 + i * 13);
+    result = libxstream_mem_copy_h2d(host, src, NBYTES, src_stream);
+    if (EXIT_SUCCESS == result) {
+      if (0 == pass) result = libxstream_opencl_mem_copy_p2p(src, dst, NBYTES, src_stream, dst_stream, CHUNK);
+      else result = libxstream_mem_copy_p2p(src, dst, NBYTES, src_stream, dst_stream);
+    }
+    if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(dst, back, NBYTES, dst_stream);
+    if (EXIT_SUCCESS == result) result = libxstream_stream_sync(dst_stream);
+    if (EXIT_SUCCESS == result && 0 != memcmp(host, back, NBYTES)) {
+      fprintf(stderr, "ERROR: %s copy mismatch\n", 0 == pass ? "staged" : "public");
+      result = EXIT_FAILURE;
+    }
+  }
+  if (NULL != src) libxstream_mem_deallocate(src);
+  if (NULL != src_stream) libxstream_stream_destroy(src_stream);
+  if (1 < ndevices) libxstream_device_bind(1);
+  if (NULL != dst) libxstream_mem_deallocate(dst);
+  if (NULL != dst_stream) libxstream_stream_destroy(dst_stream);
+  if (1 < ndevices) libxstream_device_bind(-1);
+  libxstream_finalize();
+  free(host);
+  free(back);
+  if (EXIT_SUCCESS == result) printf("p2p: OK (%i devices)\n", LIBXS_MIN(ndevices, 2));
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("p2p: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,113 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* number of blocks, and largest block (elements) */
+#define NBLOCKS 97
+#define MAXBLOCK 45
+
+#if defined(__OPENCL)
+
+/**
+ * Blocks of varying size with gaps in between are gathered into a packed
+ * buffer and scattered back into a cleared buffer, once as doubles and once
+ * as bytes (same index), i.e., the widest and the narrowest element type. The
+ * default test build carries no OpenCL backend and skips; run "make OCL=1".
+ */
+int main(void)
+{
+  size_t index[3 * NBLOCKS], nsparse = 0, npacked = 0, i, j;
+  double *sparse = NULL, *packed = NULL, *back = NULL;
+  void *dev_sparse = NULL, *dev_packed = NULL, *dev_index = NULL;
+  int result = libxstream_init(), ndevices = 0, pass;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices) {
+    printf("pack: skipped (no OpenCL device)\n");
+    return EXIT_SUCCESS;
+  }
+  srand(25071975);
+  for (i = 0; i < NBLOCKS; ++i) {
+    const size_t size = 1 + (size_t)rand() % MAXBLOCK, gap = (size_t)rand() % 7;
+    index[3 * i + 0] = nsparse + gap;
+    index[3 * i + 1] = npacked;
+    index[3 * i + 2] = size;
+    nsparse += gap + size;
+    npacked += size;
+  }
+  sparse = (double*)malloc(sizeof(double) * nsparse);
+  back = (double*)malloc(sizeof(double) * nsparse);
+  packed = (double*)malloc(sizeof(double) * npacked);
+  if (NULL == sparse || NULL == back || NULL == packed) result = EXIT_FAILURE;
+  for (i = 0; i < nsparse && EXIT_SUCCESS == result; ++i) sparse[i] = (double)i + 0.25;
+  if (EXIT_SUCCESS == result) result = libxstream_device_set_active(0);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&dev_sparse, sizeof(double) * nsparse);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&dev_packed, sizeof(double) * npacked);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&dev_index, sizeof(index));
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(index, dev_index, sizeof(index), NULL);
+  for (pass = 0; pass < 2 && EXIT_SUCCESS == result; ++pass) {
+    const size_t typesize = (0 == pass ? sizeof(double) : 1);
+    const char* const name = (0 == pass ? "double" : "byte");
+    result = libxstream_mem_copy_h2d(sparse, dev_sparse, sizeof(double) * nsparse, NULL);
+    if (EXIT_SUCCESS == result) {
+      result = libxstream_mem_gather(dev_sparse, dev_packed, (const size_t*)dev_index, NBLOCKS, typesize, NULL);
+    }
+    if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(dev_packed, packed, typesize * npacked, NULL);
+    for (i = 0; i < NBLOCKS && EXIT_SUCCESS == result; ++i) {
+      const char* const s = (const char*)sparse + typesize * index[3 * i + 0];
+      const char* const p = (const char*)packed + typesize * index[3 * i + 1];
+      if (0 != memcmp(s, p, typesize * index[3 * i + 2])) {
+        fprintf(stderr, "ERROR: gather (%s) mismatch in block %i\n", name, (int)i);
+        result = EXIT_FAILURE;
+      }
+    }
+    if (EXIT_SUCCESS == result) result = libxstream_mem_zero(dev_sparse, 0, sizeof(double) * nsparse, NULL);
+    if (EXIT_SUCCESS == result) {
+      result = libxstream_mem_scatter(dev_packed, dev_sparse, (const size_t*)dev_index, NBLOCKS, typesize, NULL);
+    }
+    if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(dev_sparse, back, sizeof(double) * nsparse, NULL);
+    for (i = 0, j = 0; j < typesize * nsparse && EXIT_SUCCESS == result; ++j) { /* gaps remain zero */
+      const size_t lo = typesize * index[3 * i + 0], hi = lo + typesize * index[3 * i + 2];
+      const char expected = (lo <= j && j < hi) ? ((const char*)sparse)[j] : 0;
+      if (expected != ((const char*)back)[j]) {
+        fprintf(stderr, "ERROR: scatter (%s) mismatch at byte %i\n", name, (int)j);
+        result = EXIT_FAILURE;
+      }
+      if (hi <= j + 1 && i + 1 < NBLOCKS) ++i;
+    }
+  }
+  if (NULL != dev_sparse) libxstream_mem_deallocate(dev_sparse);
+  if (NULL != dev_packed) libxstream_mem_deallocate(dev_packed);
+  if (NULL != dev_index) libxstream_mem_deallocate(dev_index);
+  libxstream_finalize();
+  free(sparse);
+  free(packed);
+  free(back);
+  if (EXIT_SUCCESS == result) printf("pack: OK (%i blocks, %i of %i elements)\n", NBLOCKS, (int)npacked, (int)nsparse);
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("pack: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,132 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* number of elements */
+#define N (1 << 20)
+
+#if defined(__OPENCL)
+
+/**
+ * Host memory (shared if USM or SVM is active) is prefetched to the device
+ * around an upload and back to the host, a device buffer about to be cleared is
+ * placed without its content, and plain (malloc) memory is left alone. Content
+ * must survive every migration. Under Intel USM, host memory must be a shared
+ * allocation, and its prefetch must enqueue a migration (the stream is no
+ * longer idle) whereas one of plain memory must not. The default test build
+ * carries no OpenCL backend and skips; run "make OCL=1" to exercise this.
+ */
+int main(void)
+{
+  double *host = NULL, *back = NULL, *other = NULL;
+  libxstream_stream_t* stream = NULL;
+  libxstream_event_t* event = NULL;
+  void* dev = NULL;
+  int result = libxstream_init(), ndevices = 0, i;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices) {
+    printf("prefetch: skipped (no OpenCL device)\n");
+    return EXIT_SUCCESS;
+  }
+  back = (double*)malloc(sizeof(double) * N);
+  other = (double*)malloc(sizeof(double) * N);
+  if (NULL == back || NULL == other) result = EXIT_FAILURE;
+  if (EXIT_SUCCESS == result) result = libxstream_device_set_active(0);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_create(&stream, "prefetch", LIBXSTREAM_STREAM_DEFAULT);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_host_allocate((void**)&host, sizeof(double) * N, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&dev, sizeof(double) * N);
+  for (i = 0; i < N && EXIT_SUCCESS == result; ++i) host[i] = other[i] = 0.5 * i;
+  if (EXIT_SUCCESS == result) result = libxstream_mem_prefetch(host, sizeof(double) * N, 1 /*to_device*/, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_h2d(host, dev, sizeof(double) * N, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_prefetch(host, sizeof(double) * N, 0 /*to_device*/, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_prefetch(other, sizeof(double) * N, 1 /*to_device*/, stream);
+  if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(dev, back, sizeof(double) * N, NULL);
+  if (EXIT_SUCCESS == result && (0 != memcmp(back, other, sizeof(double) * N) || 0 != memcmp(host, other, sizeof(double) * N))) {
+    fprintf(stderr, "ERROR: content changed by migration\n");
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result && NULL != libxstream_opencl_device()->clGetMemAllocInfoINTEL &&
+      NULL != libxstream_opencl_device()->clEnqueueMigrateMemINTEL &&
+      libxstream_opencl_mem_hst_shared_intel == libxstream_opencl_config.mem_hst)
+  {
+    const libxstream_opencl_device_t* const devinfo = libxstream_opencl_device();
+    cl_uint kind = 0;
+    result = devinfo->clGetMemAllocInfoINTEL(devinfo->context, host, 0x419A /*CL_MEM_ALLOC_TYPE_INTEL*/, sizeof(kind), &kind, NULL);
+    if (EXIT_SUCCESS == result && 0x4199 /*CL_MEM_TYPE_SHARED_INTEL*/ != kind) {
+      fprintf(stderr, "ERROR: host memory is not a shared allocation (0x%X)\n", kind);
+      result = EXIT_FAILURE;
+    }
+    if (EXIT_SUCCESS == result && 0 != libxstream_opencl_config.elide) { /* idle stream: record without marker */
+      result = libxstream_event_create(&event);
+      if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+      if (EXIT_SUCCESS == result) result = libxstream_mem_prefetch(other, sizeof(double) * N, 1 /*to_device*/, stream);
+      if (EXIT_SUCCESS == result) result = libxstream_event_record(event, stream);
+      if (EXIT_SUCCESS == result && NULL != event->cl_evt) {
+        fprintf(stderr, "ERROR: plain memory migrated\n");
+        result = EXIT_FAILURE;
+      }
+      if (EXIT_SUCCESS == result) result = libxstream_mem_prefetch(host, sizeof(double) * N, 1 /*to_device*/, stream);
+      if (EXIT_SUCCESS == result) result = libxstream_event_record(event, stream);
+      if (EXIT_SUCCESS == result && NULL == event->cl_evt) {
+        fprintf(stderr, "ERROR: shared allocation not migrated\n");
+        result = EXIT_FAILURE;
+      }
+      if (EXIT_SUCCESS == result) result = libxstream_stream_sync(stream);
+      if (EXIT_SUCCESS == result && 0 != memcmp(host, other, sizeof(double) * N)) {
+        fprintf(stderr, "ERROR: content changed by migration\n");
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+  if (EXIT_SUCCESS == result) { /* content is about to be overwritten */
+    result = libxstream_mem_advise(dev, sizeof(double) * N, LIBXSTREAM_MEM_ADVISE_DEVICE | LIBXSTREAM_MEM_ADVISE_DISCARD, NULL);
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_mem_zero(dev, 0, sizeof(double) * N, NULL);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(dev, back, sizeof(double) * N, NULL);
+  for (i = 0; i < N && EXIT_SUCCESS == result; ++i) {
+    if (0 != back[i]) {
+      fprintf(stderr, "ERROR: buffer not cleared at %i\n", i);
+      result = EXIT_FAILURE;
+    }
+  }
+  if (EXIT_SUCCESS == result && EXIT_SUCCESS == libxstream_mem_advise(host, sizeof(double), LIBXSTREAM_MEM_ADVISE_DISCARD, NULL)) {
+    fprintf(stderr, "ERROR: advice without a location accepted\n");
+    result = EXIT_FAILURE;
+  }
+  if (NULL != event) libxstream_event_destroy(event);
+  if (NULL != dev) libxstream_mem_deallocate(dev);
+  if (NULL != host) libxstream_mem_host_deallocate(host, stream);
+  if (NULL != stream) libxstream_stream_destroy(stream);
+  libxstream_finalize();
+  free(back);
+  free(other);
+  if (EXIT_SUCCESS == result) printf("prefetch: OK\n");
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("prefetch: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,89 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__OPENCL)
+
+/**
+ * CPU-lists (Cpus_allowed_list, sysfs) are parsed into a bitmap with CPUs
+ * beyond the bitmap ignored, and the launcher's variables yield the local rank
+ * and the number of local ranks in the order of precedence. A global rank
+ * (PMI_RANK) is no local rank. No device is needed. The default test build
+ * carries no OpenCL backend and skips; run "make OCL=1" to exercise this.
+ */
+int main(void)
+{
+  /* cleared (empty) rather than unset: a launcher may have set them */
+  static char clear[][32] = {"MPI_LOCALRANKID=", "OMPI_COMM_WORLD_LOCAL_RANK=", "PALS_LOCAL_RANKID=", "PMI_LOCAL_RANK=",
+    "SLURM_LOCALID="};
+  static char pmi_rank[] = "PMI_RANK=5";
+  static char slurm_rank[] = "SLURM_LOCALID=1", slurm_size[] = "SLURM_TASKS_PER_NODE=4(x2),3";
+  static char mpi_rank[] = "MPI_LOCALRANKID=3", mpi_size[] = "MPI_LOCALNRANKS=2";
+  unsigned char bitmap[8];
+  int result = EXIT_SUCCESS, nlocal = -1, lrank, i;
+  /* CPU-lists */
+  if (7 != libxstream_opencl_cpulist("0-3,8,10-11\n", bitmap, 64) || 0x0F != bitmap[0] || 0x0D != bitmap[1]) {
+    fprintf(stderr, "ERROR: CPU-list with ranges\n");
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result && (2 != libxstream_opencl_cpulist("62-65", bitmap, 64) || 0xC0 != bitmap[7])) {
+    fprintf(stderr, "ERROR: CPU-list beyond the bitmap\n");
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result && (0 != libxstream_opencl_cpulist("", bitmap, 64) || 0 != bitmap[0])) {
+    fprintf(stderr, "ERROR: empty CPU-list\n");
+    result = EXIT_FAILURE;
+  }
+  /* launcher variables */
+  for (i = 0; i < (int)(sizeof(clear) / sizeof(*clear)) && EXIT_SUCCESS == result; ++i) {
+    if (0 != LIBXS_PUTENV(clear[i])) result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result && 0 == LIBXS_PUTENV(pmi_rank)) {
+    lrank = libxstream_opencl_local_rank(&nlocal);
+    if (0 <= lrank || 0 != nlocal) {
+      fprintf(stderr, "ERROR: PMI_RANK taken as local rank %i of %i\n", lrank, nlocal);
+      result = EXIT_FAILURE;
+    }
+  }
+  if (EXIT_SUCCESS == result && 0 == LIBXS_PUTENV(slurm_rank) && 0 == LIBXS_PUTENV(slurm_size)) {
+    lrank = libxstream_opencl_local_rank(&nlocal);
+    if (1 != lrank || 4 != nlocal) {
+      fprintf(stderr, "ERROR: SLURM rank %i of %i\n", lrank, nlocal);
+      result = EXIT_FAILURE;
+    }
+  }
+  if (EXIT_SUCCESS == result && 0 == LIBXS_PUTENV(mpi_rank) && 0 == LIBXS_PUTENV(mpi_size)) {
+    lrank = libxstream_opencl_local_rank(&nlocal); /* precedes SLURM, and the size covers the rank */
+    if (3 != lrank || 4 != nlocal) {
+      fprintf(stderr, "ERROR: MPI rank %i of %i\n", lrank, nlocal);
+      result = EXIT_FAILURE;
+    }
+  }
+  if (EXIT_SUCCESS == result) printf("rankmap: OK\n");
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("rankmap: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,117 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+/* unit of allocation, and the budget in such units */
+#define UNIT ((size_t)4 << 20)
+#define BUDGET 4
+
+#if defined(__OPENCL)
+
+/** Memory a subsystem keeps but can give up (cache). */
+typedef struct held_t {
+  void* mem[2];
+  int ncalls;
+} held_t;
+
+
+static size_t held_reclaim(size_t nbytes, void* arg)
+{
+  held_t* const held = (held_t*)arg;
+  size_t result = 0;
+  int i = 0;
+  for (; i < 2 && result < nbytes; ++i) {
+    if (NULL != held->mem[i]) {
+      libxstream_mem_deallocate(held->mem[i]);
+      held->mem[i] = NULL;
+      result += UNIT;
+    }
+  }
+  ++held->ncalls;
+  return result;
+}
+
+
+/**
+ * Under a budget of four units with three held by reclaimers (priority 0: one
+ * unit, priority 1: two), an allocation of two units is admitted by reclaiming
+ * the cheaper one only, the next by the other, and a further one is denied
+ * since nothing is left. The budget is set directly (LIBXSTREAM_MEMBUDGET at
+ * init). The default test build carries no OpenCL backend and skips; run
+ * "make OCL=1" to exercise this.
+ */
+int main(void)
+{
+  held_t cheap = {{NULL, NULL}, 0}, dear = {{NULL, NULL}, 0};
+  void *a = NULL, *b = NULL, *c = NULL;
+  int result = libxstream_init(), ndevices = 0;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices) {
+    printf("reclaim: skipped (no OpenCL device)\n");
+    return EXIT_SUCCESS;
+  }
+  result = libxstream_device_set_active(0);
+  libxstream_opencl_config.memtag = 1; /* budget relies on accounting */
+  libxstream_opencl_config.mem_budget = BUDGET * UNIT + libxstream_opencl_config.mem_live;
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(cheap.mem + 0, UNIT);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(dear.mem + 0, UNIT);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(dear.mem + 1, UNIT);
+  /* registered in reverse order of priority */
+  if (EXIT_SUCCESS == result) result = libxstream_mem_reclaim_register(held_reclaim, &dear, 1);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_reclaim_register(held_reclaim, &cheap, 0);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&a, 2 * UNIT);
+  if (EXIT_SUCCESS == result && (NULL != cheap.mem[0] || 1 != cheap.ncalls || 0 != dear.ncalls)) {
+    fprintf(stderr, "ERROR: reclaimed out of priority order\n");
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&b, 2 * UNIT);
+  if (EXIT_SUCCESS == result && (NULL != dear.mem[0] || NULL != dear.mem[1] || 1 != dear.ncalls)) {
+    fprintf(stderr, "ERROR: second reclaimer not asked\n");
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS == result && EXIT_SUCCESS == libxstream_mem_allocate(&c, UNIT)) {
+    fprintf(stderr, "ERROR: allocation beyond the budget admitted\n");
+    result = EXIT_FAILURE;
+  }
+  if (EXIT_SUCCESS != libxstream_mem_reclaim_unregister(held_reclaim, &cheap) ||
+      EXIT_SUCCESS != libxstream_mem_reclaim_unregister(held_reclaim, &dear) ||
+      EXIT_SUCCESS == libxstream_mem_reclaim_unregister(held_reclaim, &dear))
+  {
+    fprintf(stderr, "ERROR: unregistering failed\n");
+    result = EXIT_FAILURE;
+  }
+  libxstream_mem_deallocate(c);
+  libxstream_mem_deallocate(b);
+  libxstream_mem_deallocate(a);
+  held_reclaim((size_t)-1, &cheap);
+  held_reclaim((size_t)-1, &dear);
+  libxstream_opencl_config.mem_budget = 0;
+  libxstream_finalize();
+  if (EXIT_SUCCESS == result) printf("reclaim: OK\n");
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("reclaim: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,105 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* host array (bytes per row, rows, slices) */
+#define NX 37
+#define NY 11
+#define NZ 5
+
+#if defined(__OPENCL)
+
+/**
+ * A subarray of the host array is uploaded packed, copied on the device into
+ * a padded layout, and downloaded into the same place of a cleared host array.
+ * Buffers take the Rect-commands, whereas USM/SVM splits into row copies, i.e.,
+ * both paths are covered depending on the device. The default test build
+ * carries no OpenCL backend and skips; run "make OCL=1" to exercise this.
+ */
+int main(void)
+{
+  const size_t origin[] = { 3, 2, 1 }, zero[] = { 0, 0, 0 }, region[] = { 29, 7, 3 };
+  const size_t pitch = region[0] + 5, slice = pitch * (region[1] + 2); /* padded device layout */
+  unsigned char host[NZ][NY][NX], back[NZ][NY][NX], packed[3][7][29];
+  void *dev = NULL, *pad = NULL;
+  int result = libxstream_init(), ndevices = 0, x, y, z;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices) {
+    printf("rect: skipped (no OpenCL device)\n");
+    return EXIT_SUCCESS;
+  }
+  for (z = 0; z < NZ; ++z) {
+    for (y = 0; y < NY; ++y) {
+      for (x = 0; x < NX; ++x) host[z][y][x] = (unsigned char)(z * 71 + y * 13 + x);
+    }
+  }
+  memset(back, 0, sizeof(back));
+  result = libxstream_device_set_active(0);
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&dev, sizeof(packed));
+  if (EXIT_SUCCESS == result) result = libxstream_mem_allocate(&pad, slice * region[2]);
+  if (EXIT_SUCCESS == result) { /* packed upload of the subarray */
+    result = libxstream_mem_copy_h2d_rect(host, dev, origin, zero, region, NX, NX * NY, 0, 0, NULL);
+  }
+  if (EXIT_SUCCESS == result) result = libxstream_mem_copy_d2h(dev, packed, sizeof(packed), NULL);
+  for (z = 0; z < (int)region[2] && EXIT_SUCCESS == result; ++z) {
+    for (y = 0; y < (int)region[1] && EXIT_SUCCESS == result; ++y) {
+      for (x = 0; x < (int)region[0]; ++x) {
+        if (host[z + origin[2]][y + origin[1]][x + origin[0]] != packed[z][y][x]) {
+          fprintf(stderr, "ERROR: h2d_rect mismatch at (%i,%i,%i)\n", x, y, z);
+          result = EXIT_FAILURE;
+          break;
+        }
+      }
+    }
+  }
+  if (EXIT_SUCCESS == result) { /* packed -> padded on the device */
+    result = libxstream_mem_copy_d2d_rect(dev, pad, zero, zero, region, 0, 0, pitch, slice, NULL);
+  }
+  if (EXIT_SUCCESS == result) { /* padded -> same place in the host array */
+    result = libxstream_mem_copy_d2h_rect(pad, back, zero, origin, region, pitch, slice, NX, NX * NY, NULL);
+  }
+  for (z = 0; z < NZ && EXIT_SUCCESS == result; ++z) {
+    for (y = 0; y < NY && EXIT_SUCCESS == result; ++y) {
+      for (x = 0; x < NX; ++x) {
+        const int inside = (origin[0] <= (size_t)x && (size_t)x < origin[0] + region[0] && origin[1] <= (size_t)y &&
+                            (size_t)y < origin[1] + region[1] && origin[2] <= (size_t)z && (size_t)z < origin[2] + region[2]);
+        if ((0 != inside ? host[z][y][x] : 0) != back[z][y][x]) {
+          fprintf(stderr, "ERROR: d2d_rect/d2h_rect mismatch at (%i,%i,%i)\n", x, y, z);
+          result = EXIT_FAILURE;
+          break;
+        }
+      }
+    }
+  }
+  if (NULL != dev) libxstream_mem_deallocate(dev);
+  if (NULL != pad) libxstream_mem_deallocate(pad);
+  libxstream_finalize();
+  if (EXIT_SUCCESS == result) printf("rect: OK\n");
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("rect: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
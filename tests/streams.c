@@ -0,0 +1,119 @@
+/******************************************************************************
+* Copyright (c) 2009-2026 Hans Pabst                                          *
+* Copyright (c) 2009-2026 Intel Corporation                                   *
+* This file is part of the LIBXSTREAM library.                                *
+*                                                                             *
+* For information on the license, see the LICENSE file.                       *
+* Further information: https://github.com/hfp/libxstream/                     *
+* SPDX-License-Identifier: BSD-3-Clause                                       *
+******************************************************************************/
+#if defined(__OPENCL)
+# if defined(LIBXSTREAM_SOURCE)
+#   include <libxstream/libxstream_source.h>
+# else
+#   include <libxstream/libxstream_opencl.h>
+# endif
+#endif
+#if defined(_OPENMP)
+# include <omp.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+/* lookups per thread and measurement */
+#if !defined(NLOOKUPS)
+# define NLOOKUPS 100000
+#endif
+/* streams created per thread (more than one is what the registry scan pays for) */
+#if !defined(NSTREAMS)
+# define NSTREAMS 4
+#endif
+
+#if defined(__OPENCL)
+
+/**
+ * The default stream (NULL stream) must be what the registry scan determines,
+ * before and after streams are created and destroyed (epoch). The cached lookup
+ * is timed against the scan under lock_stream, i.e., the previous NULL-stream
+ * path, with all threads looking up concurrently. The default test build carries
+ * no OpenCL backend and skips; run "make OCL=1" to exercise this.
+ */
+int main(void)
+{
+  double t_cached = 0, t_scan = 0;
+  int result = libxstream_init(), ndevices = 0, nthreads = 1, nerrors = 0;
+  if (EXIT_SUCCESS == result) result = libxstream_device_count(&ndevices);
+  if (EXIT_SUCCESS != result || 0 >= ndevices) {
+    printf("streams: skipped (no OpenCL device)\n");
+    return EXIT_SUCCESS;
+  }
+  result = libxstream_device_set_active(0);
+#if defined(_OPENMP)
+# pragma omp parallel reduction(+ : t_cached, t_scan, nerrors)
+#endif
+  {
+    libxstream_stream_t* stream[NSTREAMS] = { NULL };
+    const libxstream_opencl_stream_t *deflt, *scan;
+    libxs_timer_tick_t t0;
+    int i, ok = EXIT_SUCCESS;
+#if defined(_OPENMP)
+#   pragma omp single
+    nthreads = omp_get_num_threads();
+#endif
+    deflt = libxstream_opencl_stream_default(); /* nothing created: fallback */
+    scan = libxstream_opencl_stream(libxstream_opencl_config.lock_stream, libxs_tid());
+    if (deflt != scan) ++nerrors;
+    for (i = 0; i < NSTREAMS && EXIT_SUCCESS == ok; ++i) {
+      ok = libxstream_stream_create(stream + i, "streams", LIBXSTREAM_STREAM_DEFAULT);
+    }
+#if defined(_OPENMP)
+#   pragma omp barrier
+#endif
+    t0 = libxs_timer_tick();
+    for (i = 0; i < NLOOKUPS; ++i) deflt = libxstream_opencl_stream_default();
+    t_cached += libxs_timer_duration(t0, libxs_timer_tick());
+#if defined(_OPENMP)
+#   pragma omp barrier
+#endif
+    t0 = libxs_timer_tick();
+    for (i = 0; i < NLOOKUPS; ++i) scan = libxstream_opencl_stream(libxstream_opencl_config.lock_stream, libxs_tid());
+    t_scan += libxs_timer_duration(t0, libxs_timer_tick());
+    if (EXIT_SUCCESS != ok || deflt != scan) ++nerrors;
+    if (EXIT_SUCCESS != libxstream_device_sync()) ++nerrors; /* per-thread stream list */
+#if defined(_OPENMP)
+#   pragma omp barrier
+#endif
+    for (i = 0; i < NSTREAMS; ++i) { /* destroyed streams must not be returned */
+      if (NULL != stream[i] && EXIT_SUCCESS != libxstream_stream_destroy(stream[i])) ++nerrors;
+    }
+#if defined(_OPENMP)
+#   pragma omp barrier
+#endif
+    deflt = libxstream_opencl_stream_default();
+    scan = libxstream_opencl_stream(libxstream_opencl_config.lock_stream, libxs_tid());
+    for (i = 0; i < NSTREAMS; ++i) {
+      if (deflt == (const libxstream_opencl_stream_t*)stream[i]) ++nerrors;
+    }
+    if (deflt != scan) ++nerrors;
+  }
+  if (EXIT_SUCCESS == result && 0 != nerrors) {
+    fprintf(stderr, "ERROR: default stream differs from the registry (%i errors)\n", nerrors);
+    result = EXIT_FAILURE;
+  }
+  libxstream_finalize();
+  if (EXIT_SUCCESS == result) {
+    printf("streams: OK (%i threads, %.1f ns cached vs. %.1f ns scan per NULL-stream lookup)\n", nthreads,
+      1E9 * t_cached / ((double)nthreads * NLOOKUPS), 1E9 * t_scan / ((double)nthreads * NLOOKUPS));
+  }
+  return result;
+}
+
+#else
+
+int main(void)
+{
+  printf("streams: skipped (OpenCL backend not compiled in)\n");
+  return EXIT_SUCCESS;
+}
+
+#endif